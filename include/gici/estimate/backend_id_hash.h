@@ -0,0 +1,33 @@
+/**
+* @Function: Hash of backend IDs
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+
+namespace gici {
+
+class BackendId;
+
+// Hash of IDs. The low bits of IDs are mostly zero or the type, and std::hash 
+// of an integer is the identity, so we mix the bits (splitmix64 finalizer) for 
+// hash tables with power-of-two buckets. It is kept apart from BackendId so that 
+// the graph can use it without depending on the estimator types.
+struct BackendIdHash {
+  inline size_t operator()(uint64_t id) const {
+    id = (id ^ (id >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    id = (id ^ (id >> 27)) * 0x94D049BB133111EBULL;
+    return static_cast<size_t>(id ^ (id >> 31));
+  }
+
+  // defined in estimator_types.h
+  inline size_t operator()(const BackendId& id) const;
+};
+
+}
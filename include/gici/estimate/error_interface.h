@@ -60,6 +60,7 @@ enum class ErrorType: uint8_t
   kPseudorangeError,
   kPseudorangeErrorSD, 
   kPseudorangeErrorDD,
+  kPseudorangeErrorBatch,
   kPhaserangeError, 
   kPhaserangeErrorSD,
   kPhaserangeErrorDD,
@@ -62,6 +62,9 @@ public:
   // Get tag
   std::string getTag() { return tag_; }
 
+  // Get the rate to combine raw IMU samples into, 0 for disabled
+  double getImuPresummationRate() { return imu_presummation_rate_; }
+
   // Process funtion in every loop
   virtual void process() = 0;
 
@@ -100,6 +103,8 @@ protected:
   // Output downsampling
   int output_downsample_rate_;
   int output_downsample_cnt_;
+  // Combine raw IMU samples into coning and sculling compensated ones at this rate
+  double imu_presummation_rate_ = 0.0;
   // Pending output timestamps
   std::deque<double> output_timestamps_;
 
@@ -14,6 +14,7 @@
 #include "gici/estimate/estimator_types.h"
 #include "gici/estimate/ceres_iteration_callback.h"
 #include "gici/estimate/marginalization_error.h"
+#include "gici/estimate/object_pool.h"
 #include "gici/utility/common.h"
 
 namespace gici {
@@ -38,6 +39,32 @@ struct EstimatorBaseOptions {
   // Ceres trust region strategy type 信任域策略：决定在优化过程中如何调整步长并控制迭代的方法。
   ceres::TrustRegionStrategyType trust_region_strategy_type = ceres::DOGLEG;
 
+  // Keep an elimination ordering (landmarks, ambiguities, states) along with the
+  // graph and hand it to ceres, so that ceres does not compute one in every solve.
+  // This also enables fast block removal and disables the problem safety checks.
+  bool incremental_ordering = false;
+
+  // Keep the landmark part of the marginalization in 3x3 diagonal blocks and the
+  // rest in a compact dense storage that is reused across epochs. The prior is
+  // factorized from that storage by LDLT, without a full dense H.
+  bool block_sparse_marginalization = false;
+
+  // Keep the marginalization prior as a square-root factor updated by Householder
+  // QR, instead of the Hessian and its eigen-decomposition.
+  bool square_root_marginalization = false;
+
+  // Backend solver. The fixed-structure Gauss-Newton solver keeps its ordering and
+  // storages across epochs, which is faster than ceres for small GNSS windows.
+  GraphSolverType graph_solver_type = GraphSolverType::Ceres;
+
+  // Solve each epoch with both backends from the same initial point and log
+  // the timings and costs. Only for benchmarking, the estimator becomes slower.
+  bool benchmark_graph_solver = false;
+
+  // Create parameter blocks and error terms from a per-estimator object pool, 
+  // which recycles the storages of marginalized or erased ones.
+  bool use_object_pool = false;
+
   // Verbose optimization output
   bool verbose_output = false;
 
@@ -131,6 +158,14 @@ protected:
   // Apply ceres optimization
   virtual void optimize();
 
+  // Solve current graph with both backends and log the comparison. The graph
+  // parameters are restored afterwards.
+  void benchmarkGraphSolver();
+
+  // Update the sensor specific terms that are held fixed while solving.
+  // Called before each solve.
+  virtual void updateBeforeSolve() {}
+
   // Erase old marginalization item
   bool eraseOldMarginalization();
 
@@ -188,6 +223,9 @@ protected:
   std::shared_ptr<ceres::LossFunction> cauchy_loss_function_; 
   std::shared_ptr<ceres::LossFunction> huber_loss_function_; 
 
+  // Storage pool of parameter blocks and error terms
+  ObjectPoolPtr object_pool_;
+
   // States
   std::deque<State> states_; // the state memory should be shifted every time
                              // a estimate step has been processed!
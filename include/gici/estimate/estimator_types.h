@@ -10,6 +10,8 @@
 
 #include <map>
 #include <vector>
+#include <string>
+#include <cctype>
 
 #pragma diagnostic push
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
@@ -28,6 +30,7 @@
 #include "gici/vision/image_types.h"
 #include "gici/utility/option.h"
 #include "gici/estimate/graph.h"
+#include "gici/estimate/backend_id_hash.h"
 
 namespace gici {
 
@@ -69,6 +72,8 @@ using SensorType = option_tools::SensorType;
 #define BITS_GNSS_SYSTEM 6, 13
 // bit 14-21: GNSS PRN number
 #define BITS_GNSS_PRN 14, 21
+// bit 6-21: GNSS satellite (system and PRN number)
+#define BITS_GNSS_SATELLITE 6, 21
 // bit 50-55: GNSS PhaseID
 #define BITS_GNSS_PHASEID 50, 55
 // bit 50-56: GNSS CodeID
@@ -85,49 +90,36 @@ public:
   BackendId() = default;
   explicit BackendId(uint64_t id) : id_(id) {}
 
+  // Mask of the bit field [start, end]
+  inline constexpr static uint64_t bitMask(int start, int end) {
+    return (end - start + 1) >= 64 ? ~static_cast<uint64_t>(0) : 
+      ((static_cast<uint64_t>(1) << (end - start + 1)) - 1);
+  }
+
+  // Shift of the bit field ending at given bit. Bits are counted from the 
+  // most significant bit, the same as RTKLIB getbitu/setbitu on a big-endian buffer.
+  inline constexpr static int bitShift(int end) {
+    return 63 - end;
+  }
+
   // Get bits
-  inline static uint32_t getBits(uint64_t id, int start, int end) {
-    int length = end - start + 1;
-    uint8_t buffer[8];
-    for (int i = 0; i < 8; i++) {
-      buffer[i] = (id >> (8 * (7 - i))) & 0xFF;
-    }
-    return getbitu(buffer, start, length);
+  inline constexpr static uint32_t getBits(uint64_t id, int start, int end) {
+    return static_cast<uint32_t>((id >> bitShift(end)) & bitMask(start, end));
   }
 
   // Set bits
   template<typename T> 
-  inline static uint64_t setBits(T data, int start, int end) {
-    int length = end - start + 1;
-    uint32_t bits = static_cast<uint32_t>(data);
-    uint64_t id = 0;
-    uint8_t buffer[8];
-    memset(buffer, 0, sizeof(uint8_t) * 8);
-    setbitu(buffer, start, length, bits);
-    for (int i = 0; i < 8; i++) {
-      uint64_t byte = static_cast<uint64_t>(buffer[i]) << (8 * (7 - i));
-      id += byte;
-    }
-    return id;
+  inline constexpr static uint64_t setBits(T data, int start, int end) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(data)) & 
+      bitMask(start, end)) << bitShift(end);
   }
 
   // Reset some bits
   template<typename T> 
-  inline static uint64_t resetBits(
+  inline constexpr static uint64_t resetBits(
     uint64_t id, T data, int start, int end) {
-    int length = end - start + 1;
-    uint32_t bits = static_cast<uint32_t>(data);
-    uint64_t out_id = 0;
-    uint8_t buffer[8];
-    for (int i = 0; i < 8; i++) {
-      buffer[i] = (id >> (8 * (7 - i))) & 0xFF;
-    }
-    setbitu(buffer, start, length, bits);
-    for (int i = 0; i < 8; i++) {
-      uint64_t byte = static_cast<uint64_t>(buffer[i]) << (8 * (7 - i));
-      out_id |= byte;
-    }
-    return out_id;
+    return (id & ~(bitMask(start, end) << bitShift(end))) | 
+      setBits(data, start, end);
   }
 
   // Check sensor type
@@ -186,11 +178,17 @@ public:
   }
 
   inline std::string gPrn() const {
-    char system = gSystem();
     int prn_number = gPrnNumber();
-    char prn_buf[4];
-    sprintf(prn_buf, "%c%02d", system, prn_number);
-    return std::string(prn_buf);
+    std::string prn(3, '0');
+    prn[0] = gSystem();
+    prn[1] = static_cast<char>('0' + prn_number / 10 % 10);
+    prn[2] = static_cast<char>('0' + prn_number % 10);
+    return prn;
+  }
+
+  // Integer satellite key, the system and PRN number (see gnssSatelliteKey)
+  inline uint32_t gSatellite() const {
+    return getBits(id_, BITS_GNSS_SATELLITE);
   }
 
   inline int gPhaseId() const {
@@ -209,6 +207,85 @@ private:
   uint64_t id_{0};
 };
 
+// Compile-time descriptor of a bit field
+template<int Start, int End>
+struct BackendIdField {
+  static_assert(Start >= 0 && End < 64 && End - Start < 32, "Invalid bit field");
+  static constexpr int start = Start;
+  static constexpr int end = End;
+  static constexpr int shift = 63 - End;
+  static constexpr uint64_t mask = BackendId::bitMask(Start, End) << shift;
+
+  static constexpr uint32_t get(uint64_t id) {
+    return BackendId::getBits(id, Start, End);
+  }
+  template<typename T>
+  static constexpr uint64_t set(T data) {
+    return BackendId::setBits(data, Start, End);
+  }
+  template<typename T>
+  static constexpr uint64_t reset(uint64_t id, T data) {
+    return BackendId::resetBits(id, data, Start, End);
+  }
+};
+using BackendIdTypeField = BackendIdField<BITS_IDTYPE>;
+using BackendIdBundleField = BackendIdField<BITS_BUNDLEID>;
+using BackendIdImuSubIdField = BackendIdField<BITS_IMU_SUBID>;
+using BackendIdGnssSystemField = BackendIdField<BITS_GNSS_SYSTEM>;
+using BackendIdGnssPrnField = BackendIdField<BITS_GNSS_PRN>;
+using BackendIdGnssSatelliteField = BackendIdField<BITS_GNSS_SATELLITE>;
+using BackendIdGnssPhaseIdField = BackendIdField<BITS_GNSS_PHASEID>;
+using BackendIdGnssCodeIdField = BackendIdField<BITS_GNSS_CODEID>;
+using BackendIdCameraIdxField = BackendIdField<BITS_CAMERA_IDX>;
+using BackendIdLandmarkField = BackendIdField<BITS_LANDMARKID>;
+
+// The layout is identical to the former byte-buffer implementation
+// (RTKLIB setbitu on the big-endian bytes of the id). tools/benchmark/backend_id
+// checks all the fields against it.
+static_assert(BackendIdTypeField::set(IdType::gIfb) == 0x3400000000000000ULL, 
+  "BackendId layout changed");
+static_assert(BackendIdBundleField::set(RANGE_BUNDLE_ID_MAX) == 
+  0x000000FFFFFFC000ULL, "BackendId layout changed");
+static_assert(BackendIdGnssSystemField::set('G') == 0x011C000000000000ULL, 
+  "BackendId layout changed");
+static_assert(BackendIdGnssPrnField::set(32) == 0x0000800000000000ULL, 
+  "BackendId layout changed");
+static_assert(BackendIdGnssCodeIdField::set(0x7F) == 0x0000000000003F80ULL, 
+  "BackendId layout changed");
+static_assert(BackendIdLandmarkField::set(0xFFFFFFFFu) == 0x00000000FFFFFFFFULL, 
+  "BackendId layout changed");
+static_assert(BackendIdGnssSatelliteField::get(
+  BackendIdGnssSystemField::set('C') | BackendIdGnssPrnField::set(5)) == 
+  ((static_cast<uint32_t>('C') << 8) | 5), "BackendId layout changed");
+static_assert(BackendIdGnssPrnField::reset(0xFFFFFFFFFFFFFFFFULL, 0) == 
+  0xFFFC03FFFFFFFFFFULL, "BackendId layout changed");
+
+// PRN number of a PRN string, e.g. 5 for "G05"
+inline int gnssPrnNumber(const std::string& prn)
+{
+  if (prn.size() == 3 && isdigit(prn[1]) && isdigit(prn[2])) {
+    return (prn[1] - '0') * 10 + (prn[2] - '0');
+  }
+  return atoi(prn.substr(1, 2).data());
+}
+
+// Integer satellite key, equals to BackendId::gSatellite() of the satellite
+inline constexpr uint32_t gnssSatelliteKey(char system, int prn_number)
+{
+  return (static_cast<uint32_t>(static_cast<uint8_t>(system)) << 8) | 
+         (static_cast<uint32_t>(prn_number) & 0xFF);
+}
+
+inline uint32_t gnssSatelliteKey(const std::string& prn)
+{
+  return gnssSatelliteKey(prn[0], gnssPrnNumber(prn));
+}
+
+inline size_t BackendIdHash::operator()(const BackendId& id) const
+{
+  return operator()(id.asInteger());
+}
+
 // Factories
 inline BackendId createLandmarkId(int track_id)
 {
@@ -281,7 +358,7 @@ inline BackendId createGnssAmbiguityId(std::string prn,
   CHECK_GE(bundle_id, 0);
   CHECK_GE(phase_id, 0);
   char system = prn[0];
-  int prn_number = atoi(prn.substr(1, 2).data());
+  int prn_number = gnssPrnNumber(prn);
   return BackendId(
     BackendId::setBits(BackendId::adjustBundleId(
       bundle_id, IdType::gAmbiguity), BITS_BUNDLEID) |
@@ -304,7 +381,7 @@ inline BackendId createGnssIonosphereId(std::string prn, int32_t bundle_id)
 {
   CHECK_GE(bundle_id, 0);
   char system = prn[0];
-  int prn_number = atoi(prn.substr(1, 2).data());
+  int prn_number = gnssPrnNumber(prn);
   return BackendId(
     BackendId::setBits(BackendId::adjustBundleId(
       bundle_id, IdType::gIonosphere), BITS_BUNDLEID) |
@@ -320,7 +397,7 @@ inline BackendId createGnssIfbId(char system,
   int prn_number = 0;
   if (prn != "") {
     CHECK(prn.size() == 3);
-    prn_number = atoi(prn.substr(1, 2).data());
+    prn_number = gnssPrnNumber(prn);
   }
   return BackendId(
     BackendId::setBits(0, BITS_BUNDLEID) |
@@ -369,13 +446,7 @@ inline bool sameAmbiguity(const BackendId& lhs, const BackendId& rhs)
   CHECK(BackendId::getBits(rhs.asInteger(), BITS_IDTYPE) == 
         static_cast<uint32_t>(IdType::gAmbiguity));
   
-  uint32_t sys_lhs = BackendId::getBits(lhs.asInteger(), BITS_GNSS_SYSTEM);
-  uint32_t sys_rhs = BackendId::getBits(rhs.asInteger(), BITS_GNSS_SYSTEM);
-  if (sys_lhs != sys_rhs) return false;
-
-  uint32_t prn_lhs = BackendId::getBits(lhs.asInteger(), BITS_GNSS_PRN);
-  uint32_t prn_rhs = BackendId::getBits(rhs.asInteger(), BITS_GNSS_PRN);
-  if (prn_lhs != prn_rhs) return false;
+  if (lhs.gSatellite() != rhs.gSatellite()) return false;
 
   uint32_t phase_lhs = BackendId::getBits(lhs.asInteger(), BITS_GNSS_PHASEID);
   uint32_t phase_rhs = BackendId::getBits(rhs.asInteger(), BITS_GNSS_PHASEID);
@@ -391,13 +462,7 @@ inline bool sameIonosphere(const BackendId& lhs, const BackendId& rhs)
   CHECK(BackendId::getBits(rhs.asInteger(), BITS_IDTYPE) == 
         static_cast<uint32_t>(IdType::gIonosphere));
   
-  uint32_t sys_lhs = BackendId::getBits(lhs.asInteger(), BITS_GNSS_SYSTEM);
-  uint32_t sys_rhs = BackendId::getBits(rhs.asInteger(), BITS_GNSS_SYSTEM);
-  if (sys_lhs != sys_rhs) return false;
-
-  uint32_t prn_lhs = BackendId::getBits(lhs.asInteger(), BITS_GNSS_PRN);
-  uint32_t prn_rhs = BackendId::getBits(rhs.asInteger(), BITS_GNSS_PRN);
-  if (prn_lhs != prn_rhs) return false;
+  if (lhs.gSatellite() != rhs.gSatellite()) return false;
 
   return true;
 }
@@ -538,6 +603,11 @@ public:
     imu(std::make_shared<ImuMeasurement>(data)),
     imu_role(role), tag(tag), timestamp(data.timestamp) {}
 
+  EstimatorDataCluster(const ImuMeasurementBatchPtr& data, 
+                       const ImuRole& role, const std::string& tag) :
+    imu_batch(data),
+    imu_role(role), tag(tag), timestamp(data->back().timestamp) {}
+
   EstimatorDataCluster(const std::shared_ptr<cv::Mat>& data, const CameraRole& role, 
                        const std::string& tag, const double time) :
     image(data),
@@ -558,6 +628,7 @@ public:
   // Raw data
   std::shared_ptr<GnssMeasurement> gnss;
   std::shared_ptr<ImuMeasurement> imu;
+  ImuMeasurementBatchPtr imu_batch;
   std::shared_ptr<cv::Mat> image;
 
   // Intermediate processing data, which generated from other estimators
@@ -51,7 +51,9 @@
 #include <ceres/ceres.h>
 #pragma diagnostic pop
 
+#include "gici/estimate/backend_id_hash.h"
 #include "gici/estimate/error_interface.h"
+#include "gici/estimate/graph_solver.h"
 #include "gici/estimate/homogeneous_point_local_parameterization.h"
 #include "gici/estimate/parameter_block.h"
 #include "gici/estimate/pose_local_parameterization.h"
@@ -68,7 +70,9 @@ class Graph
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   /// @brief Constructor.
-  Graph();
+  /// @param[in] incremental_ordering Keep an elimination ordering for ceres
+  ///            that is updated along with the blocks, and enable fast removal.
+  Graph(const bool incremental_ordering = false);
 
   // definitions
   /// @brief Struct to store some infos about a residual.
@@ -146,7 +150,8 @@ public:
    * @param parameter_block    Parameter block to insert.
    * @param parameterization  Parameterization to tell how to do the local
    *                          parameterisation.
-   * @param group             Schur elimination group -- currently unused.
+   * @param group             Schur elimination group. Only used with incremental
+   *                          ordering, -1 for the default group of the block type.
    * @return True if successful.
    */
   bool addParameterBlock(
@@ -353,6 +358,32 @@ public:
   ParameterBlockCollection parameters(
       ceres::ResidualBlockId residual_block_id) const;  // get the parameter blocks connected
 
+  /// @brief Get the number of residual blocks connected to a parameter block
+  ///        without building the collection.
+  size_t numResiduals(uint64_t parameter_block_id) const
+  {
+    return id_to_residual_block_multimap_.count(parameter_block_id);
+  }
+
+  /// @brief Visit the residual blocks of a parameter block without copying them.
+  /// @warning The graph must not be modified inside the visitor.
+  /// @param[in] parameter_block_id The ID of the parameter block in question.
+  /// @param[in] visitor Callable as visitor(const ResidualBlockSpec&).
+  template<typename Visitor>
+  void forEachResidual(uint64_t parameter_block_id, Visitor&& visitor) const
+  {
+    auto range = id_to_residual_block_multimap_.equal_range(parameter_block_id);
+    for (auto it = range.first; it != range.second; ++it) {
+      visitor(it->second);
+    }
+  }
+
+  /// @brief Get the parameters of a residual block without copying them.
+  /// @param[in] residual_block_id The ID of the residual block in question.
+  /// @return Reference to the stored collection (empty if not found).
+  const ParameterBlockCollection& parameterCollection(
+      ceres::ResidualBlockId residual_block_id) const;
+
   // Get all the residual blocks
   ResidualBlockCollection residuals() const;
 
@@ -378,7 +409,7 @@ public:
   // access to the map as such
   /// \brief The actual map from Id to parameter block pointer.
   typedef std::unordered_map<uint64_t,
-      std::shared_ptr<ParameterBlock> > IdToParameterBlockMap;
+      std::shared_ptr<ParameterBlock>, BackendIdHash> IdToParameterBlockMap;
 
   /// \brief The actual map from Id to residual block specs.
   typedef std::unordered_map<ceres::ResidualBlockId, ResidualBlockSpec>
@@ -403,11 +434,19 @@ public:
   /// \brief Ceres optimization summary
   ceres::Solver::Summary summary;
 
+  /// \brief Backend solver type
+  GraphSolverType solver_type = GraphSolverType::Ceres;
+
+  /// \brief Options of the fixed-structure solver (used for GraphSolverType::GaussNewton)
+  GraphSolverOptions solver_options;
+
   /// @brief Solve the optimization problem.
-  void solve()
-  {
-    Solve(options, problem_.get(), &summary);
-  }
+  void solve();
+
+  /// @brief Counter that changes whenever blocks are added, removed or
+  ///        switched between constant and variable. Solvers use it to detect
+  ///        structure changes, and then check what actually changed.
+  uint64_t structureVersion() const { return structure_version_; }
 
   // Get covariance estimation of given parameter blocks
   // Enabling dense_svd can make this function handle rank deficient problem, 
@@ -419,11 +458,37 @@ public:
   // Evaluate all residual blocks and get total cost
   double computeTotalCost(bool apply_loss_function = true);
 
+  /// @brief Get the maintained elimination ordering (nullptr if not enabled).
+  std::shared_ptr<const ceres::ParameterBlockOrdering> linearSolverOrdering() const
+  {
+    return linear_solver_ordering_;
+  }
+
+protected:
+  /// @brief Check if the linear solver is a Schur type.
+  static bool isSchurType(const ceres::LinearSolverType type);
+
+  /// @brief Check if the first group of the maintained ordering is an independent
+  ///        set, which is required by the Schur type solvers. The result is
+  ///        re-computed only when the graph structure changes.
+  bool linearSolverOrderingUsableForSchur();
+
 public:
 
   /// \brief count the inserted residual blocks.
   uint64_t residual_counter_;
 
+  /// \brief Version of the graph structure.
+  uint64_t structure_version_;
+
+  /// \brief The fixed-structure solver (created on first use).
+  std::unique_ptr<GraphSolver> graph_solver_;
+
+  /// \brief Elimination ordering maintained along with the blocks.
+  std::shared_ptr<ceres::ParameterBlockOrdering> linear_solver_ordering_;
+  uint64_t ordering_check_version_;
+  bool ordering_usable_for_schur_;
+
   // member variables related to optimization
   /// \brief The ceres problem
   std::shared_ptr<ceres::Problem> problem_;
@@ -431,7 +496,7 @@ public:
   // the actual maps
   /// \brief Go from Id to residual block pointer.
   typedef std::unordered_multimap<uint64_t,
-  ResidualBlockSpec> IdToResidualBlockMultimap;
+  ResidualBlockSpec, BackendIdHash> IdToResidualBlockMultimap;
 
   /// \brief Go from residual block id to its parameter blocks.
   typedef std::unordered_map<ceres::ResidualBlockId,
@@ -0,0 +1,194 @@
+/**
+* @Function: Fixed-structure sliding-window solver for the graph
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+#pragma diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+// Eigen 3.2.7 uses std::binder1st and std::binder2nd which are deprecated since c++11
+// Fix is in 3.3 devel (http://eigen.tuxfamily.org/bz/show_bug.cgi?id=872).
+#include <ceres/ceres.h>
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+#pragma diagnostic pop
+
+#include "gici/estimate/backend_id_hash.h"
+#include "gici/estimate/error_interface.h"
+#include "gici/estimate/parameter_block.h"
+
+namespace gici {
+
+class Graph;
+
+// Backend solver types of the graph
+enum class GraphSolverType {
+  Ceres,        // Ceres solver, which rebuilds its program at every solve
+  GaussNewton   // Dense Gauss-Newton/Levenberg-Marquardt on persistent storage
+};
+
+// Options for the fixed-structure solver
+struct GraphSolverOptions {
+  // Max iteration number
+  int max_iteration = 10;
+
+  // Maximum time in second for which the solver should run for
+  double max_solver_time = 0.05;
+
+  // Initial Levenberg-Marquardt damping
+  double initial_lambda = 1.0e-4;
+
+  // Bounds of the damping
+  double min_lambda = 1.0e-12;
+  double max_lambda = 1.0e16;
+
+  // Minimum ratio of actual to predicted cost decrease to accept a step
+  double min_relative_decrease = 1.0e-3;
+
+  // Convergence tolerances (same meanings as in ceres)
+  double function_tolerance = 1.0e-6;
+  double gradient_tolerance = 1.0e-10;
+  double parameter_tolerance = 1.0e-8;
+};
+
+// Solver that assembles the normal equations block-wise from the error terms
+// connected in graph and solves them with LDLT. The ordering, the Hessian and
+// all the Jacobian workspaces are kept across solves. When the graph changes,
+// the book-keeping is updated incrementally: a new block takes the slot in the
+// normal equations that a removed block of the same size left, so that the
+// layout of a sliding window is kept across epochs. The ordering is only
+// re-built when the block layout actually changes, i.e. when the slots of the
+// removed blocks can not be filled by the new ones.
+class GraphSolver {
+public:
+  GraphSolver(Graph& graph);
+  ~GraphSolver() = default;
+
+  // Solve the graph. The summary is filled in the ceres format so that the
+  // estimators can handle both backends in the same way.
+  void solve(const GraphSolverOptions& options, ceres::Solver::Summary* summary);
+
+  // Current size of the system in minimal dimension
+  size_t numEffectiveParameters() const { return num_minimal_; }
+
+  // Number of ordering re-builds, for statistics
+  size_t numLayoutRebuilds() const { return num_layout_rebuilds_; }
+
+protected:
+  // Book-keeping for parameter blocks
+  struct ParameterBlockEntry {
+    uint64_t id;
+    ParameterBlock* block;  // nullptr for free entries
+    size_t dimension;
+    size_t minimal_dimension;
+    int ordering_idx;   // -1 for constant blocks and free entries
+    size_t backup_idx;  // index in backup storage
+    bool seen;          // book-keeping for updateStructure()
+  };
+
+  // Book-keeping for residual blocks
+  struct ResidualBlockEntry {
+    ceres::ResidualBlockId id;
+    ErrorInterface* error;  // nullptr for free entries
+    ceres::LossFunction* loss_function;
+    size_t residual_dimension;
+    std::vector<size_t> parameter_entries;
+    bool seen;              // book-keeping for updateStructure()
+  };
+
+  // A slot in the normal equations left by a removed variable block
+  struct Slot {
+    size_t dimension;
+    size_t minimal_dimension;
+    int ordering_idx;
+    size_t backup_idx;
+  };
+
+  // Update the book-keeping if the graph structure changed
+  void updateStructure();
+
+  // Update the parameter block entries, returns false if the removed blocks left
+  // slots that could not be filled, or the new blocks did not fit in them
+  bool updateParameterEntries();
+
+  // Update the residual block entries and the workspaces
+  void updateResidualEntries();
+
+  // Release a parameter block entry and keep its slot for new blocks
+  void releaseParameterEntry(const size_t index);
+
+  // Assign contiguous ordering to all variable blocks
+  void rebuildOrdering();
+
+  // Check if a residual entry still connects the given parameter blocks
+  bool residualEntryMatches(const ResidualBlockEntry& entry,
+    const std::vector<std::pair<uint64_t, std::shared_ptr<ParameterBlock>>>&
+    parameters) const;
+
+  // Evaluate total cost, and assemble the normal equations if required
+  double evaluate(bool linearize);
+
+  // Apply loss function correction to residual and minimal Jacobians (as in
+  // ceres/internal/ceres/corrector.cc), returns the robustified cost.
+  double correctResidualAndJacobians(const ceres::LossFunction* loss_function,
+                                     ResidualBlockEntry& residual_entry,
+                                     double* residuals, bool linearize);
+
+  // Parameter backup handles
+  void backupParameters();
+  void restoreParameters();
+
+  // Apply dx to the backuped parameters
+  void applyStep(const Eigen::VectorXd& dx);
+
+  // Make sure the dense storages can hold a system of given size
+  void reserve(size_t size);
+
+protected:
+  Graph* graph_;
+
+  // Ordering
+  uint64_t structure_version_;
+  std::vector<ParameterBlockEntry> parameter_entries_;
+  std::vector<ResidualBlockEntry> residual_entries_;
+  std::unordered_map<uint64_t, size_t, BackendIdHash> id_to_parameter_entry_;
+  std::unordered_map<ceres::ResidualBlockId, size_t> id_to_residual_entry_;
+  std::vector<size_t> free_parameter_entries_;
+  std::vector<size_t> free_residual_entries_;
+  std::vector<Slot> free_slots_;
+  std::vector<size_t> new_parameter_entries_;
+  size_t num_parameter_blocks_;
+  size_t num_residual_blocks_;
+  size_t num_minimal_;
+  size_t num_backup_;
+  size_t num_residuals_;
+  size_t num_layout_rebuilds_;
+
+  // Normal equations (H * dx = b). The storages are only grown, the top left
+  // corners are used as the active system.
+  size_t capacity_;
+  Eigen::MatrixXd H_;
+  Eigen::VectorXd b_;
+  Eigen::VectorXd dx_;
+  Eigen::VectorXd diagonal_;
+  Eigen::LDLT<Eigen::MatrixXd, Eigen::Upper> ldlt_;
+
+  // Workspaces
+  std::vector<double> parameter_backup_;
+  std::vector<double> residual_workspace_;
+  std::vector<double> jacobian_workspace_;
+  std::vector<double> jacobian_minimal_workspace_;
+  std::vector<const double*> parameter_ptrs_;
+  std::vector<double*> jacobian_ptrs_;
+  std::vector<double*> jacobian_minimal_ptrs_;
+};
+
+}  // namespace gici
@@ -41,6 +41,7 @@
 #pragma once
 
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 #pragma diagnostic push
@@ -49,6 +50,7 @@
 // Fix is in 3.3 devel (http://eigen.tuxfamily.org/bz/show_bug.cgi?id=872).
 #include <ceres/ceres.h>
 #include <Eigen/Core>
+#include <Eigen/QR>
 #pragma diagnostic pop
 
 #include "gici/estimate/error_interface.h"
@@ -112,6 +114,23 @@ public:
   bool addResidualBlock(ceres::ResidualBlockId residual_block_id,
                         bool keep = false);
 
+  /// \brief Use the block-sparse storage of the linearised system. The landmark
+  ///        part is kept as 3x3 diagonal blocks with their couplings to the dense
+  ///        part, and the dense part is kept in a storage that is only grown.
+  ///        The error terms are computed from the dense part by a pivoted LDLT,
+  ///        so the full H_ and its eigen-decomposition are never formed.
+  ///        If a residual couples two landmarks, the landmarks are moved to
+  ///        the dense part.
+  /// \warning Must be set before any residual block is added.
+  void setBlockSparse(bool block_sparse);
+
+  /// \brief Keep the linearised system in square-root form, i.e. as a stacked
+  ///        Jacobian that is triangularized by Householder QR. Marginalization
+  ///        and error computation then work on the factor directly, without
+  ///        forming H or an eigen-decomposition.
+  /// \warning Must be set before any residual block is added.
+  void setSquareRoot(bool square_root);
+
   /// \brief Info: is this parameter block connected to this marginalization error?
   /// @param[in] parameter_block_id Parameter block id of interest.
   bool isParameterBlockConnected(uint64_t parameter_block_id);
@@ -292,6 +311,49 @@ protected:
   bool computeDeltaChi(double const* const * parameters,
                        Eigen::VectorXd& DeltaChi) const;  // use the provided estimates
 
+  /// \brief Dimension of the linearised system.
+  size_t systemDimension() const;
+
+  /// \brief Append zero rows and columns to the dense part of the block-sparse system.
+  void appendDenseDimension(size_t size);
+
+  /// \brief Marginalise out with the block-sparse storage. Landmarks are
+  ///        eliminated block by block, the dense part as in marginalizeOut.
+  void marginalizeOutBlockSparse(
+      const std::vector<std::pair<int, int> >& landmark_start_idx_and_length_pairs,
+      const std::vector<std::pair<int, int> >& dense_start_idx_and_length_pairs,
+      const size_t marginalization_parameters_dense);
+
+  /// \brief Grow the storage of the dense part of the block-sparse system.
+  void reserveDense(size_t dense_dimension);
+
+  /// \brief Move the landmark blocks into the dense part of the block-sparse
+  ///        system, except for the skipped ones (empty to move all).
+  void appendLandmarksToDense(const std::vector<bool>& skip);
+
+  /// \brief Move all the landmark blocks into the dense part and mark them
+  ///        as dense parameter blocks.
+  void moveLandmarksToDense();
+
+  /// \brief Compute J_ and e0_ from the dense part of the block-sparse system
+  ///        with a pivoted LDLT, without forming H_.
+  void updateBlockSparseErrorComputation();
+
+  /// \brief Insert zero columns into the square-root factor.
+  void insertSquareRootColumns(size_t idx, size_t size);
+
+  /// \brief Make room for more rows in the square-root factor.
+  void reserveSquareRootRows(size_t rows);
+
+  /// \brief Triangularize the stacked square-root factor with Householder QR.
+  void triangularizeSquareRoot();
+
+  /// \brief Marginalise out with the square-root factor. The columns to be
+  ///        marginalized are eliminated by a column-pivoting QR, the remaining
+  ///        rows form the new factor.
+  void marginalizeOutSquareRoot(
+      const std::vector<std::pair<int, int> >& marginalization_start_idx_and_length_pairs);
+
   /// \brief Split for Schur complement op.
   template<typename Derived_A, typename Derived_U, typename Derived_W,
       typename Derived_V>
@@ -402,13 +464,51 @@ protected:
   };
 
   std::vector<ParameterBlockInfo> parameter_block_infos_;  ///< Book keeper.
-  std::map<uint64_t, size_t> parameter_block_id_to_parameter_block_info_idx_;
+  std::unordered_map<uint64_t, size_t, BackendIdHash>
+  parameter_block_id_to_parameter_block_info_idx_;
   ///< Maps parameter block Ids to index in _parameterBlockInfos
   size_t dense_indices_;
   ///< Keep track of the size of the dense part of the equation system
 
   /// @}
 
+  /// @name Block-sparse storage of the linearised system.
+  /// The dense part is stored in the top left corner of H_dense_ and b_dense_,
+  /// the landmarks are stored in the order of their parameter block infos.
+  /// @{
+  struct LandmarkBlock
+  {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    Eigen::Matrix3d H_ll;  ///< Diagonal block of the landmark
+    Eigen::Vector3d b_l;  ///< rhs of the landmark
+    Eigen::Matrix<double, Eigen::Dynamic, 3> H_dl;
+    ///< Coupling to the dense part, sized to the dense capacity
+  };
+
+  bool block_sparse_;  ///< Use the block-sparse storage
+  size_t dense_dimension_;  ///< Used dimension of the dense part
+  size_t dense_capacity_;  ///< Allocated dimension of the dense part
+  size_t landmark_dimension_;  ///< Dimension of the landmark part
+  Eigen::MatrixXd H_dense_;  ///< lhs of the dense part
+  Eigen::VectorXd b_dense_;  ///< rhs of the dense part
+  std::vector<LandmarkBlock, Eigen::aligned_allocator<LandmarkBlock> >
+  landmark_blocks_;  ///< Landmark part
+
+  /// @}
+
+  /// @name Square-root storage of the linearised system.
+  /// The cost is 0.5*|r0_ + R_*Delta_Chi|^2, where only the first
+  /// square_root_rows_ rows and square_root_cols_ columns are used. The
+  /// storages are only grown.
+  /// @{
+  bool square_root_;  ///< Use the square-root storage
+  Eigen::MatrixXd R_;  ///< Stacked (and triangularized) Jacobian
+  Eigen::VectorXd r0_;  ///< Stacked residual
+  size_t square_root_rows_;  ///< Used rows of R_ and r0_
+  size_t square_root_cols_;  ///< Used columns of R_
+
+  /// @}
+
 };
 
 }  // namespace gici
@@ -0,0 +1,118 @@
+/**
+* @Function: Object pool for parameter blocks and error terms
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+#include <Eigen/Core>
+
+namespace gici {
+
+// Storage pool of fixed-size chunks.
+// The parameter blocks and error terms of an estimator are created and destroyed
+// in every epoch as the window slides. Their storages are kept in free lists
+// keyed by size and handed out again, which saves the allocation of the objects
+// themselves. Their dynamic members (e.g. Eigen::MatrixXd) and the bookkeeping of
+// ceres and Graph still allocate. Chunks are aligned for fixed-size Eigen members.
+class ObjectPool {
+public:
+  ObjectPool() {}
+  ~ObjectPool() {
+    for (auto& free_list : free_lists_) {
+      for (void* chunk : free_list.second) {
+        Eigen::internal::aligned_free(chunk);
+      }
+    }
+  }
+
+  // Get a chunk of given size
+  void* allocate(const size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<void*>& free_list = free_lists_[size];
+    if (free_list.size() > 0) {
+      void* chunk = free_list.back();
+      free_list.pop_back();
+      num_reused_++;
+      return chunk;
+    }
+    num_allocated_++;
+    return Eigen::internal::aligned_malloc(size);
+  }
+
+  // Return a chunk to pool
+  void deallocate(void* chunk, const size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_lists_[size].push_back(chunk);
+  }
+
+  // Number of chunks allocated from system
+  size_t numAllocated() const { return num_allocated_.load(); }
+
+  // Number of chunks reused from free lists
+  size_t numReused() const { return num_reused_.load(); }
+
+private:
+  std::mutex mutex_;
+  std::unordered_map<size_t, std::vector<void*>> free_lists_;
+  std::atomic<size_t> num_allocated_{0};
+  std::atomic<size_t> num_reused_{0};
+};
+
+using ObjectPoolPtr = std::shared_ptr<ObjectPool>;
+
+// Allocator that takes storages from an object pool.
+// Used with std::allocate_shared, the object and its control block share one
+// chunk, and the control block keeps the pool alive until the object is released.
+template<typename T>
+class PoolAllocator {
+public:
+  typedef T value_type;
+
+  PoolAllocator(const ObjectPoolPtr& pool) : pool_(pool) {}
+
+  template<typename U>
+  PoolAllocator(const PoolAllocator<U>& other) : pool_(other.pool()) {}
+
+  T* allocate(const size_t n) {
+    return static_cast<T*>(pool_->allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, const size_t n) {
+    pool_->deallocate(p, n * sizeof(T));
+  }
+
+  const ObjectPoolPtr& pool() const { return pool_; }
+
+private:
+  ObjectPoolPtr pool_;
+};
+
+template<typename T, typename U>
+inline bool operator==(const PoolAllocator<T>& lhs, const PoolAllocator<U>& rhs) {
+  return lhs.pool() == rhs.pool();
+}
+
+template<typename T, typename U>
+inline bool operator!=(const PoolAllocator<T>& lhs, const PoolAllocator<U>& rhs) {
+  return !(lhs == rhs);
+}
+
+// Create a shared object from pool. Falls back to std::make_shared if pool is null.
+template<typename T, typename... Args>
+inline std::shared_ptr<T> makePooled(const ObjectPoolPtr& pool, Args&&... args)
+{
+  if (pool == nullptr) return std::make_shared<T>(std::forward<Args>(args)...);
+  return std::allocate_shared<T>(
+    PoolAllocator<T>(pool), std::forward<Args>(args)...);
+}
+
+}
@@ -97,6 +97,9 @@ protected:
   // initialized by zero motion
   Transformation T_WS_0_;
   SpeedAndBias speed_and_bias_0_;
+
+  // Reused buffer for copying out the IMU measurements
+  ImuMeasurementVector imu_measurements_buffer_;
 };
 
 }
\ No newline at end of file
@@ -30,6 +30,7 @@
 #include "gici/fusion/gnss_imu_camera_srr_estimator.h"
 #include "gici/fusion/spp_imu_camera_rrr_estimator.h"
 #include "gici/fusion/rtk_imu_camera_rrr_estimator.h"
+#include "gici/imu/imu_forward_propagator.h"
 
 namespace gici {
 
@@ -79,6 +80,12 @@ private:
   // Backend processing
   void runBackend();
 
+  // Fill GNSS status of solution
+  void updateGnssSolutionStatus(Solution& solution);
+
+  // Hand over latest backend solution to forward propagator
+  void updateForwardPropagatorBaseState();
+
   // Estimator type checker
   inline bool estimatorTypeContains(
     SensorType sensor_type, EstimatorType estimator_type) {
@@ -135,6 +142,7 @@ private:
     int num_data_type = 0;
     if (data.gnss) num_data_type++;
     if (data.imu) num_data_type++;
+    if (data.imu_batch) num_data_type++;
     if (data.image) num_data_type++;
     if (data.frame_bundle) num_data_type++;
     if (data.solution) num_data_type++;
@@ -157,7 +165,7 @@ private:
 
   // Check if the data will be used for time propagation (only support IMU)
   inline bool estimatorDataIsImu(const EstimatorDataCluster& data) {
-    return (data.imu != nullptr);
+    return (data.imu != nullptr || data.imu_batch != nullptr);
   }
 
 protected:
@@ -218,6 +226,9 @@ protected:
 
   // Solutions
   bool backend_firstly_updated_ = false;  // 后端是否启用
+
+  // Low-latency IMU-rate outputs
+  ImuForwardPropagatorPtr forward_propagator_;
 };
 
 }
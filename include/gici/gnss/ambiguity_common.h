@@ -8,6 +8,10 @@
 **/
 #pragma once
 
+#include <iostream>
+#include <functional>
+#include <Eigen/Sparse>
+
 #include "gici/gnss/gnss_types.h"
 #include "gici/estimate/estimator_types.h"
 #include "gici/estimate/graph.h"
@@ -74,4 +78,56 @@ bool solveAmbiguityLambda(const Eigen::VectorXd& float_ambiguities,
                           Eigen::VectorXd& fixed_ambiguities,
                           double& ratio);
 
-}
\ No newline at end of file
+// Solve integer ambiguity by LAMBDA with partial AR on nested subsets.
+// Ambiguities are dropped from the last one until the ratio test passes or the 
+// number of them reaches min_num_fixation. The full set is skipped if skip_full. 
+// Returns the number of fixed ambiguities, 0 if failed or timeout.
+int solveAmbiguityPartialLambda(const Eigen::VectorXd& float_ambiguities,
+                                const Eigen::MatrixXd& covariance, 
+                                const double ratio_threshold, 
+                                const int min_num_fixation,
+                                const bool skip_full,
+                                const bool use_incremental,
+                                Eigen::VectorXd& fixed_ambiguities,
+                                double& ratio,
+                                const std::function<bool()>& is_timeout = nullptr);
+
+// Float ambiguities of one epoch for AR replay. They are the ambiguities that 
+// enter the lane formation of AmbiguityResolution::solvePpp or solveRtk, after 
+// the satellite, phase and elevation masks.
+struct AmbiguitySnapshot {
+  int mode;                      // 0: PPP, 1: RTK
+  std::vector<BackendId> ids;    // ambiguity parameter IDs
+  Eigen::VectorXd values;        // in meter
+  Eigen::VectorXd wavelengths;
+  Eigen::VectorXd elevations;    // in rad
+  Eigen::MatrixXd covariance;    // in meter^2
+};
+
+// Write a snapshot as one text block
+void writeAmbiguitySnapshot(std::ostream& out, const AmbiguitySnapshot& snapshot);
+
+// Read a snapshot, returns false at end of stream or on a broken block
+bool readAmbiguitySnapshot(std::istream& in, AmbiguitySnapshot& snapshot);
+
+// Sparse difference operator from ambiguities to their combinations.
+// Each row has only 2 (NL) or 4 (WL, UWL) non-zeros.
+using AmbiguityDifference = Eigen::SparseMatrix<double, Eigen::RowMajor>;
+
+// Transform ambiguity covariance by difference operator: D * P * D^T
+void transformAmbiguityCovariance(const AmbiguityDifference& difference,
+                                  const Eigen::MatrixXd& covariance,
+                                  Eigen::MatrixXd& transformed_covariance);
+
+// Constrain ambiguities by fixed combinations with Kalman update.
+// The innovation covariance is solved by LLT, and the covariance is updated by 
+// a symmetric rank-k downdate on the ambiguities that are correlated with the 
+// constrained ones. Returns false without changing anything if the innovation 
+// covariance is not positive definite.
+bool constrainAmbiguities(const AmbiguityDifference& jacobian,
+                          const Eigen::VectorXd& fixed_ambiguities,
+                          const double variance,
+                          Eigen::VectorXd& ambiguities,
+                          Eigen::MatrixXd& covariance);
+
+}
@@ -8,11 +8,14 @@
 **/
 #pragma once
 
+#include <fstream>
+
 #include "gici/utility/common.h"
 #include "gici/gnss/gnss_types.h"
 #include "gici/estimate/estimator_types.h"
 #include "gici/estimate/graph.h"
 #include "gici/gnss/ambiguity_common.h"
+#include "gici/utility/thread_pool.h"
 
 namespace gici {
 
@@ -47,6 +50,23 @@ struct AmbiguityResolutionOptions {
 
   // Ambiguity fixation ratio for LAMBDA
   double ratio = 3.0;
+
+  // Factorize once for each partial AR ordering and solve the nested subsets
+  // on the shared factor, instead of running full LAMBDA on every subset
+  bool use_incremental_partial_ar = true;
+
+  // Number of threads to evaluate the partial AR strategies concurrently.
+  // The strategies run in sequence and stop at the first success if it is 1.
+  int num_threads = 1;
+
+  // Time budget of ambiguity resolution in one epoch (s), 0 for no limit.
+  // The lanes that are not solved before the deadline are left float.
+  double max_time = 0.0;
+
+  // File to dump the float ambiguities of every epoch, which can be replayed 
+  // through the lane formation and partial AR by AmbiguityResolution::replay.
+  // Empty for disable.
+  std::string dump_path = "";
 };
 
 // Ambiguity resolution (AR)
@@ -183,6 +203,16 @@ public:
     ceres::ResidualBlockId residual_id = nullptr;
   };
 
+  // Search result of a group of lanes
+  struct LaneSolution {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    std::vector<LanePair> lane_pairs; // sorted by the partial AR strategy
+    AmbiguityDifference differential_jacobian;
+    Eigen::VectorXd fixed_ambiguities;
+    int num_fixed = 0;
+    double ratio = 0.0;
+  };
+
   // Other parameters
   struct Parameter {
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -215,6 +245,13 @@ public:
               const Eigen::MatrixXd& ambiguity_covariance,
               const std::pair<GnssMeasurement, GnssMeasurement>& measurements);
 
+  // Replay the float ambiguities of an epoch dumped by solvePpp or solveRtk 
+  // (see "dump_path"). The lanes are formed and fixed in the same way, and the 
+  // fixations are applied to the ambiguity states. The graph related steps, 
+  // adding the fixations as residual blocks and validating them by the range 
+  // costs, are skipped. The graph can be null for replay.
+  Result replay(const AmbiguitySnapshot& snapshot);
+
   // Set coordinate
   void setCoordinate(const GeoCoordinatePtr coordinate) { 
     coordinate_ = coordinate;
@@ -223,7 +260,20 @@ public:
   // Get options
   const AmbiguityResolutionOptions& getOptions() const { return options_; }
 
+  // Get the LAMBDA ratios of the lane solutions applied in current epoch
+  const std::vector<double>& getRatios() const { return ratios_; }
+
 private:
+  // Shift the ambiguity storages to a new epoch
+  void shiftEpoch();
+
+  // Dump the ambiguities of current epoch for replay
+  void dumpSnapshot(const int mode);
+
+  // Form lanes of current ambiguities and fix them group by group
+  void fixLanes(const bool is_rtk, int& num_fixed_nl, 
+                int& num_fixed_wl, int& num_fixed_uwl);
+
   // Apply Between-Satellite-Difference (BSD) and lane combination for PPP
   void formSatellitePairPpp();
 
@@ -244,6 +294,19 @@ private:
                  const bool use_rounding = false, 
                  const bool skip_full = false);
 
+  // Search integer ambiguities of lanes, without touching the graph and the
+  // ambiguity handles. Returns true if enough ambiguities are fixed.
+  bool searchLanes(const std::vector<size_t>& indexes, 
+                   const double min_percentage_fixation,
+                   const DelMethod method,
+                   const bool use_rounding, 
+                   const bool skip_full,
+                   LaneSolution& solution);
+
+  // Apply fixed ambiguities of lanes to the ambiguity handles and the graph.
+  // The graph is not touched if it is null.
+  int applyLanes(LaneSolution& solution);
+
   // Try to solve ambiguity by all partial AR methods
   int trySolveLanes(const std::vector<size_t>& indexes, 
                  const double min_percentage_fixation,
@@ -268,6 +331,12 @@ private:
   // Compute pseudorange and phasernage total cost in current epoch
   double computeRangeCost(const BackendId& epoch_id);
 
+  // Start the time budget of current epoch
+  void startTimer();
+
+  // Check if the time budget is used up
+  bool isTimeout() const;
+
   // Check if it is the first epoch
   bool isFirstEpoch() { return ambiguities_.size() < 2; }
 
@@ -302,6 +371,7 @@ private:
   std::deque<std::vector<LanePair>> ambiguity_lane_pairs_;
   std::vector<Parameter> full_parameters_store_;
   std::vector<std::vector<size_t>> lane_groups_;
+  std::vector<double> ratios_;  // of the applied lane solutions, for statistics
 
   // Covariances in minimal
   Eigen::MatrixXd ambiguity_covariance_;
@@ -311,6 +381,15 @@ private:
 
   // Coordinate handle
   GeoCoordinatePtr coordinate_;
+
+  // Workers for partial AR strategies
+  ThreadPoolPtr thread_pool_;
+
+  // Deadline of current epoch
+  double deadline_ = 0.0;
+
+  // Snapshot dump
+  std::ofstream dump_file_;
 };
 
 }
\ No newline at end of file
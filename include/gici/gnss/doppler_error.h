@@ -54,18 +54,18 @@ public:
   DopplerError();
 
   /// \brief Construct with measurement and information matrix
-  /// @param[in] measurement The measurement.
+  /// @param[in] measurement The shared epoch context.
   /// @param[in] index Index of current satellite.
   /// @param[in] error_parameter To compute GNSS information matrix.
-  DopplerError(const GnssMeasurement& measurement,
+  DopplerError(const GnssMeasurementConstPtr& measurement,
                    const GnssMeasurementIndex index,
                    const GnssErrorParameter& error_parameter);
 
   /// \brief Construct with measurement and information matrix
-  /// @param[in] measurement The measurement.
+  /// @param[in] measurement The shared epoch context.
   /// @param[in] index Index of current satellite.
   /// @param[in] error_parameter To compute GNSS information matrix.
-  DopplerError(const GnssMeasurement& measurement,
+  DopplerError(const GnssMeasurementConstPtr& measurement,
                    const GnssMeasurementIndex index,
                    const GnssErrorParameter& error_parameter,
                    const Eigen::Vector3d& angular_velocity);
@@ -75,10 +75,13 @@ public:
 
   // setters
   /// \brief Set the measurement.
-  /// @param[in] measurement The measurement.
-  void setMeasurement(const GnssMeasurement& measurement)
+  /// @param[in] measurement The shared epoch context.
+  void setMeasurement(const GnssMeasurementConstPtr& measurement)
   {
+    // Re-point to our signal in the new context
     measurement_ = measurement;
+    satellite_ = &measurement_->getSat(index_);
+    observation_ = measurement_->getObs(index_);
   }
 
   /// \brief Set the information.
@@ -93,7 +96,7 @@ public:
   // getters
   /// \brief Get the measurement.
   /// \return The measurement vector.
-  const GnssMeasurement& measurement() const { return measurement_; }
+  const GnssMeasurement& measurement() const { return *measurement_; }
 
   // error term and Jacobian implementation
   /**
@@ -147,12 +150,13 @@ public:
 
   // Get GNSS index
   inline GnssMeasurementIndex getGnssMeasurementIndex() { 
-    return GnssMeasurementIndex(satellite_.prn, observation_.raw_code);
+    return GnssMeasurementIndex(satellite_->prn, observation_.raw_code);
   }
 
 protected:
-  GnssMeasurement measurement_; ///< The measurement.
-  Satellite satellite_;
+  GnssMeasurementConstPtr measurement_; ///< The shared epoch context.
+  GnssMeasurementIndex index_; ///< The signal in the epoch context.
+  const Satellite* satellite_ = nullptr; ///< Points into the epoch context.
   Observation observation_;
   Eigen::Vector3d angular_velocity_;
 
@@ -0,0 +1,108 @@
+/**
+* @Function: Per-epoch cache of GNSS model corrections
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+
+#include "gici/gnss/gnss_types.h"
+
+namespace gici {
+
+// Station related corrections
+struct GnssStationCorrections {
+  Eigen::Vector3d tide;  // Solid earth tide displacement in ECEF
+  double zenith_hydro;   // Saastamoinen zenith hydro-static delay
+};
+
+// Satellite related corrections
+struct GnssSatelliteCorrections {
+  double elevation;
+  double azimuth;
+  double troposphere_hydro;  // Saastamoinen slant hydro-static delay
+  double gmf_hydro;          // GMF hydro-static mapping
+  double gmf_wet;            // GMF wet mapping
+  double ionosphere;         // Broadcast ionosphere delay in 1575.42 MHz
+};
+
+// Earth tide, mapping functions and model atmosphere delays barely change while
+// the solver iterates, so we compute them once per epoch and station and once per
+// satellite before each solve, at the receiver position estimate. The residuals
+// read them without locking while solving, and compute the corrections directly
+// if the receiver is more than the tolerance away from where they were computed.
+// The geometry (distance and its Jacobians) is always computed at the exact
+// receiver position by the residuals.
+class GnssCorrectionCache {
+public:
+  // If apply_tide is set, the satellite corrections are computed at the tide
+  // corrected position, as the undifferenced residuals do. Otherwise they are
+  // computed at the receiver position, as the double-differenced residuals do.
+  GnssCorrectionCache(const double timestamp,
+                      const Eigen::VectorXd& ionosphere_parameters,
+                      const double tolerance,
+                      const bool apply_tide);
+  ~GnssCorrectionCache() {}
+
+  // Register a satellite and get its slot. Should be called while building
+  // the problem, not while solving.
+  size_t addSatellite(const Satellite& satellite);
+
+  // Recompute the corrections if the receiver moved beyond tolerance.
+  // Should be called before solving, not while solving.
+  void update(const Eigen::Vector3d& receiver_ecef);
+
+  // Whether the cached corrections can be used at given receiver position
+  bool valid(const Eigen::Vector3d& receiver_ecef) const {
+    return enabled_ && has_station_ &&
+      (receiver_ecef - position_).norm() <= tolerance_;
+  }
+
+  // Get station corrections
+  const GnssStationCorrections& station() const { return station_; }
+
+  // Get satellite corrections
+  const GnssSatelliteCorrections& satellite(const size_t slot) const {
+    return satellites_[slot];
+  }
+
+  // Enable or disable the cache. Residuals compute the corrections directly if disabled.
+  void setEnabled(const bool enabled) { enabled_ = enabled; }
+  bool enabled() const { return enabled_; }
+
+  // Number of refreshes
+  size_t numRefreshes() const { return num_refreshes_; }
+
+protected:
+  // Compute satellite corrections at current position
+  void computeSatellite(const size_t slot);
+
+protected:
+  double timestamp_;
+  Eigen::VectorXd ionosphere_parameters_;
+  double tolerance_;
+  bool apply_tide_;
+  bool enabled_ = true;
+
+  // Linearization point of the corrections
+  bool has_station_ = false;
+  Eigen::Vector3d position_;
+  GnssStationCorrections station_;
+  size_t num_refreshes_ = 0;
+
+  // Satellites and their corrections, indexed by slot
+  std::vector<std::string> prns_;
+  std::vector<Eigen::Vector3d> satellite_positions_;
+  std::vector<GnssSatelliteCorrections> satellites_;
+};
+
+using GnssCorrectionCachePtr = std::shared_ptr<GnssCorrectionCache>;
+
+}
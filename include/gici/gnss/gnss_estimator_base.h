@@ -12,6 +12,8 @@
 #include "gici/gnss/gnss_types.h"
 #include "gici/gnss/ambiguity_resolution.h"
 #include "gici/gnss/gnss_common.h"
+#include "gici/gnss/gnss_correction_cache.h"
+#include "gici/gnss/igg_loss.h"
 
 namespace gici {
 
@@ -38,6 +40,17 @@ struct GnssEstimatorBaseOptions {
   // Maximum doppler error to exclude (m/s)
   double max_doppler_error = 0.5;
 
+  // Use single-pass robust FDE instead of the solve-reject-resolve loop. 
+  // The GNSS residuals are solved once with the IGG-III loss, i.e. reweighted 
+  // at every iteration. The standardized residuals of that solution are tested 
+  // with the leverages of its normal matrix, all outliers are rejected at once, 
+  // and the problem is re-solved with the Huber loss at most once.
+  bool use_robust_fde = false;
+
+  // IGG-III thresholds of normalized residuals. Residuals beyond k1 are rejected.
+  double robust_fde_k0 = 1.5;
+  double robust_fde_k1 = 3.0;
+
   // Minimum number of satellite to be considered as good observation environment
   int good_observation_min_num_satellites = 10;
 
@@ -55,6 +68,17 @@ struct GnssEstimatorBaseOptions {
 
   // Minimum number of continuous large amount rejection to be considered as divergence
   size_t diverge_min_num_continuous_reject = 10;
+
+  // Compute earth tide, mapping functions and model atmosphere delays once per
+  // epoch and satellite before each solve, and use them while the receiver is
+  // within the tolerance (m) from where they were computed.
+  bool use_correction_cache = false;
+  double correction_cache_tolerance = 1.0;
+
+  // Put all the pseudorange residuals of one epoch into a single batched residual 
+  // block. Only applies to SPP code residuals, i.e. the ECEF position models
+  // without atmosphere estimation. Phase, RTK and PPP residuals are not batched.
+  bool use_batched_pseudorange = false;
 };
 
 // Estimator
@@ -310,6 +334,27 @@ protected:
   size_t rejectDopplerOutlier(
     const State& state, bool reject_one = false);
 
+  // Solve with single-pass robust FDE: one IGG-III solve, reject all the 
+  // outliers flagged by standardized residuals, and at most one re-solve
+  size_t optimizeWithRobustFde(
+    const State& state, AmbiguityState* ambiguity_state = nullptr);
+
+  // Leverages w * j^T N^-1 j of given rows, N = J^T W J. N^-1 is only 
+  // recovered on the columns touched by these rows, with one blocked solve.
+  bool computeRowLeverages(const ceres::CRSMatrix& jacobian, 
+    const std::vector<double>& weights, const std::vector<int>& rows, 
+    std::vector<double>& leverages) const;
+
+  // Reject all GNSS outliers by the standardized residuals of one solution
+  size_t rejectGnssOutlierByNormalizedResidual(
+    const State& state, AmbiguityState* ambiguity_state = nullptr);
+
+  // Add prior to the clock blocks without residuals
+  void constrainIsolatedClockBlocks(const State& state);
+
+  // Add prior to the frequency blocks without residuals
+  void constrainIsolatedFrequencyBlocks(const State& state);
+
   // Add GNSS position block to marginalizer
   void addGnssPositionMarginBlockWithResiduals(const State& state, bool keep = false);
 
@@ -404,6 +449,19 @@ protected:
   void convertStateAndCovarianceToBody(
     Transformation* T_WS, SpeedAndBias* speed_and_bias, 
     Eigen::Matrix<double, 15, 15>* covariance) override;
+
+  // Get the shared context of an epoch. It is copied at the first call of the epoch
+  // and shared by all the residual blocks added for it afterwards, so the measurement
+  // should be final before its first residual block is added.
+  GnssMeasurementConstPtr getEpochContext(const GnssMeasurement& measurement);
+
+  // Get the correction cache of an epoch, whose receiver position is the one of
+  // given state. Returns nullptr if disabled.
+  GnssCorrectionCachePtr getCorrectionCache(const GnssMeasurement& measurement,
+    const State& state, const bool apply_tide);
+
+  // Refresh the model corrections at the receiver position estimates
+  void updateBeforeSolve() override;
   
   // Get extrinsics estimate
   Eigen::Vector3d getGnssExtrinsicsEstimate();
@@ -420,6 +478,11 @@ protected:
   GnssMeasurementDDIndexPair getGnssMeasurementDDIndexPairFromErrorInterface(
     const std::shared_ptr<ErrorInterface>& error_interface);
 
+  // Compute the row errors of a batched pseudorange residual block
+  void computePseudorangeBatchErrors(
+    const Graph::ResidualBlockSpec& residual_block, 
+    Eigen::VectorXd& errors, bool normalize = false);
+
   // Create ambiguity logger
   void createAmbiguityLogger(const std::string& directory);
 
@@ -703,6 +766,23 @@ protected:
   // Ambiguity resolution
   std::unique_ptr<AmbiguityResolution> ambiguity_resolution_;
 
+  // Loss of the GNSS residual blocks, which wraps the Huber loss, or the IGG-III
+  // loss while solving with robust FDE
+  std::shared_ptr<ceres::LossFunctionWrapper> gnss_loss_function_;
+  std::shared_ptr<IggLoss> igg_loss_function_;
+
+  // Per-epoch shared contexts, indexed by GNSS measurement ID
+  std::unordered_map<int32_t, GnssMeasurementConstPtr> epoch_contexts_;
+
+  // Per-epoch correction caches and the parameter blocks of their receiver positions,
+  // indexed by GNSS measurement ID and whether the earth tide is applied
+  struct CorrectionCacheItem {
+    GnssCorrectionCachePtr corrections;
+    std::shared_ptr<ParameterBlock> position_block;  // position or pose
+    std::shared_ptr<ParameterBlock> extrinsics_block;  // only for pose
+  };
+  std::map<std::pair<int32_t, bool>, CorrectionCacheItem> correction_caches_;
+
   // Flags
   bool is_state_pose_ = false;
   bool is_verbose_model_ = false;  // if estimate atmosphere, IFB, etc...
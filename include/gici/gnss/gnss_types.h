@@ -204,6 +204,10 @@ struct GnssMeasurement {
   static int32_t epoch_cnt_;
 };
 
+// Immutable epoch context shared by all the residual blocks of one epoch.
+// Residuals keep this handle and point into it instead of copying the epoch.
+using GnssMeasurementConstPtr = std::shared_ptr<const GnssMeasurement>;
+
 // Observation type
 enum class ObservationType {
   Pseudorange,
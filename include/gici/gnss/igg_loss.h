@@ -0,0 +1,40 @@
+/**
+* @Function: IGG-III loss function for ceres backend
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#pragma once
+
+#pragma diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+// Eigen 3.2.7 uses std::binder1st and std::binder2nd which are deprecated since c++11
+// Fix is in 3.3 devel (http://eigen.tuxfamily.org/bz/show_bug.cgi?id=872).
+#include <ceres/ceres.h>
+#pragma diagnostic pop
+
+namespace gici {
+
+// IGG-III loss of normalized residual u = sqrt(s):
+// rho'(s) = 1                              if u <= k0
+//         = k0 / u * ((k1 - u) / (k1 - k0))^2  if k0 < u <= k1
+//         = 0                              if u > k1
+// rho'' is never positive, so the ceres corrector scales the rows by sqrt(rho'),
+// and each iteration solves the IGG-III reweighted normal equations.
+class IggLoss : public ceres::LossFunction {
+public:
+  IggLoss(const double k0, const double k1);
+
+  void Evaluate(double s, double rho[3]) const override;
+
+  // Weight of a normalized residual, i.e. rho'(u^2)
+  double weight(const double normalized_residual) const;
+
+private:
+  const double k0_;
+  const double k1_;
+};
+
+}
@@ -0,0 +1,61 @@
+/**
+* @Function: LAMBDA on nested ambiguity subsets for partial AR
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#pragma once
+
+#include <Eigen/Core>
+
+namespace gici {
+
+// LAMBDA for partial AR on nested subsets.
+// Partial AR tries the leading ambiguities of a fixed ordering, dropping the last
+// one on each failure. We factorize the covariance once as Q = L^T * D * L (the
+// same form as RTKLIB) on the reversed ordering. The factor of each leading subset
+// is then a trailing block of the full factor, so every subset skips the
+// decomposition and starts directly from decorrelation and search.
+class IncrementalLambda {
+public:
+  // Factorize the float ambiguities and their covariance
+  IncrementalLambda(const Eigen::VectorXd& float_ambiguities,
+                    const Eigen::MatrixXd& covariance);
+  ~IncrementalLambda() {}
+
+  // Number of ambiguities
+  int size() const { return static_cast<int>(float_ambiguities_.size()); }
+
+  // Maximum size of the leading subsets with a valid factor
+  int validSize() const { return valid_size_; }
+
+  // Solve the leading num_active ambiguities
+  // Returns true if the ratio test passed. The search is bounded by the maximum
+  // number of loops, and fails if it does not finish.
+  bool solve(const int num_active,
+             const double ratio_threshold,
+             Eigen::VectorXd& fixed_ambiguities,
+             double& ratio) const;
+
+protected:
+  // Decorrelation (Z-transformation) of the factor
+  static void reduction(Eigen::MatrixXd& L, Eigen::VectorXd& D, Eigen::MatrixXd& Z);
+
+  // Search the best two integer vectors, returns false if the search is not finished
+  static bool search(const Eigen::MatrixXd& L, const Eigen::VectorXd& D,
+                     const Eigen::VectorXd& zs, Eigen::MatrixXd& zn,
+                     Eigen::Vector2d& s);
+
+protected:
+  // Float ambiguities in reversed ordering
+  Eigen::VectorXd float_ambiguities_;
+
+  // Factor of the covariance in reversed ordering
+  Eigen::MatrixXd L_;
+  Eigen::VectorXd D_;
+  int valid_size_;
+};
+
+}
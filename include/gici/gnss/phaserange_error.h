@@ -19,6 +19,7 @@
 #include "gici/estimate/error_interface.h"
 #include "gici/gnss/geodetic_coordinate.h"
 #include "gici/gnss/gnss_types.h"
+#include "gici/gnss/gnss_correction_cache.h"
 
 namespace gici {
 
@@ -55,10 +56,10 @@ public:
   PhaserangeError();
 
   /// \brief Construct with measurement and information matrix
-  /// @param[in] measurement The measurement.
+  /// @param[in] measurement The shared epoch context.
   /// @param[in] index Index of current satellite.
   /// @param[in] error_parameter To compute GNSS information matrix.
-  PhaserangeError(const GnssMeasurement& measurement,
+  PhaserangeError(const GnssMeasurementConstPtr& measurement,
                    const GnssMeasurementIndex index,
                    const GnssErrorParameter& error_parameter);
 
@@ -67,10 +68,13 @@ public:
 
   // setters
   /// \brief Set the measurement.
-  /// @param[in] measurement The measurement.
-  void setMeasurement(const GnssMeasurement& measurement)
+  /// @param[in] measurement The shared epoch context.
+  void setMeasurement(const GnssMeasurementConstPtr& measurement)
   {
+    // Re-point to our signal in the new context
     measurement_ = measurement;
+    satellite_ = &measurement_->getSat(index_);
+    observation_ = measurement_->getObs(index_);
   }
 
   /// \brief Set the information.
@@ -82,6 +86,12 @@ public:
     coordinate_ = coordinate;
   }
 
+  // Set per-epoch corrections cache
+  void setCorrectionCache(const GnssCorrectionCachePtr& corrections) {
+    corrections_ = corrections;
+    if (corrections_) correction_slot_ = corrections_->addSatellite(*satellite_);
+  }
+
   // error term and Jacobian implementation
   /**
     * @brief This evaluates the error term and additionally computes the Jacobians.
@@ -134,12 +144,13 @@ public:
 
   // Get GNSS index
   inline GnssMeasurementIndex getGnssMeasurementIndex() { 
-    return GnssMeasurementIndex(satellite_.prn, observation_.raw_code);
+    return GnssMeasurementIndex(satellite_->prn, observation_.raw_code);
   }
 
 protected:
-  GnssMeasurement measurement_; ///< The measurement.
-  Satellite satellite_;
+  GnssMeasurementConstPtr measurement_; ///< The shared epoch context.
+  GnssMeasurementIndex index_; ///< The signal in the epoch context.
+  const Satellite* satellite_ = nullptr; ///< Points into the epoch context.
   Observation observation_;
 
   // weighting related
@@ -155,6 +166,10 @@ protected:
   // Geodetic coordinate
   GeoCoordinatePtr coordinate_;
 
+  // Per-epoch corrections cache, corrections are computed directly if not set
+  GnssCorrectionCachePtr corrections_;
+  size_t correction_slot_ = 0;
+
   // parameter types
   bool is_estimate_body_;
   int parameter_block_group_;
@@ -19,9 +19,18 @@
 #include "gici/estimate/error_interface.h"
 #include "gici/gnss/geodetic_coordinate.h"
 #include "gici/gnss/gnss_types.h"
+#include "gici/gnss/gnss_correction_cache.h"
 
 namespace gici {
 
+// Variance of a pseudorange measurement, with the model errors if the
+// atmosphere is not estimated
+double pseudorangeVariance(const GnssMeasurement& measurement,
+                           const Satellite& satellite,
+                           const Observation& observation,
+                           const GnssErrorParameter& error_parameter,
+                           const bool is_estimate_atmosphere);
+
 // pseudorange error
 // The candidate parameter setups are:
 // Group 1: P1. receiver position in ECEF (3), P2. receiver clock (1)
@@ -55,10 +64,10 @@ public:
   PseudorangeError();
 
   /// \brief Construct with measurement and information matrix
-  /// @param[in] measurement The measurement.
+  /// @param[in] measurement The shared epoch context.
   /// @param[in] index Index of current satellite.
   /// @param[in] error_parameter To compute GNSS information matrix.
-  PseudorangeError(const GnssMeasurement& measurement,
+  PseudorangeError(const GnssMeasurementConstPtr& measurement,
                    const GnssMeasurementIndex index,
                    const GnssErrorParameter& error_parameter);
 
@@ -67,10 +76,13 @@ public:
 
   // setters
   /// \brief Set the measurement.
-  /// @param[in] measurement The measurement.
-  void setMeasurement(const GnssMeasurement& measurement)
+  /// @param[in] measurement The shared epoch context.
+  void setMeasurement(const GnssMeasurementConstPtr& measurement)
   {
+    // Re-point to our signal in the new context
     measurement_ = measurement;
+    satellite_ = &measurement_->getSat(index_);
+    observation_ = measurement_->getObs(index_);
   }
 
   /// \brief Set the information.
@@ -82,10 +94,20 @@ public:
     coordinate_ = coordinate;
   }
 
+  // Set per-epoch corrections cache
+  void setCorrectionCache(const GnssCorrectionCachePtr& corrections) {
+    corrections_ = corrections;
+    if (corrections_) correction_slot_ = corrections_->addSatellite(*satellite_);
+  }
+
   // getters
   /// \brief Get the measurement.
   /// \return The measurement vector.
-  const GnssMeasurement& measurement() const { return measurement_; }
+  const GnssMeasurement& measurement() const { return *measurement_; }
+
+  /// \brief Get the information matrix.
+  /// \return The information (weight) matrix.
+  const information_t& information() const { return information_; }
 
   // error term and Jacobian implementation
   /**
@@ -139,12 +161,13 @@ public:
 
   // Get GNSS index
   inline GnssMeasurementIndex getGnssMeasurementIndex() { 
-    return GnssMeasurementIndex(satellite_.prn, observation_.raw_code);
+    return GnssMeasurementIndex(satellite_->prn, observation_.raw_code);
   }
 
 protected:
-  GnssMeasurement measurement_; ///< The measurement.
-  Satellite satellite_;
+  GnssMeasurementConstPtr measurement_; ///< The shared epoch context.
+  GnssMeasurementIndex index_; ///< The signal in the epoch context.
+  const Satellite* satellite_ = nullptr; ///< Points into the epoch context.
   Observation observation_;
 
   // weighting related
@@ -160,6 +183,10 @@ protected:
   // Geodetic coordinate
   GeoCoordinatePtr coordinate_;
 
+  // Per-epoch corrections cache, corrections are computed directly if not set
+  GnssCorrectionCachePtr corrections_;
+  size_t correction_slot_ = 0;
+
   // parameter types
   bool is_estimate_body_;
   bool is_estimate_atmosphere_;
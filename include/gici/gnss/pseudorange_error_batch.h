@@ -0,0 +1,203 @@
+/**
+* @Function: Batched pseudorange residual block of one epoch for ceres backend
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#pragma once
+
+#include <vector>
+
+#pragma diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+// Eigen 3.2.7 uses std::binder1st and std::binder2nd which are deprecated since c++11
+// Fix is in 3.3 devel (http://eigen.tuxfamily.org/bz/show_bug.cgi?id=872).
+#include <ceres/ceres.h>
+#include <Eigen/Core>
+#pragma diagnostic pop
+
+#include "gici/estimate/error_interface.h"
+#include "gici/gnss/gnss_types.h"
+
+namespace gici {
+
+// Batched pseudorange error
+// All the code residuals of one epoch in a single residual block. Only the SPP
+// model is supported, i.e. the ECEF position without atmosphere estimation:
+// there are no phase rows, no double-differenced (RTK) or PPP rows, and no
+// troposphere, ionosphere or IFB blocks. The other models keep one residual
+// block per signal. The parameter setup is:
+// P1. receiver position in ECEF (3), P2...Pn. receiver clock of each system (1)
+// Satellite geometry and the clock assignment of the rows are kept in
+// structure-of-arrays, so that the ranges, errors and Jacobians are computed with
+// Eigen array expressions over all rows instead of one residual block per row.
+// Earth tide and model atmosphere delays are computed row by row at a
+// linearization point before solving, and only recomputed in the evaluation when
+// the receiver is beyond the tolerance from it. The evaluation only uses
+// workspaces on stack, so it can run in parallel without locking.
+// Rows are disabled by setting their weights to zero.
+class PseudorangeErrorBatch :
+    public ceres::CostFunction,
+    public ErrorInterface
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  /// \brief The base class type.
+  typedef ceres::CostFunction base_t;
+
+  /// \brief Construct with measurement and error parameter
+  /// @param[in] measurement The shared epoch context.
+  /// @param[in] error_parameter To compute GNSS information matrix.
+  /// @param[in] tolerance Receiver motion (m) to refresh the model corrections.
+  PseudorangeErrorBatch(const GnssMeasurementConstPtr& measurement,
+                        const GnssErrorParameter& error_parameter,
+                        const double tolerance = 1.0);
+
+  /// \brief Trivial destructor.
+  virtual ~PseudorangeErrorBatch() {}
+
+  // setters
+  /// \brief Add a row. Rows should be added before adding the block to graph.
+  /// @param[in] index Index of the satellite and code.
+  void addRow(const GnssMeasurementIndex& index);
+
+  /// \brief Refresh tide and model delays if the receiver moved beyond tolerance.
+  /// Should be called before solving, not while solving.
+  /// @param[in] t_WR_ECEF Receiver position estimate.
+  void updateCorrections(const Eigen::Vector3d& t_WR_ECEF);
+
+  /// \brief Set the weight of a row, zero disables it.
+  void setRowWeight(const size_t row, const double weight) {
+    weights_.at(row) = weight;
+  }
+
+  /// \brief Set a loss function that is applied to each row.
+  void setLossFunction(const ceres::LossFunction* loss_function) {
+    loss_function_ = loss_function;
+  }
+
+  // getters
+  /// \brief Number of rows.
+  size_t numRows() const { return indexes_.size(); }
+
+  /// \brief Number of rows with non-zero weights.
+  size_t numActiveRows() const;
+
+  /// \brief Weight of a row.
+  double rowWeight(const size_t row) const { return weights_.at(row); }
+
+  /// \brief GNSS index of a row.
+  const GnssMeasurementIndex& rowIndex(const size_t row) const {
+    return indexes_.at(row);
+  }
+
+  /// \brief Systems of the clock parameter blocks, in parameter order.
+  const std::vector<char>& systems() const { return systems_; }
+
+  /// \brief Check if any active row is connected to the clock of given system.
+  bool hasActiveRows(const char system) const;
+
+  /// \brief Compute the errors of all rows without weighting and loss.
+  /// @param[in] parameters Pointer to the parameters (see ceres)
+  /// @param[out] errors Errors of all rows.
+  /// @param[in] normalize Apply square root information (not the row weights).
+  void computeRowErrors(double const* const * parameters,
+                        Eigen::VectorXd& errors, bool normalize = false) const;
+
+  // error term and Jacobian implementation
+  /**
+    * @brief This evaluates the error term and additionally computes the Jacobians.
+    * @param parameters Pointer to the parameters (see ceres)
+    * @param residuals Pointer to the residual vector (see ceres)
+    * @param jacobians Pointer to the Jacobians (see ceres)
+    * @return success of th evaluation.
+    */
+  virtual bool Evaluate(double const* const * parameters, double* residuals,
+                        double** jacobians) const;
+
+  /**
+   * @brief This evaluates the error term and additionally computes
+   *        the Jacobians in the minimal internal representation.
+   * @param parameters Pointer to the parameters (see ceres)
+   * @param residuals Pointer to the residual vector (see ceres)
+   * @param jacobians Pointer to the Jacobians (see ceres)
+   * @param jacobians_minimal Pointer to the minimal Jacobians (equivalent to jacobians).
+   * @return Success of the evaluation.
+   */
+  bool EvaluateWithMinimalJacobians(double const* const * parameters,
+                                    double* residuals, double** jacobians,
+                                    double** jacobians_minimal) const;
+
+  // sizes
+  /// \brief Residual dimension.
+  size_t residualDim() const { return base_t::num_residuals(); }
+
+  /// \brief Number of parameter blocks.
+  size_t parameterBlocks() const { return base_t::parameter_block_sizes().size(); }
+
+  /// \brief Dimension of an individual parameter block.
+  size_t parameterBlockDim(size_t parameter_block_idx) const
+  {
+    return base_t::parameter_block_sizes().at(parameter_block_idx);
+  }
+
+  /// @brief Residual block type as string
+  virtual ErrorType typeInfo() const
+  {
+    return ErrorType::kPseudorangeErrorBatch;
+  }
+
+  // Convert normalized residual to raw residual
+  virtual void deNormalizeResidual(double *residuals) const;
+
+  /// \brief Maximum number of rows, for 4 systems with 3 frequencies.
+  static constexpr int kMaxRows = 256;
+
+protected:
+  // Row-wise arrays without heap allocation
+  using RowArray = Eigen::Array<double, Eigen::Dynamic, 1, 0, kMaxRows, 1>;
+
+  // Workspace of one evaluation
+  struct Workspace {
+    RowArray dx, dy, dz, rho, errors, scale;
+  };
+
+  // Compute the unweighted errors into workspace
+  void computeErrors(double const* const * parameters, Workspace& workspace) const;
+
+  // Compute tide and model delays at given receiver position
+  void computeCorrections(const Eigen::Vector3d& t_WR_ECEF,
+                          Eigen::Vector3d& tide, RowArray& delays) const;
+
+protected:
+  GnssMeasurementConstPtr measurement_; ///< The shared epoch context.
+  GnssErrorParameter error_parameter_;
+  double tolerance_;
+  const ceres::LossFunction* loss_function_ = nullptr;
+
+  // Rows
+  std::vector<GnssMeasurementIndex> indexes_;
+  std::vector<const Satellite*> satellites_;
+  std::vector<char> systems_;
+  std::vector<int> clock_indexes_;
+  std::vector<std::vector<double>> clock_masks_;  ///< 1 for rows of each clock
+
+  // Row data in structure-of-arrays
+  std::vector<double> satellite_x_, satellite_y_, satellite_z_;
+  std::vector<double> satellite_clocks_;
+  std::vector<double> pseudoranges_;
+  std::vector<double> wavelengths_;
+  std::vector<double> square_root_information_;
+  std::vector<double> weights_;
+
+  // Model corrections at linearization point
+  bool has_linearization_point_ = false;
+  Eigen::Vector3d linearization_point_;
+  Eigen::Vector3d tide_;
+  RowArray delays_;
+};
+
+}
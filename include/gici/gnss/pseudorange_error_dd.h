@@ -19,6 +19,7 @@
 #include "gici/estimate/error_interface.h"
 #include "gici/gnss/geodetic_coordinate.h"
 #include "gici/gnss/gnss_types.h"
+#include "gici/gnss/gnss_correction_cache.h"
 
 namespace gici {
 
@@ -62,8 +63,8 @@ public:
   /// @param[in] measurement_rov_base The measurement of base satellite at rover.
   /// @param[in] measurement_ref_base The measurement of base satellite at reference.
   /// @param[in] error_parameter To compute GNSS information matrix.
-  PseudorangeErrorDD(const GnssMeasurement& measurement_rov,
-                    const GnssMeasurement& measurement_ref,
+  PseudorangeErrorDD(const GnssMeasurementConstPtr& measurement_rov,
+                    const GnssMeasurementConstPtr& measurement_ref,
                     const GnssMeasurementIndex index_rov,
                     const GnssMeasurementIndex index_ref,
                     const GnssMeasurementIndex index_rov_base,
@@ -75,12 +76,21 @@ public:
 
   // setters
   /// \brief Set the measurement.
-  /// @param[in] measurement The measurement.
-  void setMeasurement(const GnssMeasurement& measurement_rov,
-                      const GnssMeasurement& measurement_ref)
+  /// @param[in] measurement The shared epoch context.
+  void setMeasurement(const GnssMeasurementConstPtr& measurement_rov,
+                      const GnssMeasurementConstPtr& measurement_ref)
   {
+    // Re-point to our signals in the new contexts
     measurement_rov_ = measurement_rov;
     measurement_ref_ = measurement_ref;
+    satellite_rov_ = &measurement_rov_->getSat(index_rov_);
+    satellite_ref_ = &measurement_ref_->getSat(index_ref_);
+    satellite_rov_base_ = &measurement_rov_->getSat(index_rov_base_);
+    satellite_ref_base_ = &measurement_ref_->getSat(index_ref_base_);
+    observation_rov_ = measurement_rov_->getObs(index_rov_);
+    observation_ref_ = measurement_ref_->getObs(index_ref_);
+    observation_rov_base_ = measurement_rov_->getObs(index_rov_base_);
+    observation_ref_base_ = measurement_ref_->getObs(index_ref_base_);
   }
 
   /// \brief Set the information.
@@ -92,6 +102,15 @@ public:
     coordinate_ = coordinate;
   }
 
+  // Set per-epoch corrections cache
+  void setCorrectionCache(const GnssCorrectionCachePtr& corrections) {
+    corrections_ = corrections;
+    if (corrections_) {
+      correction_slot_rov_ = corrections_->addSatellite(*satellite_rov_);
+      correction_slot_rov_base_ = corrections_->addSatellite(*satellite_rov_base_);
+    }
+  }
+
   // error term and Jacobian implementation
   /**
     * @brief This evaluates the error term and additionally computes the Jacobians.
@@ -145,16 +164,18 @@ public:
   // Get GNSS index
   inline GnssMeasurementDDIndexPair getGnssMeasurementIndex() { 
     return GnssMeasurementDDIndexPair(
-      GnssMeasurementIndex(satellite_rov_.prn, observation_rov_.raw_code),
-      GnssMeasurementIndex(satellite_ref_.prn, observation_ref_.raw_code),
-      GnssMeasurementIndex(satellite_rov_base_.prn, observation_rov_base_.raw_code),
-      GnssMeasurementIndex(satellite_ref_base_.prn, observation_ref_base_.raw_code));
+      GnssMeasurementIndex(satellite_rov_->prn, observation_rov_.raw_code),
+      GnssMeasurementIndex(satellite_ref_->prn, observation_ref_.raw_code),
+      GnssMeasurementIndex(satellite_rov_base_->prn, observation_rov_base_.raw_code),
+      GnssMeasurementIndex(satellite_ref_base_->prn, observation_ref_base_.raw_code));
   }
 
 protected:
-  GnssMeasurement measurement_rov_, measurement_ref_; 
-  Satellite satellite_rov_, satellite_ref_,
-            satellite_rov_base_, satellite_ref_base_;
+  GnssMeasurementConstPtr measurement_rov_, measurement_ref_; ///< The shared epoch contexts.
+  GnssMeasurementIndex index_rov_, index_ref_,
+                       index_rov_base_, index_ref_base_; ///< The signals in the epoch contexts.
+  const Satellite *satellite_rov_ = nullptr, *satellite_ref_ = nullptr,
+                  *satellite_rov_base_ = nullptr, *satellite_ref_base_ = nullptr;
   Observation observation_rov_, observation_ref_,
               observation_rov_base_, observation_ref_base_;
 
@@ -171,6 +192,10 @@ protected:
   // Geodetic coordinate
   GeoCoordinatePtr coordinate_;
 
+  // Per-epoch corrections cache, corrections are computed directly if not set
+  GnssCorrectionCachePtr corrections_;
+  size_t correction_slot_rov_ = 0, correction_slot_rov_base_ = 0;
+
   // parameter types
   bool is_estimate_body_;
   bool is_estimate_atmosphere_;
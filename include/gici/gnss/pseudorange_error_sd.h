@@ -60,8 +60,8 @@ public:
   /// @param[in] measurement_rov The measurement of rover.
   /// @param[in] measurement_ref The measurement of reference.
   /// @param[in] error_parameter To compute GNSS information matrix.
-  PseudorangeErrorSD(const GnssMeasurement& measurement_rov,
-                    const GnssMeasurement& measurement_ref,
+  PseudorangeErrorSD(const GnssMeasurementConstPtr& measurement_rov,
+                    const GnssMeasurementConstPtr& measurement_ref,
                     const GnssMeasurementIndex index_rov,
                     const GnssMeasurementIndex index_ref,
                     const GnssErrorParameter& error_parameter);
@@ -71,12 +71,17 @@ public:
 
   // setters
   /// \brief Set the measurement.
-  /// @param[in] measurement The measurement.
-  void setMeasurement(const GnssMeasurement& measurement_rov,
-                      const GnssMeasurement& measurement_ref)
+  /// @param[in] measurement The shared epoch context.
+  void setMeasurement(const GnssMeasurementConstPtr& measurement_rov,
+                      const GnssMeasurementConstPtr& measurement_ref)
   {
+    // Re-point to our signals in the new contexts
     measurement_rov_ = measurement_rov;
     measurement_ref_ = measurement_ref;
+    satellite_rov_ = &measurement_rov_->getSat(index_rov_);
+    satellite_ref_ = &measurement_ref_->getSat(index_ref_);
+    observation_rov_ = measurement_rov_->getObs(index_rov_);
+    observation_ref_ = measurement_ref_->getObs(index_ref_);
   }
 
   /// \brief Set the information.
@@ -141,13 +146,14 @@ public:
   // Get GNSS index
   inline GnssMeasurementSDIndexPair getGnssMeasurementIndex() { 
     return GnssMeasurementSDIndexPair(
-      GnssMeasurementIndex(satellite_rov_.prn, observation_rov_.raw_code),
-      GnssMeasurementIndex(satellite_ref_.prn, observation_ref_.raw_code));
+      GnssMeasurementIndex(satellite_rov_->prn, observation_rov_.raw_code),
+      GnssMeasurementIndex(satellite_ref_->prn, observation_ref_.raw_code));
   }
 
 protected:
-  GnssMeasurement measurement_rov_, measurement_ref_; ///< The measurement.
-  Satellite satellite_rov_, satellite_ref_;;
+  GnssMeasurementConstPtr measurement_rov_, measurement_ref_; ///< The shared epoch contexts.
+  GnssMeasurementIndex index_rov_, index_ref_; ///< The signals in the epoch contexts.
+  const Satellite *satellite_rov_ = nullptr, *satellite_ref_ = nullptr;
   Observation observation_rov_, observation_ref_;
 
   // weighting related
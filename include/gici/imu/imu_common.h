@@ -20,7 +20,7 @@
 namespace gici {
 
 // Initialize IMU pose and biases with gravity vector
-bool initPoseAndBiases(const ImuMeasurements& imu_measurements,
+bool initPoseAndBiases(const ImuMeasurementVector& imu_measurements,
                        const double gravity,
                        Transformation& T_WS,
                        SpeedAndBias& speed_and_bias, 
@@ -30,6 +30,29 @@ bool initPoseAndBiases(const ImuMeasurements& imu_measurements,
 // Initialize IMU pose with body velocity in world frame
 bool initYawFromVelocity(const Eigen::Vector3d& v_WS_W, double& yaw);
 
+// Propagate IMU covariance P = F * P * F^T with one-step transition matrix F.
+// F is identity except for the blocks in [p, q, v, b_g, b_a] order:
+// (p, v) = I * dt, (q, q) = F_qq, (q, b_g) = (v, b_a) = F_qb, (v, q) = F_vq.
+// Only the non-trivial blocks are touched. The upper block triangle is computed and 
+// mirrored to the lower one.
+void propagateImuCovariance(const double dt, 
+                            const Eigen::Matrix3d& F_qq,
+                            const Eigen::Matrix3d& F_qb,
+                            const Eigen::Matrix3d& F_vq,
+                            Eigen::Matrix<double, 15, 15>& P);
+
+// Accumulate IMU transition matrix J = F * J, with F structured as above
+void accumulateImuTransition(const double dt, 
+                             const Eigen::Matrix3d& F_qq,
+                             const Eigen::Matrix3d& F_qb,
+                             const Eigen::Matrix3d& F_vq,
+                             Eigen::Matrix<double, 15, 15>& J);
+
+// Transform IMU covariance P = F * P * F^T with an accumulated transition matrix F, 
+// whose bias rows are still [0, I]
+void transformImuCovariance(const Eigen::Matrix<double, 15, 15>& F,
+                            Eigen::Matrix<double, 15, 15>& P);
+
 // Get earth gravity at a given position
 // input should be in rad
 inline double earthGravity(const Eigen::Vector3d& lla) {
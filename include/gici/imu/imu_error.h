@@ -41,6 +41,7 @@
 #pragma once
 
 #include <mutex>
+#include <atomic>
 
 #pragma diagnostic push
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
@@ -130,7 +131,7 @@ public:
   /// \@param[in] imu_parameters The parameters to be used.
   /// \@param[in] t_0 Start time.
   /// \@param[in] t_1 End time.
-  ImuError(const ImuMeasurements &imu_measurements,
+  ImuError(const ImuMeasurementVector &imu_measurements,
            const ImuParameters& imu_parameters, const double &t_0,
            const double &t_1);
 
@@ -147,7 +148,7 @@ public:
    * @param[out] jacobian Jacobian w.r.t. start states.
    * @return Number of integration steps.
    */
-  static int propagation(const ImuMeasurements &imu_measurements,
+  static int propagation(const ImuMeasurementVector &imu_measurements,
                          const ImuParameters& imu_params,
                          Transformation& T_WS,
                          SpeedAndBias& speed_and_biases,
@@ -166,12 +167,40 @@ public:
   int redoPreintegration(const Transformation& T_WS,
                          const SpeedAndBias& speed_and_biases) const;
 
+  /**
+   * @brief Do the pre-integration if it has not been done, or redo it if the
+   *        biases moved too far from the linearization point, see
+   *        setFirstOrderBiasCorrection().
+   * @remark This is meant to be called between solves, and not concurrently
+   *         with Evaluate().
+   * @param[in] T_WS Start pose.
+   * @param[in] speed_and_biases Start speed and biases.
+   * @return True if the pre-integration was redone.
+   */
+  bool relinearize(const Transformation& T_WS,
+                   const SpeedAndBias& speed_and_biases) const;
+
   // setters
   void setRedo(const bool redo = true) const
   {
     redo_ = redo;
   }
 
+  /// \brief Only apply first-order bias corrections in Evaluate(), and leave
+  ///        the re-integration to relinearize(). Evaluate() does not lock
+  ///        once the pre-integration has been done.
+  /// \@param[in] gyro_threshold Gyro bias change times delta t to
+  ///            relinearize. [rad]
+  /// \@param[in] acc_threshold Accelerometer bias change times delta t to
+  ///            relinearize. [m/s]
+  void setFirstOrderBiasCorrection(const double gyro_threshold,
+                                   const double acc_threshold)
+  {
+    first_order_bias_correction_ = true;
+    relinearization_gyro_threshold_ = gyro_threshold;
+    relinearization_acc_threshold_ = acc_threshold;
+  }
+
   /// \brief (Re)set the parameters.
   /// \@param[in] imuParameters The parameters to be used.
   void setImuParameters(const ImuParameters& imuParameters)
@@ -180,7 +209,7 @@ public:
   }
 
   /// \brief (Re)set the measurements
-  void setImuMeasurements(const ImuMeasurements& imu_measurements)
+  void setImuMeasurements(const ImuMeasurementVector& imu_measurements)
   {
     imu_measurements_.clear();
     auto it_imu = imu_measurements.rbegin();
@@ -221,6 +250,18 @@ public:
   /// \brief Get the end time.
   double t1() const { return t1_; }
 
+  /// \brief Get the number of pre-integrations of this error term.
+  int redoCounter() const { return redoCounter_; }
+
+  /// \brief Number of pre-integrations redone inside Evaluate(), for all
+  ///        error terms.
+  static size_t numRedoInEvaluation() { return num_redo_in_evaluation_; }
+
+  /// \brief Number of pre-integrations redone by relinearize(), for all
+  ///        error terms.
+  static size_t numRedoInRelinearization()
+  { return num_redo_in_relinearization_; }
+
   // error term and Jacobian implementation
   /**
    * @brief This evaluates the error term and additionally computes the Jacobians.
@@ -321,11 +362,25 @@ protected:
   /// \brief Reference biases that are updated when called redoPreintegration.
   mutable SpeedAndBias speed_and_biases_ref_ = SpeedAndBias::Zero();
 
-  mutable bool redo_ = true;
+  mutable std::atomic<bool> redo_{true};
   ///< Keeps track of whether or not this redoPreintegration() needs to be done.
-  mutable int redoCounter_ = 0;
+  ///< It is only cleared after the pre-integration is done, so that a lock-free
+  ///< reader never sees a partially integrated term.
+  mutable std::atomic<int> redoCounter_{0};
   ///< Counts the number of preintegrations for statistics.
 
+  bool first_order_bias_correction_ = false;
+  ///< Do not redo the preintegration in Evaluate().
+  double relinearization_gyro_threshold_ = 1.0e-4;
+  ///< Gyro bias change times delta t to relinearize. [rad]
+  double relinearization_acc_threshold_ = 1.0e-2;
+  ///< Accelerometer bias change times delta t to relinearize. [m/s]
+
+  static std::atomic<size_t> num_redo_in_evaluation_;
+  ///< Counts the preintegrations in Evaluate() of all error terms.
+  static std::atomic<size_t> num_redo_in_relinearization_;
+  ///< Counts the preintegrations in relinearize() of all error terms.
+
   // information matrix and its square root
   mutable information_t information_;
   ///< The information matrix for this error term.
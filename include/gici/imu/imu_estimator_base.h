@@ -11,6 +11,8 @@
 #include "gici/estimate/estimator_base.h"
 #include "gici/imu/imu_common.h"
 #include "gici/imu/imu_types.h"
+#include "gici/imu/imu_ring_buffer.h"
+#include "gici/imu/imu_preintegration_manager.h"
 #include "gici/utility/transform.h"
 
 namespace gici {
@@ -54,8 +56,37 @@ struct ImuEstimatorBaseOptions {
 
   // Maximum angular rate to apply car motion constraints (deg/s)
   double car_motion_max_anguler_velocity = 5.0;
+
+  // If only apply first-order bias corrections to IMU pre-integrations while solving.
+  // The pre-integrations are redone in parallel before each solve, when the bias changes
+  // exceed the following thresholds, and the IMU errors are evaluated without locking.
+  // Otherwise, each IMU error locks in Evaluate() and re-integrates there when its gyro
+  // bias moved, and the pre-integrations are not prepared before the solve.
+  bool use_first_order_bias_correction = false;
+
+  // Gyroscope bias change multiplied by pre-integration duration to redo (rad)
+  double relinearization_gyro_threshold = 1.0e-4;
+
+  // Accelerometer bias change multiplied by pre-integration duration to redo (m/s)
+  double relinearization_acc_threshold = 1.0e-2;
+
+  // Number of IMU samples between cached integration checkpoints for getXXXAt functions.
+  // The checkpoints are rebuilt by the backend after each update. Set 0 to integrate
+  // from the estimated state at each call.
+  int propagation_checkpoint_interval = 20;
+
+  // Capacity of the IMU measurement buffer, rounded up to a power of two. The oldest 
+  // measurements are dropped with a warning if it is full, e.g. when the backend pauses
+  // for longer than the buffer covers (about 160 s of 200 Hz IMU with the default). 
+  int imu_buffer_capacity = 32768;
+
+  // If output IMU-rate solutions from a forward propagator on the IMU input thread, 
+  // instead of querying the estimator. Only works when outputs are aligned to IMU.
+  bool use_forward_propagation = false;
 };
 
+class ImuError;
+
 // Estimator
 class ImuEstimatorBase : public virtual EstimatorBase {
 public:
@@ -68,6 +99,9 @@ public:
   // Add IMU meausrement
   virtual void addImuMeasurement(const ImuMeasurement& imu_measurement);
 
+  // Add a batch of IMU measurements with one buffer modification
+  virtual void addImuMeasurements(const ImuMeasurementBatch& imu_measurements);
+
   // Rotate translation variable from IMU frame to body frame
   inline Eigen::Vector3d rotateImuToBody(const Eigen::Vector3d& p_I) {
     return T_BI_ * p_I;
@@ -111,6 +145,9 @@ public:
     gravity_setted_ = true;
   }
 
+  // Get gravity
+  double getGravity() const { return imu_base_options_.imu_parameters.g; }
+
   // IMU integration
   bool imuIntegration(const double last_timestamp, const double timestamp, 
     Transformation& T_WS, SpeedAndBias& speed_and_bias);
@@ -143,9 +180,22 @@ public:
   bool getCovarianceAt(
     const double timestamp, Eigen::Matrix<double, 15, 15>& covariance) override;
 
+  // Solve current graph, with IMU pre-integrations updated beforehand if enabled
+  void optimize() override;
+
+  // Rebuild the integration checkpoints from the latest estimate. Called by the backend
+  // thread after each update, so that the getXXXAt functions only read and extend them.
+  void updateImuCheckpoints();
+
   // Get lastest IMU measurement timestamp
   double latestImuMeasurementTimestamp() 
-  { return imu_measurements_.size() == 0 ? 0.0 : imu_measurements_.back().timestamp; }
+  {
+    ImuMeasurement imu;
+    return imu_measurements_.tryBack(imu) ? imu.timestamp : 0.0;
+  }
+
+  // Get number of IMU measurements dropped because the buffer was full
+  size_t numDroppedImuMeasurements() const { return num_dropped_imu_measurements_; }
 
 protected:
   // Add IMU speed and bias block to graph
@@ -255,14 +305,34 @@ protected:
   // Get a IMU measurement near given timestamp
   ImuMeasurement getImuMeasurementNear(const double timestamp);
 
+  // Get IMU measurements that cover the given time range. The returned buffer
+  // belongs to the calling thread and is overwritten by its next call.
+  const ImuMeasurementVector& getImuMeasurementsBetween(
+    const double start_timestamp, const double end_timestamp);
+
+  // Get the timestamp of the n-th IMU measurement after given timestamp
+  bool getImuTimestampAfter(const double timestamp, const int n, double& timestamp_after);
+
+  // Count and report the IMU measurements dropped by the buffer
+  void handleDroppedImuMeasurements(const size_t num_dropped);
+
+  // Get a pose and speed and bias from cached checkpoints and IMU integration
+  bool getMotionFromCheckpoints(
+    const State& base_state, const double timestamp, 
+    Transformation& T_WS, SpeedAndBias& speed_and_bias,
+    Eigen::Matrix<double, 15, 15>& covariance);
+
 protected:
   // Options
   ImuEstimatorBaseOptions imu_base_options_;
 
   // Measurements
-  ImuMeasurements imu_measurements_;
+  ImuRingBuffer imu_measurements_;
   bool do_not_remove_imu_measurements_ = false;
-  std::mutex imu_mutex_, imu_state_mutex_;
+  std::atomic<size_t> num_dropped_imu_measurements_{0};
+  bool dropping_imu_measurements_ = false;
+  ImuMeasurementVector imu_measurements_in_body_;
+  std::mutex imu_state_mutex_;
 
   // Body to IMU transformation to rotate variables
   Transformation T_BI_;
@@ -276,7 +346,24 @@ protected:
   Transformation last_T_WS_;
   SpeedAndBias last_speed_and_bias_;
   Eigen::Matrix<double, 15, 15> last_covariance_;
-  bool need_covariance_ = false;
+  std::atomic<bool> need_covariance_{false};
+
+  // Integration checkpoints from the base state for getXXXAt functions
+  struct ImuCheckpoint {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    double timestamp;
+    Transformation T_WS;
+    SpeedAndBias speed_and_bias;
+    Eigen::Matrix<double, 15, 15> covariance;
+  };
+  std::vector<ImuCheckpoint, Eigen::aligned_allocator<ImuCheckpoint>> imu_checkpoints_;
+  bool imu_checkpoints_with_covariance_ = false;
+  // built by the backend and swapped with the above
+  std::vector<ImuCheckpoint, Eigen::aligned_allocator<ImuCheckpoint>> 
+    imu_checkpoints_update_;
+
+  // Parallel (re-)integration of IMU pre-integrations before solves
+  ImuPreintegrationManager imu_preintegration_manager_;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,67 @@
+/**
+* @Function: Forward IMU propagation for low-latency outputs
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#pragma once
+
+#include <memory>
+
+#include "gici/estimate/estimator_types.h"
+#include "gici/imu/imu_estimator_base.h"
+
+namespace gici {
+
+// Forward propagator
+// The backend hands over its latest solution by setBaseState(), which is stored as an
+// immutable snapshot and swapped atomically. The IMU thread integrates every incoming
+// sample from its current state immediately. When it sees a new snapshot, it replays the
+// buffered samples from the new base state once and then continues sample by sample.
+// The IMU thread never waits for the backend.
+class ImuForwardPropagator {
+public:
+  ImuForwardPropagator(const ImuEstimatorBaseOptions& options,
+                       const bool propagate_covariance);
+  ~ImuForwardPropagator();
+
+  // Set the latest backend solution as base state. Called by the backend thread.
+  void setBaseState(const Solution& solution, const double gravity);
+
+  // Drop the base state, for example when the backend is reset
+  void reset();
+
+  // Integrate a raw IMU measurement and get the propagated solution. Called by the
+  // IMU thread. Returns false if we do not have a base state.
+  bool propagate(const ImuMeasurement& imu_measurement, Solution& solution);
+
+private:
+  // Snapshot of backend solution
+  struct BaseState {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    Solution solution;
+    double gravity;
+  };
+
+  // Integrate current state to given timestamp with buffered measurements
+  void integrate(const double timestamp);
+
+private:
+  ImuEstimatorBaseOptions options_;
+  bool propagate_covariance_;
+
+  // Written by the backend thread, accessed with std::atomic_load/atomic_store
+  std::shared_ptr<const BaseState> base_state_;
+
+  // Only accessed by the IMU thread
+  std::shared_ptr<const BaseState> used_base_state_;
+  ImuMeasurements imu_measurements_;
+  ImuMeasurementVector integration_measurements_;
+  Solution state_;
+};
+
+using ImuForwardPropagatorPtr = std::shared_ptr<ImuForwardPropagator>;
+
+}
@@ -0,0 +1,49 @@
+/**
+* @Function: Parallel pre-integration of the IMU error terms in a window
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "gici/estimate/graph.h"
+#include "gici/imu/imu_error.h"
+#include "gici/utility/thread_pool.h"
+
+namespace gici {
+
+// IMU pre-integration manager
+// Before each solve, the IMU error terms in the graph that are not integrated yet, or
+// whose biases moved away from their linearization points, are (re-)integrated across
+// a worker pool. The error terms should be in first-order bias correction mode, so that
+// they are never integrated inside Evaluate() while solving, and Evaluate() can read
+// the pre-integrations without locking.
+class ImuPreintegrationManager {
+public:
+  // The calling thread also takes tasks, so num_threads - 1 workers are created
+  ImuPreintegrationManager(const int num_threads);
+  ~ImuPreintegrationManager();
+
+  // Redo the pre-integrations that need it. Returns the number of redone ones.
+  size_t update(const std::shared_ptr<Graph>& graph);
+
+private:
+  // An error term and its current start speed and bias
+  struct Item {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    std::shared_ptr<ImuError> imu_error;
+    SpeedAndBias speed_and_bias;
+    bool redone;
+  };
+
+  ThreadPoolPtr thread_pool_;
+  size_t num_tasks_;
+  std::vector<Item, Eigen::aligned_allocator<Item>> items_;
+};
+
+}
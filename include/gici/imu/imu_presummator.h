@@ -0,0 +1,55 @@
+/**
+* @Function: Combine high-rate IMU samples into coning and sculling compensated increments
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#pragma once
+
+#include <memory>
+
+#include "gici/imu/imu_types.h"
+
+namespace gici {
+
+// IMU pre-summation
+// Raw samples are integrated into delta-angle and delta-velocity increments over
+// intervals of the given rate, with second-order coning and sculling compensations.
+// Each increment is converted back to an equivalent measurement, which is the mean
+// rate over the interval, expressed in the body frame at the middle of the interval
+// and time tagged there. So it can be consumed by the estimators as a normal sample.
+class ImuPresummator {
+public:
+  ImuPresummator(const double rate);
+  ~ImuPresummator();
+
+  // Add a raw measurement. Returns true if a combined measurement is ready.
+  bool add(const ImuMeasurement& measurement, ImuMeasurement& combined);
+
+  // Drop the current increments
+  void reset();
+
+private:
+  // Clear increments and start a new interval from the last measurement
+  void restart();
+
+private:
+  double interval_;
+
+  // Last raw measurement
+  bool has_last_ = false;
+  ImuMeasurement last_;
+
+  // Increments since the start of current interval, in the body frame at start
+  double start_timestamp_;
+  Eigen::Vector3d delta_angle_;
+  Eigen::Vector3d delta_velocity_;
+  Eigen::Vector3d coning_;
+  Eigen::Vector3d sculling_;
+};
+
+using ImuPresummatorPtr = std::shared_ptr<ImuPresummator>;
+
+}
@@ -0,0 +1,120 @@
+/**
+* @Function: Fixed-capacity IMU measurement buffer with lock-free readers
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "gici/imu/imu_types.h"
+
+namespace gici {
+
+// IMU measurement ring buffer
+// Measurements are stored in a pre-allocated ring, ordered by timestamp. Only readers
+// are lock-free: every modification takes a writer mutex, which in normal operation is
+// only contended by the IMU input thread. Readers are protected by a sequence lock and
+// retry if a writer modified the buffer while they were copying. The slots are stored
+// as atomic words, so that a reader racing with a writer reads stale or torn values
+// that are discarded by the retry, instead of causing a data race.
+class ImuRingBuffer {
+public:
+  // The capacity is rounded up to a power of two
+  ImuRingBuffer(const size_t capacity);
+  ~ImuRingBuffer();
+
+  // Writer functions
+
+  // Append a measurement, the oldest one is dropped if the buffer is full.
+  // Returns the number of dropped measurements.
+  size_t pushBack(const ImuMeasurement& measurement);
+
+  // Append measurements in one modification, the oldest ones are dropped if the
+  // buffer is full. Returns the number of dropped measurements.
+  size_t pushBack(const ImuMeasurement *measurements, const size_t size);
+
+  // Prepend a measurement, returns false if the buffer is full
+  bool pushFront(const ImuMeasurement& measurement);
+
+  // Erase the measurements older than given timestamp
+  void popFrontBefore(const double timestamp);
+
+  // Reader functions
+
+  // Number of measurements
+  size_t size() const;
+
+  // Maximum number of measurements
+  size_t capacity() const { return mask_ + 1; }
+
+  // Check if the buffer is empty
+  bool empty() const { return size() == 0; }
+
+  // Get the oldest measurement in one read, returns false if the buffer is empty
+  bool tryFront(ImuMeasurement& measurement) const;
+
+  // Get the latest measurement in one read, returns false if the buffer is empty
+  bool tryBack(ImuMeasurement& measurement) const;
+
+  // Copy all measurements. The output is cleared first, so that a caller that keeps
+  // it across queries does not allocate once its capacity is reached.
+  void getAll(ImuMeasurementVector& measurements) const;
+
+  // Copy the measurements that cover the given time range, i.e. the ones in the range
+  // plus the last one before and the first one after it. The output is cleared first.
+  void getBetween(const double start_timestamp, const double end_timestamp,
+                  ImuMeasurementVector& measurements) const;
+
+  // Get the timestamp of the n-th measurement after given timestamp
+  bool getTimestampAfter(const double timestamp, const size_t n,
+                         double& timestamp_after) const;
+
+private:
+  // Number of words of a slot: timestamp, angular velocity and linear acceleration
+  static constexpr size_t kSlotWords = 7;
+
+  // Store a measurement to the slot of a logical index
+  void storeSlot(const uint64_t index, const ImuMeasurement& measurement);
+
+  // Load the measurement in the slot of a logical index
+  ImuMeasurement loadSlot(const uint64_t index) const;
+
+  // Load a word of the slot of a logical index
+  double loadWord(const uint64_t index, const size_t word) const;
+
+  // Load the timestamp in the slot of a logical index
+  inline double loadTimestamp(const uint64_t index) const {
+    return loadWord(index, 0);
+  }
+
+  // First logical index in [begin, end) whose timestamp is larger than given one
+  uint64_t upperBound(uint64_t begin, uint64_t end, const double timestamp) const;
+
+  // Run a read operation until no writer interfered
+  template<typename Function>
+  void read(Function&& function) const;
+
+  // Mark the begin and end of a modification
+  void beginWrite();
+  void endWrite();
+
+private:
+  std::unique_ptr<std::atomic<uint64_t>[]> buffer_;
+  uint64_t mask_;
+
+  // Logical indexes of the oldest measurement and the one after the latest measurement
+  std::atomic<uint64_t> head_{0};
+  std::atomic<uint64_t> tail_{0};
+
+  // Odd while a writer is modifying the buffer
+  std::atomic<uint64_t> sequence_{0};
+  std::mutex writer_mutex_;
+};
+
+}
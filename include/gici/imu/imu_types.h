@@ -42,6 +42,25 @@ struct ImuMeasurement
 };
 typedef std::deque<ImuMeasurement,
 Eigen::aligned_allocator<ImuMeasurement> > ImuMeasurements;
+typedef std::vector<ImuMeasurement,
+Eigen::aligned_allocator<ImuMeasurement> > ImuMeasurementVector;
+
+// IMU measurements decoded from one stream read, stored contiguously.
+// The capacity is fixed so that batches can be recycled by an object pool.
+struct ImuMeasurementBatch
+{
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  enum { Capacity = 500 };
+  int size = 0;
+  ImuMeasurement measurements[Capacity];
+
+  bool full() const { return size == Capacity; }
+  void push_back(const ImuMeasurement& measurement) {
+    measurements[size++] = measurement;
+  }
+  const ImuMeasurement& back() const { return measurements[size - 1]; }
+};
+using ImuMeasurementBatchPtr = std::shared_ptr<ImuMeasurementBatch>;
 
 // A simple struct to specify properties of an IMU.
 struct ImuParameters
@@ -10,6 +10,7 @@
 
 #include "gici/stream/streaming.h"
 #include "gici/estimate/estimating.h"
+#include "gici/imu/imu_presummator.h"
 
 namespace gici {
 
@@ -94,6 +95,8 @@ public:
     const std::vector<std::vector<std::string>>& roles) :
     DataIntegrationBase(estimating, streamings, formator_tags, roles) {
     valid_ = true;
+    presummation_rate_ = estimating->getImuPresummationRate();
+    batch_pool_ = std::make_shared<ObjectPool>();
   }
 
   // Data callback
@@ -104,6 +107,25 @@ protected:
   // Handle IMU data
   void handleIMU(const std::string& formator_tag, 
                  const std::shared_ptr<DataCluster::IMU>& imu);
+
+  // Handle IMU data batch
+  void handleIMUBatch(const std::string& formator_tag, 
+                      const ImuMeasurementBatchPtr& imu_batch);
+
+  // Get role of IMU formator
+  bool getRole(const std::string& formator_tag, ImuRole& role);
+
+  // Get pre-summator of IMU formator
+  const ImuPresummatorPtr& getPresummator(const std::string& formator_tag);
+
+protected:
+  // Combine raw samples of each IMU before sending to estimator. The raw samples 
+  // are still logged by the streamers and formators.
+  double presummation_rate_;
+  std::unordered_map<std::string, ImuPresummatorPtr> presummators_;
+
+  // Recycles combined IMU batches
+  ObjectPoolPtr batch_pool_;
 };
 
 // Image data integration
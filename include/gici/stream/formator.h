@@ -17,6 +17,7 @@
 #include "gici/utility/option.h"
 #include "gici/utility/rtklib_safe.h"
 #include "gici/estimate/estimator_types.h"
+#include "gici/estimate/object_pool.h"
 #include "gici/gnss/code_bias.h"
 
 namespace gici {
@@ -64,6 +65,8 @@ public:
 
   DataCluster(const MapPtr& data) : map(data) {}
 
+  DataCluster(const ImuMeasurementBatchPtr& data) : imu_batch(data) {}
+
   ~DataCluster();
 
   // GNSS data format
@@ -105,6 +108,7 @@ public:
   std::shared_ptr<GNSS> gnss;
   std::shared_ptr<Image> image;
   std::shared_ptr<IMU> imu;
+  ImuMeasurementBatchPtr imu_batch;  // IMU data in sensor frame decoded in batch
   std::shared_ptr<Option> option;
 
   // Output data types
@@ -180,9 +184,9 @@ public:
   virtual int decode(const uint8_t *buf, int size, 
     std::vector<std::shared_ptr<DataCluster>>& data) = 0;
 
-  // Encode data to stream
+  // Encode data to stream, size is the capacity of buf
   virtual int encode(
-    const std::shared_ptr<DataCluster>& data, uint8_t *buf) = 0;
+    const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size) = 0;
 
   // Get formator type
   FormatorType getType() { return type_; }
@@ -211,7 +215,7 @@ public:
     std::vector<std::shared_ptr<DataCluster>>& data) override;
 
   // Encode data to stream
-  int encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf) override;
+  int encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size) override;
 
 protected:
   rtcm_t rtcm_;
@@ -233,7 +237,7 @@ public:
     std::vector<std::shared_ptr<DataCluster>>& data) override;
 
   // Encode data to stream
-  int encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf) override;
+  int encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size) override;
 
 protected:
   rtcm_t rtcm_;
@@ -256,7 +260,7 @@ public:
     std::vector<std::shared_ptr<DataCluster>>& data) override;
 
   // Encode data to stream
-  int encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf) override;
+  int encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size) override;
 
 protected:
   raw_t raw_;
@@ -281,7 +285,7 @@ public:
     std::vector<std::shared_ptr<DataCluster>>& data) override;
 
   // Encode data to stream
-  int encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf) override;
+  int encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size) override;
 
 protected:
   img_t image_;
@@ -305,7 +309,7 @@ public:
     std::vector<std::shared_ptr<DataCluster>>& data) override;
 
   // Encode data to stream
-  int encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf) override;
+  int encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size) override;
 
 protected:
   img_t image_;
@@ -327,10 +331,13 @@ public:
     std::vector<std::shared_ptr<DataCluster>>& data) override;
 
   // Encode data to stream
-  int encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf) override;
+  int encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size) override;
 
 protected:
   imu_t imu_;
+
+  // Recycles decoded IMU batches
+  ObjectPoolPtr batch_pool_;
 };
 
 // Option
@@ -349,7 +356,7 @@ public:
     std::vector<std::shared_ptr<DataCluster>>& data) override;
 
   // Encode data to stream
-  int encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf) override;
+  int encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size) override;
 
 protected:
 
@@ -377,7 +384,7 @@ public:
     std::vector<std::shared_ptr<DataCluster>>& data) override;
 
   // Encode data to stream
-  int encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf) override;
+  int encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size) override;
 
 protected:
   // Encode GNGGA message
@@ -418,7 +425,7 @@ public:
     std::vector<std::shared_ptr<DataCluster>>& data) override;
 
   // Encode data to stream
-  int encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf) override;
+  int encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size) override;
 
 protected:
   const int max_line_length_ = 128;
@@ -447,7 +454,7 @@ public:
     std::vector<std::shared_ptr<DataCluster>>& data) override;
 
   // Encode data to stream
-  int encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf) override;
+  int encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size) override;
 
 private:
   // Add antenna parameter
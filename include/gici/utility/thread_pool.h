@@ -0,0 +1,54 @@
+/**
+* @Function: Small worker pool for parallel tasks
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+
+namespace gici {
+
+// Worker pool
+// Threads are created once and wait for tasks. The calling thread of run()
+// also takes tasks, so that a pool of N threads runs N + 1 tasks at a time.
+class ThreadPool {
+public:
+  ThreadPool(const size_t num_threads);
+  ~ThreadPool();
+
+  // Run tasks and wait until all of them finished
+  void run(const std::vector<std::function<void()>>& tasks);
+
+  // Number of worker threads
+  size_t size() const { return threads_.size(); }
+
+private:
+  // Worker loop
+  void work();
+
+  // Take and execute one task of the batch, returns false if no task left
+  bool executeOne(std::unique_lock<std::mutex>& lock);
+
+private:
+  std::vector<std::thread> threads_;
+  std::deque<std::function<void()>> tasks_;
+  size_t num_running_ = 0;
+  bool quit_ = false;
+  std::mutex mutex_;
+  std::condition_variable task_condition_;
+  std::condition_variable done_condition_;
+};
+
+using ThreadPoolPtr = std::shared_ptr<ThreadPool>;
+
+}
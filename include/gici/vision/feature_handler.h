@@ -59,6 +59,10 @@ struct FeatureHandlerOptions {
   // Feature detector options
   DetectorOptions detector;
 
+  // Number of threads for FAST feature detection. If larger than 1, the pyramid
+  // levels are split into row bands and detected in parallel.
+  int num_detection_threads = 1;
+
   // Feature tracker options
   FeatureTrackerOptions tracker;
 
@@ -8,6 +8,8 @@
 **/
 #pragma once
 
+#include <deque>
+
 #include "gici/utility/svo.h"
 
 namespace gici {
@@ -57,8 +59,20 @@ private:
       const std::vector<cv::Point2f>& ref_points,
       std::vector<cv::Point2f>& pre_points);
 
+  // Get the LK pyramid of a frame. The pyramids (with padded gradient levels) are
+  // built once and cached for the recent frames, because a frame is usually tracked
+  // as current frame and then as reference frame.
+  std::vector<cv::Mat> getPyramid(const FramePtr& frame);
+
 protected: 
   FeatureTrackerOptions options_;
+
+  // Cached LK pyramids of recent frames, the latest used one at back
+  struct FramePyramid {
+    int frame_id;
+    std::vector<cv::Mat> pyramid;
+  };
+  std::deque<FramePyramid> pyramids_;
 };
 
 using FeatureTrackerPtr = std::shared_ptr<FeatureTracker>;
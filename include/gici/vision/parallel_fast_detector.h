@@ -0,0 +1,58 @@
+/**
+* @Function: FAST feature detection in parallel row bands
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#pragma once
+
+#include <svo/direct/feature_detection.h>
+
+#include "gici/utility/svo.h"
+#include "gici/utility/thread_pool.h"
+
+namespace gici {
+
+// Parallel FAST detector
+// Each pyramid level is split into row bands, which are detected on a worker pool.
+// Every band takes the best corner of each occupancy grid cell, and the bands are
+// merged in the order of the serial detector, so the result is identical to the
+// one of svo::FastDetector.
+class ParallelFastDetector : public svo::FastDetector {
+public:
+  // The calling thread also takes tasks, so num_threads - 1 workers are created
+  ParallelFastDetector(const DetectorOptions& options,
+                       const CameraPtr& cam, const int num_threads);
+  virtual ~ParallelFastDetector() = default;
+
+  virtual void detect(
+      const svo::ImgPyr& img_pyr,
+      const cv::Mat& mask,
+      const size_t max_n_features,
+      Keypoints& px_vec,
+      Scores& score_vec,
+      Levels& level_vec,
+      Gradients& grad_vec,
+      FeatureTypes& types_vec) override;
+
+private:
+  // Rows of a pyramid level and the best corners of the cells in them
+  struct Band {
+    size_t level;
+    int row_begin;
+    int row_end;
+    std::vector<std::pair<size_t, svo::Corner>> best_corners;
+  };
+
+  // Detect FAST corners in a band and keep the best one of each cell
+  void detectBand(const cv::Mat& img, Band& band) const;
+
+private:
+  ThreadPoolPtr thread_pool_;
+  int num_threads_;
+  std::vector<Band> bands_;
+};
+
+}
@@ -314,6 +314,18 @@ void RosStream::outputDataCallback(
   else if (data->imu) {
     imuDataOutputCallback(*data->imu);
   }
+  else if (data->imu_batch) {
+    for (int i = 0; i < data->imu_batch->size; i++) {
+      const ImuMeasurement& measurement = data->imu_batch->measurements[i];
+      DataCluster::IMU imu;
+      imu.time = measurement.timestamp;
+      for (int k = 0; k < 3; k++) {
+        imu.acceleration[k] = measurement.linear_acceleration(k);
+        imu.angular_velocity[k] = measurement.angular_velocity(k);
+      }
+      imuDataOutputCallback(imu);
+    }
+  }
   else if (data->image) {
     imageDataOutputCallback(*data->image);
   }
@@ -18,6 +18,7 @@ const std::map<ErrorType, std::string> kErrorToStr
   {ErrorType::kPseudorangeError, std::string("PseudorangeError") },
   {ErrorType::kPseudorangeErrorSD, std::string("PseudorangeErrorSD") },
   {ErrorType::kPseudorangeErrorDD, std::string("PseudorangeErrorDD") },
+  {ErrorType::kPseudorangeErrorBatch, std::string("PseudorangeErrorBatch") },
   {ErrorType::kPhaserangeError, std::string("PhaserangeError") },
   {ErrorType::kPhaserangeErrorSD, std::string("PhaserangeErrorSD") },
   {ErrorType::kPhaserangeErrorDD, std::string("PhaserangeErrorDD") },
@@ -78,6 +78,11 @@ EstimatingBase::EstimatingBase(
   }
   output_downsample_cnt_ = 0;
 
+  // IMU pre-summation rate
+  if (!option_tools::safeGet(node, "imu_presummation_rate", &imu_presummation_rate_)) {
+    imu_presummation_rate_ = 0.0;
+  }
+
   solution_.timestamp = 0.0;
 }
 
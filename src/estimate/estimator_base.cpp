@@ -8,18 +8,24 @@
 **/
 #include "gici/estimate/estimator_base.h"
 
+#include <iomanip>
+
 #include "gici/gnss/gnss_parameter_blocks.h"
 
 namespace gici {
 
 // The default constructor
 EstimatorBase::EstimatorBase(const EstimatorBaseOptions& options) :
-  base_options_(options), graph_(std::make_shared<Graph>()),
+  base_options_(options),
+  graph_(std::make_shared<Graph>(options.incremental_ordering)),
   cauchy_loss_function_(new ceres::CauchyLoss(1)),
   huber_loss_function_(new ceres::HuberLoss(1)),
   marginalization_residual_id_(0), status_(EstimatorStatus::Initializing)
 {
   marginalization_error_.reset(new MarginalizationError(*graph_.get()));
+  marginalization_error_->setBlockSparse(options.block_sparse_marginalization);
+  marginalization_error_->setSquareRoot(options.square_root_marginalization);
+  if (options.use_object_pool) object_pool_ = std::make_shared<ObjectPool>();
 }
 
 // The default destructor
@@ -33,8 +39,13 @@ void EstimatorBase::optimize()
   graph_->options.trust_region_strategy_type = base_options_.trust_region_strategy_type;
   graph_->options.num_threads = base_options_.num_threads;
   graph_->options.max_num_iterations = base_options_.max_iteration;
+  graph_->solver_type = base_options_.graph_solver_type;
+  graph_->solver_options.max_iteration = base_options_.max_iteration;
 #ifdef NDEBUG
   graph_->options.max_solver_time_in_seconds = base_options_.max_solver_time;
+  graph_->solver_options.max_solver_time = base_options_.max_solver_time;
+#else
+  graph_->solver_options.max_solver_time = 1.0e6;
 #endif
 
   if (base_options_.verbose_output) {
@@ -45,6 +56,14 @@ void EstimatorBase::optimize()
     graph_->options.minimizer_progress_to_stdout = false;
   }
 
+  // update terms held fixed while solving
+  updateBeforeSolve();
+
+  // compare backends
+  if (base_options_.benchmark_graph_solver) {
+    benchmarkGraphSolver();
+  }
+
   // call solver
   graph_->solve();
 
@@ -54,6 +73,45 @@ void EstimatorBase::optimize()
   }
 }
 
+// Solve current graph with both backends and log the comparison
+void EstimatorBase::benchmarkGraphSolver()
+{
+  // Store current parameters
+  std::vector<std::pair<std::shared_ptr<ParameterBlock>, std::vector<double>>> backup;
+  for (const auto& it : graph_->idToParameterBlockMap()) {
+    const double* parameters = it.second->parameters();
+    backup.push_back(std::make_pair(it.second, 
+      std::vector<double>(parameters, parameters + it.second->dimension())));
+  }
+  auto restore = [&backup]() {
+    for (auto& it : backup) {
+      memcpy(it.first->parameters(), it.second.data(), 
+        it.second.size() * sizeof(double));
+    }
+  };
+
+  const GraphSolverType solver_type = graph_->solver_type;
+  std::vector<GraphSolverType> types = 
+    { GraphSolverType::Ceres, GraphSolverType::GaussNewton };
+  std::vector<ceres::Solver::Summary> summaries;
+  for (auto type : types) {
+    graph_->solver_type = type;
+    graph_->solve();
+    summaries.push_back(graph_->summary);
+    restore();
+  }
+  graph_->solver_type = solver_type;
+
+  LOG(INFO) << estimatorTypeToString(type_) << " solver benchmark: " 
+    << std::scientific << std::setprecision(3)
+    << "Ceres: " << summaries[0].total_time_in_seconds * 1.0e3 << " ms, "
+    << summaries[0].iterations.size() << " iterations, cost " 
+    << summaries[0].initial_cost << " -> " << summaries[0].final_cost << "; "
+    << "Gauss-Newton: " << summaries[1].total_time_in_seconds * 1.0e3 << " ms, "
+    << summaries[1].iterations.size() << " iterations, cost " 
+    << summaries[1].initial_cost << " -> " << summaries[1].final_cost;
+}
+
 // Erase old marginalization item
 bool EstimatorBase::eraseOldMarginalization()
 {
@@ -43,6 +43,7 @@
 
 #include "gici/estimate/graph.h"
 
+#include <unordered_set>
 #include <ceres/ordered_groups.h>
 
 #include "gici/estimate/homogeneous_point_parameter_block.h"
@@ -51,9 +52,40 @@
 
 namespace gici {
 
+namespace {
+
+// Elimination group of a parameter block in the incremental ordering.
+// Landmarks are eliminated first, then ambiguities, and the states last.
+int defaultEliminationGroup(uint64_t parameter_block_id)
+{
+  const IdType type = BackendId(parameter_block_id).type();
+  if (type == IdType::cLandmark) return 0;
+  if (type == IdType::gAmbiguity) return 1;
+  return 2;
+}
+
+// Expected book-keeping sizes of a full window, used to pre-size the maps so that
+// they do not rehash while the window fills up. The largest windows are the visual
+// ones: 10 keyframes with up to 120 features each give about 1000 landmarks, which
+// dominate the number of parameter blocks.
+constexpr size_t kExpectedParameterBlocks = 1024;
+
+// Each landmark is observed by a few keyframes, and the GNSS windows carry tens of
+// code, phase and Doppler residuals per epoch, so about 4 residuals per block.
+constexpr size_t kExpectedResidualBlocks = 4 * kExpectedParameterBlocks;
+
+// Reprojection and most GNSS residuals connect 2 parameter blocks on average,
+// and each connection is one entry of the parameter-to-residual multimap.
+constexpr size_t kExpectedResidualConnections = 2 * kExpectedResidualBlocks;
+
+}
+
 // Constructor.
-Graph::Graph()
-    : residual_counter_(0)
+Graph::Graph(const bool incremental_ordering)
+    : residual_counter_(0),
+      structure_version_(0),
+      ordering_check_version_(0),
+      ordering_usable_for_schur_(false)
 {
   ceres::Problem::Options problemOptions;
   problemOptions.local_parameterization_ownership =
@@ -62,9 +94,22 @@ Graph::Graph()
       ceres::Ownership::DO_NOT_TAKE_OWNERSHIP;
   problemOptions.cost_function_ownership =
       ceres::Ownership::DO_NOT_TAKE_OWNERSHIP;
-  //problemOptions.enable_fast_parameter_block_removal = true;
+  if (incremental_ordering) {
+    // The sliding window removes blocks at every epoch, and all the blocks
+    // are checked by our own book-keeping before they go into ceres.
+    problemOptions.enable_fast_removal = true;
+    problemOptions.disable_all_safety_checks = true;
+    linear_solver_ordering_ = std::make_shared<ceres::ParameterBlockOrdering>();
+  }
   problem_.reset(new ceres::Problem(problemOptions));
-  //options.linear_solver_ordering = new ceres::ParameterBlockOrdering;
+
+  // Pre-size the book-keeping for a full window to avoid rehashing
+  // while the window fills up.
+  id_to_parameter_block_map_.reserve(kExpectedParameterBlocks);
+  residual_block_id_to_residual_block_spec_map_.reserve(kExpectedResidualBlocks);
+  id_to_residual_block_multimap_.reserve(kExpectedResidualConnections);
+  residual_block_id_to_parameter_block_collection_map_.reserve(
+    kExpectedResidualBlocks);
 }
 
 // Check whether a certain parameter block is part of the graph.
@@ -282,9 +327,8 @@ bool Graph::isMinimalJacobianCorrect(ceres::ResidualBlockId residual_block_id,
 // Add a parameter block to the map
 bool Graph::addParameterBlock(
     std::shared_ptr<ParameterBlock> parameter_block,
-    int parameterization, const int /*group*/)
+    int parameterization, const int group)
 {
-
   CHECK(parameter_block != nullptr);
   VLOG(200) << "Adding parameter block with parameterization "
             << parameterization << " and id " << BackendId(parameter_block->id());
@@ -300,6 +344,7 @@ bool Graph::addParameterBlock(
   id_to_parameter_block_map_.insert(
       std::pair<uint64_t, std::shared_ptr<ParameterBlock> >(
           parameter_block->id(), parameter_block));
+  structure_version_++;
 
   // also add to ceres problem
   switch (parameterization)
@@ -335,6 +380,12 @@ bool Graph::addParameterBlock(
     }
   }
 
+  // maintain elimination ordering
+  if (linear_solver_ordering_) {
+    linear_solver_ordering_->AddElementToGroup(parameter_block->parameters(),
+      group < 0 ? defaultEliminationGroup(parameter_block->id()) : group);
+  }
+
   /*const LocalParamizationAdditionalInterfaces* ptr =
       dynamic_cast<const LocalParamizationAdditionalInterfaces*>(
       parameter_block->localParameterizationPtr());
@@ -361,9 +412,14 @@ bool Graph::removeParameterBlock(uint64_t parameter_block_id)
   {
     removeResidualBlock(res[i].residual_block_id);  // remove in ceres and book-keeping
   }
+  if (linear_solver_ordering_) {
+    linear_solver_ordering_->Remove(
+      parameterBlockPtr(parameter_block_id)->parameters());  // remove from ordering
+  }
   problem_->RemoveParameterBlock(
       parameterBlockPtr(parameter_block_id)->parameters());  // remove parameter block
   id_to_parameter_block_map_.erase(parameter_block_id);  // remove book-keeping
+  structure_version_++;
   return true;
 }
 
@@ -438,6 +494,7 @@ ceres::ResidualBlockId Graph::addResidualBlock(
             parameter_block_collection[parameter_id].first,
             ResidualBlockSpec(return_id, loss_function, error_interface_ptr)));
   }
+  structure_version_++;
 
   return return_id;
 }
@@ -560,6 +617,7 @@ void Graph::resetResidualBlock(
         std::pair<uint64_t, ResidualBlockSpec>(
             parameter_block_collection[parameter_id].first, spec));
   }
+  structure_version_++;
 }
 
 // Remove a residual block.
@@ -602,6 +660,7 @@ bool Graph::removeResidualBlock(ceres::ResidualBlockId residual_block_id)
   }
   residual_block_id_to_parameter_block_collection_map_.erase(it);  // remove book-keeping
   residual_block_id_to_residual_block_spec_map_.erase(residual_block_id);  // remove book-keeping
+  structure_version_++;
   return true;
 }
 
@@ -614,8 +673,10 @@ bool Graph::setParameterBlockConstant(uint64_t parameter_block_id)
   }
   std::shared_ptr<ParameterBlock> parameter_block = id_to_parameter_block_map_.find(
       parameter_block_id)->second;
+  if (parameter_block->fixed() == true) return true;
   parameter_block->setFixed(true);
   problem_->SetParameterBlockConstant(parameter_block->parameters());
+  structure_version_++;
   return true;
 }
 
@@ -639,8 +700,10 @@ bool Graph::setParameterBlockVariable(uint64_t parameter_block_id)
     return false;
   std::shared_ptr<ParameterBlock> parameter_block =
       id_to_parameter_block_map_.find(parameter_block_id)->second;
+  if (parameter_block->fixed() == false) return true;
   parameter_block->setFixed(false);
   problem_->SetParameterBlockVariable(parameter_block->parameters());
+  structure_version_++;
   return true;
 }
 
@@ -671,10 +734,13 @@ bool Graph::resetParameterization(uint64_t parameter_block_id,
   }
 
   // remove
-  // int group = options.linear_solver_ordering->GroupId(parBlockPtr->parameters());
+  int group = -1;
+  if (linear_solver_ordering_) {
+    group = linear_solver_ordering_->GroupId(par_block_ptr->parameters());
+  }
   removeParameterBlock(parameter_block_id);
   // add with new parameterization
-  addParameterBlock(par_block_ptr, parameterization/*,group*/);
+  addParameterBlock(par_block_ptr, parameterization, group);
 
   // re-assemble
   for (size_t r = 0; r < res.size(); ++r)
@@ -702,6 +768,7 @@ bool Graph::setParameterization(
       local_parameterization);
   id_to_parameter_block_map_.find(parameter_block_id)->second
       ->setLocalParameterizationPtr(local_parameterization);
+  structure_version_++;
   return true;
 }
 
@@ -737,14 +804,11 @@ std::shared_ptr<const ParameterBlock> Graph::parameterBlockPtr(
 Graph::ResidualBlockCollection Graph::residuals(uint64_t parameter_block_id) const
 {
   // get the residual blocks of a parameter block
-  IdToResidualBlockMultimap::const_iterator it1 = id_to_residual_block_multimap_
-      .find(parameter_block_id);
-  if (it1 == id_to_residual_block_multimap_.end())
-    return Graph::ResidualBlockCollection();  // empty
-  ResidualBlockCollection returnResiduals;
   std::pair<IdToResidualBlockMultimap::const_iterator,
       IdToResidualBlockMultimap::const_iterator> range =
       id_to_residual_block_multimap_.equal_range(parameter_block_id);
+  ResidualBlockCollection returnResiduals;
+  returnResiduals.reserve(std::distance(range.first, range.second));
   for (IdToResidualBlockMultimap::const_iterator it = range.first;
       it != range.second; ++it)
   {
@@ -794,11 +858,26 @@ Graph::ParameterBlockCollection Graph::parameters(
   return it->second;
 }
 
+// Get the parameters of a residual block without copying them.
+const Graph::ParameterBlockCollection& Graph::parameterCollection(
+    ceres::ResidualBlockId residual_block_id) const
+{
+  static const ParameterBlockCollection empty;
+  ResidualBlockIdToParameterBlockCollectionMap::const_iterator it =
+      residual_block_id_to_parameter_block_collection_map_.find(residual_block_id);
+  if (it == residual_block_id_to_parameter_block_collection_map_.end())
+  {
+    return empty;
+  }
+  return it->second;
+}
+
 // Get all the residual blocks
 Graph::ResidualBlockCollection Graph::residuals() const
 {
   ResidualBlockCollection returnResiduals;
-  for (auto it : residual_block_id_to_residual_block_spec_map_) {
+  returnResiduals.reserve(residual_block_id_to_residual_block_spec_map_.size());
+  for (const auto& it : residual_block_id_to_residual_block_spec_map_) {
     returnResiduals.push_back(it.second);
   }
   return returnResiduals;
@@ -808,16 +887,90 @@ Graph::ResidualBlockCollection Graph::residuals() const
 Graph::ParameterBlockCollection Graph::parameters() const
 {
   ParameterBlockCollection returnParameters;
-  for (auto it : residual_block_id_to_parameter_block_collection_map_) {
-    for (auto parameter : it.second) {
-      if (std::find(returnParameters.begin(), returnParameters.end(), parameter) 
-        != returnParameters.end()) continue;
+  std::unordered_set<uint64_t, BackendIdHash> added;
+  for (const auto& it : residual_block_id_to_parameter_block_collection_map_) {
+    for (const auto& parameter : it.second) {
+      if (!added.insert(parameter.first).second) continue;
       returnParameters.push_back(parameter);
     }
   }
   return returnParameters;
 }
 
+// Solve the optimization problem.
+void Graph::solve()
+{
+  if (solver_type == GraphSolverType::GaussNewton) {
+    if (graph_solver_ == nullptr) {
+      graph_solver_.reset(new GraphSolver(*this));
+    }
+    graph_solver_->solve(solver_options, &summary);
+    return;
+  }
+
+  // Hand our ordering over to ceres so that it does not compute one in every
+  // solve. Ceres removes the constant blocks from the given ordering in place,
+  // so it gets a copy.
+  if (linear_solver_ordering_) {
+    if (!isSchurType(options.linear_solver_type) || 
+        linearSolverOrderingUsableForSchur()) {
+      options.linear_solver_ordering = 
+        std::make_shared<ceres::ParameterBlockOrdering>(*linear_solver_ordering_);
+    }
+    else {
+      options.linear_solver_ordering.reset();
+    }
+  }
+
+  Solve(options, problem_.get(), &summary);
+}
+
+// Check if the linear solver is a Schur type
+bool Graph::isSchurType(const ceres::LinearSolverType type)
+{
+  return type == ceres::DENSE_SCHUR || type == ceres::SPARSE_SCHUR ||
+         type == ceres::ITERATIVE_SCHUR;
+}
+
+// Check if the first elimination group is an independent set
+bool Graph::linearSolverOrderingUsableForSchur()
+{
+  if (ordering_check_version_ == structure_version_ && ordering_check_version_ > 0) {
+    return ordering_usable_for_schur_;
+  }
+  ordering_check_version_ = structure_version_;
+  ordering_usable_for_schur_ = false;
+
+  // Find the first group that has variable blocks. Ceres removes the 
+  // constant blocks before it eliminates the first group.
+  const std::set<double*>* e_blocks = nullptr;
+  for (const auto& group : linear_solver_ordering_->group_to_elements()) {
+    for (double* element : group.second) {
+      if (!problem_->IsParameterBlockConstant(element)) {
+        e_blocks = &group.second; break;
+      }
+    }
+    if (e_blocks != nullptr) break;
+  }
+  if (e_blocks == nullptr) return false;
+
+  // No residual block may connect two variable blocks in this group
+  for (const auto& it : residual_block_id_to_parameter_block_collection_map_) {
+    int num_e_blocks = 0;
+    for (const auto& parameter : it.second) {
+      double* element = parameter.second->parameters();
+      if (e_blocks->count(element) == 0 || parameter.second->fixed()) continue;
+      if (++num_e_blocks > 1) return false;
+    }
+  }
+
+  // Ceres needs at least one f block
+  if (e_blocks->size() == linear_solver_ordering_->NumElements()) return false;
+
+  ordering_usable_for_schur_ = true;
+  return true;
+}
+
 // Get covariance estimation of given parameter blocks
 bool Graph::computeCovariance(
     const std::vector<uint64_t>& parameter_block_ids,
@@ -0,0 +1,588 @@
+/**
+* @Function: Fixed-structure sliding-window solver for the graph
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#include "gici/estimate/graph_solver.h"
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <glog/logging.h>
+
+#include "gici/estimate/graph.h"
+
+namespace gici {
+
+namespace {
+
+inline double getCurrentTime()
+{
+  return std::chrono::duration<double>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+// The default constructor
+GraphSolver::GraphSolver(Graph& graph) :
+  graph_(&graph), structure_version_(std::numeric_limits<uint64_t>::max()),
+  num_parameter_blocks_(0), num_residual_blocks_(0), num_minimal_(0),
+  num_backup_(0), num_residuals_(0), num_layout_rebuilds_(0), capacity_(0)
+{}
+
+// Solve the graph
+void GraphSolver::solve(
+  const GraphSolverOptions& options, ceres::Solver::Summary* summary)
+{
+  const double start_time = getCurrentTime();
+  summary->iterations.clear();
+  summary->num_successful_steps = 0;
+  summary->num_unsuccessful_steps = 0;
+  summary->linear_solver_time_in_seconds = 0.0;
+  summary->jacobian_evaluation_time_in_seconds = 0.0;
+  summary->residual_evaluation_time_in_seconds = 0.0;
+
+  // Update the book-keeping on structure changes
+  updateStructure();
+  summary->preprocessor_time_in_seconds = getCurrentTime() - start_time;
+  summary->num_parameter_blocks = num_parameter_blocks_;
+  summary->num_residual_blocks = num_residual_blocks_;
+  summary->num_effective_parameters = num_minimal_;
+  summary->num_residuals = num_residuals_;
+
+  // Linearize at the initial point
+  double t = getCurrentTime();
+  double cost = evaluate(true);
+  summary->jacobian_evaluation_time_in_seconds += getCurrentTime() - t;
+  summary->initial_cost = cost;
+  summary->final_cost = cost;
+  summary->termination_type = ceres::NO_CONVERGENCE;
+  if (num_minimal_ == 0) {
+    summary->termination_type = ceres::CONVERGENCE;
+    summary->message = "No effective parameters.";
+    summary->total_time_in_seconds = getCurrentTime() - start_time;
+    return;
+  }
+
+  const size_t n = num_minimal_;
+  double lambda = options.initial_lambda;
+  double nu = 2.0;
+  for (int iteration = 0; iteration < options.max_iteration; iteration++)
+  {
+    ceres::IterationSummary iteration_summary;
+    iteration_summary.iteration = iteration + 1;
+    iteration_summary.gradient_max_norm =
+      b_.head(n).lpNorm<Eigen::Infinity>();
+    if (iteration_summary.gradient_max_norm <= options.gradient_tolerance) {
+      summary->termination_type = ceres::CONVERGENCE;
+      summary->message = "Gradient tolerance reached.";
+      break;
+    }
+
+    // Solve damped system: (H + lambda * D) * dx = b
+    t = getCurrentTime();
+    diagonal_.head(n) = H_.diagonal().head(n).cwiseMax(1.0e-6).cwiseMin(1.0e32);
+    H_.diagonal().head(n) += lambda * diagonal_.head(n);
+    ldlt_.compute(H_.topLeftCorner(n, n));
+    H_.diagonal().head(n) -= lambda * diagonal_.head(n);
+    bool solved = (ldlt_.info() == Eigen::Success);
+    if (solved) {
+      dx_.head(n) = ldlt_.solve(b_.head(n));
+      solved = dx_.head(n).allFinite();
+    }
+    summary->linear_solver_time_in_seconds += getCurrentTime() - t;
+    if (!solved) {
+      lambda = std::min(lambda * nu, options.max_lambda);
+      nu *= 2.0;
+      summary->num_unsuccessful_steps++;
+      if (lambda >= options.max_lambda) {
+        summary->termination_type = ceres::FAILURE;
+        summary->message = "Linear solver failed.";
+        break;
+      }
+      continue;
+    }
+    iteration_summary.step_norm = dx_.head(n).norm();
+
+    // Predicted cost decrease of the linearized model
+    const double model_cost_change = dx_.head(n).dot(b_.head(n)) - 0.5 *
+      dx_.head(n).dot(H_.topLeftCorner(n, n).selfadjointView<Eigen::Upper>() *
+      dx_.head(n));
+
+    // Try step
+    backupParameters();
+    applyStep(dx_);
+    t = getCurrentTime();
+    const double new_cost = evaluate(false);
+    summary->residual_evaluation_time_in_seconds += getCurrentTime() - t;
+    const double cost_change = cost - new_cost;
+    const double relative_decrease = (model_cost_change > 0.0) ?
+      cost_change / model_cost_change : -1.0;
+    iteration_summary.cost_change = cost_change;
+    iteration_summary.relative_decrease = relative_decrease;
+    iteration_summary.trust_region_radius = 1.0 / lambda;
+
+    if (std::isfinite(new_cost) &&
+        relative_decrease > options.min_relative_decrease) {
+      // Accept
+      iteration_summary.step_is_successful = true;
+      summary->num_successful_steps++;
+      lambda *= std::max(1.0 / 3.0,
+        1.0 - std::pow(2.0 * relative_decrease - 1.0, 3));
+      lambda = std::max(lambda, options.min_lambda);
+      nu = 2.0;
+      cost = new_cost;
+
+      // Check convergence
+      double parameter_norm = 0.0;
+      for (const auto& entry : parameter_entries_) {
+        if (entry.ordering_idx < 0) continue;
+        parameter_norm += Eigen::Map<const Eigen::VectorXd>(
+          entry.block->parameters(), entry.dimension).squaredNorm();
+      }
+      parameter_norm = sqrt(parameter_norm);
+      const bool function_converged =
+        fabs(cost_change) <= options.function_tolerance * cost;
+      const bool parameter_converged = iteration_summary.step_norm <=
+        options.parameter_tolerance * (parameter_norm + options.parameter_tolerance);
+
+      // Re-linearize at the new point
+      t = getCurrentTime();
+      evaluate(true);
+      summary->jacobian_evaluation_time_in_seconds += getCurrentTime() - t;
+
+      if (function_converged || parameter_converged) {
+        iteration_summary.cost = cost;
+        iteration_summary.cumulative_time_in_seconds = getCurrentTime() - start_time;
+        summary->iterations.push_back(iteration_summary);
+        summary->termination_type = ceres::CONVERGENCE;
+        summary->message = function_converged ?
+          "Function tolerance reached." : "Parameter tolerance reached.";
+        break;
+      }
+    }
+    else {
+      // Reject
+      iteration_summary.step_is_successful = false;
+      summary->num_unsuccessful_steps++;
+      restoreParameters();
+      lambda = std::min(lambda * nu, options.max_lambda);
+      nu *= 2.0;
+    }
+    iteration_summary.cost = cost;
+    iteration_summary.cumulative_time_in_seconds = getCurrentTime() - start_time;
+    summary->iterations.push_back(iteration_summary);
+
+    if (iteration_summary.cumulative_time_in_seconds > options.max_solver_time) {
+      summary->message = "Maximum solver time reached.";
+      break;
+    }
+  }
+
+  summary->final_cost = cost;
+  summary->total_time_in_seconds = getCurrentTime() - start_time;
+  summary->minimizer_time_in_seconds =
+    summary->total_time_in_seconds - summary->preprocessor_time_in_seconds;
+}
+
+// Update the book-keeping if the graph structure changed
+void GraphSolver::updateStructure()
+{
+  if (structure_version_ == graph_->structureVersion()) return;
+  structure_version_ = graph_->structureVersion();
+
+  if (!updateParameterEntries()) rebuildOrdering();
+  updateResidualEntries();
+}
+
+// Update the parameter block entries
+bool GraphSolver::updateParameterEntries()
+{
+  for (auto& entry : parameter_entries_) entry.seen = false;
+  new_parameter_entries_.clear();
+  num_parameter_blocks_ = 0;
+
+  // Keep the entries of unchanged blocks, and add entries for new or changed ones
+  for (const auto& it : graph_->idToParameterBlockMap()) {
+    ParameterBlock* block = it.second.get();
+    num_parameter_blocks_++;
+    auto it_entry = id_to_parameter_entry_.find(it.first);
+    if (it_entry != id_to_parameter_entry_.end()) {
+      ParameterBlockEntry& entry = parameter_entries_[it_entry->second];
+      if (entry.block == block && entry.dimension == block->dimension() &&
+          entry.minimal_dimension == block->minimalDimension() &&
+          (entry.ordering_idx < 0) == block->fixed()) {
+        entry.seen = true; continue;
+      }
+      releaseParameterEntry(it_entry->second);
+    }
+
+    size_t index;
+    if (free_parameter_entries_.empty()) {
+      index = parameter_entries_.size();
+      parameter_entries_.push_back(ParameterBlockEntry());
+    }
+    else {
+      index = free_parameter_entries_.back();
+      free_parameter_entries_.pop_back();
+    }
+    ParameterBlockEntry& entry = parameter_entries_[index];
+    entry.id = it.first;
+    entry.block = block;
+    entry.dimension = block->dimension();
+    entry.minimal_dimension = block->minimalDimension();
+    entry.ordering_idx = -1;
+    entry.backup_idx = 0;
+    entry.seen = true;
+    id_to_parameter_entry_[it.first] = index;
+    if (!block->fixed()) new_parameter_entries_.push_back(index);
+  }
+
+  // Release the entries of removed blocks, their slots can be taken by new blocks
+  for (size_t i = 0; i < parameter_entries_.size(); i++) {
+    if (parameter_entries_[i].block == nullptr || parameter_entries_[i].seen) continue;
+    releaseParameterEntry(i);
+  }
+
+  // Put new variable blocks into the slots of the same size
+  bool layout_kept = true;
+  for (const size_t index : new_parameter_entries_) {
+    ParameterBlockEntry& entry = parameter_entries_[index];
+    size_t i = 0;
+    for (; i < free_slots_.size(); i++) {
+      if (free_slots_[i].dimension == entry.dimension &&
+          free_slots_[i].minimal_dimension == entry.minimal_dimension) break;
+    }
+    if (i == free_slots_.size()) {
+      layout_kept = false; continue;
+    }
+    entry.ordering_idx = free_slots_[i].ordering_idx;
+    entry.backup_idx = free_slots_[i].backup_idx;
+    free_slots_[i] = free_slots_.back();
+    free_slots_.pop_back();
+  }
+
+  // Unfilled slots would leave gaps in the normal equations
+  return layout_kept && free_slots_.empty();
+}
+
+// Release a parameter block entry and keep its slot
+void GraphSolver::releaseParameterEntry(const size_t index)
+{
+  ParameterBlockEntry& entry = parameter_entries_[index];
+  if (entry.ordering_idx >= 0) {
+    Slot slot;
+    slot.dimension = entry.dimension;
+    slot.minimal_dimension = entry.minimal_dimension;
+    slot.ordering_idx = entry.ordering_idx;
+    slot.backup_idx = entry.backup_idx;
+    free_slots_.push_back(slot);
+  }
+  auto it_entry = id_to_parameter_entry_.find(entry.id);
+  if (it_entry != id_to_parameter_entry_.end() && it_entry->second == index) {
+    id_to_parameter_entry_.erase(it_entry);
+  }
+  entry.block = nullptr;
+  entry.ordering_idx = -1;
+  entry.seen = false;
+  free_parameter_entries_.push_back(index);
+}
+
+// Assign contiguous ordering to all variable blocks
+void GraphSolver::rebuildOrdering()
+{
+  free_slots_.clear();
+  num_minimal_ = 0;
+  num_backup_ = 0;
+  for (auto& entry : parameter_entries_) {
+    if (entry.block == nullptr || entry.block->fixed()) {
+      entry.ordering_idx = -1; continue;
+    }
+    entry.ordering_idx = num_minimal_;
+    entry.backup_idx = num_backup_;
+    num_minimal_ += entry.minimal_dimension;
+    num_backup_ += entry.dimension;
+  }
+  num_layout_rebuilds_++;
+
+  reserve(num_minimal_);
+  if (parameter_backup_.size() < num_backup_) {
+    parameter_backup_.resize(num_backup_);
+  }
+}
+
+// Check if a residual entry still connects the given parameter blocks
+bool GraphSolver::residualEntryMatches(const ResidualBlockEntry& entry,
+  const std::vector<std::pair<uint64_t, std::shared_ptr<ParameterBlock>>>&
+  parameters) const
+{
+  if (entry.parameter_entries.size() != parameters.size()) return false;
+  for (size_t i = 0; i < parameters.size(); i++) {
+    const ParameterBlockEntry& parameter_entry =
+      parameter_entries_[entry.parameter_entries[i]];
+    if (parameter_entry.block != parameters[i].second.get() ||
+        parameter_entry.id != parameters[i].first) return false;
+  }
+  return true;
+}
+
+// Update the residual block entries and the workspaces
+void GraphSolver::updateResidualEntries()
+{
+  for (auto& entry : residual_entries_) entry.seen = false;
+  num_residual_blocks_ = 0;
+  num_residuals_ = 0;
+
+  size_t max_num_parameter_blocks = 0;
+  size_t max_residual_dimension = 0;
+  size_t max_jacobian_size = 0;
+  size_t max_jacobian_minimal_size = 0;
+  for (const auto& it : graph_->residualBlockIdToResidualBlockSpecMap()) {
+    const auto& parameters = graph_->parameterCollection(it.first);
+    ErrorInterface* error = it.second.error_interface_ptr.get();
+    auto it_entry = id_to_residual_entry_.find(it.first);
+    size_t index;
+    bool reset = false;
+    if (it_entry != id_to_residual_entry_.end()) {
+      index = it_entry->second;
+      const ResidualBlockEntry& entry = residual_entries_[index];
+      reset = entry.error != error || !residualEntryMatches(entry, parameters);
+    }
+    else {
+      if (free_residual_entries_.empty()) {
+        index = residual_entries_.size();
+        residual_entries_.push_back(ResidualBlockEntry());
+      }
+      else {
+        index = free_residual_entries_.back();
+        free_residual_entries_.pop_back();
+      }
+      id_to_residual_entry_[it.first] = index;
+      reset = true;
+    }
+
+    ResidualBlockEntry& entry = residual_entries_[index];
+    if (reset) {
+      entry.id = it.first;
+      entry.error = error;
+      entry.residual_dimension = error->residualDim();
+      entry.parameter_entries.clear();
+      for (const auto& parameter : parameters) {
+        auto it_parameter = id_to_parameter_entry_.find(parameter.first);
+        CHECK(it_parameter != id_to_parameter_entry_.end());
+        entry.parameter_entries.push_back(it_parameter->second);
+      }
+    }
+    entry.loss_function = it.second.loss_function_ptr;
+    entry.seen = true;
+
+    size_t jacobian_size = 0, jacobian_minimal_size = 0;
+    for (const size_t parameter_entry : entry.parameter_entries) {
+      jacobian_size += parameter_entries_[parameter_entry].dimension;
+      jacobian_minimal_size += parameter_entries_[parameter_entry].minimal_dimension;
+    }
+    num_residual_blocks_++;
+    num_residuals_ += entry.residual_dimension;
+    max_num_parameter_blocks = std::max(
+      max_num_parameter_blocks, entry.parameter_entries.size());
+    max_residual_dimension = std::max(
+      max_residual_dimension, entry.residual_dimension);
+    max_jacobian_size = std::max(max_jacobian_size,
+      jacobian_size * entry.residual_dimension);
+    max_jacobian_minimal_size = std::max(max_jacobian_minimal_size,
+      jacobian_minimal_size * entry.residual_dimension);
+  }
+
+  // Release the entries of removed residual blocks
+  for (size_t i = 0; i < residual_entries_.size(); i++) {
+    ResidualBlockEntry& entry = residual_entries_[i];
+    if (entry.error == nullptr || entry.seen) continue;
+    id_to_residual_entry_.erase(entry.id);
+    entry.error = nullptr;
+    entry.parameter_entries.clear();
+    free_residual_entries_.push_back(i);
+  }
+
+  // Workspaces
+  if (residual_workspace_.size() < max_residual_dimension) {
+    residual_workspace_.resize(max_residual_dimension);
+  }
+  if (jacobian_workspace_.size() < max_jacobian_size) {
+    jacobian_workspace_.resize(max_jacobian_size);
+  }
+  if (jacobian_minimal_workspace_.size() < max_jacobian_minimal_size) {
+    jacobian_minimal_workspace_.resize(max_jacobian_minimal_size);
+  }
+  if (parameter_ptrs_.size() < max_num_parameter_blocks) {
+    parameter_ptrs_.resize(max_num_parameter_blocks);
+    jacobian_ptrs_.resize(max_num_parameter_blocks);
+    jacobian_minimal_ptrs_.resize(max_num_parameter_blocks);
+  }
+}
+
+// Make sure the dense storages can hold a system of given size
+void GraphSolver::reserve(size_t size)
+{
+  if (size <= capacity_) return;
+  // grow with margin to avoid re-allocation on small window size changes
+  capacity_ = std::max(size, capacity_ + capacity_ / 2);
+  H_.resize(capacity_, capacity_);
+  b_.resize(capacity_);
+  dx_.resize(capacity_);
+  diagonal_.resize(capacity_);
+}
+
+// Evaluate total cost, and assemble the normal equations if required
+double GraphSolver::evaluate(bool linearize)
+{
+  const size_t n = num_minimal_;
+  if (linearize) {
+    H_.topLeftCorner(n, n).setZero();
+    b_.head(n).setZero();
+  }
+
+  double cost = 0.0;
+  for (auto& residual_entry : residual_entries_)
+  {
+    if (residual_entry.error == nullptr) continue;
+    const size_t dim = residual_entry.residual_dimension;
+    const size_t num_blocks = residual_entry.parameter_entries.size();
+
+    // Gather parameters and Jacobian storages
+    size_t jacobian_offset = 0, jacobian_minimal_offset = 0;
+    for (size_t i = 0; i < num_blocks; i++) {
+      const ParameterBlockEntry& entry =
+        parameter_entries_[residual_entry.parameter_entries[i]];
+      parameter_ptrs_[i] = entry.block->parameters();
+      if (linearize && entry.ordering_idx >= 0) {
+        jacobian_ptrs_[i] = jacobian_workspace_.data() + jacobian_offset;
+        jacobian_minimal_ptrs_[i] =
+          jacobian_minimal_workspace_.data() + jacobian_minimal_offset;
+        jacobian_offset += dim * entry.dimension;
+        jacobian_minimal_offset += dim * entry.minimal_dimension;
+      }
+      else {
+        jacobian_ptrs_[i] = nullptr;
+        jacobian_minimal_ptrs_[i] = nullptr;
+      }
+    }
+
+    // Evaluate
+    double* residuals = residual_workspace_.data();
+    residual_entry.error->EvaluateWithMinimalJacobians(parameter_ptrs_.data(),
+      residuals, linearize ? jacobian_ptrs_.data() : nullptr,
+      linearize ? jacobian_minimal_ptrs_.data() : nullptr);
+    cost += correctResidualAndJacobians(
+      residual_entry.loss_function, residual_entry, residuals, linearize);
+    if (!linearize) continue;
+
+    // Accumulate to the upper triangle of the normal equations
+    Eigen::Map<const Eigen::VectorXd> r(residuals, dim);
+    for (size_t i = 0; i < num_blocks; i++) {
+      if (jacobian_minimal_ptrs_[i] == nullptr) continue;
+      const ParameterBlockEntry& entry_i =
+        parameter_entries_[residual_entry.parameter_entries[i]];
+      Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic,
+        Eigen::RowMajor>> J_i(jacobian_minimal_ptrs_[i], dim, entry_i.minimal_dimension);
+      b_.segment(entry_i.ordering_idx, entry_i.minimal_dimension).noalias() -=
+        J_i.transpose() * r;
+      for (size_t j = i; j < num_blocks; j++) {
+        if (jacobian_minimal_ptrs_[j] == nullptr) continue;
+        const ParameterBlockEntry& entry_j =
+          parameter_entries_[residual_entry.parameter_entries[j]];
+        Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic,
+          Eigen::RowMajor>> J_j(jacobian_minimal_ptrs_[j], dim, entry_j.minimal_dimension);
+        if (entry_i.ordering_idx <= entry_j.ordering_idx) {
+          H_.block(entry_i.ordering_idx, entry_j.ordering_idx,
+            entry_i.minimal_dimension, entry_j.minimal_dimension).noalias() +=
+            J_i.transpose() * J_j;
+        }
+        else {
+          H_.block(entry_j.ordering_idx, entry_i.ordering_idx,
+            entry_j.minimal_dimension, entry_i.minimal_dimension).noalias() +=
+            J_j.transpose() * J_i;
+        }
+      }
+    }
+  }
+
+  return cost;
+}
+
+// Apply loss function correction to residual and minimal Jacobians
+double GraphSolver::correctResidualAndJacobians(
+  const ceres::LossFunction* loss_function,
+  ResidualBlockEntry& residual_entry, double* residuals, bool linearize)
+{
+  const size_t dim = residual_entry.residual_dimension;
+  Eigen::Map<Eigen::VectorXd> r(residuals, dim);
+  const double sq_norm = r.squaredNorm();
+  if (loss_function == nullptr) return 0.5 * sq_norm;
+
+  double rho[3];
+  loss_function->Evaluate(sq_norm, rho);
+  if (!linearize) return 0.5 * rho[0];
+
+  const double sqrt_rho1 = sqrt(rho[1]);
+  double residual_scaling, alpha_sq_norm;
+  if ((sq_norm == 0.0) || (rho[2] <= 0.0)) {
+    residual_scaling = sqrt_rho1;
+    alpha_sq_norm = 0.0;
+  }
+  else {
+    const double D = 1.0 + 2.0 * sq_norm * rho[2] / rho[1];
+    const double alpha = 1.0 - sqrt(D);
+    residual_scaling = sqrt_rho1 / (1 - alpha);
+    alpha_sq_norm = alpha / sq_norm;
+  }
+
+  // correct Jacobians (Equation 11 in BANS)
+  for (size_t i = 0; i < residual_entry.parameter_entries.size(); i++) {
+    if (jacobian_minimal_ptrs_[i] == nullptr) continue;
+    const ParameterBlockEntry& entry =
+      parameter_entries_[residual_entry.parameter_entries[i]];
+    Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic,
+      Eigen::RowMajor>> J(jacobian_minimal_ptrs_[i], dim, entry.minimal_dimension);
+    J = sqrt_rho1 * (J - alpha_sq_norm * r * (r.transpose() * J));
+  }
+
+  // correct residuals (caution: must be after "correct Jacobians")
+  r *= residual_scaling;
+
+  return 0.5 * rho[0];
+}
+
+// Parameter backup handles
+void GraphSolver::backupParameters()
+{
+  for (const auto& entry : parameter_entries_) {
+    if (entry.ordering_idx < 0) continue;
+    memcpy(parameter_backup_.data() + entry.backup_idx,
+      entry.block->parameters(), entry.dimension * sizeof(double));
+  }
+}
+
+void GraphSolver::restoreParameters()
+{
+  for (const auto& entry : parameter_entries_) {
+    if (entry.ordering_idx < 0) continue;
+    memcpy(entry.block->parameters(),
+      parameter_backup_.data() + entry.backup_idx, entry.dimension * sizeof(double));
+  }
+}
+
+// Apply dx to the backuped parameters
+void GraphSolver::applyStep(const Eigen::VectorXd& dx)
+{
+  for (const auto& entry : parameter_entries_) {
+    if (entry.ordering_idx < 0) continue;
+    entry.block->plus(parameter_backup_.data() + entry.backup_idx,
+      dx.data() + entry.ordering_idx, entry.block->parameters());
+  }
+}
+
+}  // namespace gici
@@ -40,7 +40,9 @@
 
 #include "gici/estimate/marginalization_error.h"
 
+#include <algorithm>
 #include <functional>
+#include <Eigen/Cholesky>
 
 #include "gici/estimate/local_parameterization_additional_interfaces.h"
 
@@ -83,6 +85,13 @@ MarginalizationError::MarginalizationError()
   dense_indices_ = 0;
   residual_block_id_ = 0;
   error_computation_valid_ = false;
+  block_sparse_ = false;
+  dense_dimension_ = 0;
+  dense_capacity_ = 0;
+  landmark_dimension_ = 0;
+  square_root_ = false;
+  square_root_rows_ = 0;
+  square_root_cols_ = 0;
 }
 
 // Default constructor from Graph.
@@ -92,6 +101,13 @@ MarginalizationError::MarginalizationError(Graph& map)
   dense_indices_ = 0;
   residual_block_id_ = 0;
   error_computation_valid_ = false;
+  block_sparse_ = false;
+  dense_dimension_ = 0;
+  dense_capacity_ = 0;
+  landmark_dimension_ = 0;
+  square_root_ = false;
+  square_root_rows_ = 0;
+  square_root_cols_ = 0;
 }
 
 MarginalizationError::MarginalizationError(
@@ -101,6 +117,13 @@ MarginalizationError::MarginalizationError(
   dense_indices_ = 0;
   residual_block_id_ = 0;
   error_computation_valid_ = false;
+  block_sparse_ = false;
+  dense_dimension_ = 0;
+  dense_capacity_ = 0;
+  landmark_dimension_ = 0;
+  square_root_ = false;
+  square_root_rows_ = 0;
+  square_root_cols_ = 0;
   bool success = addResidualBlocks(residual_block_ids);
   CHECK(success)
       << "residual blocks supplied or their connected parameter blocks were not properly added to the map";
@@ -113,6 +136,73 @@ void MarginalizationError::setMap(Graph& map)
   residual_block_id_ = 0;  // reset.
 }
 
+// Use the block-sparse storage of the linearised system.
+void MarginalizationError::setBlockSparse(bool block_sparse)
+{
+  CHECK(parameter_block_infos_.size() == 0)
+      << "storage type can only be changed on an empty marginalization error";
+  CHECK(!(block_sparse && square_root_))
+      << "block-sparse and square-root storages cannot be used together";
+  block_sparse_ = block_sparse;
+}
+
+// Keep the linearised system in square-root form.
+void MarginalizationError::setSquareRoot(bool square_root)
+{
+  CHECK(parameter_block_infos_.size() == 0)
+      << "storage type can only be changed on an empty marginalization error";
+  CHECK(!(square_root && block_sparse_))
+      << "block-sparse and square-root storages cannot be used together";
+  square_root_ = square_root;
+}
+
+// Grow the storage of the dense part of the block-sparse system.
+void MarginalizationError::reserveDense(size_t dense_dimension)
+{
+  if (dense_dimension <= dense_capacity_) {
+    return;
+  }
+
+  // the used corners are kept, the rest is left uninitialized
+  conservativeResize(H_dense_, dense_dimension, dense_dimension);
+  conservativeResize(b_dense_, dense_dimension);
+  for (LandmarkBlock& landmark : landmark_blocks_) {
+    Eigen::Matrix<double, Eigen::Dynamic, 3> H_dl(dense_dimension, 3);
+    H_dl.topRows(dense_dimension_) = landmark.H_dl.topRows(dense_dimension_);
+    landmark.H_dl.swap(H_dl);
+  }
+  dense_capacity_ = dense_dimension;
+}
+
+// Dimension of the linearised system.
+size_t MarginalizationError::systemDimension() const
+{
+  if (square_root_) {
+    return square_root_cols_;
+  }
+  if (!block_sparse_) {
+    return H_.cols();
+  }
+  return dense_dimension_ + landmark_dimension_;
+}
+
+// Append zero rows and columns to the dense part of the block-sparse system.
+void MarginalizationError::appendDenseDimension(size_t size)
+{
+  const size_t new_dimension = dense_dimension_ + size;
+  if (new_dimension > dense_capacity_) {
+    // grow geometrically so that the storage settles after a few epochs
+    reserveDense(std::max(new_dimension, dense_capacity_ + dense_capacity_ / 2));
+  }
+  H_dense_.block(dense_dimension_, 0, size, new_dimension).setZero();
+  H_dense_.block(0, dense_dimension_, new_dimension, size).setZero();
+  b_dense_.segment(dense_dimension_, size).setZero();
+  for (LandmarkBlock& landmark : landmark_blocks_) {
+    landmark.H_dl.middleRows(dense_dimension_, size).setZero();
+  }
+  dense_dimension_ = new_dimension;
+}
+
 // Add some residuals to this marginalisation error. This means, they will get linearised.
 bool MarginalizationError::addResidualBlocks(
     const std::vector< ceres::ResidualBlockId> & residual_block_ids,
@@ -160,7 +250,7 @@ bool MarginalizationError::addResidualBlock(
 
     // does it already exist as a parameter block connected?
     ParameterBlockInfo info;
-    std::map<uint64_t, size_t>::iterator it =
+    auto it =
         parameter_block_id_to_parameter_block_info_idx_.find(parameter_block_spec.first);
     if (it == parameter_block_id_to_parameter_block_info_idx_.end())
     {
@@ -185,7 +275,31 @@ bool MarginalizationError::addResidualBlock(
             parameter_block_infos_.at(dense_indices_ - 1).ordering_idx
             + parameter_block_infos_.at(dense_indices_ - 1).minimal_dimension;
 
-      if(additionalSize > 0)
+      if (square_root_)
+      {
+        // dense blocks are inserted after the dense part, landmarks at the end
+        insertSquareRootColumns(
+          is_landmark ? square_root_cols_ : denseSize, additionalSize);
+      }
+      else if (block_sparse_)
+      {
+        // dense blocks are appended to the dense storage, landmarks get
+        // their own diagonal blocks
+        if (!is_landmark)
+        {
+          appendDenseDimension(additionalSize);
+        }
+        else
+        {
+          LandmarkBlock landmark;
+          landmark.H_ll.setZero();
+          landmark.b_l.setZero();
+          landmark.H_dl.setZero(dense_capacity_, 3);
+          landmark_blocks_.push_back(landmark);
+          landmark_dimension_ += additionalSize;
+        }
+      }
+      else if(additionalSize > 0)
       {
         if (!is_landmark)
         {
@@ -298,7 +412,7 @@ bool MarginalizationError::addResidualBlock(
   }
 
   // update base_t book-keeping on residuals
-  base_t::set_num_residuals(H_.cols());
+  base_t::set_num_residuals(systemDimension());
 
   double** parameters_raw = new double*[parameters.size()];
   Eigen::VectorXd residuals_eigen(error_interface_ptr->residualDim());
@@ -398,8 +512,58 @@ bool MarginalizationError::addResidualBlock(
     residuals_eigen *= residual_scaling;
   }
 
+  // stack weighted Jacobians and residuals below the square-root factor
+  if (square_root_)
+  {
+    const size_t residual_dimension = error_interface_ptr->residualDim();
+    const size_t row = square_root_rows_;
+    reserveSquareRootRows(row + residual_dimension);
+    R_.block(row, 0, residual_dimension, square_root_cols_).setZero();
+    r0_.segment(row, residual_dimension) = residuals_eigen;
+    for (size_t i = 0; i < parameters.size(); ++i)
+    {
+      const ParameterBlockInfo& parameterBlockInfo_i = parameter_block_infos_.at(
+          parameter_block_id_to_parameter_block_info_idx_[parameters[i].first]);
+      if (parameterBlockInfo_i.minimal_dimension == 0)
+      {
+        continue;
+      }
+      CHECK(jacobians_minimal_eigen.at(i).allFinite())
+          << jacobians_minimal_eigen.at(i) << std::endl << (int)parameters[i].first;
+      R_.block(row, parameterBlockInfo_i.ordering_idx, residual_dimension,
+               parameterBlockInfo_i.minimal_dimension) = jacobians_minimal_eigen.at(i);
+    }
+    square_root_rows_ += residual_dimension;
+
+    // keep the stack bounded
+    if (square_root_rows_ > 2 * square_root_cols_ + 64)
+    {
+      triangularizeSquareRoot();
+    }
+  }
+
+  // a residual that couples two landmarks does not fit the block-diagonal
+  // landmark part, the landmarks fall back to the dense part in that case
+  if (block_sparse_ && !square_root_)
+  {
+    size_t num_landmarks = 0;
+    for (size_t i = 0; i < parameters.size(); ++i)
+    {
+      const ParameterBlockInfo& info = parameter_block_infos_.at(
+          parameter_block_id_to_parameter_block_info_idx_[parameters[i].first]);
+      if (info.is_landmark && info.minimal_dimension > 0) num_landmarks++;
+    }
+    if (num_landmarks > 1)
+    {
+      LOG(WARNING) << "Residual couples " << num_landmarks << " landmarks, "
+                   << "moving the landmarks to the dense part of the "
+                   << "marginalization.";
+      moveLandmarksToDense();
+    }
+  }
+
   // add blocks to lhs and rhs
-  for (size_t i = 0; i < parameters.size(); ++i)
+  for (size_t i = 0; i < parameters.size() && !square_root_; ++i)
   {
     ParameterBlockInfo parameterBlockInfo_i = parameter_block_infos_.at(
         parameter_block_id_to_parameter_block_info_idx_[parameters[i].first]);
@@ -413,6 +577,77 @@ bool MarginalizationError::addResidualBlock(
       continue;
     }
 
+    if (block_sparse_)
+    {
+      const Eigen::MatrixXd H_ii = jacobians_minimal_eigen.at(i).transpose()
+          * jacobians_minimal_eigen.at(i);
+      CHECK(H_ii.allFinite()) << H_ii << std::endl << (int)parameters[i].first;
+
+      // Insert Hessian and rhs in diagonal.
+      LandmarkBlock* landmark_i = nullptr;
+      if (parameterBlockInfo_i.is_landmark)
+      {
+        landmark_i = &landmark_blocks_.at(
+            parameter_block_id_to_parameter_block_info_idx_[parameters[i].first]
+            - dense_indices_);
+        landmark_i->H_ll += H_ii;
+        landmark_i->b_l -=
+            jacobians_minimal_eigen.at(i).transpose() * residuals_eigen;
+      }
+      else
+      {
+        H_dense_.block(parameterBlockInfo_i.ordering_idx,
+                       parameterBlockInfo_i.ordering_idx,
+                       parameterBlockInfo_i.minimal_dimension,
+                       parameterBlockInfo_i.minimal_dimension) += H_ii;
+        b_dense_.segment(parameterBlockInfo_i.ordering_idx,
+                         parameterBlockInfo_i.minimal_dimension) -=
+            jacobians_minimal_eigen.at(i).transpose() * residuals_eigen;
+      }
+
+      for (size_t j = 0; j < i; ++j)
+      {
+        // Now the parts not in the diagonal
+        ParameterBlockInfo parameterBlockInfo_j = parameter_block_infos_.at(
+            parameter_block_id_to_parameter_block_info_idx_[parameters[j].first]);
+        if (parameterBlockInfo_j.minimal_dimension == 0)
+        {
+          continue;
+        }
+
+        if (parameterBlockInfo_i.is_landmark)
+        {
+          landmark_i->H_dl.block(parameterBlockInfo_j.ordering_idx, 0,
+                                 parameterBlockInfo_j.minimal_dimension, 3) +=
+              jacobians_minimal_eigen.at(j).transpose().eval()
+              * jacobians_minimal_eigen.at(i);
+        }
+        else if (parameterBlockInfo_j.is_landmark)
+        {
+          landmark_blocks_.at(
+              parameter_block_id_to_parameter_block_info_idx_[parameters[j].first]
+              - dense_indices_).H_dl.block(parameterBlockInfo_i.ordering_idx, 0,
+                                           parameterBlockInfo_i.minimal_dimension, 3) +=
+              jacobians_minimal_eigen.at(i).transpose().eval()
+              * jacobians_minimal_eigen.at(j);
+        }
+        else
+        {
+          const Eigen::MatrixXd H_ij = jacobians_minimal_eigen.at(i).transpose()
+              * jacobians_minimal_eigen.at(j);
+          H_dense_.block(parameterBlockInfo_i.ordering_idx,
+                         parameterBlockInfo_j.ordering_idx,
+                         parameterBlockInfo_i.minimal_dimension,
+                         parameterBlockInfo_j.minimal_dimension) += H_ij;
+          H_dense_.block(parameterBlockInfo_j.ordering_idx,
+                         parameterBlockInfo_i.ordering_idx,
+                         parameterBlockInfo_j.minimal_dimension,
+                         parameterBlockInfo_i.minimal_dimension) += H_ij.transpose();
+        }
+      }
+      continue;
+    }
+
     CHECK(H_.allFinite());
 
     // Insert Hessian and rhs in diagonal.
@@ -482,7 +717,7 @@ bool MarginalizationError::isParameterBlockConnected(
     uint64_t parameter_block_id) {
   CHECK(graph_->parameterBlockExists(parameter_block_id))
       << "this parameter block does not even exist in the graph...";
-  std::map<uint64_t, size_t>::iterator it =
+  auto it =
       parameter_block_id_to_parameter_block_info_idx_.find(parameter_block_id);
   if (it == parameter_block_id_to_parameter_block_info_idx_.end())
     return false;
@@ -498,9 +733,19 @@ void MarginalizationError::check() {
   CHECK(
         parameter_block_id_to_parameter_block_info_idx_.size()
         ==parameter_block_infos_.size());
-  CHECK(base_t::num_residuals()==H_.cols());
-  CHECK(base_t::num_residuals()==H_.rows());
-  CHECK(base_t::num_residuals()==b0_.rows());
+  CHECK(base_t::num_residuals()==static_cast<int>(systemDimension()));
+  if (square_root_) {
+    CHECK(R_.rows()==r0_.rows());
+    CHECK(square_root_rows_<=static_cast<size_t>(R_.rows()));
+    CHECK(square_root_cols_<=static_cast<size_t>(R_.cols()));
+  }
+  else if (!block_sparse_) {
+    CHECK(base_t::num_residuals()==H_.rows());
+    CHECK(base_t::num_residuals()==b0_.rows());
+  }
+  else {
+    CHECK(landmark_blocks_.size()==parameter_block_infos_.size()-dense_indices_);
+  }
   CHECK(parameter_block_infos_.size()>=dense_indices_);
   int totalsize = 0;
   // check parameter block sizes
@@ -598,7 +843,7 @@ bool MarginalizationError::marginalizeOut(
   }
   for (size_t i = 0; i < parameter_block_ids_copy.size(); ++i)
   {
-    std::map<uint64_t, size_t>::iterator it =
+    auto it =
         parameter_block_id_to_parameter_block_info_idx_.find(
           parameter_block_ids_copy[i]);
 
@@ -678,8 +923,26 @@ bool MarginalizationError::marginalizeOut(
   // include in the fix rhs part deviations from linearization point of the parameter blocks to be marginalized
   // corrected: this is not necessary, will cancel itself
 
+  if (square_root_)
+  {
+    std::vector<std::pair<int, int> > marginalization_start_idx_and_length_pairs =
+        marginalization_start_idx_and_length_pairs_dense;
+    marginalization_start_idx_and_length_pairs.insert(
+        marginalization_start_idx_and_length_pairs.end(),
+        marginalization_start_idx_and_length_pairs_landmarks.begin(),
+        marginalization_start_idx_and_length_pairs_landmarks.end());
+    marginalizeOutSquareRoot(marginalization_start_idx_and_length_pairs);
+  }
+  else if (block_sparse_)
+  {
+    marginalizeOutBlockSparse(marginalization_start_idx_and_length_pairs_landmarks,
+                              marginalization_start_idx_and_length_pairs_dense,
+                              marginalization_parameters_dense);
+  }
+
   /* landmark part (if existing) */
-  if (marginalization_start_idx_and_length_pairs_landmarks.size() > 0)
+  if (!block_sparse_ && !square_root_ &&
+      marginalization_start_idx_and_length_pairs_landmarks.size() > 0)
   {
     // preconditioner
     Eigen::VectorXd p = (H_.diagonal().array() > 1.0e-9).select(
@@ -764,7 +1027,8 @@ bool MarginalizationError::marginalizeOut(
   }
 
   /* dense part (if existing) */
-  if (marginalization_start_idx_and_length_pairs_dense.size() > 0)
+  if (!block_sparse_ && !square_root_ &&
+      marginalization_start_idx_and_length_pairs_dense.size() > 0)
   {
     // preconditioner
     Eigen::VectorXd p = (H_.diagonal().array() > 1.0e-9).select(
@@ -861,14 +1125,13 @@ bool MarginalizationError::marginalizeOut(
   // check if the removal is safe
   for (size_t i = 0; i < parameter_block_ids_copy.size(); ++i)
   {
-    Graph::ResidualBlockCollection residuals = graph_->residuals(
-        parameter_block_ids_copy[i]);
-    if (residuals.size() != 0
+    const size_t num_residuals = graph_->numResiduals(parameter_block_ids_copy[i]);
+    if (num_residuals != 0
         && parameter_block_ptrs.at(parameter_block_ids_copy[i]) == false)
     {
       graph_->printParameterBlockInfo(parameter_block_ids_copy[i]);
     }
-    CHECK(residuals.size()==0 ||
+    CHECK(num_residuals==0 ||
                 parameter_block_ptrs.at(parameter_block_ids_copy[i]) == true)
         << "trying to marginalize out a parameterBlock that is still connected "
         << "to other error terms. keep = "
@@ -892,6 +1155,301 @@ bool MarginalizationError::marginalizeOut(
   return true;
 }
 
+// Marginalise out with the block-sparse storage.
+void MarginalizationError::marginalizeOutBlockSparse(
+    const std::vector<std::pair<int, int> >& landmark_start_idx_and_length_pairs,
+    const std::vector<std::pair<int, int> >& dense_start_idx_and_length_pairs,
+    const size_t marginalization_parameters_dense)
+{
+  static const int sdim = HomogeneousPointParameterBlock::c_minimal_dimension;
+  const size_t dense_dimension = dense_dimension_;
+
+  // Mark the landmarks to be marginalized
+  std::vector<bool> marginalize_index(systemDimension(), false);
+  for (const auto& pair : landmark_start_idx_and_length_pairs)
+  {
+    std::fill(marginalize_index.begin() + pair.first,
+              marginalize_index.begin() + pair.first + pair.second, true);
+  }
+  std::vector<bool> marginalize_landmark(landmark_blocks_.size(), false);
+  for (size_t k = 0; k < landmark_blocks_.size(); ++k)
+  {
+    const ParameterBlockInfo& info = parameter_block_infos_[dense_indices_ + k];
+    if (info.minimal_dimension == 0) continue;
+    marginalize_landmark[k] = marginalize_index[info.ordering_idx];
+  }
+
+  /* landmark part: Schur complement block by block */
+  Eigen::Matrix<double, Eigen::Dynamic, sdim> M(dense_dimension, sdim);
+  for (size_t k = 0; k < landmark_blocks_.size(); ++k)
+  {
+    if (!marginalize_landmark[k]) continue;
+    const LandmarkBlock& landmark = landmark_blocks_[k];
+
+    // preconditioner
+    Eigen::Matrix<double, sdim, 1> p =
+        (landmark.H_ll.diagonal().array() > 1.0e-9).select(
+          landmark.H_ll.diagonal().cwiseSqrt(), 1.0e-3);
+    Eigen::Matrix<double, sdim, 1> p_inv = p.cwiseInverse();
+    Eigen::Matrix<double, sdim, sdim> V = p_inv.asDiagonal() * 
+        (0.5 * (landmark.H_ll + landmark.H_ll.transpose())) * p_inv.asDiagonal();
+    Eigen::Matrix<double, sdim, sdim> V_inv_sqrt;
+    pseudoInverseSymmSqrt(V, V_inv_sqrt);
+    V_inv_sqrt = p_inv.asDiagonal() * V_inv_sqrt;
+
+    // Schur
+    M.noalias() = landmark.H_dl.topRows(dense_dimension) * V_inv_sqrt;
+    H_dense_.topLeftCorner(dense_dimension, dense_dimension).noalias() -= 
+        M * M.transpose();
+    b_dense_.head(dense_dimension).noalias() -= 
+        M * (V_inv_sqrt.transpose() * landmark.b_l);
+  }
+
+  /* the remaining landmarks get dense */
+  appendLandmarksToDense(marginalize_landmark);
+
+  /* dense part (if existing) */
+  if (dense_start_idx_and_length_pairs.size() > 0)
+  {
+    const size_t size = dense_dimension_;
+    const size_t kept_size = size - marginalization_parameters_dense;
+    auto H = H_dense_.topLeftCorner(size, size);
+    auto b = b_dense_.head(size);
+
+    // preconditioner
+    Eigen::VectorXd p = (H.diagonal().array() > 1.0e-9).select(
+          H.diagonal().cwiseSqrt(),1.0e-3);
+    Eigen::VectorXd p_inv = p.cwiseInverse();
+
+    // scale H and b
+    H = p_inv.asDiagonal() * H * p_inv.asDiagonal();
+    b = p_inv.asDiagonal() * b;
+
+    Eigen::MatrixXd U(kept_size, kept_size);
+    Eigen::MatrixXd V(marginalization_parameters_dense,
+                      marginalization_parameters_dense);
+    Eigen::MatrixXd W(kept_size, marginalization_parameters_dense);
+    Eigen::VectorXd b_a(kept_size);
+    Eigen::VectorXd b_b(marginalization_parameters_dense);
+
+    // split preconditioner
+    Eigen::VectorXd p_a(kept_size);
+    Eigen::VectorXd p_b(marginalization_parameters_dense);
+    splitVector(dense_start_idx_and_length_pairs, p, p_a, p_b);  // output
+
+    // split lhs
+    splitSymmetricMatrix(dense_start_idx_and_length_pairs, H, U, W, V);  // output
+
+    // split rhs
+    splitVector(dense_start_idx_and_length_pairs, b, b_a, b_b);  // output
+
+    // invert the marginalization block
+    Eigen::MatrixXd V_inverse_sqrt(V.rows(), V.cols());
+    Eigen::MatrixXd V1 = 0.5 * (V + V.transpose());
+    pseudoInverseSymmSqrt(V1, V_inverse_sqrt);
+
+    // Schur and unscale
+    Eigen::MatrixXd M = W * V_inverse_sqrt;
+    b_dense_.head(kept_size) = p_a.asDiagonal() * 
+        (b_a - M * (V_inverse_sqrt.transpose() * b_b));
+    U.noalias() -= M * M.transpose();
+    H_dense_.topLeftCorner(kept_size, kept_size) = 
+        p_a.asDiagonal() * U * p_a.asDiagonal();
+    dense_dimension_ = kept_size;
+  }
+}
+
+// Move the landmark blocks into the dense part of the block-sparse system.
+void MarginalizationError::appendLandmarksToDense(
+    const std::vector<bool>& skip)
+{
+  static const int sdim = HomogeneousPointParameterBlock::c_minimal_dimension;
+  const size_t dense_dimension = dense_dimension_;
+  for (size_t k = 0; k < landmark_blocks_.size(); ++k)
+  {
+    if (skip.size() > 0 && skip[k]) continue;
+    if (parameter_block_infos_[dense_indices_ + k].minimal_dimension == 0) continue;
+    const size_t idx = dense_dimension_;
+    appendDenseDimension(sdim);
+    LandmarkBlock& landmark = landmark_blocks_[k];
+    H_dense_.block(0, idx, dense_dimension, sdim) = 
+        landmark.H_dl.topRows(dense_dimension);
+    H_dense_.block(idx, 0, sdim, dense_dimension) = 
+        landmark.H_dl.topRows(dense_dimension).transpose();
+    H_dense_.block<sdim, sdim>(idx, idx) = landmark.H_ll;
+    b_dense_.segment<sdim>(idx) = landmark.b_l;
+  }
+  landmark_blocks_.clear();
+  landmark_dimension_ = 0;
+}
+
+// Move all the landmarks into the dense part and treat them as dense blocks.
+void MarginalizationError::moveLandmarksToDense()
+{
+  if (landmark_blocks_.size() == 0) return;
+  appendLandmarksToDense(std::vector<bool>());
+  dense_indices_ = parameter_block_infos_.size();
+  for (size_t i = 0; i < parameter_block_infos_.size(); ++i)
+  {
+    parameter_block_infos_.at(i).is_landmark = false;
+  }
+}
+
+// Compute the error terms from the block-sparse system.
+void MarginalizationError::updateBlockSparseErrorComputation()
+{
+  // landmarks that were not marginalized yet become dense, as in marginalizeOut
+  moveLandmarksToDense();
+
+  const size_t size = dense_dimension_;
+  base_t::set_num_residuals(size);
+  if (size == 0)
+  {
+    J_.resize(0, 0);
+    e0_.resize(0);
+    error_computation_valid_ = true;
+    return;
+  }
+  const auto H = H_dense_.topLeftCorner(size, size);
+  const auto b = b_dense_.head(size);
+
+  // preconditioner
+  Eigen::VectorXd p = (H.diagonal().array() > 1.0e-9).select(
+        H.diagonal().cwiseSqrt(),1.0e-3);
+  Eigen::VectorXd p_inv = p.cwiseInverse();
+
+  // Pivoted LDLT instead of an eigen-decomposition: H = P^T*L*D*L^T*P, so that
+  // J = sqrt(D)*L^T*P. Pivots below the threshold are dropped as the eigenvalues
+  // of the dense path, as H is only positive semidefinite.
+  Eigen::LDLT<Eigen::MatrixXd> ldlt(
+      0.5 * p_inv.asDiagonal() * (H + H.transpose()) * p_inv.asDiagonal());
+  const Eigen::VectorXd& D = ldlt.vectorD();
+  static const double epsilon = std::numeric_limits<double>::epsilon();
+  const double tolerance = epsilon * size * D.maxCoeff();
+  S_sqrt_ = (D.array() > tolerance).select(D.cwiseSqrt(), 0.0);
+  S_pinv_sqrt_ = (D.array() > tolerance).select(
+      D.cwiseSqrt().cwiseInverse(), 0.0);
+
+  // assign Jacobian
+  J_ = ldlt.matrixU();
+  J_ = S_sqrt_.asDiagonal() * J_;
+  J_ = J_ * ldlt.transpositionsP().transpose();
+  J_ = J_ * p.asDiagonal();
+
+  // constant error (residual) e0 := -pinv(J^T)*b
+  e0_ = ldlt.transpositionsP() * (-(p_inv.asDiagonal() * b));
+  ldlt.matrixL().solveInPlace(e0_);
+  e0_ = S_pinv_sqrt_.asDiagonal() * e0_;
+
+  error_computation_valid_ = true;
+}
+
+// Insert zero columns into the square-root factor.
+void MarginalizationError::insertSquareRootColumns(size_t idx, size_t size)
+{
+  if (size == 0) {
+    return;
+  }
+  const size_t cols = square_root_cols_;
+  const size_t rows = square_root_rows_;
+  if (cols + size > static_cast<size_t>(R_.cols())) {
+    // grow geometrically, the used part is kept
+    const size_t capacity =
+      std::max(cols + size, static_cast<size_t>(R_.cols() * 3 / 2));
+    conservativeResize(R_, R_.rows(), capacity);
+  }
+
+  // shift the columns behind in place, from the last one
+  for (size_t i = cols; i > idx; --i) {
+    R_.col(i - 1 + size).head(rows) = R_.col(i - 1).head(rows);
+  }
+  R_.block(0, idx, rows, size).setZero();
+  square_root_cols_ = cols + size;
+}
+
+// Make room for more rows in the square-root factor.
+void MarginalizationError::reserveSquareRootRows(size_t rows)
+{
+  if (rows <= static_cast<size_t>(R_.rows())) {
+    return;
+  }
+  const size_t capacity = std::max(rows, static_cast<size_t>(R_.rows() * 3 / 2));
+  conservativeResize(R_, capacity, R_.cols());
+  conservativeResize(r0_, capacity);
+}
+
+// Triangularize the stacked square-root factor with Householder QR.
+void MarginalizationError::triangularizeSquareRoot()
+{
+  const size_t cols = square_root_cols_;
+  const size_t rows = square_root_rows_;
+  if (rows == 0 || cols == 0) {
+    square_root_rows_ = 0;
+    return;
+  }
+
+  // factorize together with the residual, so that it gets rotated as well
+  Eigen::MatrixXd A(rows, cols + 1);
+  A.leftCols(cols) = R_.topLeftCorner(rows, cols);
+  A.col(cols) = r0_.head(rows);
+  Eigen::HouseholderQR<Eigen::Ref<Eigen::MatrixXd> > qr(A);
+
+  // the rows below are constant terms of the cost, which do not matter
+  const size_t size = std::min(rows, cols);
+  R_.topLeftCorner(size, cols) = qr.matrixQR().topLeftCorner(size, cols)
+      .triangularView<Eigen::Upper>();
+  r0_.head(size) = qr.matrixQR().col(cols).head(size);
+  square_root_rows_ = size;
+}
+
+// Marginalise out with the square-root factor.
+void MarginalizationError::marginalizeOutSquareRoot(
+    const std::vector<std::pair<int, int> >& marginalization_start_idx_and_length_pairs)
+{
+  triangularizeSquareRoot();
+
+  const size_t cols = square_root_cols_;
+  const size_t rows = square_root_rows_;
+  std::vector<bool> marginalize(cols, false);
+  size_t marginalization_parameters = 0;
+  for (const auto& pair : marginalization_start_idx_and_length_pairs)
+  {
+    std::fill(marginalize.begin() + pair.first,
+              marginalize.begin() + pair.first + pair.second, true);
+    marginalization_parameters += pair.second;
+  }
+  const size_t kept_size = cols - marginalization_parameters;
+
+  // split columns, the residual goes with the kept part
+  Eigen::MatrixXd A_m(rows, marginalization_parameters);
+  Eigen::MatrixXd A_k(rows, kept_size + 1);
+  for (size_t i = 0, i_m = 0, i_k = 0; i < cols; ++i)
+  {
+    if (marginalize[i]) A_m.col(i_m++) = R_.col(i).head(rows);
+    else A_k.col(i_k++) = R_.col(i).head(rows);
+  }
+  A_k.col(kept_size) = r0_.head(rows);
+
+  // Eliminate the marginalized columns. The rows below the rank of the
+  // marginalized part do not depend on it any more and form the new prior.
+  size_t rank = 0;
+  if (rows > 0 && marginalization_parameters > 0)
+  {
+    Eigen::ColPivHouseholderQR<Eigen::MatrixXd> qr(A_m);
+    rank = qr.rank();
+    A_k.applyOnTheLeft(qr.householderQ().adjoint());
+  }
+
+  // write back into the storages, which keep their capacities
+  const size_t new_rows = rows - rank;
+  R_.topLeftCorner(new_rows, kept_size) = A_k.bottomLeftCorner(new_rows, kept_size);
+  r0_.head(new_rows) = A_k.col(kept_size).tail(new_rows);
+  square_root_rows_ = new_rows;
+  square_root_cols_ = kept_size;
+
+  triangularizeSquareRoot();
+}
+
 // This must be called before optimization after adding residual blocks and/or
 // marginalizing, since it performs all the lhs and rhs computations on from a
 // given _H and _b.
@@ -902,6 +1460,26 @@ void MarginalizationError::updateErrorComputation()
     return;  // already done.
   }
 
+  if (square_root_)
+  {
+    // the factor is already the weighted Jacobian
+    triangularizeSquareRoot();
+    const size_t size = square_root_cols_;
+    base_t::set_num_residuals(size);
+    J_.setZero(size, size);
+    J_.topRows(square_root_rows_) = R_.topLeftCorner(square_root_rows_, size);
+    e0_.setZero(size);
+    e0_.head(square_root_rows_) = r0_.head(square_root_rows_);
+    error_computation_valid_ = true;
+    return;
+  }
+
+  if (block_sparse_)
+  {
+    updateBlockSparseErrorComputation();
+    return;
+  }
+
   // now we also know the error dimension:
   base_t::set_num_residuals(H_.cols());
 
@@ -946,7 +1524,7 @@ void MarginalizationError::updateErrorComputation()
 
 // Computes the linearized deviation from the references (linearization points)
 bool MarginalizationError::computeDeltaChi(Eigen::VectorXd& DeltaChi) const {
-  DeltaChi.resize(H_.rows());
+  DeltaChi.resize(systemDimension());
   for (size_t i = 0; i < parameter_block_infos_.size(); ++i)
   {
     // stack Delta_Chi vector
@@ -968,7 +1546,7 @@ bool MarginalizationError::computeDeltaChi(Eigen::VectorXd& DeltaChi) const {
 bool MarginalizationError::computeDeltaChi(double const* const * parameters,
                                            Eigen::VectorXd& DeltaChi) const
 {
-  DeltaChi.resize(H_.rows());
+  DeltaChi.resize(systemDimension());
   for (size_t i = 0; i < parameter_block_infos_.size(); ++i)
   {
     // stack Delta_Chi vector
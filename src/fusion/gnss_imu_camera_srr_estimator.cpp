@@ -61,6 +61,9 @@ bool GnssImuCameraSrrEstimator::addMeasurement(const EstimatorDataCluster& measu
   if (measurement.imu && measurement.imu_role == ImuRole::Major) {
     addImuMeasurement(*measurement.imu);
   }
+  if (measurement.imu_batch && measurement.imu_role == ImuRole::Major) {
+    addImuMeasurements(*measurement.imu_batch);
+  }
 
   // Add GNSS by solution measurement
   if (measurement.solution && 
@@ -315,9 +318,7 @@ void GnssImuCameraSrrEstimator::setInitializationResult(
     marginalization_residual_id_, gnss_extrinsics_id_, 
     gnss_solution_measurements_, imu_measurements);
   for (auto it = imu_measurements.rbegin(); it != imu_measurements.rend(); it++) {
-    imu_mutex_.lock();
-    imu_measurements_.push_front(*it);
-    imu_mutex_.unlock();
+    if (!imu_measurements_.pushFront(*it)) break;
   }
 
   // Shift memory for states and measurements
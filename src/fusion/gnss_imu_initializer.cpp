@@ -49,6 +49,9 @@ bool GnssImuInitializer::addMeasurement(const EstimatorDataCluster& measurement)
   if (measurement.imu && measurement.imu_role == ImuRole::Major) {
     addImuMeasurement(*measurement.imu);
   }
+  if (measurement.imu_batch && measurement.imu_role == ImuRole::Major) {
+    addImuMeasurements(*measurement.imu_batch);
+  }
 
   // Add GNSS by solution measurement
   if (measurement.solution && 
@@ -111,8 +114,11 @@ bool GnssImuInitializer::addGnssSolutionMeasurement(
   gnss_solution_measurements_.push_back(measurement);
 
   // Ensure that no duration overlaped with slow motion initialization
+  ImuMeasurement imu_front;
+  if (!imu_measurements_.tryFront(imu_front)) return false;
+  const double imu_front_timestamp = imu_front.timestamp;
   while (gnss_solution_measurements_.size() > 0 &&
-    gnss_solution_measurements_.front().timestamp < imu_measurements_.front().timestamp) {
+    gnss_solution_measurements_.front().timestamp < imu_front_timestamp) {
     gnss_solution_measurements_.pop_front();
   }
 
@@ -125,12 +131,8 @@ bool GnssImuInitializer::addGnssSolutionMeasurement(
   if (cur_timestamp - oldest_timestamp > 
       options_.time_window_length_dynamic_motion) {
     gnss_solution_measurements_.pop_front();
-    imu_mutex_.lock();
-    while (imu_measurements_.front().timestamp < 
-           gnss_solution_measurements_.front().timestamp - 1.0) {
-      imu_measurements_.pop_front();
-    }
-    imu_mutex_.unlock();
+    imu_measurements_.popFrontBefore(
+      gnss_solution_measurements_.front().timestamp - 1.0);
     dynamic_window_full_ = true;
   }
 
@@ -265,7 +267,9 @@ bool GnssImuInitializer::arrangeToEstimator(const int window_length,
     marginalization_residual_id = marginalization_residual_id_;
     gnss_extrinsics_id = gnss_extrinsics_id_;
     gnss_solution_measurements = gnss_solution_measurements_;
-    imu_measurements = imu_measurements_;
+    imu_measurements_.getAll(imu_measurements_buffer_);
+    imu_measurements.assign(
+      imu_measurements_buffer_.begin(), imu_measurements_buffer_.end());
     return true;
   }
 
@@ -294,7 +298,9 @@ bool GnssImuInitializer::arrangeToEstimator(const int window_length,
   marginalization_residual_id = marginalization_residual_id_;
   gnss_extrinsics_id = gnss_extrinsics_id_;
   gnss_solution_measurements = gnss_solution_measurements_;
-  imu_measurements = imu_measurements_;
+  imu_measurements_.getAll(imu_measurements_buffer_);
+  imu_measurements.assign(
+    imu_measurements_buffer_.begin(), imu_measurements_buffer_.end());
 
   return true;
 }
@@ -303,21 +309,19 @@ bool GnssImuInitializer::arrangeToEstimator(const int window_length,
 void GnssImuInitializer::slowMotionInitialization()
 {
   if (!gravity_setted_) return;
-  if (imu_measurements_.size() == 0) return;
+  ImuMeasurement imu_front, imu_back;
+  if (!imu_measurements_.tryFront(imu_front) || 
+      !imu_measurements_.tryBack(imu_back)) return;
   // if (zero_motion_finished_) return;
-  const double timestamp_end = imu_measurements_.back().timestamp;
+  const double timestamp_end = imu_back.timestamp;
   const double timestamp_start = 
     timestamp_end - options_.time_window_length_slow_motion;
-  if (timestamp_start >= imu_measurements_.front().timestamp) {
-    imu_mutex_.lock();
-    if (!zero_motion_finished_)
-    while (timestamp_start > imu_measurements_.front().timestamp) {
-      imu_measurements_.pop_front();
-    }
-    imu_mutex_.unlock();
+  if (timestamp_start >= imu_front.timestamp) {
+    if (!zero_motion_finished_) imu_measurements_.popFrontBefore(timestamp_start);
     Transformation T_WS_store = T_WS_0_;
     SpeedAndBias speed_and_bias_store = speed_and_bias_0_;
-    if (initPoseAndBiases(imu_measurements_, 
+    imu_measurements_.getAll(imu_measurements_buffer_);
+    if (initPoseAndBiases(imu_measurements_buffer_, 
         imu_base_options_.imu_parameters.g, T_WS_0_, speed_and_bias_0_)) {
       zero_motion_finished_ = true;
     }
@@ -353,6 +353,13 @@ MultiSensorEstimating::MultiSensorEstimating(
     spp_estimator_.reset(new SppEstimator(gnss_base_options_)); // 所以这里也定义了一个SPP需要用的估计器
   }
 
+  // For low-latency IMU-rate outputs
+  if (estimatorTypeContains(SensorType::IMU, type_) && 
+      imu_base_options_.use_forward_propagation) {
+    forward_propagator_ = std::make_shared<ImuForwardPropagator>(
+      imu_base_options_, compute_covariance_);
+  }
+
   // Initial values
   solution_.timestamp = 0.0;
 }
@@ -487,6 +494,7 @@ void MultiSensorEstimating::resetProcessors()
 
   // Clear output control
   output_timestamps_.clear();
+  if (forward_propagator_) forward_propagator_->reset();
   mutex_output_.unlock();
 }
 
@@ -578,23 +586,7 @@ bool MultiSensorEstimating::updateSolution()
   }
 
   // if we have GNSS, get GNSS variables
-  if (estimatorTypeContains(SensorType::GNSS, type_)) {
-    if (std::shared_ptr<GnssEstimatorBase> gnss_estimator = 
-      std::dynamic_pointer_cast<GnssEstimatorBase>(estimator_)) {         // 紧组合
-      solution_.status = gnss_estimator->getSolutionStatus();             // 解的状态
-      solution_.num_satellites = gnss_estimator->getNumberSatellite();    // 卫星数
-      solution_.differential_age = gnss_estimator->getDifferentialAge();  // 差分龄期
-    }
-    else if (std::shared_ptr<GnssLooseEstimatorBase> gnss_estimator = 
-      std::dynamic_pointer_cast<GnssLooseEstimatorBase>(estimator_)) {    // 松组合
-      solution_.status = gnss_estimator->getSolutionStatus();
-      solution_.num_satellites = gnss_estimator->getNumberSatellite();
-      solution_.differential_age = gnss_estimator->getDifferentialAge();
-    }
-    else {
-      LOG(FATAL) << "Unable to cast estimaotr to GNSS estimator!";
-    }
-  }
+  updateGnssSolutionStatus(solution_);
 
   mutex_output_.lock();
   output_timestamps_.pop_front();
@@ -603,6 +595,45 @@ bool MultiSensorEstimating::updateSolution()
   return true;
 }
 
+// Fill GNSS status of solution
+void MultiSensorEstimating::updateGnssSolutionStatus(Solution& solution)
+{
+  if (!estimatorTypeContains(SensorType::GNSS, type_)) return;
+
+  if (std::shared_ptr<GnssEstimatorBase> gnss_estimator = 
+    std::dynamic_pointer_cast<GnssEstimatorBase>(estimator_)) {         // 紧组合
+    solution.status = gnss_estimator->getSolutionStatus();              // 解的状态
+    solution.num_satellites = gnss_estimator->getNumberSatellite();     // 卫星数
+    solution.differential_age = gnss_estimator->getDifferentialAge();   // 差分龄期
+  }
+  else if (std::shared_ptr<GnssLooseEstimatorBase> gnss_estimator = 
+    std::dynamic_pointer_cast<GnssLooseEstimatorBase>(estimator_)) {    // 松组合
+    solution.status = gnss_estimator->getSolutionStatus();
+    solution.num_satellites = gnss_estimator->getNumberSatellite();
+    solution.differential_age = gnss_estimator->getDifferentialAge();
+  }
+  else {
+    LOG(FATAL) << "Unable to cast estimaotr to GNSS estimator!";
+  }
+}
+
+// Hand over latest backend solution to forward propagator
+void MultiSensorEstimating::updateForwardPropagatorBaseState()
+{
+  std::shared_ptr<ImuEstimatorBase> imu_estimator = 
+    std::dynamic_pointer_cast<ImuEstimatorBase>(estimator_);
+  CHECK_NOTNULL(imu_estimator);
+
+  Solution solution = solution_;
+  solution.timestamp = estimator_->getTimestamp();
+  solution.pose = estimator_->getPoseEstimate();
+  solution.speed_and_bias = estimator_->getSpeedAndBiasEstimate();
+  if (compute_covariance_) solution.covariance = estimator_->getCovariance();
+  else solution.covariance.setZero();
+  updateGnssSolutionStatus(solution);
+  forward_propagator_->setBaseState(solution, imu_estimator->getGravity());
+}
+
 // Handle time-propagation sensors
 void MultiSensorEstimating::handleTimePropagationSensors(EstimatorDataCluster& data)
 {
@@ -612,13 +643,33 @@ void MultiSensorEstimating::handleTimePropagationSensors(EstimatorDataCluster& d
   mutex_input_.lock();
   latest_imu_timestamp_ = data.timestamp;
   mutex_input_.unlock();
+  if (output_align_tag_ != data.tag) return;
+  const ImuMeasurement *imus = 
+    data.imu ? data.imu.get() : data.imu_batch->measurements;
+  const int num_imus = data.imu ? 1 : data.imu_batch->size;
+  // publish forward propagated solution without waiting for backend
+  if (forward_propagator_) {
+    for (int i = 0; i < num_imus; i++) {
+      Solution solution;
+      if (forward_propagator_->propagate(imus[i], solution) && 
+          checkDownsampling(data.tag)) {
+        std::shared_ptr<DataCluster> out_data = std::make_shared<DataCluster>(solution);
+        for (auto& out_callback : output_data_callbacks_) {
+          out_callback(tag_, out_data);
+        }
+      }
+    }
+    return;
+  }
   // align timeline for output control
-  if (backend_firstly_updated_ && output_align_tag_ == data.tag) {
-    if (checkDownsampling(data.tag)) {
-      mutex_output_.lock();
-      output_timestamps_.push_back(data.timestamp);
-      mutex_output_.unlock();
+  if (backend_firstly_updated_) {
+    mutex_output_.lock();
+    for (int i = 0; i < num_imus; i++) {
+      if (checkDownsampling(data.tag)) {
+        output_timestamps_.push_back(imus[i].timestamp);
+      }
     }
+    mutex_output_.unlock();
   }
 }
 
@@ -844,6 +895,12 @@ bool MultiSensorEstimating::processEstimator()
   {
     // update flag
     backend_firstly_updated_ = true;
+    // correct base state of forward propagation
+    if (forward_propagator_) updateForwardPropagatorBaseState();
+    // rebuild the integration checkpoints for output queries
+    std::shared_ptr<ImuEstimatorBase> imu_estimator = 
+      std::dynamic_pointer_cast<ImuEstimatorBase>(estimator_);
+    if (imu_estimator) imu_estimator->updateImuCheckpoints();
     // align timeline for output control
     if (output_align_tag_ == measurement.tag) {
       mutex_output_.lock();
@@ -95,6 +95,9 @@ bool PppImuTcEstimator::addMeasurement(const EstimatorDataCluster& measurement)
   if (measurement.imu && measurement.imu_role == ImuRole::Major) {
     addImuMeasurement(*measurement.imu);
   }
+  if (measurement.imu_batch && measurement.imu_role == ImuRole::Major) {
+    addImuMeasurements(*measurement.imu_batch);
+  }
 
   // Add GNSS
   if (measurement.gnss && measurement.gnss_role == GnssRole::Rover) {
@@ -358,9 +361,7 @@ void PppImuTcEstimator::setInitializationResult(
     marginalization_residual_id_, gnss_extrinsics_id_, 
     gnss_solution_measurements, imu_measurements);
   for (auto it = imu_measurements.rbegin(); it != imu_measurements.rend(); it++) {
-    imu_mutex_.lock();
-    imu_measurements_.push_front(*it);
-    imu_mutex_.unlock();
+    if (!imu_measurements_.pushFront(*it)) break;
   }
   gnss_measurements_.resize(gnss_solution_measurements.size());
   ambiguity_states_.resize(states_.size());
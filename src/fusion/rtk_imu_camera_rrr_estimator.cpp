@@ -86,6 +86,9 @@ bool RtkImuCameraRrrEstimator::addMeasurement(const EstimatorDataCluster& measur
   if (measurement.imu && measurement.imu_role == ImuRole::Major) {
     addImuMeasurement(*measurement.imu);
   }
+  if (measurement.imu_batch && measurement.imu_role == ImuRole::Major) {
+    addImuMeasurements(*measurement.imu_batch);
+  }
 
   // Add GNSS
   if (measurement.gnss) {
@@ -501,9 +504,7 @@ void RtkImuCameraRrrEstimator::setInitializationResult(
     marginalization_residual_id_, gnss_extrinsics_id_, 
     gnss_measurement_temp, imu_measurements);
   for (auto it = imu_measurements.rbegin(); it != imu_measurements.rend(); it++) {
-    imu_mutex_.lock();
-    imu_measurements_.push_front(*it);
-    imu_mutex_.unlock();
+    if (!imu_measurements_.pushFront(*it)) break;
   }
 
   // Shift memory for states and measurements
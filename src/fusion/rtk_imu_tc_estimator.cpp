@@ -68,6 +68,9 @@ bool RtkImuTcEstimator::addMeasurement(const EstimatorDataCluster& measurement)
   if (measurement.imu && measurement.imu_role == ImuRole::Major) {
     addImuMeasurement(*measurement.imu);
   }
+  if (measurement.imu_batch && measurement.imu_role == ImuRole::Major) {
+    addImuMeasurements(*measurement.imu_batch);
+  }
 
   // Add GNSS
   if (measurement.gnss) {
@@ -304,9 +307,7 @@ void RtkImuTcEstimator::setInitializationResult(
     marginalization_residual_id_, gnss_extrinsics_id_, 
     gnss_solution_measurements, imu_measurements);
   for (auto it = imu_measurements.rbegin(); it != imu_measurements.rend(); it++) {
-    imu_mutex_.lock();
-    imu_measurements_.push_front(*it);
-    imu_mutex_.unlock();
+    if (!imu_measurements_.pushFront(*it)) break;
   }
   gnss_measurement_pairs_.resize(gnss_solution_measurements.size());
   ambiguity_states_.resize(states_.size());
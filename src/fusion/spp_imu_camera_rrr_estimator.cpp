@@ -69,6 +69,9 @@ bool SppImuCameraRrrEstimator::addMeasurement(const EstimatorDataCluster& measur
   if (measurement.imu && measurement.imu_role == ImuRole::Major) {
     addImuMeasurement(*measurement.imu);
   }
+  if (measurement.imu_batch && measurement.imu_role == ImuRole::Major) {
+    addImuMeasurements(*measurement.imu_batch);
+  }
 
   // Add GNSS
   if (measurement.gnss && measurement.gnss_role == GnssRole::Rover) {
@@ -400,9 +403,7 @@ void SppImuCameraRrrEstimator::setInitializationResult(
     marginalization_residual_id_, gnss_extrinsics_id_, 
     gnss_measurement_temp, imu_measurements);
   for (auto it = imu_measurements.rbegin(); it != imu_measurements.rend(); it++) {
-    imu_mutex_.lock();
-    imu_measurements_.push_front(*it);
-    imu_mutex_.unlock();
+    if (!imu_measurements_.pushFront(*it)) break;
   }
 
   // Shift memory for states and measurements
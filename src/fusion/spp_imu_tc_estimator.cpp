@@ -63,6 +63,9 @@ bool SppImuTcEstimator::addMeasurement(const EstimatorDataCluster& measurement)
   if (measurement.imu && measurement.imu_role == ImuRole::Major) {
     addImuMeasurement(*measurement.imu);
   }
+  if (measurement.imu_batch && measurement.imu_role == ImuRole::Major) {
+    addImuMeasurements(*measurement.imu_batch);
+  }
 
   // Add GNSS
   if (measurement.gnss && measurement.gnss_role == GnssRole::Rover) {
@@ -232,9 +235,7 @@ void SppImuTcEstimator::setInitializationResult(
     marginalization_residual_id_, gnss_extrinsics_id_, 
     gnss_solution_measurements, imu_measurements);
   for (auto it = imu_measurements.rbegin(); it != imu_measurements.rend(); it++) {
-    imu_mutex_.lock();
-    imu_measurements_.push_front(*it);
-    imu_mutex_.unlock();
+    if (!imu_measurements_.pushFront(*it)) break;
   }
   gnss_measurements_.resize(gnss_solution_measurements.size());
 
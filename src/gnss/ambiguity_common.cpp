@@ -8,7 +8,11 @@
 **/
 #include "gici/gnss/ambiguity_common.h"
 
+#include <iomanip>
+#include <Eigen/Dense>
+
 #include "gici/gnss/gnss_common.h"
+#include "gici/gnss/incremental_lambda.h"
 
 namespace gici {
 
@@ -369,8 +373,12 @@ bool solveAmbiguityLambda(const Eigen::VectorXd& float_ambiguities,
     fixed_template = Eigen::MatrixXd::Zero(length, 2);
   Eigen::Vector2d residuals;
   // Lambda search
-  lambda(float_ambiguities.size(), 2, float_ambiguities.data(), 
-         covariance.data(), fixed_template.data(), residuals.data());
+  // The integer vectors are not computed if the search is not finished
+  if (lambda(float_ambiguities.size(), 2, float_ambiguities.data(), 
+      covariance.data(), fixed_template.data(), residuals.data()) != 0) {
+    ratio = 0.0;
+    return false;
+  }
   ratio = residuals[0] > 0 ? (residuals[1] / residuals[0]) : 0.0;
 
   // Check ratio
@@ -381,4 +389,162 @@ bool solveAmbiguityLambda(const Eigen::VectorXd& float_ambiguities,
   else return false;
 }
 
-}
\ No newline at end of file
+// Solve integer ambiguity by LAMBDA with partial AR on nested subsets
+int solveAmbiguityPartialLambda(const Eigen::VectorXd& float_ambiguities,
+                                const Eigen::MatrixXd& covariance, 
+                                const double ratio_threshold, 
+                                const int min_num_fixation,
+                                const bool skip_full,
+                                const bool use_incremental,
+                                Eigen::VectorXd& fixed_ambiguities,
+                                double& ratio,
+                                const std::function<bool()>& is_timeout)
+{
+  CHECK(float_ambiguities.size() == covariance.cols());
+  CHECK(covariance.rows() == covariance.cols());
+
+  // Try full AR and then partial AR, until it successed or active number 
+  // of ambiguities reaches the minimum number of fixation judgement.
+  const int num_full = float_ambiguities.size();
+  int num_active = num_full;
+  ratio = 0.0;
+  // The subsets are nested, so that they share one factorization
+  if (use_incremental) {
+    IncrementalLambda lambda(float_ambiguities, covariance);
+    while (num_active >= min_num_fixation && num_active > 0) {
+      if (is_timeout && is_timeout()) return 0;
+      if (!(skip_full && num_active == num_full)) {
+        if (sqrt(covariance(num_active - 1, num_active - 1)) < 0.25)
+        if (lambda.solve(num_active, ratio_threshold, 
+            fixed_ambiguities, ratio)) return num_active;
+      }
+      // reduce subsets
+      --num_active;
+    }
+  }
+  else {
+    Eigen::VectorXd active_float_ambiguities = float_ambiguities;
+    Eigen::MatrixXd active_covariance = covariance;
+    while (num_active >= min_num_fixation && num_active > 0) {
+      if (is_timeout && is_timeout()) return 0;
+      if (!(skip_full && num_active == num_full)) {
+        if (sqrt(active_covariance(num_active - 1, num_active - 1)) < 0.25)
+        if (solveAmbiguityLambda(active_float_ambiguities, 
+            active_covariance, ratio_threshold, fixed_ambiguities, ratio)) 
+          return num_active;
+      }
+      // reduce subsets
+      --num_active;
+      active_float_ambiguities = float_ambiguities.topRows(num_active);
+      active_covariance = covariance.topLeftCorner(num_active, num_active);
+    }
+  }
+
+  return 0;
+}
+
+// Write a snapshot as one text block
+void writeAmbiguitySnapshot(std::ostream& out, const AmbiguitySnapshot& snapshot)
+{
+  const int n = snapshot.ids.size();
+  out << "snapshot " << snapshot.mode << " " << n << "\n" << std::setprecision(17);
+  for (int i = 0; i < n; i++) {
+    out << snapshot.ids[i].asInteger() << " " << snapshot.values(i) << " " 
+        << snapshot.wavelengths(i) << " " << snapshot.elevations(i) << "\n";
+  }
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      out << snapshot.covariance(i, j) << (j == n - 1 ? "\n" : " ");
+    }
+  }
+}
+
+// Read a snapshot
+bool readAmbiguitySnapshot(std::istream& in, AmbiguitySnapshot& snapshot)
+{
+  std::string tag;
+  int n;
+  if (!(in >> tag) || tag != "snapshot") return false;
+  if (!(in >> snapshot.mode >> n) || n < 0) return false;
+  snapshot.ids.resize(n);
+  snapshot.values.resize(n);
+  snapshot.wavelengths.resize(n);
+  snapshot.elevations.resize(n);
+  snapshot.covariance.resize(n, n);
+  for (int i = 0; i < n; i++) {
+    uint64_t id;
+    if (!(in >> id >> snapshot.values(i) >> snapshot.wavelengths(i) 
+          >> snapshot.elevations(i))) return false;
+    snapshot.ids[i] = BackendId(id);
+  }
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      if (!(in >> snapshot.covariance(i, j))) return false;
+    }
+  }
+  return true;
+}
+
+// Transform ambiguity covariance by difference operator
+void transformAmbiguityCovariance(const AmbiguityDifference& difference,
+                                  const Eigen::MatrixXd& covariance,
+                                  Eigen::MatrixXd& transformed_covariance)
+{
+  CHECK(difference.cols() == covariance.rows());
+
+  // P is symmetric, so that D * P * D^T = D * (D * P)^T
+  Eigen::MatrixXd DP = difference * covariance;
+  transformed_covariance = difference * DP.transpose();
+}
+
+// Constrain ambiguities by fixed combinations with Kalman update
+bool constrainAmbiguities(const AmbiguityDifference& jacobian,
+                          const Eigen::VectorXd& fixed_ambiguities,
+                          const double variance,
+                          Eigen::VectorXd& ambiguities,
+                          Eigen::MatrixXd& covariance)
+{
+  CHECK(jacobian.rows() == fixed_ambiguities.size());
+  CHECK(jacobian.cols() == ambiguities.size());
+  CHECK(covariance.rows() == covariance.cols());
+  CHECK(covariance.rows() == ambiguities.size());
+
+  // Innovation and its covariance
+  const int n = ambiguities.size();
+  const int k = jacobian.rows();
+  Eigen::MatrixXd JP = jacobian * covariance;
+  Eigen::MatrixXd S = jacobian * JP.transpose();
+  S.diagonal().array() += variance;
+  Eigen::LLT<Eigen::MatrixXd> llt(S);
+  if (llt.info() != Eigen::Success) return false;
+  Eigen::VectorXd innovation = fixed_ambiguities - jacobian * ambiguities;
+
+  // x += P * J^T * S^-1 * y
+  ambiguities += JP.transpose() * llt.solve(innovation);
+
+  // P -= W^T * W, where W = L^-1 * J * P and S = L * L^T
+  llt.matrixL().solveInPlace(JP);
+  std::vector<int> affected;
+  for (int i = 0; i < n; i++) {
+    if (!JP.col(i).isZero(0.0)) affected.push_back(i);
+  }
+  const int m = affected.size();
+  if (m == n) {
+    covariance.selfadjointView<Eigen::Lower>().rankUpdate(JP.transpose(), -1.0);
+    covariance.triangularView<Eigen::StrictlyUpper>() = covariance.transpose();
+    return true;
+  }
+  Eigen::MatrixXd W(k, m);
+  for (int i = 0; i < m; i++) W.col(i) = JP.col(affected[i]);
+  Eigen::MatrixXd update = Eigen::MatrixXd::Zero(m, m);
+  update.selfadjointView<Eigen::Lower>().rankUpdate(W.transpose(), 1.0);
+  for (int j = 0; j < m; j++) {
+    for (int i = j; i < m; i++) {
+      covariance(affected[i], affected[j]) -= update(i, j);
+      covariance(affected[j], affected[i]) = covariance(affected[i], affected[j]);
+    }
+  }
+  return true;
+}
+
+}
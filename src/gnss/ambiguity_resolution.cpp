@@ -8,6 +8,9 @@
 **/
 #include "gici/gnss/ambiguity_resolution.h"
 
+#include <algorithm>
+#include <chrono>
+
 #include "gici/gnss/gnss_common.h"
 #include "gici/gnss/phaserange_error_sd.h"
 #include "gici/gnss/ambiguity_error.h"
@@ -25,11 +28,26 @@ AmbiguityResolution::AmbiguityResolution(
   ambiguities_.push_back(std::vector<Spec>());
   ambiguity_pairs_.push_back(std::vector<BsdPair>());
   ambiguity_lane_pairs_.push_back(std::vector<LanePair>());
+
+  // snapshots for replay
+  if (options_.dump_path != "") {
+    dump_file_.open(options_.dump_path);
+    if (!dump_file_.is_open()) {
+      LOG(WARNING) << "Unable to open ambiguity dump file " << options_.dump_path;
+    }
+  }
+
+  // the calling thread also takes a strategy
+  if (options_.num_threads > 1) {
+    thread_pool_ = std::make_shared<ThreadPool>(options_.num_threads - 1);
+  }
 }
 
 // The default destructor
 AmbiguityResolution::~AmbiguityResolution()
-{}
+{
+  if (dump_file_.is_open()) dump_file_.close();
+}
 
 // Solve ambiguity at given epoch
 AmbiguityResolution::Result AmbiguityResolution::solvePpp(
@@ -38,18 +56,10 @@ AmbiguityResolution::Result AmbiguityResolution::solvePpp(
              const Eigen::MatrixXd& ambiguity_covariance,
              const GnssMeasurement& measurements)
 {
+  startTimer();
+
   // Prepare data 
-  // Shift storage
-  ambiguities_.push_back(std::vector<Spec>());
-  ambiguity_pairs_.push_back(std::vector<BsdPair>());
-  ambiguity_lane_pairs_.push_back(std::vector<LanePair>());
-  if (ambiguities_.size() > 2) {
-    ambiguities_.pop_front();
-    ambiguity_pairs_.pop_front();
-    ambiguity_lane_pairs_.pop_front();
-  }
-  full_parameters_store_.clear();
-  lane_groups_.clear();
+  shiftEpoch();
 
   // Get parameters
   std::unordered_map<size_t, size_t> ambiguity_index_map;
@@ -115,6 +125,7 @@ AmbiguityResolution::Result AmbiguityResolution::solvePpp(
     }
     curAmbs()[i].std = sqrt(ambiguity_covariance_(i, i));
   }
+  dumpSnapshot(0);
 
   // Collect all parameter blocks
   Graph::ParameterBlockCollection parameters = graph_->parameters();
@@ -138,53 +149,8 @@ AmbiguityResolution::Result AmbiguityResolution::solvePpp(
   }
 
   // Sovle ambiguity
-  // Apply Between-Satellite-Difference (BSD) and lane combination
-  formSatellitePairPpp();
-
-  // Sort lanes to groups
-  groupingSatellitePair();
-  if (lane_groups_.size() == 0) return Result::NoFix;
-
-  // Try fix lanes
-  int num_success_uwl = 0, num_candidate_uwl = 0; 
-  int num_success_wl = 0, num_candidate_wl = 0; 
-  int num_success_nl = 0, num_candidate_nl = 0;
-  bool has_uwl = false, has_wl = false;
-  for (int i = lane_groups_.size() - 1; i >= 0; i--) {
-    LaneType type = curAmbLanePairs().at(lane_groups_.at(i).front()).laneType();
-    double min_percentage_fixation;
-    bool use_rounding = false;
-    if (type == LaneType::UWL) {
-      min_percentage_fixation = options_.min_percentage_fixation_uwl;
-      use_rounding = true;
-      has_uwl = true;
-    }
-    else if (type == LaneType::WL) {
-      min_percentage_fixation = options_.min_percentage_fixation_wl;
-      use_rounding = true;
-      has_wl = true;
-    }
-    else {
-      min_percentage_fixation = options_.min_percentage_fixation_nl;
-      use_rounding = false;
-    }
-
-    int num_fixed = trySolveLanes(
-      lane_groups_.at(i), min_percentage_fixation, use_rounding);
-
-    if (type == LaneType::UWL) {
-      num_success_uwl += num_fixed;
-      num_candidate_uwl += lane_groups_.at(i).size();
-    }
-    else if (type == LaneType::WL) {
-      num_success_wl += num_fixed;
-      num_candidate_wl += lane_groups_.at(i).size();
-    }
-    else {
-      num_success_nl += num_fixed;
-      num_candidate_nl += lane_groups_.at(i).size();
-    }
-  }
+  int num_success_nl = 0, num_success_wl = 0, num_success_uwl = 0;
+  fixLanes(false, num_success_nl, num_success_wl, num_success_uwl);
 
   // Check if no valid fixation
   if (num_success_nl == 0 && num_success_wl == 0 && 
@@ -212,6 +178,119 @@ AmbiguityResolution::Result AmbiguityResolution::solvePpp(
   return Result::NoFix;
 }
 
+// Replay the float ambiguities of an epoch
+AmbiguityResolution::Result AmbiguityResolution::replay(
+  const AmbiguitySnapshot& snapshot)
+{
+  startTimer();
+  shiftEpoch();
+
+  // Get ambiguities
+  const size_t ambiguity_size = snapshot.ids.size();
+  for (size_t i = 0; i < ambiguity_size; i++) {
+    Spec ambiguity;
+    ambiguity.id = snapshot.ids[i];
+    ambiguity.prn = ambiguity.id.gPrn();
+    ambiguity.value = snapshot.values(i);
+    ambiguity.wavelength = snapshot.wavelengths(i);
+    ambiguity.elevation = snapshot.elevations(i);
+    ambiguity.std = sqrt(snapshot.covariance(i, i));
+    curAmbs().push_back(ambiguity);
+  }
+  ambiguity_covariance_ = snapshot.covariance;
+
+  // Sovle ambiguity
+  int num_success_nl = 0, num_success_wl = 0, num_success_uwl = 0;
+  fixLanes(snapshot.mode == 1, num_success_nl, num_success_wl, num_success_uwl);
+
+  if (num_success_nl > 0) return Result::NlFix;
+  else if (num_success_wl > 0) return Result::WlFix;
+  return Result::NoFix;
+}
+
+// Shift the ambiguity storages to a new epoch
+void AmbiguityResolution::shiftEpoch()
+{
+  ambiguities_.push_back(std::vector<Spec>());
+  ambiguity_pairs_.push_back(std::vector<BsdPair>());
+  ambiguity_lane_pairs_.push_back(std::vector<LanePair>());
+  if (ambiguities_.size() > 2) {
+    ambiguities_.pop_front();
+    ambiguity_pairs_.pop_front();
+    ambiguity_lane_pairs_.pop_front();
+  }
+  full_parameters_store_.clear();
+  lane_groups_.clear();
+  ratios_.clear();
+}
+
+// Dump the ambiguities of current epoch for replay
+void AmbiguityResolution::dumpSnapshot(const int mode)
+{
+  if (!dump_file_.is_open()) return;
+
+  AmbiguitySnapshot snapshot;
+  const size_t ambiguity_size = curAmbs().size();
+  snapshot.mode = mode;
+  snapshot.values.resize(ambiguity_size);
+  snapshot.wavelengths.resize(ambiguity_size);
+  snapshot.elevations.resize(ambiguity_size);
+  for (size_t i = 0; i < ambiguity_size; i++) {
+    snapshot.ids.push_back(curAmbs()[i].id);
+    snapshot.values(i) = curAmbs()[i].value;
+    snapshot.wavelengths(i) = curAmbs()[i].wavelength;
+    snapshot.elevations(i) = curAmbs()[i].elevation;
+  }
+  snapshot.covariance = ambiguity_covariance_;
+  writeAmbiguitySnapshot(dump_file_, snapshot);
+}
+
+// Form lanes of current ambiguities and fix them group by group
+void AmbiguityResolution::fixLanes(const bool is_rtk, int& num_fixed_nl, 
+                                   int& num_fixed_wl, int& num_fixed_uwl)
+{
+  num_fixed_nl = num_fixed_wl = num_fixed_uwl = 0;
+
+  // Apply Between-Satellite-Difference (BSD) and lane combination
+  if (is_rtk) formSatellitePairRtk();
+  else formSatellitePairPpp();
+
+  // Sort lanes to groups
+  groupingSatellitePair();
+
+  // Try fix lanes. 
+  // For PPP, UWL and WL are fixed by rounding, as they are less correlated. 
+  for (int i = lane_groups_.size() - 1; i >= 0; i--) {
+    if (isTimeout()) {
+      LOG(INFO) << "Ambiguity resolution exceeded its time budget. "
+        << "Remaining lanes are left float.";
+      break;
+    }
+    LaneType type = curAmbLanePairs().at(lane_groups_.at(i).front()).laneType();
+    double min_percentage_fixation;
+    bool use_rounding = false;
+    if (type == LaneType::UWL) {
+      min_percentage_fixation = options_.min_percentage_fixation_uwl;
+      use_rounding = !is_rtk;
+    }
+    else if (type == LaneType::WL) {
+      min_percentage_fixation = options_.min_percentage_fixation_wl;
+      use_rounding = !is_rtk;
+    }
+    else {
+      min_percentage_fixation = options_.min_percentage_fixation_nl;
+      use_rounding = false;
+    }
+
+    int num_fixed = trySolveLanes(
+      lane_groups_.at(i), min_percentage_fixation, use_rounding);
+
+    if (type == LaneType::UWL) num_fixed_uwl += num_fixed;
+    else if (type == LaneType::WL) num_fixed_wl += num_fixed;
+    else num_fixed_nl += num_fixed;
+  }
+}
+
 // Apply Between-Satellite-Difference (BSD) and lane combination for PPP
 void AmbiguityResolution::formSatellitePairPpp()
 {
@@ -221,7 +300,7 @@ void AmbiguityResolution::formSatellitePairPpp()
   std::map<std::string, int> prn_to_number_phases; 
   std::multimap<std::string, double> prn_to_wavelengths;
   std::multimap<std::string, Spec> prn_to_specs;
-  std::map<uint64_t, size_t> id_to_spec_id;
+  std::unordered_map<uint64_t, size_t, BackendIdHash> id_to_spec_id;
   bool has_bds_meo = false;  // we prefer to select BDS MEO satellite as reference
   for (size_t i = 0; i < curAmbs().size(); i++) {
     Spec& ambiguity = curAmbs()[i];
@@ -497,9 +576,25 @@ int AmbiguityResolution::solveLanes(
   const DelMethod method,
   const bool use_rounding,
   const bool skip_full)
+{
+  LaneSolution solution;
+  if (!searchLanes(indexes, min_percentage_fixation, 
+      method, use_rounding, skip_full, solution)) return 0;
+  return applyLanes(solution);
+}
+
+// Search integer ambiguities of lanes
+bool AmbiguityResolution::searchLanes(
+  const std::vector<size_t>& indexes, 
+  const double min_percentage_fixation,
+  const DelMethod method,
+  const bool use_rounding,
+  const bool skip_full,
+  LaneSolution& solution)
 {
   // Get combinations
-  std::vector<LanePair> lane_pairs;
+  std::vector<LanePair>& lane_pairs = solution.lane_pairs;
+  lane_pairs.clear();
   for (size_t i = 0; i < indexes.size(); i++) {
     lane_pairs.push_back(curAmbLanePairs().at(indexes[i]));
   }
@@ -529,10 +624,8 @@ int AmbiguityResolution::solveLanes(
 
   // Get float ambiguities and its covariance
   Eigen::VectorXd float_ambiguities = Eigen::VectorXd::Zero(lane_pairs.size());
-  Eigen::MatrixXd float_covariance = 
-    Eigen::MatrixXd::Zero(lane_pairs.size(), lane_pairs.size());
-  Eigen::MatrixXd differential_jacobian = 
-    Eigen::MatrixXd::Zero(lane_pairs.size(), curAmbs().size());
+  Eigen::MatrixXd float_covariance;
+  std::vector<Eigen::Triplet<double>> coefficients;
   for (size_t i = 0; i < lane_pairs.size(); i++) {
     float_ambiguities(i) = lane_pairs[i].value / lane_pairs[i].wavelength;
     size_t id_higher_raw = curAmbPairs()[lane_pairs[i].bsd_pair_id_higher].spec_id;
@@ -543,54 +636,47 @@ int AmbiguityResolution::solveLanes(
       size_t id_lower_ref = curAmbPairs()[lane_pairs[i].bsd_pair_id_lower].spec_id_ref;
       double wave_higher = curAmbPairs()[lane_pairs[i].bsd_pair_id_higher].wavelength;
       double wave_lower = curAmbPairs()[lane_pairs[i].bsd_pair_id_lower].wavelength;
-      differential_jacobian(i, id_higher_raw) = 1.0 / wave_higher;
-      differential_jacobian(i, id_higher_ref) = -1.0 / wave_higher;
-      differential_jacobian(i, id_lower_raw) = -1.0 / wave_lower;
-      differential_jacobian(i, id_lower_ref) = 1.0 / wave_lower;
+      coefficients.push_back(Eigen::Triplet<double>(i, id_higher_raw, 1.0 / wave_higher));
+      coefficients.push_back(Eigen::Triplet<double>(i, id_higher_ref, -1.0 / wave_higher));
+      coefficients.push_back(Eigen::Triplet<double>(i, id_lower_raw, -1.0 / wave_lower));
+      coefficients.push_back(Eigen::Triplet<double>(i, id_lower_ref, 1.0 / wave_lower));
     }
     else {
       double wave = lane_pairs[i].wavelength;
-      differential_jacobian(i, id_higher_raw) = 1.0 / wave;
-      differential_jacobian(i, id_higher_ref) = -1.0 / wave;
+      coefficients.push_back(Eigen::Triplet<double>(i, id_higher_raw, 1.0 / wave));
+      coefficients.push_back(Eigen::Triplet<double>(i, id_higher_ref, -1.0 / wave));
     }
   }
-  float_covariance = differential_jacobian * 
-      ambiguity_covariance_ * differential_jacobian.transpose();
+  AmbiguityDifference& differential_jacobian = solution.differential_jacobian;
+  differential_jacobian.resize(lane_pairs.size(), curAmbs().size());
+  differential_jacobian.setFromTriplets(coefficients.begin(), coefficients.end());
+  transformAmbiguityCovariance(
+    differential_jacobian, ambiguity_covariance_, float_covariance);
 
   // Sovle ambiguity
-  Eigen::VectorXd fixed_ambiguities;
+  Eigen::VectorXd& fixed_ambiguities = solution.fixed_ambiguities;
   int num_active = float_ambiguities.size();
   int min_num_fixation = static_cast<int>(
     min_percentage_fixation * static_cast<double>(num_active));
   if (min_num_fixation < options_.min_num_satellite_pairs_fixation) {
     min_num_fixation = options_.min_num_satellite_pairs_fixation;
   }
-  Eigen::VectorXd active_float_ambiguities = float_ambiguities;
-  Eigen::MatrixXd active_float_covariance = float_covariance;
   // solve by LAMBDA
   if (!use_rounding) {
-    // Try full AR and then partial AR, until it successed or active number 
-    // of ambiguities reaches the minimum number of fixation judgement.
     double ratio = 0.0;
-    while (num_active >= min_num_fixation) {
-      if (!(skip_full && num_active == float_ambiguities.size())) {
-        if (sqrt(active_float_covariance(num_active - 1, num_active - 1)) < 0.25)
-        if (solveAmbiguityLambda(active_float_ambiguities, 
-            active_float_covariance, options_.ratio, fixed_ambiguities, ratio)) break;
-      }
-      // reduce subsets
-      --num_active;
-      active_float_ambiguities = float_ambiguities.topRows(num_active);
-      active_float_covariance = float_covariance.topLeftCorner(num_active, num_active);
-    }
-    // if (ratio != 0.0) LOG(INFO) << (int)lane_type << ": " << ratio << " | " << active_float_ambiguities.transpose();
+    num_active = solveAmbiguityPartialLambda(float_ambiguities, float_covariance, 
+      options_.ratio, min_num_fixation, skip_full, 
+      options_.use_incremental_partial_ar, fixed_ambiguities, ratio, 
+      std::bind(&AmbiguityResolution::isTimeout, this));
+    // if (ratio != 0.0) LOG(INFO) << (int)lane_type << ": " << ratio << " | " << fixed_ambiguities.transpose();
+    solution.ratio = ratio;
   }
   // solve by rounding
   else {
     num_active = 0;
     for (size_t i = 0; i < float_ambiguities.size(); i++) {
-      double integer = round(active_float_ambiguities(i));
-      double fractional = active_float_ambiguities(i) - integer;
+      double integer = round(float_ambiguities(i));
+      double fractional = float_ambiguities(i) - integer;
       if (sqrt(float_covariance(i, i)) > 0.25) break;
       if (fabs(fractional) > 0.25) break;
       fixed_ambiguities.conservativeResize(num_active + 1);
@@ -599,7 +685,19 @@ int AmbiguityResolution::solveLanes(
     }
   }
 
-  if (num_active < min_num_fixation) return 0;
+  if (num_active == 0 || num_active < min_num_fixation) return false;
+  solution.num_fixed = num_active;
+
+  return true;
+}
+
+// Apply fixed ambiguities of lanes
+int AmbiguityResolution::applyLanes(LaneSolution& solution)
+{
+  std::vector<LanePair>& lane_pairs = solution.lane_pairs;
+  const AmbiguityDifference& differential_jacobian = solution.differential_jacobian;
+  const Eigen::VectorXd& fixed_ambiguities = solution.fixed_ambiguities;
+  const int num_active = solution.num_fixed;
 
   // Contraint the fixed ambiguities to temporary parameters and check phaserange residual. 
   // ambiguity parameters
@@ -611,22 +709,16 @@ int AmbiguityResolution::solveLanes(
 
   // ambiguity measurements
   CHECK(fixed_ambiguities.size() == num_active);
-  size_t ambiguity_size = ambiguity_covariance_.cols();
-  Eigen::MatrixXd jacobian; jacobian.resize(num_active, ambiguity_size);
-  jacobian = differential_jacobian.topRows(num_active);
-  Eigen::MatrixXd fix_ambiguity_covariance = 
-    Eigen::MatrixXd::Identity(num_active, num_active) * 1e-6; // 0.001 cycles
+  AmbiguityDifference jacobian = differential_jacobian.topRows(num_active);
+  const double fix_ambiguity_variance = 1e-6; // 0.001 cycles
 
   // apply Kalman upadte to constraint the parameters
-  Eigen::MatrixXd kalman_gain = ambiguity_covariance_ * jacobian.transpose() * (jacobian * 
-    ambiguity_covariance_ * jacobian.transpose() + fix_ambiguity_covariance).inverse();
-  Eigen::VectorXd dx = kalman_gain * 
-    (fixed_ambiguities - jacobian * ambiguity_parameters);
-  ambiguity_covariance_ = (Eigen::MatrixXd::Identity(ambiguity_size, ambiguity_size) - 
-    kalman_gain * jacobian) * ambiguity_covariance_;
-  ambiguity_covariance_ = (ambiguity_covariance_ + ambiguity_covariance_.transpose()) / 2.0;
-  // update dx
-  ambiguity_parameters += dx;
+  if (!constrainAmbiguities(jacobian, fixed_ambiguities, fix_ambiguity_variance, 
+      ambiguity_parameters, ambiguity_covariance_)) {
+    LOG(WARNING) << "Innovation covariance of fixed ambiguities is not "
+                 << "positive definite! Skip the fixation.";
+    return 0;
+  }
 
   // Put ambiguities on global parameters
   // set to ambiguity handles
@@ -660,8 +752,10 @@ int AmbiguityResolution::solveLanes(
       }
     }
   }
+  if (solution.ratio > 0.0) ratios_.push_back(solution.ratio);
 
   // Add to graph
+  if (graph_ == nullptr) return num_active;
   const double information = 1.0e6; 
   for (int i = 0; i < num_active; i++) {
     auto& lane_pair = lane_pairs[i];
@@ -726,9 +820,46 @@ int AmbiguityResolution::trySolveLanes(
   static const std::vector<DelMethod> sequence = {
     DelMethod::Elevation, DelMethod::Variance, DelMethod::Fractional};
   // static const std::vector<DelMethod> sequence = {DelMethod::Elevation};
+
+  // Evaluate the strategies concurrently and take the best one
+  if (thread_pool_ != nullptr && !use_rounding) {
+    if (isTimeout()) return 0;
+    std::vector<LaneSolution> solutions(sequence.size());
+    std::vector<char> valid(sequence.size(), false);
+    std::vector<std::function<void()>> tasks;
+    for (size_t i = 0; i < sequence.size(); i++) {
+      bool skip_full = i == 0 ? false : true;
+      tasks.push_back([&, i, skip_full]() {
+        valid[i] = searchLanes(indexes, min_percentage_fixation, 
+          sequence[i], use_rounding, skip_full, solutions[i]);
+      });
+    }
+    thread_pool_->run(tasks);
+
+    // more fixed ambiguities first, and then higher ratio. If a solution cannot
+    // be applied, the next one is tried, as the serial path does.
+    std::vector<size_t> ranks;
+    for (size_t i = 0; i < sequence.size(); i++) {
+      if (valid[i]) ranks.push_back(i);
+    }
+    std::stable_sort(ranks.begin(), ranks.end(), 
+      [&solutions](const size_t a, const size_t b) {
+      if (solutions[a].num_fixed != solutions[b].num_fixed) {
+        return solutions[a].num_fixed > solutions[b].num_fixed;
+      }
+      return solutions[a].ratio > solutions[b].ratio;
+    });
+    for (const size_t i : ranks) {
+      const int num_fixed = applyLanes(solutions[i]);
+      if (num_fixed) return num_fixed;
+    }
+    return 0;
+  }
+
   int num_fixed = 0;
   for (size_t i = 0; i < sequence.size(); i++) {
     if (num_fixed) break;
+    if (isTimeout()) break;
     DelMethod method = sequence[i];
     bool skip_full = i == 0 ? false : true;
     num_fixed = solveLanes(indexes, min_percentage_fixation, 
@@ -884,4 +1015,22 @@ double AmbiguityResolution::computeRangeCost(const BackendId& epoch_id)
   return sqrt(total_cost_square);
 }
 
-}
\ No newline at end of file
+// Start the time budget of current epoch
+void AmbiguityResolution::startTimer()
+{
+  if (options_.max_time <= 0.0) {
+    deadline_ = 0.0; return;
+  }
+  deadline_ = std::chrono::duration<double>(
+    std::chrono::steady_clock::now().time_since_epoch()).count() + options_.max_time;
+}
+
+// Check if the time budget is used up
+bool AmbiguityResolution::isTimeout() const
+{
+  if (deadline_ == 0.0) return false;
+  return std::chrono::duration<double>(
+    std::chrono::steady_clock::now().time_since_epoch()).count() > deadline_;
+}
+
+}
@@ -21,18 +21,10 @@ AmbiguityResolution::Result AmbiguityResolution::solveRtk(
              const Eigen::MatrixXd& ambiguity_covariance,
              const std::pair<GnssMeasurement, GnssMeasurement>& measurements)
 {
+  startTimer();
+
   // Prepare data 
-  // Shift storage
-  ambiguities_.push_back(std::vector<Spec>());
-  ambiguity_pairs_.push_back(std::vector<BsdPair>());
-  ambiguity_lane_pairs_.push_back(std::vector<LanePair>());
-  if (ambiguities_.size() > 2) {
-    ambiguities_.pop_front();
-    ambiguity_pairs_.pop_front();
-    ambiguity_lane_pairs_.pop_front();
-  }
-  full_parameters_store_.clear();
-  lane_groups_.clear();
+  shiftEpoch();
 
   // Get parameters
   const GnssMeasurement& measurements_rov = measurements.first;
@@ -111,6 +103,7 @@ AmbiguityResolution::Result AmbiguityResolution::solveRtk(
     }
     curAmbs()[i].std = sqrt(ambiguity_covariance_(i, i));
   }
+  dumpSnapshot(1);
 
   // Collect all parameter blocks
   Graph::ParameterBlockCollection parameters = graph_->parameters();
@@ -134,53 +127,8 @@ AmbiguityResolution::Result AmbiguityResolution::solveRtk(
   }
 
   // Sovle ambiguity
-  // Apply Between-Satellite-Difference (BSD) and lane combination
-  formSatellitePairRtk();
-
-  // Sort lanes to groups
-  groupingSatellitePair();
-  if (lane_groups_.size() == 0) return Result::NoFix;
-
-  // Try fix lanes
-  int num_success_uwl = 0, num_candidate_uwl = 0; 
-  int num_success_wl = 0, num_candidate_wl = 0; 
-  int num_success_nl = 0, num_candidate_nl = 0;
-  bool has_uwl = false, has_wl = false;
-  for (int i = lane_groups_.size() - 1; i >= 0; i--) {
-    LaneType type = curAmbLanePairs().at(lane_groups_.at(i).front()).laneType();
-    double min_percentage_fixation;
-    bool use_rounding = false;
-    if (type == LaneType::UWL) {
-      min_percentage_fixation = options_.min_percentage_fixation_uwl;
-      use_rounding = false;
-      has_uwl = true;
-    }
-    else if (type == LaneType::WL) {
-      min_percentage_fixation = options_.min_percentage_fixation_wl;
-      use_rounding = false;
-      has_wl = true;
-    }
-    else {
-      min_percentage_fixation = options_.min_percentage_fixation_nl;
-      use_rounding = false;
-    }
-
-    int num_fixed = trySolveLanes(
-      lane_groups_.at(i), min_percentage_fixation, use_rounding);
-
-    if (type == LaneType::UWL) {
-      num_success_uwl += num_fixed;
-      num_candidate_uwl += lane_groups_.at(i).size();
-    }
-    else if (type == LaneType::WL) {
-      num_success_wl += num_fixed;
-      num_candidate_wl += lane_groups_.at(i).size();
-    }
-    else {
-      num_success_nl += num_fixed;
-      num_candidate_nl += lane_groups_.at(i).size();
-    }
-  }
+  int num_success_nl = 0, num_success_wl = 0, num_success_uwl = 0;
+  fixLanes(true, num_success_nl, num_success_wl, num_success_uwl);
 
   // Check if no valid fixation
   if (num_success_nl == 0 && num_success_wl == 0 && 
@@ -218,7 +166,7 @@ void AmbiguityResolution::formSatellitePairRtk()
   std::map<std::string, int> prn_to_number_phases; 
   std::multimap<std::string, double> prn_to_wavelengths;
   std::multimap<std::string, Spec> prn_to_specs;
-  std::map<uint64_t, size_t> id_to_spec_id;
+  std::unordered_map<uint64_t, size_t, BackendIdHash> id_to_spec_id;
   for (size_t i = 0; i < curAmbs().size(); i++) {
     Spec& ambiguity = curAmbs()[i];
     std::string prn = ambiguity.id.gPrn();
@@ -17,13 +17,12 @@ namespace gici {
 // Construct with measurement and information matrix
 template<int... Ns>
 DopplerError<Ns ...>::DopplerError(
-                       const GnssMeasurement& measurement,
+                       const GnssMeasurementConstPtr& measurement,
                        const GnssMeasurementIndex index,
                        const GnssErrorParameter& error_parameter)
 {
+  index_ = index;
   setMeasurement(measurement);
-  satellite_ = measurement_.getSat(index);
-  observation_ = measurement_.getObs(index);
 
   // Check parameter block types
   // Group 1
@@ -50,7 +49,7 @@ DopplerError<Ns ...>::DopplerError(
 // Construct with measurement and information matrix
 template<int... Ns>
 DopplerError<Ns ...>::DopplerError(
-                       const GnssMeasurement& measurement,
+                       const GnssMeasurementConstPtr& measurement,
                        const GnssMeasurementIndex index,
                        const GnssErrorParameter& error_parameter,
                        const Eigen::Vector3d& angular_velocity)
@@ -67,7 +66,7 @@ void DopplerError<Ns ...>::setInformation(const GnssErrorParameter& error_parame
   error_parameter_ = error_parameter;
   double factor = error_parameter_.doppler_error_factor;
   covariance_ = covariance_t(square(factor));
-  char system = satellite_.getSystem();
+  char system = satellite_->getSystem();
   covariance_ *= square(error_parameter_.system_error_ratio.at(system));
 
   information_ = covariance_.inverse();
@@ -135,25 +134,25 @@ bool DopplerError<Ns ...>::EvaluateWithMinimalJacobians(
     v_WR_ECEF = coordinate_->rotate(v_WR, GeoType::ENU, GeoType::ECEF);
   }
 
-  double timestamp = measurement_.timestamp;
+  double timestamp = measurement_->timestamp;
   double rho = gnss_common::satelliteToReceiverDistance(
-    satellite_.sat_position, t_WR_ECEF);
+    satellite_->sat_position, t_WR_ECEF);
   double elevation = gnss_common::satelliteElevation(
-    satellite_.sat_position, t_WR_ECEF);
+    satellite_->sat_position, t_WR_ECEF);
   double azimuth = gnss_common::satelliteAzimuth(
-    satellite_.sat_position, t_WR_ECEF);
+    satellite_->sat_position, t_WR_ECEF);
 
   // Get estimate derivated measurement
-  Eigen::Vector3d e = (satellite_.sat_position - t_WR_ECEF) / rho;
-  Eigen::Vector3d v_sat = satellite_.sat_velocity;
-  Eigen::Vector3d p_sat = satellite_.sat_position;
+  Eigen::Vector3d e = (satellite_->sat_position - t_WR_ECEF) / rho;
+  Eigen::Vector3d v_sat = satellite_->sat_velocity;
+  Eigen::Vector3d p_sat = satellite_->sat_position;
   Eigen::Vector3d vs = v_sat - v_WR_ECEF;
   // range rate with earth rotation correction
   double range_rate = vs.dot(e) + OMGE / CLIGHT *
       (v_sat(1) * t_WR_ECEF(0) + p_sat(1) * v_WR_ECEF(0) -
        v_sat(0) * t_WR_ECEF(1) - p_sat(0) * v_WR_ECEF(1));
   double doppler_estimate = 
-    range_rate + clock_frequency - satellite_.sat_frequency;
+    range_rate + clock_frequency - satellite_->sat_frequency;
 
   // Compute error
   double doppler = observation_.doppler;
@@ -172,7 +171,7 @@ bool DopplerError<Ns ...>::EvaluateWithMinimalJacobians(
 
     // Receiver velocity in ECEF
     Eigen::Matrix<double, 1, 3> J_v_ECEF = 
-      -((t_WR_ECEF - satellite_.sat_position) / rho).transpose();
+      -((t_WR_ECEF - satellite_->sat_position) / rho).transpose();
 
     // Poses and velocities in ENU
     Eigen::Matrix<double, 1, 6> J_T_WS;
@@ -0,0 +1,76 @@
+/**
+* @Function: Per-epoch cache of GNSS model corrections
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#include "gici/gnss/gnss_correction_cache.h"
+
+#include "gici/gnss/gnss_common.h"
+
+namespace gici {
+
+// The default constructor.
+GnssCorrectionCache::GnssCorrectionCache(
+                    const double timestamp,
+                    const Eigen::VectorXd& ionosphere_parameters,
+                    const double tolerance,
+                    const bool apply_tide) :
+  timestamp_(timestamp), ionosphere_parameters_(ionosphere_parameters),
+  tolerance_(tolerance), apply_tide_(apply_tide)
+{
+  prns_.reserve(64);
+  satellite_positions_.reserve(64);
+  satellites_.reserve(64);
+}
+
+// Register a satellite and get its slot
+size_t GnssCorrectionCache::addSatellite(const Satellite& satellite)
+{
+  for (size_t i = 0; i < prns_.size(); i++) {
+    if (prns_[i] == satellite.prn) return i;
+  }
+
+  prns_.push_back(satellite.prn);
+  satellite_positions_.push_back(satellite.sat_position);
+  satellites_.push_back(GnssSatelliteCorrections());
+  if (has_station_) computeSatellite(satellites_.size() - 1);
+  return satellites_.size() - 1;
+}
+
+// Recompute the corrections if the receiver moved beyond tolerance
+void GnssCorrectionCache::update(const Eigen::Vector3d& receiver_ecef)
+{
+  if (has_station_ && (receiver_ecef - position_).norm() <= tolerance_) return;
+
+  position_ = receiver_ecef;
+  station_.tide = apply_tide_ ?
+    gnss_common::solidEarthTide(timestamp_, position_) : Eigen::Vector3d::Zero();
+  station_.zenith_hydro = gnss_common::troposphereSaastamoinen(
+    timestamp_, position_ + station_.tide, PI / 2.0);
+  for (size_t i = 0; i < satellites_.size(); i++) computeSatellite(i);
+  has_station_ = true;
+  num_refreshes_++;
+}
+
+// Compute satellite corrections at current position
+void GnssCorrectionCache::computeSatellite(const size_t slot)
+{
+  GnssSatelliteCorrections& terms = satellites_[slot];
+  const Eigen::Vector3d& satellite_position = satellite_positions_[slot];
+  const Eigen::Vector3d position = position_ + station_.tide;
+  terms.elevation = gnss_common::satelliteElevation(
+    satellite_position, position);
+  terms.azimuth = gnss_common::satelliteAzimuth(
+    satellite_position, position);
+  terms.troposphere_hydro = gnss_common::troposphereSaastamoinen(
+    timestamp_, position, terms.elevation);
+  gnss_common::troposphereGMF(timestamp_, position, terms.elevation,
+    &terms.gmf_hydro, &terms.gmf_wet);
+  terms.ionosphere = gnss_common::ionosphereBroadcast(timestamp_, position,
+    terms.azimuth, terms.elevation, CLIGHT / FREQ1, ionosphere_parameters_);
+}
+
+}
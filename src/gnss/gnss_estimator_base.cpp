@@ -8,9 +8,12 @@
 **/
 #include "gici/gnss/gnss_estimator_base.h"
 
+#include <Eigen/Sparse>
+
 #include "gici/gnss/gnss_parameter_blocks.h"
 #include "gici/gnss/gnss_const_errors.h"
 #include "gici/gnss/pseudorange_error.h"
+#include "gici/gnss/pseudorange_error_batch.h"
 #include "gici/gnss/phaserange_error.h"
 #include "gici/gnss/doppler_error.h"
 #include "gici/gnss/gnss_relative_errors.h"
@@ -28,8 +31,15 @@ int32_t GnssEstimatorBase::solution_id = 0;
 GnssEstimatorBase::GnssEstimatorBase(
                     const GnssEstimatorBaseOptions& options,
                     const EstimatorBaseOptions& base_options) :
-  gnss_base_options_(options), EstimatorBase(base_options)
-{}
+  gnss_base_options_(options), EstimatorBase(base_options),
+  gnss_loss_function_(new ceres::LossFunctionWrapper(
+    huber_loss_function_.get(), ceres::DO_NOT_TAKE_OWNERSHIP))
+{
+  if (gnss_base_options_.use_robust_fde) {
+    igg_loss_function_ = std::make_shared<IggLoss>(
+      gnss_base_options_.robust_fde_k0, gnss_base_options_.robust_fde_k1);
+  }
+}
 
 // The default destructor
 GnssEstimatorBase::~GnssEstimatorBase()
@@ -41,7 +51,7 @@ BackendId GnssEstimatorBase::addGnssPositionParameterBlock(
 {
   BackendId position_id = createGnssPositionId(id);
   std::shared_ptr<PositionParameterBlock> position_parameter_block =  // 创建参数块
-    std::make_shared<PositionParameterBlock>(prior, position_id.asInteger());
+    makePooled<PositionParameterBlock>(object_pool_, prior, position_id.asInteger());
   CHECK(graph_->addParameterBlock(position_parameter_block));   // 加到图中
   return position_id;
 }
@@ -53,7 +63,7 @@ BackendId GnssEstimatorBase::addGnssVelocityParameterBlock(
 {
   BackendId velocity_id = createGnssVelocityId(id);
   std::shared_ptr<VelocityParameterBlock> velocity_parameter_block = 
-    std::make_shared<VelocityParameterBlock>(prior, velocity_id.asInteger());
+    makePooled<VelocityParameterBlock>(object_pool_, prior, velocity_id.asInteger());
   CHECK(graph_->addParameterBlock(velocity_parameter_block));
   return velocity_id;
 }
@@ -66,7 +76,7 @@ BackendId GnssEstimatorBase::addGnssExtrinsicsParameterBlock(
   BackendId pose_id = createGnssPoseId(id);
   BackendId gnss_extrinsics_id = changeIdType(pose_id, IdType::gExtrinsics);
   std::shared_ptr<PositionParameterBlock> gnss_extrinsic_parameter_block = 
-    std::make_shared<PositionParameterBlock>(
+    makePooled<PositionParameterBlock>(object_pool_,
       t_SR_S_prior, gnss_extrinsics_id.asInteger());
   CHECK(graph_->addParameterBlock(gnss_extrinsic_parameter_block));
   return gnss_extrinsics_id;
@@ -90,7 +100,7 @@ void GnssEstimatorBase::addClockParameterBlocks(
       clock_init.setZero();
       if (prior.find(system) != prior.end()) clock_init[0] = prior.at(system);
       std::shared_ptr<ClockParameterBlock> clock_parameter_block = 
-        std::make_shared<ClockParameterBlock>(clock_init, clock_id.asInteger());
+        makePooled<ClockParameterBlock>(object_pool_, clock_init, clock_id.asInteger());
       CHECK(graph_->addParameterBlock(clock_parameter_block));
     }
   }
@@ -136,7 +146,7 @@ void GnssEstimatorBase::addClockParameterBlocks(
         square(1.0 / gnss_base_options_.error_parameter.initial_clock);
     }
     std::shared_ptr<ClockError> clock_error = 
-      std::make_shared<ClockError>(measurement, information);
+      makePooled<ClockError>(object_pool_, measurement, information);
     graph_->addResidualBlock(clock_error, nullptr,  // 残差和参数块在一个语句中加入了
       graph_->parameterBlockPtr(clock_id.asInteger()));
   }
@@ -206,7 +216,7 @@ void GnssEstimatorBase::addIfbParameterBlocks(
         Eigen::Matrix<double, 1, 1> init = 
           Eigen::Matrix<double, 1, 1>::Identity() * init_ifb;
         std::shared_ptr<IfbParameterBlock> ifb_parameter_block = 
-          std::make_shared<IfbParameterBlock>(init, ifb_id.asInteger());
+          makePooled<IfbParameterBlock>(object_pool_, init, ifb_id.asInteger());
         CHECK(graph_->addParameterBlock(ifb_parameter_block));
         ifbs_.push_back(ifb);
 
@@ -245,7 +255,7 @@ void GnssEstimatorBase::addFrequencyParameterBlocks(
       freq_init.setZero();
       if (prior.find(system) != prior.end()) freq_init[0] = prior.at(system);
       std::shared_ptr<FrequencyParameterBlock> freq_parameter_block = 
-        std::make_shared<FrequencyParameterBlock>(freq_init, freq_id.asInteger());
+        makePooled<FrequencyParameterBlock>(object_pool_, freq_init, freq_id.asInteger());
       CHECK(graph_->addParameterBlock(freq_parameter_block));
     }
   }
@@ -289,7 +299,7 @@ void GnssEstimatorBase::addFrequencyParameterBlocks(
     if (prior.find(system) != prior.end()) measurement[0] = prior.at(system);
     Eigen::MatrixXd information = Eigen::MatrixXd::Identity(1, 1) * 1e-6;
     std::shared_ptr<FrequencyError> freq_error = 
-      std::make_shared<FrequencyError>(measurement, information);
+      makePooled<FrequencyError>(object_pool_, measurement, information);
     graph_->addResidualBlock(freq_error, nullptr, 
       graph_->parameterBlockPtr(freq_id.asInteger()));
   }
@@ -302,7 +312,7 @@ void GnssEstimatorBase::addTroposphereParameterBlock(const int32_t id)
   Eigen::Matrix<double, 1, 1> tropo_init;
   tropo_init.setZero();
   std::shared_ptr<TroposphereParameterBlock> tropo_parameter_block = 
-    std::make_shared<TroposphereParameterBlock>(tropo_init, tropo_id.asInteger());
+    makePooled<TroposphereParameterBlock>(object_pool_, tropo_init, tropo_id.asInteger());
   CHECK(graph_->addParameterBlock(tropo_parameter_block));
 
   // Add initial prior measurement
@@ -336,7 +346,7 @@ void GnssEstimatorBase::addIonosphereParameterBlocks(
     Eigen::Matrix<double, 1, 1> init;
     init[0] = satellite.ionosphere;
     std::shared_ptr<IonosphereParameterBlock> iono_parameter_block = 
-      std::make_shared<IonosphereParameterBlock>(init, iono_id.asInteger());
+      makePooled<IonosphereParameterBlock>(object_pool_, init, iono_id.asInteger());
     CHECK(graph_->addParameterBlock(iono_parameter_block));
     state.ids.push_back(iono_id);
 
@@ -399,7 +409,7 @@ void GnssEstimatorBase::addAmbiguityParameterBlocks(
       Eigen::Matrix<double, 1, 1> init;
       init[0] = ambiguity;
       std::shared_ptr<AmbiguityParameterBlock> ambiguity_parameter_block = 
-        std::make_shared<AmbiguityParameterBlock>(init, ambiguity_id.asInteger());
+        makePooled<AmbiguityParameterBlock>(object_pool_, init, ambiguity_id.asInteger());
       CHECK(graph_->addParameterBlock(ambiguity_parameter_block));
       state.ids.push_back(ambiguity_id);
 
@@ -635,7 +645,7 @@ void GnssEstimatorBase::addGnssPositionResidualBlock(
 {
   Eigen::Matrix3d information = Eigen::Matrix3d::Identity() * (1.0 / square(std));
   std::shared_ptr<PositionError<3>> position_error = 
-    std::make_shared<PositionError<3>>(position, information);
+    makePooled<PositionError<3>>(object_pool_, position, information);
   ceres::ResidualBlockId residual_id = 
     graph_->addResidualBlock(position_error, 
       nullptr,   
@@ -649,7 +659,7 @@ void GnssEstimatorBase::addGnssVelocityResidualBlock(
   BackendId velocity_id = createGnssVelocityId(state.id_in_graph.bundleId());
   Eigen::Matrix3d information = Eigen::Matrix3d::Identity() * (1.0 / square(std));
   std::shared_ptr<VelocityError<3>> velocity_error = 
-    std::make_shared<VelocityError<3>>(velocity, information);
+    makePooled<VelocityError<3>>(object_pool_, velocity, information);
   ceres::ResidualBlockId residual_id = 
     graph_->addResidualBlock(velocity_error, 
       nullptr,   
@@ -663,6 +673,8 @@ void GnssEstimatorBase::addPseudorangeResidualBlocks(
   int& num_valid_satellite,
   bool use_single_frequency)
 {
+  const GnssMeasurementConstPtr context = getEpochContext(measurement);
+  const GnssCorrectionCachePtr corrections = getCorrectionCache(measurement, state, true);
   CHECK(!(use_single_frequency && is_verbose_model_));
   num_valid_satellite = 0;
   const BackendId parameter_id = state.id;  // 外部是让curGNSS()和curState()的ID一致了
@@ -672,6 +684,16 @@ void GnssEstimatorBase::addPseudorangeResidualBlocks(
   // Ignore IFBs, because they are not significant for meter-level positioning. 
   if (!is_verbose_model_) 
   {
+    // All the rows of this epoch go to one residual block for ECEF position
+    std::shared_ptr<PseudorangeErrorBatch> pseudorange_batch;
+    if (gnss_base_options_.use_batched_pseudorange && 
+        parameter_id.type() == IdType::gPosition) {
+      pseudorange_batch = makePooled<PseudorangeErrorBatch>(object_pool_, context, 
+        gnss_base_options_.error_parameter, 
+        gnss_base_options_.correction_cache_tolerance);
+      pseudorange_batch->setLossFunction(gnss_loss_function_.get());
+    }
+
     for (auto& sat : measurement.satellites) 
     {
       const Satellite& satellite = sat.second;          // 卫星的信息：位置、速度等
@@ -702,14 +724,19 @@ void GnssEstimatorBase::addPseudorangeResidualBlocks(
 
         // position in ECEF for standalone 
         ceres::ResidualBlockId residual_id;
-        if (parameter_id.type() == IdType::gPosition) {
+        if (pseudorange_batch) {
+          is_state_pose_ = false;
+          pseudorange_batch->addRow(GnssMeasurementIndex(satellite.prn, obs.first));
+        }
+        else if (parameter_id.type() == IdType::gPosition) {
           is_state_pose_ = false;
           std::shared_ptr<PseudorangeError<3, 1>> pseudorange_error = 
-            std::make_shared<PseudorangeError<3, 1>>(measurement,   // measurement包含误差项
+            makePooled<PseudorangeError<3, 1>>(object_pool_, context,   // measurement包含误差项
             GnssMeasurementIndex(satellite.prn, obs.first), 
             gnss_base_options_.error_parameter);
+          pseudorange_error->setCorrectionCache(corrections);
           residual_id = graph_->addResidualBlock(pseudorange_error, 
-            huber_loss_function_ ? huber_loss_function_.get() : nullptr,
+            gnss_loss_function_.get(),
             graph_->parameterBlockPtr(parameter_id.asInteger()),
             graph_->parameterBlockPtr(clock_id.asInteger()));
         }
@@ -718,12 +745,13 @@ void GnssEstimatorBase::addPseudorangeResidualBlocks(
           is_state_pose_ = true;
           BackendId pose_id = state.id_in_graph;
           std::shared_ptr<PseudorangeError<7, 3, 1>> pseudorange_error =  // ENU下是七维
-            std::make_shared<PseudorangeError<7, 3, 1>>(measurement,      // measurement包含误差项
+            makePooled<PseudorangeError<7, 3, 1>>(object_pool_, context,      // measurement包含误差项
             GnssMeasurementIndex(satellite.prn, obs.first), 
             gnss_base_options_.error_parameter);
+          pseudorange_error->setCorrectionCache(corrections);
           pseudorange_error->setCoordinate(coordinate_);
           residual_id = graph_->addResidualBlock(pseudorange_error, 
-            huber_loss_function_ ? huber_loss_function_.get() : nullptr,
+            gnss_loss_function_.get(),
             graph_->parameterBlockPtr(pose_id.asInteger()), 
             graph_->parameterBlockPtr(gnss_extrinsics_id_.asInteger()),
             graph_->parameterBlockPtr(clock_id.asInteger()));
@@ -733,6 +761,16 @@ void GnssEstimatorBase::addPseudorangeResidualBlocks(
       }
       if (has_valid) num_valid_satellite++;
     }
+
+    if (pseudorange_batch && pseudorange_batch->numRows() > 0) {
+      std::vector<std::shared_ptr<ParameterBlock>> parameter_blocks;
+      parameter_blocks.push_back(graph_->parameterBlockPtr(parameter_id.asInteger()));
+      for (const char system : pseudorange_batch->systems()) {
+        BackendId clock_id = createGnssClockId(system, measurement.id);
+        parameter_blocks.push_back(graph_->parameterBlockPtr(clock_id.asInteger()));
+      }
+      graph_->addResidualBlock(pseudorange_batch, nullptr, parameter_blocks);
+    }
   }
   // Precise mode.
   // Estimate atmosphere and IFBs
@@ -770,11 +808,12 @@ void GnssEstimatorBase::addPseudorangeResidualBlocks(
         if (parameter_id.type() == IdType::gPosition) {
           is_state_pose_ = false;
           std::shared_ptr<PseudorangeError<3, 1, 1, 1, 1>> pseudorange_error = 
-            std::make_shared<PseudorangeError<3, 1, 1, 1, 1>>(measurement, 
+            makePooled<PseudorangeError<3, 1, 1, 1, 1>>(object_pool_, context, 
             GnssMeasurementIndex(satellite.prn, obs.first), 
             gnss_base_options_.error_parameter);
+          pseudorange_error->setCorrectionCache(corrections);
           residual_id = graph_->addResidualBlock(pseudorange_error, 
-            huber_loss_function_ ? huber_loss_function_.get() : nullptr,
+            gnss_loss_function_.get(),
             graph_->parameterBlockPtr(parameter_id.asInteger()),
             graph_->parameterBlockPtr(clock_id.asInteger()), 
             graph_->parameterBlockPtr(ifb_id.asInteger()), 
@@ -786,12 +825,13 @@ void GnssEstimatorBase::addPseudorangeResidualBlocks(
           is_state_pose_ = true;
           BackendId pose_id = state.id_in_graph;
           std::shared_ptr<PseudorangeError<7, 3, 1, 1, 1, 1>> pseudorange_error = 
-            std::make_shared<PseudorangeError<7, 3, 1, 1, 1, 1>>(measurement, 
+            makePooled<PseudorangeError<7, 3, 1, 1, 1, 1>>(object_pool_, context, 
             GnssMeasurementIndex(satellite.prn, obs.first), 
             gnss_base_options_.error_parameter);
+          pseudorange_error->setCorrectionCache(corrections);
           pseudorange_error->setCoordinate(coordinate_);
           residual_id = graph_->addResidualBlock(pseudorange_error, 
-            huber_loss_function_ ? huber_loss_function_.get() : nullptr,
+            gnss_loss_function_.get(),
             graph_->parameterBlockPtr(pose_id.asInteger()), 
             graph_->parameterBlockPtr(gnss_extrinsics_id_.asInteger()),
             graph_->parameterBlockPtr(clock_id.asInteger()),
@@ -810,6 +850,8 @@ void GnssEstimatorBase::addPhaserangeResidualBlocks(
   const GnssMeasurement& measurement,
   const State& state)
 {
+  const GnssMeasurementConstPtr context = getEpochContext(measurement);
+  const GnssCorrectionCachePtr corrections = getCorrectionCache(measurement, state, true);
   CHECK(is_verbose_model_);
   const BackendId parameter_id = state.id;
 
@@ -841,11 +883,12 @@ void GnssEstimatorBase::addPhaserangeResidualBlocks(
       if (parameter_id.type() == IdType::gPosition) {
         is_state_pose_ = false;
         std::shared_ptr<PhaserangeError<3, 1, 1, 1, 1>> phaserange_error = 
-          std::make_shared<PhaserangeError<3, 1, 1, 1, 1>>(measurement, 
+          makePooled<PhaserangeError<3, 1, 1, 1, 1>>(object_pool_, context, 
           GnssMeasurementIndex(satellite.prn, obs.first), 
           gnss_base_options_.error_parameter);
+        phaserange_error->setCorrectionCache(corrections);
         residual_id = graph_->addResidualBlock(phaserange_error, 
-          huber_loss_function_ ? huber_loss_function_.get() : nullptr,
+          gnss_loss_function_.get(),
           graph_->parameterBlockPtr(parameter_id.asInteger()),
           graph_->parameterBlockPtr(clock_id.asInteger()), 
           graph_->parameterBlockPtr(ambiguity_id.asInteger()), 
@@ -857,12 +900,13 @@ void GnssEstimatorBase::addPhaserangeResidualBlocks(
         is_state_pose_ = true;
         BackendId pose_id = state.id_in_graph;
         std::shared_ptr<PhaserangeError<7, 3, 1, 1, 1, 1>> phaserange_error = 
-          std::make_shared<PhaserangeError<7, 3, 1, 1, 1, 1>>(measurement, 
+          makePooled<PhaserangeError<7, 3, 1, 1, 1, 1>>(object_pool_, context, 
           GnssMeasurementIndex(satellite.prn, obs.first), 
           gnss_base_options_.error_parameter);
+        phaserange_error->setCorrectionCache(corrections);
         phaserange_error->setCoordinate(coordinate_);
         residual_id = graph_->addResidualBlock(phaserange_error, 
-          huber_loss_function_ ? huber_loss_function_.get() : nullptr,
+          gnss_loss_function_.get(),
           graph_->parameterBlockPtr(pose_id.asInteger()), 
           graph_->parameterBlockPtr(gnss_extrinsics_id_.asInteger()),
           graph_->parameterBlockPtr(clock_id.asInteger()),
@@ -882,6 +926,7 @@ void GnssEstimatorBase::addDopplerResidualBlocks(
   bool use_single_frequency,
   const Eigen::Vector3d& angular_velocity)
 {
+  const GnssMeasurementConstPtr context = getEpochContext(measurement);
   num_valid_satellite = 0;
   const BackendId parameter_id = state.id;
 
@@ -919,11 +964,11 @@ void GnssEstimatorBase::addDopplerResidualBlocks(
         BackendId velocity_id = changeIdType(parameter_id, IdType::gVelocity);
         BackendId freq_id = createGnssFrequencyId(system, measurement.id);
         std::shared_ptr<DopplerError<3, 3, 1>> doppler_error = 
-          std::make_shared<DopplerError<3, 3, 1>>(measurement, 
+          makePooled<DopplerError<3, 3, 1>>(object_pool_, context, 
           GnssMeasurementIndex(satellite.prn, obs.first), 
           gnss_base_options_.error_parameter);
         graph_->addResidualBlock(doppler_error, 
-          huber_loss_function_ ? huber_loss_function_.get() : nullptr,
+          gnss_loss_function_.get(),
           graph_->parameterBlockPtr(parameter_id.asInteger()),
           graph_->parameterBlockPtr(velocity_id.asInteger()),
           graph_->parameterBlockPtr(freq_id.asInteger()));
@@ -935,12 +980,12 @@ void GnssEstimatorBase::addDopplerResidualBlocks(
         BackendId speed_and_bias_id = changeIdType(pose_id, IdType::ImuStates);
         BackendId freq_id = createGnssFrequencyId(system, measurement.id);
         std::shared_ptr<DopplerError<7, 9, 3, 1>> doppler_error = 
-          std::make_shared<DopplerError<7, 9, 3, 1>>(measurement, 
+          makePooled<DopplerError<7, 9, 3, 1>>(object_pool_, context, 
           GnssMeasurementIndex(satellite.prn, obs.first), 
           gnss_base_options_.error_parameter, angular_velocity);
         doppler_error->setCoordinate(coordinate_);
         graph_->addResidualBlock(doppler_error, 
-          huber_loss_function_ ? huber_loss_function_.get() : nullptr,
+          gnss_loss_function_.get(),
           graph_->parameterBlockPtr(pose_id.asInteger()), 
           graph_->parameterBlockPtr(speed_and_bias_id.asInteger()), 
           graph_->parameterBlockPtr(gnss_extrinsics_id_.asInteger()),
@@ -964,7 +1009,7 @@ void GnssEstimatorBase::addTroposphereResidualBlock(
     Eigen::Matrix<double, 1, 1>::Identity() * square(std);
   const Eigen::Map<const Eigen::VectorXd> tropo_init(&value, 1);
   std::shared_ptr<TroposphereError> tropo_error = 
-    std::make_shared<TroposphereError>(tropo_init, covariance.inverse());
+    makePooled<TroposphereError>(object_pool_, tropo_init, covariance.inverse());
   graph_->addResidualBlock(tropo_error, nullptr,
     graph_->parameterBlockPtr(tropo_id.asInteger()));
 }
@@ -979,7 +1024,7 @@ void GnssEstimatorBase::addIonosphereResidualBlock(
     Eigen::Matrix<double, 1, 1>::Identity() * square(std);
   const Eigen::Map<const Eigen::VectorXd> iono_init(&value, 1);
   std::shared_ptr<IonosphereError> iono_error = 
-    std::make_shared<IonosphereError>(iono_init, covariance.inverse());
+    makePooled<IonosphereError>(object_pool_, iono_init, covariance.inverse());
   graph_->addResidualBlock(iono_error, nullptr,
     graph_->parameterBlockPtr(iono_id.asInteger()));
 }
@@ -994,7 +1039,7 @@ void GnssEstimatorBase::addAmbiguityResidualBlock(
     Eigen::Matrix<double, 1, 1>::Identity() * square(std);
   const Eigen::Map<const Eigen::VectorXd> amb_init(&value, 1);
   std::shared_ptr<SingleAmbiguityError> amb_error =   // 在构建误差的时候会执行setInformation的操作
-    std::make_shared<SingleAmbiguityError>(amb_init, covariance.inverse());
+    makePooled<SingleAmbiguityError>(object_pool_, amb_init, covariance.inverse());
   graph_->addResidualBlock(amb_error, nullptr,
     graph_->parameterBlockPtr(amb_id.asInteger()));
 }
@@ -1017,7 +1062,7 @@ void GnssEstimatorBase::addRelativePositionResidualBlock(
     dp_covariance, GeoType::ENU, GeoType::ECEF);
 
   std::shared_ptr<RelativePositionError> relative_position_error = 
-    std::make_shared<RelativePositionError>(dp_covariance.inverse());
+    makePooled<RelativePositionError>(object_pool_, dp_covariance.inverse());
   graph_->addResidualBlock(relative_position_error, nullptr,
     graph_->parameterBlockPtr(last_id.asInteger()),
     graph_->parameterBlockPtr(cur_id.asInteger()));
@@ -1044,7 +1089,7 @@ void GnssEstimatorBase::addRelativePositionAndVelocityResidualBlock(
   dv_psd = coordinate_->convertCovariance(dv_psd, GeoType::ENU, GeoType::ECEF);
 
   std::shared_ptr<RelativePositionAndVelocityError> relative_error = 
-    std::make_shared<RelativePositionAndVelocityError>(dv_psd, dt);
+    makePooled<RelativePositionAndVelocityError>(object_pool_, dv_psd, dt);
   graph_->addResidualBlock(relative_error, nullptr, 
     graph_->parameterBlockPtr(last_id.asInteger()), 
     graph_->parameterBlockPtr(cur_id.asInteger()),
@@ -1080,7 +1125,7 @@ void GnssEstimatorBase::addRelativeIsbResidualBlock(
 
   for (size_t i = 1; i < cur_clock_ids.size(); i++) {
     std::shared_ptr<RelativeIsbError> relative_isb_error = 
-      std::make_shared<RelativeIsbError>(1.0 / disb_covariance);
+      makePooled<RelativeIsbError>(object_pool_, 1.0 / disb_covariance);
     graph_->addResidualBlock(relative_isb_error, nullptr,
       graph_->parameterBlockPtr(last_clock_ids[0].asInteger()),
       graph_->parameterBlockPtr(last_clock_ids[i].asInteger()), 
@@ -1111,7 +1156,7 @@ void GnssEstimatorBase::addRelativeFrequencyResidualBlock(
       Eigen::Matrix<double, 1, 1>::Identity() * square(dfreq_error) * dt;
     
     std::shared_ptr<RelativeFrequencyError> relative_freq_error = 
-      std::make_shared<RelativeFrequencyError>(dfreq_covariance.inverse());
+      makePooled<RelativeFrequencyError>(object_pool_, dfreq_covariance.inverse());
     graph_->addResidualBlock(relative_freq_error, nullptr,
       graph_->parameterBlockPtr(last_freq_id.asInteger()),
       graph_->parameterBlockPtr(cur_freq_id.asInteger()));
@@ -1150,7 +1195,7 @@ void GnssEstimatorBase::addRelativeTroposphereResidualBlock(
     Eigen::Matrix<double, 1, 1>::Identity() * square(dtropo_error) * dt;
   
   std::shared_ptr<RelativeTroposphereError> relative_tropo_error = 
-    std::make_shared<RelativeTroposphereError>(dtropo_covariance.inverse());
+    makePooled<RelativeTroposphereError>(object_pool_, dtropo_covariance.inverse());
   graph_->addResidualBlock(relative_tropo_error, nullptr,
     graph_->parameterBlockPtr(last_tropo_id.asInteger()),
     graph_->parameterBlockPtr(cur_tropo_id.asInteger()));
@@ -1177,7 +1222,7 @@ void GnssEstimatorBase::addRelativeIonosphereResidualBlock(
       if (!sameIonosphere(last_state.ids[j], cur_state.ids[i])) continue;
 
       std::shared_ptr<RelativeIonosphereError> relative_iono_error = 
-        std::make_shared<RelativeIonosphereError>(diono_covariance.inverse());
+        makePooled<RelativeIonosphereError>(object_pool_, diono_covariance.inverse());
       graph_->addResidualBlock(relative_iono_error, nullptr,
         graph_->parameterBlockPtr(last_state.ids[j].asInteger()),
         graph_->parameterBlockPtr(cur_state.ids[i].asInteger()));
@@ -1230,7 +1275,7 @@ void GnssEstimatorBase::addRelativeAmbiguityResidualBlock(
       }
 
       std::shared_ptr<RelativeAmbiguityError> relative_amb_error = 
-        std::make_shared<RelativeAmbiguityError>(damb_covariance.inverse());
+        makePooled<RelativeAmbiguityError>(object_pool_, damb_covariance.inverse());
       graph_->addResidualBlock(relative_amb_error, nullptr,
         graph_->parameterBlockPtr(last_state.ids[j].asInteger()),
         graph_->parameterBlockPtr(cur_state.ids[i].asInteger()));
@@ -1250,17 +1295,19 @@ size_t GnssEstimatorBase::numPseudorangeError(const State& state)
 {
   size_t num = 0;
   const BackendId& parameter_id = state.id_in_graph;
-  Graph::ResidualBlockCollection residual_blocks = 
-    graph_->residuals(parameter_id.asInteger());
-  for (size_t i = 0; i < residual_blocks.size(); i++) {
-    auto& residual_block = residual_blocks[i];
-    std::shared_ptr<ErrorInterface> interface = residual_block.error_interface_ptr;
-    ErrorType type = interface->typeInfo();
+  graph_->forEachResidual(parameter_id.asInteger(), 
+    [&num](const Graph::ResidualBlockSpec& residual_block) {
+    ErrorType type = residual_block.error_interface_ptr->typeInfo();
+    if (type == ErrorType::kPseudorangeErrorBatch) {
+      num += std::static_pointer_cast<PseudorangeErrorBatch>(
+        residual_block.error_interface_ptr)->numActiveRows();
+      return;
+    }
     if (!(type == ErrorType::kPseudorangeError || 
-          type == ErrorType::kPseudorangeErrorSD || 
-          type == ErrorType::kPseudorangeErrorDD)) continue;
+        type == ErrorType::kPseudorangeErrorSD || 
+        type == ErrorType::kPseudorangeErrorDD)) return;
     num++;
-  }
+  });
   return num;
 }
 
@@ -1269,17 +1316,14 @@ size_t GnssEstimatorBase::numPhaserangeError(const State& state)
 {
   size_t num = 0;
   const BackendId& parameter_id = state.id_in_graph;
-  Graph::ResidualBlockCollection residual_blocks = 
-    graph_->residuals(parameter_id.asInteger());
-  for (size_t i = 0; i < residual_blocks.size(); i++) {
-    auto& residual_block = residual_blocks[i];
-    std::shared_ptr<ErrorInterface> interface = residual_block.error_interface_ptr;
-    ErrorType type = interface->typeInfo();
+  graph_->forEachResidual(parameter_id.asInteger(), 
+    [&num](const Graph::ResidualBlockSpec& residual_block) {
+    ErrorType type = residual_block.error_interface_ptr->typeInfo();
     if (!(type == ErrorType::kPhaserangeError || 
-          type == ErrorType::kPhaserangeErrorSD || 
-          type == ErrorType::kPhaserangeErrorDD)) continue;
+        type == ErrorType::kPhaserangeErrorSD || 
+        type == ErrorType::kPhaserangeErrorDD)) return;
     num++;
-  }
+  });
   return num;
 }
 
@@ -1288,15 +1332,12 @@ size_t GnssEstimatorBase::numDopplerError(const State& state)
 {
   size_t num = 0;
   const BackendId& parameter_id = state.id_in_graph;
-  Graph::ResidualBlockCollection residual_blocks = 
-    graph_->residuals(parameter_id.asInteger());
-  for (size_t i = 0; i < residual_blocks.size(); i++) {
-    auto& residual_block = residual_blocks[i];
-    std::shared_ptr<ErrorInterface> interface = residual_block.error_interface_ptr;
-    ErrorType type = interface->typeInfo();
-    if (!(type == ErrorType::kDopplerError)) continue;
+  graph_->forEachResidual(parameter_id.asInteger(), 
+    [&num](const Graph::ResidualBlockSpec& residual_block) {
+    ErrorType type = residual_block.error_interface_ptr->typeInfo();
+    if (!(type == ErrorType::kDopplerError)) return;
     num++;
-  }
+  });
   return num;
 }
 
@@ -1311,10 +1352,28 @@ size_t GnssEstimatorBase::rejectPseudorangeOutlier(const State& state, bool reje
   std::vector<double> residuals;
   std::unordered_map<size_t, ceres::ResidualBlockId> residual_index_to_id;
   std::unordered_map<size_t, std::shared_ptr<ErrorInterface>> residual_index_to_interface;
+  std::unordered_map<size_t, size_t> residual_index_to_row;
   for (size_t i = 0; i < residual_blocks.size(); i++) {
     auto& residual_block = residual_blocks[i];
     std::shared_ptr<ErrorInterface> interface = residual_block.error_interface_ptr;
     ErrorType type = interface->typeInfo();
+    // batched rows are checked one by one
+    if (type == ErrorType::kPseudorangeErrorBatch) {
+      std::shared_ptr<PseudorangeErrorBatch> batch = 
+        std::static_pointer_cast<PseudorangeErrorBatch>(interface);
+      Eigen::VectorXd errors;
+      computePseudorangeBatchErrors(residual_block, errors);
+      for (size_t row = 0; row < batch->numRows(); row++) {
+        if (batch->rowWeight(row) == 0.0) continue;
+        residuals.push_back(errors(row));
+        residual_index_to_id.insert(std::make_pair(
+          residuals.size() - 1, residual_block.residual_block_id)); 
+        residual_index_to_interface.insert(std::make_pair(
+          residuals.size() - 1, interface));
+        residual_index_to_row.insert(std::make_pair(residuals.size() - 1, row));
+      }
+      continue;
+    }
     if (!(type == ErrorType::kPseudorangeError || 
           type == ErrorType::kPseudorangeErrorSD || 
           type == ErrorType::kPseudorangeErrorDD)) continue;
@@ -1365,8 +1424,17 @@ size_t GnssEstimatorBase::rejectPseudorangeOutlier(const State& state, bool reje
     }
     // apply rejection
     for (auto index : indexes_to_remove) {
-      graph_->removeResidualBlock(
-        residual_index_to_id.at(static_cast<size_t>(index)));
+      // disable the row of batched residual block
+      auto it_row = residual_index_to_row.find(static_cast<size_t>(index));
+      if (it_row != residual_index_to_row.end()) {
+        std::static_pointer_cast<PseudorangeErrorBatch>(
+          residual_index_to_interface.at(static_cast<size_t>(index)))->
+          setRowWeight(it_row->second, 0.0);
+      }
+      else {
+        graph_->removeResidualBlock(
+          residual_index_to_id.at(static_cast<size_t>(index)));
+      }
       if (base_options_.verbose_output) 
       {
         std::string info_message;
@@ -1378,8 +1446,12 @@ size_t GnssEstimatorBase::rejectPseudorangeOutlier(const State& state, bool reje
         std::string code_str;
 #define MAP(S, R, C) \
   if (system == S && code_type == C) { code_str = R; }
-        if (type == ErrorType::kPseudorangeError) {
+        if (type == ErrorType::kPseudorangeError || 
+            type == ErrorType::kPseudorangeErrorBatch) {
           GnssMeasurementIndex index = 
+            (type == ErrorType::kPseudorangeErrorBatch) ? 
+            std::static_pointer_cast<PseudorangeErrorBatch>(
+              error_interface)->rowIndex(it_row->second) : 
             getGnssMeasurementIndexFromErrorInterface(error_interface);
           system = index.prn[0];
           code_type = index.code_type;
@@ -1426,23 +1498,7 @@ size_t GnssEstimatorBase::rejectPseudorangeOutlier(const State& state, bool reje
     }
 
     // Check if any clock parameter block do not have residuals
-    for (auto system : getGnssSystemList())
-    {
-      BackendId clock_id = createGnssClockId(system, state.id.bundleId());
-      if (!graph_->parameterBlockExists(clock_id.asInteger())) continue;
-      if (graph_->residuals(clock_id.asInteger()).size() != 0) continue;
-      std::shared_ptr<ClockParameterBlock> block_ptr =
-          std::static_pointer_cast<ClockParameterBlock>(
-            graph_->parameterBlockPtr(clock_id.asInteger()));
-      CHECK(block_ptr != nullptr);
-      Eigen::VectorXd measurement = block_ptr->estimate();
-      Eigen::MatrixXd information = Eigen::MatrixXd::Identity(1, 1) * 
-          square(1.0 / gnss_base_options_.error_parameter.initial_clock);
-      std::shared_ptr<ClockError> clock_error = 
-        std::make_shared<ClockError>(measurement, information);
-      graph_->addResidualBlock(clock_error, nullptr, 
-        graph_->parameterBlockPtr(clock_id.asInteger()));
-    }
+    constrainIsolatedClockBlocks(state);
 
     return indexes_to_remove.size();
   }
@@ -1624,23 +1680,7 @@ size_t GnssEstimatorBase::rejectPseudorangeOutlier(
     }
 
     // Check if any clock parameter block do not have residuals
-    for (auto system : getGnssSystemList())
-    {
-      BackendId clock_id = createGnssClockId(system, state.id.bundleId());
-      if (!graph_->parameterBlockExists(clock_id.asInteger())) continue;
-      if (graph_->residuals(clock_id.asInteger()).size() != 0) continue;
-      std::shared_ptr<ClockParameterBlock> block_ptr =
-          std::static_pointer_cast<ClockParameterBlock>(
-            graph_->parameterBlockPtr(clock_id.asInteger()));
-      CHECK(block_ptr != nullptr);
-      Eigen::VectorXd measurement = block_ptr->estimate();
-      Eigen::MatrixXd information = Eigen::MatrixXd::Identity(1, 1) * 
-          square(1.0 / gnss_base_options_.error_parameter.initial_clock);
-      std::shared_ptr<ClockError> clock_error = 
-        std::make_shared<ClockError>(measurement, information);
-      graph_->addResidualBlock(clock_error, nullptr, 
-        graph_->parameterBlockPtr(clock_id.asInteger()));
-    }
+    constrainIsolatedClockBlocks(state);
 
     return indexes_to_remove.size();
   }
@@ -1925,22 +1965,7 @@ size_t GnssEstimatorBase::rejectDopplerOutlier(const State& state, bool reject_o
     }
 
     // Check if any frequency parameter block do not have residuals
-    for (auto system : getGnssSystemList())
-    {
-      BackendId freq_id = createGnssFrequencyId(system, state.id.bundleId());
-      if (!graph_->parameterBlockExists(freq_id.asInteger())) continue;
-      if (graph_->residuals(freq_id.asInteger()).size() != 0) continue;
-      std::shared_ptr<FrequencyParameterBlock> block_ptr =
-          std::static_pointer_cast<FrequencyParameterBlock>(
-            graph_->parameterBlockPtr(freq_id.asInteger()));
-      CHECK(block_ptr != nullptr);
-      Eigen::VectorXd measurement = block_ptr->estimate();
-      Eigen::MatrixXd information = Eigen::MatrixXd::Identity(1, 1) * 1e-6;
-      std::shared_ptr<FrequencyError> freq_error = 
-        std::make_shared<FrequencyError>(measurement, information);
-      graph_->addResidualBlock(freq_error, nullptr, 
-        graph_->parameterBlockPtr(freq_id.asInteger()));
-    }
+    constrainIsolatedFrequencyBlocks(state);
 
     return indexes_to_remove.size();
   }
@@ -1949,6 +1974,343 @@ size_t GnssEstimatorBase::rejectDopplerOutlier(const State& state, bool reject_o
   return 0;
 }
 
+// Solve with single-pass robust FDE
+size_t GnssEstimatorBase::optimizeWithRobustFde(
+  const State& state, AmbiguityState* ambiguity_state)
+{
+  CHECK_NOTNULL(igg_loss_function_.get());
+
+  // IGG-III reweighting of the GNSS residuals inside the solve
+  gnss_loss_function_->Reset(igg_loss_function_.get(), ceres::DO_NOT_TAKE_OWNERSHIP);
+  optimize();
+  size_t num_rejected = rejectGnssOutlierByNormalizedResidual(state, ambiguity_state);
+  gnss_loss_function_->Reset(huber_loss_function_.get(), ceres::DO_NOT_TAKE_OWNERSHIP);
+
+  // warm-started from the robust solution
+  if (num_rejected > 0) optimize();
+  return num_rejected;
+}
+
+// Leverages w * j^T N^-1 j of given rows, N = J^T W J
+bool GnssEstimatorBase::computeRowLeverages(
+  const ceres::CRSMatrix& jacobian, const std::vector<double>& weights, 
+  const std::vector<int>& rows, std::vector<double>& leverages) const
+{
+  const int num_cols = jacobian.num_cols;
+
+  // Normal matrix of the weighted problem
+  std::vector<Eigen::Triplet<double>> triplets;
+  Eigen::VectorXd diagonal = Eigen::VectorXd::Zero(num_cols);
+  for (int r = 0; r < jacobian.num_rows; r++) {
+    const double weight = weights[r];
+    if (weight == 0.0) continue;
+    for (int a = jacobian.rows[r]; a < jacobian.rows[r + 1]; a++) {
+      diagonal(jacobian.cols[a]) += weight * square(jacobian.values[a]);
+      for (int b = jacobian.rows[r]; b < jacobian.rows[r + 1]; b++) {
+        triplets.push_back(Eigen::Triplet<double>(jacobian.cols[a], jacobian.cols[b],
+          weight * jacobian.values[a] * jacobian.values[b]));
+      }
+    }
+  }
+  // constant or unobserved parameters
+  for (int c = 0; c < num_cols; c++) {
+    if (diagonal(c) == 0.0) triplets.push_back(Eigen::Triplet<double>(c, c, 1.0));
+  }
+  Eigen::SparseMatrix<double> normal(num_cols, num_cols);
+  normal.setFromTriplets(triplets.begin(), triplets.end());
+  Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> ldlt(normal);
+  if (ldlt.info() != Eigen::Success) return false;
+
+  // N^-1 on the columns touched by the rows, with one blocked solve
+  std::vector<int> local_cols(num_cols, -1);
+  int num_local_cols = 0;
+  for (const int r : rows) {
+    for (int a = jacobian.rows[r]; a < jacobian.rows[r + 1]; a++) {
+      if (local_cols[jacobian.cols[a]] < 0) {
+        local_cols[jacobian.cols[a]] = num_local_cols++;
+      }
+    }
+  }
+  Eigen::MatrixXd selection = Eigen::MatrixXd::Zero(num_cols, num_local_cols);
+  for (int c = 0; c < num_cols; c++) {
+    if (local_cols[c] >= 0) selection(c, local_cols[c]) = 1.0;
+  }
+  const Eigen::MatrixXd inverse = ldlt.solve(selection);
+  if (ldlt.info() != Eigen::Success) return false;
+
+  leverages.resize(rows.size());
+  for (size_t n = 0; n < rows.size(); n++) {
+    const int r = rows[n];
+    double leverage = 0.0;
+    for (int a = jacobian.rows[r]; a < jacobian.rows[r + 1]; a++) {
+      for (int b = jacobian.rows[r]; b < jacobian.rows[r + 1]; b++) {
+        leverage += jacobian.values[a] * jacobian.values[b] * 
+          inverse(jacobian.cols[a], local_cols[jacobian.cols[b]]);
+      }
+    }
+    leverages[n] = weights[r] * leverage;
+  }
+  return true;
+}
+
+// Reject all GNSS outliers by the normalized residuals of one solution
+size_t GnssEstimatorBase::rejectGnssOutlierByNormalizedResidual(
+  const State& state, AmbiguityState* ambiguity_state)
+{
+  const std::unordered_set<int> gnss_error_types = {
+    static_cast<int>(ErrorType::kPseudorangeError),
+    static_cast<int>(ErrorType::kPseudorangeErrorSD),
+    static_cast<int>(ErrorType::kPseudorangeErrorDD),
+    static_cast<int>(ErrorType::kPseudorangeErrorBatch),
+    static_cast<int>(ErrorType::kPhaserangeError),
+    static_cast<int>(ErrorType::kPhaserangeErrorSD),
+    static_cast<int>(ErrorType::kPhaserangeErrorDD),
+    static_cast<int>(ErrorType::kDopplerError)};
+  const BackendId& parameter_id = state.id_in_graph;
+  if (!graph_->parameterBlockExists(parameter_id.asInteger())) return 0;
+
+  // Residual blocks to evaluate and rows to test
+  std::vector<ceres::ResidualBlockId> residual_block_ids;
+  std::vector<Graph::ResidualBlockSpec> residual_blocks;
+  std::vector<int> row_offsets;
+  std::unordered_set<ceres::ResidualBlockId> test_block_ids;
+  int num_rows = 0;
+  for (const auto& it : graph_->residualBlockIdToResidualBlockSpecMap()) {
+    residual_block_ids.push_back(it.first);
+    residual_blocks.push_back(it.second);
+    row_offsets.push_back(num_rows);
+    num_rows += static_cast<int>(it.second.error_interface_ptr->residualDim());
+  }
+  graph_->forEachResidual(parameter_id.asInteger(), 
+    [&](const Graph::ResidualBlockSpec& residual_block) {
+    int type = static_cast<int>(residual_block.error_interface_ptr->typeInfo());
+    if (gnss_error_types.find(type) == gnss_error_types.end()) return;
+    test_block_ids.insert(residual_block.residual_block_id);
+  });
+  if (test_block_ids.size() == 0) return 0;
+
+  // Evaluate the residuals and Jacobians at the robust solution. Ceres does not
+  // apply the losses here, the batched blocks apply theirs internally.
+  ceres::Problem::EvaluateOptions evaluate_options;
+  evaluate_options.residual_blocks = residual_block_ids;
+  evaluate_options.apply_loss_function = false;
+  std::vector<double> residuals;
+  ceres::CRSMatrix jacobian;
+  graph_->problem()->Evaluate(evaluate_options, nullptr, &residuals, nullptr, &jacobian);
+
+  // Row weights of the normal matrix of the solve. The losses used here have 
+  // rho'' <= 0, so the solver scales the rows of a block by sqrt(rho'(|r|^2)), 
+  // i.e. the IGG-III weights for the GNSS rows. The rows of batched blocks are 
+  // already scaled, and their normalized residuals are recomputed without loss.
+  std::vector<double> weights(num_rows, 1.0);
+  std::vector<int> test_rows;
+  std::vector<int> row_blocks(num_rows, -1);
+  for (size_t i = 0; i < residual_blocks.size(); i++) {
+    const Graph::ResidualBlockSpec& residual_block = residual_blocks[i];
+    const int dim = static_cast<int>(residual_block.error_interface_ptr->residualDim());
+    const bool is_test = test_block_ids.count(residual_block_ids[i]) > 0;
+    std::shared_ptr<PseudorangeErrorBatch> batch;
+    if (residual_block.error_interface_ptr->typeInfo() == 
+        ErrorType::kPseudorangeErrorBatch) {
+      batch = std::static_pointer_cast<PseudorangeErrorBatch>(
+        residual_block.error_interface_ptr);
+      std::vector<const double*> parameters;
+      for (const auto& parameter : graph_->parameters(residual_block_ids[i])) {
+        parameters.push_back(parameter.second->parameters());
+      }
+      Eigen::VectorXd errors;
+      batch->computeRowErrors(parameters.data(), errors, true);
+      for (int k = 0; k < dim; k++) {
+        residuals[row_offsets[i] + k] = errors(k) * batch->rowWeight(k);
+      }
+    }
+    else if (residual_block.loss_function_ptr != nullptr) {
+      double sq_norm = 0.0;
+      for (int k = 0; k < dim; k++) sq_norm += square(residuals[row_offsets[i] + k]);
+      double rho[3];
+      residual_block.loss_function_ptr->Evaluate(sq_norm, rho);
+      for (int k = 0; k < dim; k++) weights[row_offsets[i] + k] = rho[1];
+    }
+    if (!is_test) continue;
+    for (int k = 0; k < dim; k++) {
+      const int r = row_offsets[i] + k;
+      if (batch && batch->rowWeight(k) == 0.0) continue;
+      test_rows.push_back(r);
+      row_blocks[r] = static_cast<int>(i);
+    }
+  }
+  if (test_rows.size() == 0) return 0;
+
+  // Test the standardized residuals v / sqrt(1 - w j^T N^-1 j), with the normal
+  // matrix N = J^T W J of the solve
+  std::vector<double> leverages;
+  if (!computeRowLeverages(jacobian, weights, test_rows, leverages)) {
+    LOG(WARNING) << "Failed to factorize the normal matrix for robust FDE!";
+    return 0;
+  }
+  std::vector<std::pair<size_t, int>> outliers;  // (block index, row or -1)
+  std::vector<double> outlier_values;
+  const double threshold = gnss_base_options_.robust_fde_k1;
+  std::vector<double> max_values(residual_blocks.size(), 0.0);
+  for (size_t n = 0; n < test_rows.size(); n++) {
+    const int r = test_rows[n];
+    const size_t i = static_cast<size_t>(row_blocks[r]);
+    const double redundancy = 1.0 - leverages[n];
+    if (redundancy <= 1.0e-6) continue;
+    const double value = fabs(residuals[r]) / sqrt(redundancy);
+    if (value <= threshold) continue;
+    if (residual_blocks[i].error_interface_ptr->typeInfo() == 
+        ErrorType::kPseudorangeErrorBatch) {
+      outliers.push_back(std::make_pair(i, r - row_offsets[i]));
+      outlier_values.push_back(value);
+    }
+    else max_values[i] = std::max(max_values[i], value);
+  }
+  for (size_t i = 0; i < residual_blocks.size(); i++) {
+    if (max_values[i] == 0.0) continue;
+    outliers.push_back(std::make_pair(i, -1));
+    outlier_values.push_back(max_values[i]);
+  }
+  if (outliers.size() == 0) return 0;
+
+  // Remove all the outliers at once
+  const auto& residual_map = graph_->residualBlockIdToResidualBlockSpecMap();
+  for (size_t n = 0; n < outliers.size(); n++) {
+    const Graph::ResidualBlockSpec& residual_block = residual_blocks[outliers[n].first];
+    std::shared_ptr<ErrorInterface> error_interface = residual_block.error_interface_ptr;
+    ErrorType type = error_interface->typeInfo();
+    if (residual_map.find(residual_block.residual_block_id) == 
+        residual_map.end()) continue;
+
+    // disable the row of batched residual block
+    GnssMeasurementIndex index;
+    if (type == ErrorType::kPseudorangeErrorBatch) {
+      std::shared_ptr<PseudorangeErrorBatch> batch = 
+        std::static_pointer_cast<PseudorangeErrorBatch>(error_interface);
+      batch->setRowWeight(outliers[n].second, 0.0);
+      index = batch->rowIndex(outliers[n].second);
+    }
+    else {
+      if (type == ErrorType::kPseudorangeErrorSD) {
+        index = getGnssMeasurementSDIndexPairFromErrorInterface(error_interface).rov;
+      }
+      else if (type == ErrorType::kPseudorangeErrorDD || 
+               type == ErrorType::kPhaserangeErrorDD) {
+        index = getGnssMeasurementDDIndexPairFromErrorInterface(error_interface).rov;
+      }
+      else if (type != ErrorType::kPhaserangeErrorSD) {
+        index = getGnssMeasurementIndexFromErrorInterface(error_interface);
+      }
+      graph_->removeResidualBlock(residual_block.residual_block_id);
+    }
+
+    // erase the ambiguity of the rejected code
+    if (ambiguity_state != nullptr && 
+        (type == ErrorType::kPseudorangeError || 
+         type == ErrorType::kPseudorangeErrorSD || 
+         type == ErrorType::kPseudorangeErrorDD)) {
+      int phase_id = gnss_common::getPhaseID(index.prn[0], index.code_type);
+      for (auto it = ambiguity_state->ids.begin(); it != ambiguity_state->ids.end(); ) {
+        if (!sameAmbiguity(*it, createGnssAmbiguityId(index.prn, phase_id, 0))) {
+          it++; continue;
+        }
+        if (graph_->parameterBlockExists(it->asInteger())) {
+          graph_->removeParameterBlock(it->asInteger());
+        }
+        it = ambiguity_state->ids.erase(it);
+      }
+    }
+
+    if (base_options_.verbose_output) {
+      LOG(INFO) << "Rejected " << kErrorToStr.at(type) << " outlier at " 
+                << index.prn << ": normalized residual = " 
+                << std::fixed << outlier_values[n];
+    }
+  }
+
+  // Check if any ambiguity parameter do not have residual blocks now
+  if (ambiguity_state != nullptr)
+  for (auto it = ambiguity_state->ids.begin(); it != ambiguity_state->ids.end(); ) {
+    int num_phaserange_block = 0;
+    graph_->forEachResidual(it->asInteger(), 
+      [&num_phaserange_block](const Graph::ResidualBlockSpec& residual_block) {
+      ErrorType type = residual_block.error_interface_ptr->typeInfo();
+      if (type == ErrorType::kPhaserangeError ||
+          type == ErrorType::kPhaserangeErrorSD ||
+          type == ErrorType::kPhaserangeErrorDD) {
+        num_phaserange_block++;
+      }
+    });
+    if (num_phaserange_block == 0) {
+      if (graph_->parameterBlockExists(it->asInteger())) {
+        graph_->removeParameterBlock(it->asInteger());
+      }
+      it = ambiguity_state->ids.erase(it);
+    }
+    else it++;
+  }
+
+  // Check if any clock or frequency parameter block do not have residuals
+  constrainIsolatedClockBlocks(state);
+  constrainIsolatedFrequencyBlocks(state);
+
+  return outliers.size();
+}
+
+// Add prior to the clock blocks without residuals
+void GnssEstimatorBase::constrainIsolatedClockBlocks(const State& state)
+{
+  for (auto system : getGnssSystemList())
+  {
+    BackendId clock_id = createGnssClockId(system, state.id.bundleId());
+    if (!graph_->parameterBlockExists(clock_id.asInteger())) continue;
+    // batched residual blocks constrain the clock only with active rows
+    bool has_residual = false;
+    graph_->forEachResidual(clock_id.asInteger(), 
+      [&has_residual, system](const Graph::ResidualBlockSpec& residual_block) {
+      if (residual_block.error_interface_ptr->typeInfo() != 
+          ErrorType::kPseudorangeErrorBatch || 
+          std::static_pointer_cast<PseudorangeErrorBatch>(
+            residual_block.error_interface_ptr)->hasActiveRows(system)) {
+        has_residual = true;
+      }
+    });
+    if (has_residual) continue;
+    std::shared_ptr<ClockParameterBlock> block_ptr =
+        std::static_pointer_cast<ClockParameterBlock>(
+          graph_->parameterBlockPtr(clock_id.asInteger()));
+    CHECK(block_ptr != nullptr);
+    Eigen::VectorXd measurement = block_ptr->estimate();
+    Eigen::MatrixXd information = Eigen::MatrixXd::Identity(1, 1) * 
+        square(1.0 / gnss_base_options_.error_parameter.initial_clock);
+    std::shared_ptr<ClockError> clock_error = 
+      makePooled<ClockError>(object_pool_, measurement, information);
+    graph_->addResidualBlock(clock_error, nullptr, 
+      graph_->parameterBlockPtr(clock_id.asInteger()));
+  }
+}
+
+// Add prior to the frequency blocks without residuals
+void GnssEstimatorBase::constrainIsolatedFrequencyBlocks(const State& state)
+{
+  for (auto system : getGnssSystemList())
+  {
+    BackendId freq_id = createGnssFrequencyId(system, state.id.bundleId());
+    if (!graph_->parameterBlockExists(freq_id.asInteger())) continue;
+    if (graph_->numResiduals(freq_id.asInteger()) != 0) continue;
+    std::shared_ptr<FrequencyParameterBlock> block_ptr =
+        std::static_pointer_cast<FrequencyParameterBlock>(
+          graph_->parameterBlockPtr(freq_id.asInteger()));
+    CHECK(block_ptr != nullptr);
+    Eigen::VectorXd measurement = block_ptr->estimate();
+    Eigen::MatrixXd information = Eigen::MatrixXd::Identity(1, 1) * 1e-6;
+    std::shared_ptr<FrequencyError> freq_error = 
+      makePooled<FrequencyError>(object_pool_, measurement, information);
+    graph_->addResidualBlock(freq_error, nullptr, 
+      graph_->parameterBlockPtr(freq_id.asInteger()));
+  }
+}
+
 // Add position block to marginalizer
 void GnssEstimatorBase::addGnssPositionMarginBlockWithResiduals(const State& state, bool keep)
 {
@@ -2082,6 +2444,7 @@ void GnssEstimatorBase::addGnssMeasurementResidualMarginBlocks(const State& stat
     static_cast<int>(ErrorType::kPseudorangeError),
     static_cast<int>(ErrorType::kPseudorangeErrorSD),
     static_cast<int>(ErrorType::kPseudorangeErrorDD),
+    static_cast<int>(ErrorType::kPseudorangeErrorBatch),
     static_cast<int>(ErrorType::kPhaserangeError),
     static_cast<int>(ErrorType::kPhaserangeErrorSD),
     static_cast<int>(ErrorType::kPhaserangeErrorDD),
@@ -2107,6 +2470,7 @@ void GnssEstimatorBase::addGnssResidualMarginBlocks(const State& state)
     static_cast<int>(ErrorType::kPseudorangeError),
     static_cast<int>(ErrorType::kPseudorangeErrorSD),
     static_cast<int>(ErrorType::kPseudorangeErrorDD),
+    static_cast<int>(ErrorType::kPseudorangeErrorBatch),
     static_cast<int>(ErrorType::kPhaserangeError),
     static_cast<int>(ErrorType::kPhaserangeErrorSD),
     static_cast<int>(ErrorType::kPhaserangeErrorDD),
@@ -2350,7 +2714,7 @@ void GnssEstimatorBase::eraseAmbiguityParameterBlocks(
         }
 
         std::shared_ptr<RelativeAmbiguityError> relative_amb_error = 
-          std::make_shared<RelativeAmbiguityError>(damb_covariance.inverse());
+          makePooled<RelativeAmbiguityError>(object_pool_, damb_covariance.inverse());
         graph_->addResidualBlock(relative_amb_error, nullptr,
           graph_->parameterBlockPtr(last_id),
           graph_->parameterBlockPtr(cur_id));
@@ -2385,7 +2749,9 @@ void GnssEstimatorBase::erasePseudorangeResidualBlocks(const State& state)
         residual_block.error_interface_ptr->typeInfo() == 
         ErrorType::kPseudorangeErrorSD || 
         residual_block.error_interface_ptr->typeInfo() == 
-        ErrorType::kPseudorangeErrorDD) {
+        ErrorType::kPseudorangeErrorDD || 
+        residual_block.error_interface_ptr->typeInfo() == 
+        ErrorType::kPseudorangeErrorBatch) {
       graph_->removeResidualBlock(residual_block.residual_block_id);
     }
   }
@@ -2398,6 +2764,7 @@ void GnssEstimatorBase::eraseGnssMeasurementResidualBlocks(const State& state)
     static_cast<int>(ErrorType::kPseudorangeError),
     static_cast<int>(ErrorType::kPseudorangeErrorSD),
     static_cast<int>(ErrorType::kPseudorangeErrorDD),
+    static_cast<int>(ErrorType::kPseudorangeErrorBatch),
     static_cast<int>(ErrorType::kPhaserangeError),
     static_cast<int>(ErrorType::kPhaserangeErrorSD),
     static_cast<int>(ErrorType::kPhaserangeErrorDD),
@@ -2599,6 +2966,101 @@ void GnssEstimatorBase::convertStateAndCovarianceToBody(
   }
 }
 
+// Get the correction cache of an epoch
+GnssCorrectionCachePtr GnssEstimatorBase::getCorrectionCache(
+  const GnssMeasurement& measurement, const State& state, const bool apply_tide)
+{
+  if (!gnss_base_options_.use_correction_cache) return nullptr;
+
+  // Release the caches whose residuals have all been removed
+  for (auto it = correction_caches_.begin(); it != correction_caches_.end();) {
+    if (it->second.corrections.use_count() == 1) it = correction_caches_.erase(it);
+    else ++it;
+  }
+
+  const std::pair<int32_t, bool> key(measurement.id, apply_tide);
+  auto it = correction_caches_.find(key);
+  if (it == correction_caches_.end()) {
+    CorrectionCacheItem item;
+    item.corrections = std::make_shared<GnssCorrectionCache>(
+      measurement.timestamp, measurement.ionosphere_parameters,
+      gnss_base_options_.correction_cache_tolerance, apply_tide);
+    if (state.id.type() == IdType::gPosition) {
+      item.position_block = graph_->parameterBlockPtr(state.id.asInteger());
+    }
+    else {
+      item.position_block = graph_->parameterBlockPtr(state.id_in_graph.asInteger());
+      item.extrinsics_block = graph_->parameterBlockPtr(gnss_extrinsics_id_.asInteger());
+    }
+    CHECK(item.position_block != nullptr);
+    it = correction_caches_.insert(std::make_pair(key, item)).first;
+  }
+  return it->second.corrections;
+}
+
+// Refresh the model corrections at the receiver position estimates
+void GnssEstimatorBase::updateBeforeSolve()
+{
+  // The batched pseudorange residuals keep their own corrections
+  if (gnss_base_options_.use_batched_pseudorange) {
+    for (const auto& it : graph_->residualBlockIdToResidualBlockSpecMap()) {
+      if (it.second.error_interface_ptr->typeInfo() != 
+          ErrorType::kPseudorangeErrorBatch) continue;
+      const Graph::ParameterBlockCollection& parameters = 
+        graph_->parameterCollection(it.first);
+      std::static_pointer_cast<PseudorangeErrorBatch>(
+        it.second.error_interface_ptr)->updateCorrections(
+        Eigen::Map<const Eigen::Vector3d>(parameters[0].second->parameters()));
+    }
+  }
+
+  for (auto it = correction_caches_.begin(); it != correction_caches_.end();) {
+    CorrectionCacheItem& item = it->second;
+    if (item.corrections.use_count() == 1) {
+      it = correction_caches_.erase(it);
+      continue;
+    }
+
+    const double* parameters = item.position_block->parameters();
+    Eigen::Vector3d t_WR_ECEF;
+    if (item.extrinsics_block == nullptr) {
+      t_WR_ECEF = Eigen::Map<const Eigen::Vector3d>(parameters);
+    }
+    else {
+      if (!coordinate_ || !coordinate_->isZeroSetted()) {
+        ++it;
+        continue;
+      }
+      const Eigen::Vector3d t_WS_W = Eigen::Map<const Eigen::Vector3d>(parameters);
+      const Eigen::Quaterniond q_WS = Eigen::Map<const Eigen::Quaterniond>(parameters + 3);
+      const Eigen::Vector3d t_SR_S = 
+        Eigen::Map<const Eigen::Vector3d>(item.extrinsics_block->parameters());
+      t_WR_ECEF = coordinate_->convert(
+        Eigen::Vector3d(t_WS_W + q_WS * t_SR_S), GeoType::ENU, GeoType::ECEF);
+    }
+    item.corrections->update(t_WR_ECEF);
+    ++it;
+  }
+}
+
+// Get the shared context of an epoch
+GnssMeasurementConstPtr GnssEstimatorBase::getEpochContext(
+  const GnssMeasurement& measurement)
+{
+  // Release the contexts whose residuals have all been removed
+  for (auto it = epoch_contexts_.begin(); it != epoch_contexts_.end();) {
+    if (it->second.use_count() == 1) it = epoch_contexts_.erase(it);
+    else ++it;
+  }
+
+  auto it = epoch_contexts_.find(measurement.id);
+  if (it == epoch_contexts_.end()) {
+    it = epoch_contexts_.insert(std::make_pair(measurement.id,
+      std::make_shared<const GnssMeasurement>(measurement))).first;
+  }
+  return it->second;
+}
+
 // Get extrinsics estimate
 Eigen::Vector3d GnssEstimatorBase::getGnssExtrinsicsEstimate()
 {
@@ -2672,4 +3134,22 @@ GnssMeasurementIndex GnssEstimatorBase::getGnssMeasurementIndexFromErrorInterfac
   return index;
 }
 
+// Compute the row errors of a batched pseudorange residual block
+void GnssEstimatorBase::computePseudorangeBatchErrors(
+  const Graph::ResidualBlockSpec& residual_block, 
+  Eigen::VectorXd& errors, bool normalize)
+{
+  CHECK(residual_block.error_interface_ptr->typeInfo() == 
+        ErrorType::kPseudorangeErrorBatch);
+  const Graph::ParameterBlockCollection& parameters = 
+    graph_->parameterCollection(residual_block.residual_block_id);
+  std::vector<const double*> parameter_ptrs;
+  for (const auto& parameter : parameters) {
+    parameter_ptrs.push_back(parameter.second->parameters());
+  }
+  std::static_pointer_cast<PseudorangeErrorBatch>(
+    residual_block.error_interface_ptr)->computeRowErrors(
+      parameter_ptrs.data(), errors, normalize);
+}
+
 }
\ No newline at end of file
@@ -41,7 +41,7 @@ void GnssEstimatorBase::addSdClockParameterBlocks(
       clock_init.setZero();
       if (prior.find(system) != prior.end()) clock_init[0] = prior.at(system);
       std::shared_ptr<ClockParameterBlock> clock_parameter_block = 
-        std::make_shared<ClockParameterBlock>(clock_init, clock_id.asInteger());
+        makePooled<ClockParameterBlock>(object_pool_, clock_init, clock_id.asInteger());
       CHECK(graph_->addParameterBlock(clock_parameter_block));
     }
   }
@@ -77,7 +77,7 @@ void GnssEstimatorBase::addSdClockParameterBlocks(
     if (prior.find(system) != prior.end()) measurement[0] = prior.at(system);
     Eigen::MatrixXd information = Eigen::MatrixXd::Identity(1, 1) * 1e-6;
     std::shared_ptr<ClockError> clock_error = 
-      std::make_shared<ClockError>(measurement, information);
+      makePooled<ClockError>(object_pool_, measurement, information);
     graph_->addResidualBlock(clock_error, nullptr, 
       graph_->parameterBlockPtr(clock_id.asInteger()));
   }
@@ -135,7 +135,7 @@ void GnssEstimatorBase::addSdAmbiguityParameterBlocks(
     Eigen::Matrix<double, 1, 1> init;
     init[0] = ambiguity;
     std::shared_ptr<AmbiguityParameterBlock> ambiguity_parameter_block = 
-      std::make_shared<AmbiguityParameterBlock>(init, ambiguity_id.asInteger());
+      makePooled<AmbiguityParameterBlock>(object_pool_, init, ambiguity_id.asInteger());
     CHECK(graph_->addParameterBlock(ambiguity_parameter_block));
     state.ids.push_back(ambiguity_id);
 
@@ -158,7 +158,7 @@ void GnssEstimatorBase::addSdAmbiguityParameterBlocks(
       Eigen::Matrix<double, 1, 1> init_base;
       init_base[0] = ambiguity;
       std::shared_ptr<AmbiguityParameterBlock> ambiguity_base_parameter_block = 
-        std::make_shared<AmbiguityParameterBlock>(
+        makePooled<AmbiguityParameterBlock>(object_pool_,
           init_base, ambiguity_base_id.asInteger());
       CHECK(graph_->addParameterBlock(ambiguity_base_parameter_block));
       state.ids.push_back(ambiguity_base_id);
@@ -207,6 +207,8 @@ void GnssEstimatorBase::addSdPseudorangeResidualBlocks(
   int& num_valid_satellite,
   bool use_single_frequency)
 {
+  const GnssMeasurementConstPtr context_rov = getEpochContext(measurement_rov);
+  const GnssMeasurementConstPtr context_ref = getEpochContext(measurement_ref);
   CHECK(!(use_single_frequency && is_verbose_model_));
   num_valid_satellite = 0;
   const BackendId parameter_id = state.id;
@@ -236,11 +238,11 @@ void GnssEstimatorBase::addSdPseudorangeResidualBlocks(
       if (parameter_id.type() == IdType::gPosition) {
         is_state_pose_ = false;
         std::shared_ptr<PseudorangeErrorSD<3, 1>> pseudorange_error = 
-          std::make_shared<PseudorangeErrorSD<3, 1>>(
-          measurement_rov, measurement_ref, 
+          makePooled<PseudorangeErrorSD<3, 1>>(object_pool_,
+          context_rov, context_ref, 
           index_pair.rov, index_pair.ref, gnss_base_options_.error_parameter);
         graph_->addResidualBlock(pseudorange_error, 
-          huber_loss_function_ ? huber_loss_function_.get() : nullptr,
+          gnss_loss_function_.get(),
           graph_->parameterBlockPtr(parameter_id.asInteger()),
           graph_->parameterBlockPtr(clock_id.asInteger()));
       }
@@ -249,12 +251,12 @@ void GnssEstimatorBase::addSdPseudorangeResidualBlocks(
         is_state_pose_ = true;
         BackendId pose_id = state.id_in_graph;
         std::shared_ptr<PseudorangeErrorSD<7, 3, 1>> pseudorange_error = 
-          std::make_shared<PseudorangeErrorSD<7, 3, 1>>(
-          measurement_rov, measurement_ref, 
+          makePooled<PseudorangeErrorSD<7, 3, 1>>(object_pool_,
+          context_rov, context_ref, 
           index_pair.rov, index_pair.ref, gnss_base_options_.error_parameter); 
         pseudorange_error->setCoordinate(coordinate_);
         graph_->addResidualBlock(pseudorange_error, 
-          huber_loss_function_ ? huber_loss_function_.get() : nullptr,
+          gnss_loss_function_.get(),
           graph_->parameterBlockPtr(pose_id.asInteger()), 
           graph_->parameterBlockPtr(gnss_extrinsics_id_.asInteger()),
           graph_->parameterBlockPtr(clock_id.asInteger()));
@@ -280,6 +282,9 @@ void GnssEstimatorBase::addDdPseudorangeResidualBlocks(
   int& num_valid_satellite,
   bool use_single_frequency)
 {
+  const GnssMeasurementConstPtr context_rov = getEpochContext(measurement_rov);
+  const GnssMeasurementConstPtr context_ref = getEpochContext(measurement_ref);
+  const GnssCorrectionCachePtr corrections = getCorrectionCache(measurement_rov, state, false);
   CHECK(!(use_single_frequency && is_verbose_model_));
   num_valid_satellite = 0;
   const BackendId parameter_id = state.id;
@@ -310,12 +315,13 @@ void GnssEstimatorBase::addDdPseudorangeResidualBlocks(
       if (parameter_id.type() == IdType::gPosition) {
         is_state_pose_ = false; // ECEF框架下
         std::shared_ptr<PseudorangeErrorDD<3>> pseudorange_error = 
-          std::make_shared<PseudorangeErrorDD<3>>(
-          measurement_rov, measurement_ref, 
+          makePooled<PseudorangeErrorDD<3>>(object_pool_,
+          context_rov, context_ref, 
           index_pair.rov, index_pair.ref, index_pair.rov_base, index_pair.ref_base,
           gnss_base_options_.error_parameter);
+        pseudorange_error->setCorrectionCache(corrections);
         graph_->addResidualBlock(pseudorange_error, 
-          huber_loss_function_ ? huber_loss_function_.get() : nullptr,
+          gnss_loss_function_.get(),
           graph_->parameterBlockPtr(parameter_id.asInteger()));
       }
       // pose in ENU for fusion
@@ -323,13 +329,14 @@ void GnssEstimatorBase::addDdPseudorangeResidualBlocks(
         is_state_pose_ = true;  // ENU框架下
         BackendId pose_id = state.id_in_graph;
         std::shared_ptr<PseudorangeErrorDD<7, 3>> pseudorange_error = 
-          std::make_shared<PseudorangeErrorDD<7, 3>>( // 主要是进行构建这个残差
-          measurement_rov, measurement_ref, 
+          makePooled<PseudorangeErrorDD<7, 3>>(object_pool_,  // 主要是进行构建这个残差
+          context_rov, context_ref, 
           index_pair.rov, index_pair.ref, index_pair.rov_base, index_pair.ref_base,
           gnss_base_options_.error_parameter); 
+        pseudorange_error->setCorrectionCache(corrections);
         pseudorange_error->setCoordinate(coordinate_);
         graph_->addResidualBlock(pseudorange_error, 
-          huber_loss_function_ ? huber_loss_function_.get() : nullptr,
+          gnss_loss_function_.get(),
           graph_->parameterBlockPtr(pose_id.asInteger()), 
           graph_->parameterBlockPtr(gnss_extrinsics_id_.asInteger()));
       }
@@ -353,6 +360,9 @@ void GnssEstimatorBase::addDdPhaserangeResidualBlocks(
   const GnssMeasurementDDIndexPairs& index_pairs,
   const State& state)
 {
+  const GnssMeasurementConstPtr context_rov = getEpochContext(measurement_rov);
+  const GnssMeasurementConstPtr context_ref = getEpochContext(measurement_ref);
+  const GnssCorrectionCachePtr corrections = getCorrectionCache(measurement_rov, state, false);
   const BackendId parameter_id = state.id;
 
   // Normal mode.  
@@ -379,12 +389,13 @@ void GnssEstimatorBase::addDdPhaserangeResidualBlocks(
       if (parameter_id.type() == IdType::gPosition) {
         is_state_pose_ = false;
         std::shared_ptr<PhaserangeErrorDD<3, 1, 1>> phaserange_error = 
-          std::make_shared<PhaserangeErrorDD<3, 1, 1>>(
-          measurement_rov, measurement_ref, 
+          makePooled<PhaserangeErrorDD<3, 1, 1>>(object_pool_,
+          context_rov, context_ref, 
           index_pair.rov, index_pair.ref, index_pair.rov_base, index_pair.ref_base,
           gnss_base_options_.error_parameter);
+        phaserange_error->setCorrectionCache(corrections);
         graph_->addResidualBlock(phaserange_error, 
-          huber_loss_function_ ? huber_loss_function_.get() : nullptr,
+          gnss_loss_function_.get(),
           graph_->parameterBlockPtr(parameter_id.asInteger()), 
           graph_->parameterBlockPtr(ambiguity_id.asInteger()), 
           graph_->parameterBlockPtr(ambiguity_base_id.asInteger()));
@@ -394,13 +405,14 @@ void GnssEstimatorBase::addDdPhaserangeResidualBlocks(
         is_state_pose_ = true;
         BackendId pose_id = state.id_in_graph;
         std::shared_ptr<PhaserangeErrorDD<7, 3, 1, 1>> phaserange_error = 
-          std::make_shared<PhaserangeErrorDD<7, 3, 1, 1>>(
-          measurement_rov, measurement_ref, 
+          makePooled<PhaserangeErrorDD<7, 3, 1, 1>>(object_pool_,
+          context_rov, context_ref, 
           index_pair.rov, index_pair.ref, index_pair.rov_base, index_pair.ref_base,
           gnss_base_options_.error_parameter); 
+        phaserange_error->setCorrectionCache(corrections);
         phaserange_error->setCoordinate(coordinate_);
         graph_->addResidualBlock(phaserange_error, 
-          huber_loss_function_ ? huber_loss_function_.get() : nullptr,
+          gnss_loss_function_.get(),
           graph_->parameterBlockPtr(pose_id.asInteger()), 
           graph_->parameterBlockPtr(gnss_extrinsics_id_.asInteger()), 
           graph_->parameterBlockPtr(ambiguity_id.asInteger()), 
@@ -12,6 +12,7 @@
 #include "gici/gnss/gnss_parameter_blocks.h"
 #include "gici/gnss/code_phase_maps.h"
 #include "gici/gnss/pseudorange_error.h"
+#include "gici/gnss/pseudorange_error_batch.h"
 #include "gici/gnss/phaserange_error.h"
 
 namespace gici {
@@ -183,6 +184,20 @@ void GnssEstimatorBase::logPseudorangeResidual()
   for (const auto& residual : residuals) {
     const ceres::ResidualBlockId id = residual.residual_block_id;
     const std::shared_ptr<ErrorInterface>& interface = residual.error_interface_ptr;
+    if (interface->typeInfo() == ErrorType::kPseudorangeErrorBatch) {
+      std::shared_ptr<PseudorangeErrorBatch> batch = 
+        std::static_pointer_cast<PseudorangeErrorBatch>(interface);
+      Eigen::VectorXd errors;
+      computePseudorangeBatchErrors(residual, errors);
+      for (size_t row = 0; row < batch->numRows(); row++) {
+        if (batch->rowWeight(row) == 0.0) continue;
+        const GnssMeasurementIndex& index = batch->rowIndex(row);
+        std::string code_str = gnss_common::codeTypeToRinexType(
+          index.prn[0], index.code_type);
+        residual_values[index.prn].insert(std::make_pair(code_str, errors(row)));
+      }
+      continue;
+    }
     if (interface->typeInfo() != ErrorType::kPseudorangeError) continue;
 
     GnssMeasurementIndex index = 
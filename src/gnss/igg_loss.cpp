@@ -0,0 +1,53 @@
+/**
+* @Function: IGG-III loss function for ceres backend
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#include "gici/gnss/igg_loss.h"
+
+#include <cmath>
+#include <glog/logging.h>
+
+namespace gici {
+
+IggLoss::IggLoss(const double k0, const double k1) :
+  k0_(k0), k1_(k1)
+{
+  CHECK_GT(k0_, 0.0);
+  CHECK_GT(k1_, k0_);
+}
+
+void IggLoss::Evaluate(double s, double rho[3]) const
+{
+  const double u = sqrt(s);
+  const double d = k1_ - k0_;
+  if (u <= k0_) {
+    rho[0] = s;
+    rho[1] = 1.0;
+    rho[2] = 0.0;
+  }
+  else if (u <= k1_) {
+    // rho is the integral of rho' over s = u^2
+    const double e = k1_ - u;
+    rho[0] = k0_ * k0_ + 2.0 * k0_ * (d * d * d - e * e * e) / (3.0 * d * d);
+    rho[1] = k0_ / u * e * e / (d * d);
+    rho[2] = -k0_ * e * (k1_ + u) / (2.0 * d * d * u * u * u);
+  }
+  else {
+    rho[0] = k0_ * k0_ + 2.0 * k0_ * d / 3.0;
+    rho[1] = 0.0;
+    rho[2] = 0.0;
+  }
+}
+
+double IggLoss::weight(const double normalized_residual) const
+{
+  double rho[3];
+  Evaluate(normalized_residual * normalized_residual, rho);
+  return rho[1];
+}
+
+}
@@ -0,0 +1,202 @@
+/**
+* @Function: LAMBDA on nested ambiguity subsets for partial AR
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#include "gici/gnss/incremental_lambda.h"
+
+#include <cmath>
+#include <utility>
+#include <Eigen/Dense>
+#include <glog/logging.h>
+
+namespace gici {
+
+namespace {
+
+// Maximum number of search loops (the same as RTKLIB)
+constexpr int kMaxSearchLoops = 10000;
+
+inline double roundValue(const double x) { return floor(x + 0.5); }
+inline double signValue(const double x) { return x <= 0.0 ? -1.0 : 1.0; }
+
+}
+
+// Factorize the float ambiguities and their covariance
+IncrementalLambda::IncrementalLambda(const Eigen::VectorXd& float_ambiguities,
+                                     const Eigen::MatrixXd& covariance)
+{
+  CHECK(float_ambiguities.size() == covariance.cols());
+  CHECK(covariance.rows() == covariance.cols());
+
+  // Reverse the ordering, so that leading subsets become trailing blocks
+  const int n = float_ambiguities.size();
+  float_ambiguities_ = float_ambiguities.reverse();
+  Eigen::MatrixXd A = covariance.reverse();
+
+  // LD factorization Q = L^T * D * L, from the last row to the first one.
+  // The trailing m x m block of L and the tail of D only depend on the
+  // trailing m x m block of Q.
+  L_ = Eigen::MatrixXd::Zero(n, n);
+  D_ = Eigen::VectorXd::Zero(n);
+  valid_size_ = n;
+  for (int i = n - 1; i >= 0; i--) {
+    if ((D_(i) = A(i, i)) <= 0.0) {
+      valid_size_ = n - 1 - i; break;
+    }
+    const double a = sqrt(D_(i));
+    A.row(i).head(i + 1) /= a;
+    for (int j = 0; j <= i - 1; j++) {
+      A.row(j).head(j + 1) -= A(i, j) * A.row(i).head(j + 1);
+    }
+    L_.row(i).head(i + 1) = A.row(i).head(i + 1) / A(i, i);
+  }
+}
+
+// Solve the leading num_active ambiguities
+bool IncrementalLambda::solve(const int num_active,
+                              const double ratio_threshold,
+                              Eigen::VectorXd& fixed_ambiguities,
+                              double& ratio) const
+{
+  CHECK(num_active <= size());
+
+  ratio = 0.0;
+  fixed_ambiguities = Eigen::VectorXd::Zero(num_active);
+  if (num_active <= 0 || num_active > valid_size_) return false;
+
+  // Take the factor of the subset
+  Eigen::MatrixXd L = L_.bottomRightCorner(num_active, num_active);
+  Eigen::VectorXd D = D_.tail(num_active);
+  Eigen::MatrixXd Z = Eigen::MatrixXd::Identity(num_active, num_active);
+
+  // Decorrelation
+  reduction(L, D, Z);
+  Eigen::VectorXd z = Z.transpose() * float_ambiguities_.tail(num_active);
+
+  // Search
+  Eigen::MatrixXd E;
+  Eigen::Vector2d s;
+  if (!search(L, D, z, E, s)) return false;
+  ratio = s(0) > 0.0 ? (s(1) / s(0)) : 0.0;
+  if (!(ratio > ratio_threshold)) return false;
+
+  // Back to the original space and ordering
+  Eigen::VectorXd F = Z.transpose().fullPivLu().solve(E.col(0));
+  fixed_ambiguities = F.reverse();
+  for (int i = 0; i < num_active; i++) {
+    fixed_ambiguities(i) = roundValue(fixed_ambiguities(i));
+  }
+  return true;
+}
+
+// Decorrelation (Z-transformation) of the factor
+void IncrementalLambda::reduction(
+  Eigen::MatrixXd& L, Eigen::VectorXd& D, Eigen::MatrixXd& Z)
+{
+  const int n = D.size();
+
+  // Integer Gauss transformation
+  auto gauss = [&L, &Z, n](const int i, const int j) {
+    const double mu = roundValue(L(i, j));
+    if (mu == 0.0) return;
+    L.col(j).segment(i, n - i) -= mu * L.col(i).segment(i, n - i);
+    Z.col(j) -= mu * Z.col(i);
+  };
+
+  // Permutation
+  auto perm = [&L, &D, &Z, n](const int j, const double del) {
+    const double eta = D(j) / del;
+    const double lam = D(j + 1) * L(j + 1, j) / del;
+    D(j) = eta * D(j + 1); D(j + 1) = del;
+    for (int k = 0; k <= j - 1; k++) {
+      const double a0 = L(j, k), a1 = L(j + 1, k);
+      L(j, k) = -L(j + 1, j) * a0 + a1;
+      L(j + 1, k) = eta * a0 + lam * a1;
+    }
+    L(j + 1, j) = lam;
+    for (int k = j + 2; k < n; k++) std::swap(L(k, j), L(k, j + 1));
+    Z.col(j).swap(Z.col(j + 1));
+  };
+
+  int j = n - 2, k = n - 2;
+  while (j >= 0) {
+    if (j <= k) for (int i = j + 1; i < n; i++) gauss(i, j);
+    const double del = D(j) + L(j + 1, j) * L(j + 1, j) * D(j + 1);
+    if (del + 1.0e-6 < D(j + 1)) {
+      perm(j, del);
+      k = j; j = n - 2;
+    }
+    else j--;
+  }
+}
+
+// Search the best two integer vectors
+bool IncrementalLambda::search(const Eigen::MatrixXd& L, const Eigen::VectorXd& D,
+                               const Eigen::VectorXd& zs, Eigen::MatrixXd& zn,
+                               Eigen::Vector2d& s)
+{
+  const int n = D.size(), m = 2;
+  Eigen::MatrixXd S = Eigen::MatrixXd::Zero(n, n);
+  Eigen::VectorXd dist(n), zb(n), z(n), step(n);
+  zn = Eigen::MatrixXd::Zero(n, m);
+  s.setZero();
+
+  int k = n - 1, nn = 0, imax = 0, c;
+  double maxdist = 1.0e99;
+  dist(k) = 0.0;
+  zb(k) = zs(k);
+  z(k) = roundValue(zb(k));
+  double y = zb(k) - z(k);
+  step(k) = signValue(y);
+  for (c = 0; c < kMaxSearchLoops; c++) {
+    const double newdist = dist(k) + y * y / D(k);
+    if (newdist < maxdist) {
+      // move down
+      if (k != 0) {
+        dist(--k) = newdist;
+        for (int i = 0; i <= k; i++) {
+          S(k, i) = S(k + 1, i) + (z(k + 1) - zb(k + 1)) * L(k + 1, i);
+        }
+        zb(k) = zs(k) + S(k, k);
+        z(k) = roundValue(zb(k)); y = zb(k) - z(k); step(k) = signValue(y);
+      }
+      // store candidate and try next valid integer
+      else {
+        if (nn < m) {
+          if (nn == 0 || newdist > s(imax)) imax = nn;
+          zn.col(nn) = z;
+          s(nn++) = newdist;
+        }
+        else {
+          if (newdist < s(imax)) {
+            zn.col(imax) = z;
+            s(imax) = newdist;
+            imax = s(0) < s(1) ? 1 : 0;
+          }
+          maxdist = s(imax);
+        }
+        z(0) += step(0); y = zb(0) - z(0); step(0) = -step(0) - signValue(step(0));
+      }
+    }
+    // exit or move up
+    else {
+      if (k == n - 1) break;
+      k++;
+      z(k) += step(k); y = zb(k) - z(k); step(k) = -step(k) - signValue(step(k));
+    }
+  }
+
+  // sort by residuals
+  if (s(0) > s(1)) {
+    std::swap(s(0), s(1));
+    zn.col(0).swap(zn.col(1));
+  }
+
+  return c < kMaxSearchLoops && nn == m;
+}
+
+}
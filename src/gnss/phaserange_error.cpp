@@ -19,13 +19,12 @@ namespace gici {
 // Construct with measurement and information matrix
 template<int... Ns>
 PhaserangeError<Ns ...>::PhaserangeError(
-                       const GnssMeasurement& measurement,
+                       const GnssMeasurementConstPtr& measurement,
                        const GnssMeasurementIndex index,
                        const GnssErrorParameter& error_parameter)
 {
+  index_ = index;
   setMeasurement(measurement);
-  satellite_ = measurement_.getSat(index);
-  observation_ = measurement_.getObs(index);
 
   // Check parameter block types
   // Group 1
@@ -60,16 +59,16 @@ void PhaserangeError<Ns ...>::setInformation(const GnssErrorParameter& error_par
   Eigen::Vector3d factor;
   for (size_t i = 0; i < 3; i++) factor(i) = error_parameter_.phase_error_factor[i];
   double elevation = gnss_common::satelliteElevation(
-    satellite_.sat_position, measurement_.position);
+    satellite_->sat_position, measurement_->position);
   double covariance = square(factor(0)) + square(factor(1) / sin(elevation));
-  char system = satellite_.getSystem();
+  char system = satellite_->getSystem();
   covariance *= square(error_parameter_.system_error_ratio.at(system));
   // check precise ephemeris
-  if (satellite_.sat_type != SatEphType::Precise) {
+  if (satellite_->sat_type != SatEphType::Precise) {
     covariance += square(error_parameter_.ephemeris_broadcast);
   }
   // add IFCB residual error for GPS L5
-  if (satellite_.getSystem() == 'G' && checkEqual(observation_.wavelength, 
+  if (satellite_->getSystem() == 'G' && checkEqual(observation_.wavelength, 
       CLIGHT / gnss_common::phaseToFrequency('G', PHASE_L5))) {
     covariance += square(error_parameter_.residual_gps_ifcb);
   }
@@ -140,16 +139,24 @@ bool PhaserangeError<Ns ...>::EvaluateWithMinimalJacobians(
   }
 
   // Earth tide
-  double timestamp = measurement_.timestamp;
-  Eigen::Vector3d tide = gnss_common::solidEarthTide(timestamp, t_WR_ECEF);
-  t_WR_ECEF += tide;
+  double timestamp = measurement_->timestamp;
+  const bool use_cache = corrections_ && corrections_->valid(t_WR_ECEF);
+  GnssStationCorrections station;
+  GnssSatelliteCorrections terms;
+  if (use_cache) {
+    station = corrections_->station();
+    terms = corrections_->satellite(correction_slot_);
+    t_WR_ECEF += station.tide;
+  }
+  else {
+    Eigen::Vector3d tide = gnss_common::solidEarthTide(timestamp, t_WR_ECEF);
+    t_WR_ECEF += tide;
+  }
 
   double rho = gnss_common::satelliteToReceiverDistance(
-    satellite_.sat_position, t_WR_ECEF);
-  double elevation = gnss_common::satelliteElevation(
-    satellite_.sat_position, t_WR_ECEF);
-  double azimuth = gnss_common::satelliteAzimuth(
-    satellite_.sat_position, t_WR_ECEF);
+    satellite_->sat_position, t_WR_ECEF);
+  double elevation = use_cache ? terms.elevation : 
+    gnss_common::satelliteElevation(satellite_->sat_position, t_WR_ECEF);
 
   // Atmosphere
   double zwd = 0.0;
@@ -163,9 +170,17 @@ bool PhaserangeError<Ns ...>::EvaluateWithMinimalJacobians(
   }
 
   // troposphere hydro-static delay
-  double zhd = gnss_common::troposphereSaastamoinen(timestamp, t_WR_ECEF, PI / 2.0);
-  // mapping
-  gnss_common::troposphereGMF(timestamp, t_WR_ECEF, elevation, &gmf_hydro, &gmf_wet);
+  double zhd;
+  if (use_cache) {
+    zhd = station.zenith_hydro;
+    gmf_hydro = terms.gmf_hydro;
+    gmf_wet = terms.gmf_wet;
+  }
+  else {
+    zhd = gnss_common::troposphereSaastamoinen(timestamp, t_WR_ECEF, PI / 2.0);
+    // mapping
+    gnss_common::troposphereGMF(timestamp, t_WR_ECEF, elevation, &gmf_hydro, &gmf_wet);
+  }
   troposphere_delay = zhd * gmf_hydro + zwd * gmf_wet;
 
   // ionosphere delay to current frequency
@@ -173,12 +188,12 @@ bool PhaserangeError<Ns ...>::EvaluateWithMinimalJacobians(
     ionosphere_delay, observation_.wavelength);
 
   // phase wind-up
-  phase_windup = measurement_.phase_windup->get(
-    timestamp, satellite_.prn, satellite_.sat_position, t_WR_ECEF);
+  phase_windup = measurement_->phase_windup->get(
+    timestamp, satellite_->prn, satellite_->sat_position, t_WR_ECEF);
   phase_windup *= observation_.wavelength;
 
   // Get estimate derivated measurement
-  double phaserange_estimate = rho + clock - satellite_.sat_clock
+  double phaserange_estimate = rho + clock - satellite_->sat_clock
    + troposphere_delay - ionosphere_delay + ambiguity + phase_windup;
 
   // Compute error
@@ -195,7 +210,7 @@ bool PhaserangeError<Ns ...>::EvaluateWithMinimalJacobians(
   {
     // Receiver position in ECEF
     Eigen::Matrix<double, 1, 3> J_t_ECEF = 
-      -((t_WR_ECEF - satellite_.sat_position) / rho).transpose();
+      -((t_WR_ECEF - satellite_->sat_position) / rho).transpose();
     
     // Poses
     Eigen::Matrix<double, 1, 6> J_T_WS;
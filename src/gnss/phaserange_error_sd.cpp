@@ -17,23 +17,19 @@ namespace gici {
 // Construct with measurement and information matrix
 template<int... Ns>
 PhaserangeErrorSD<Ns ...>::PhaserangeErrorSD(
-                    const GnssMeasurement& measurement_rov,
-                    const GnssMeasurement& measurement_ref,
+                    const GnssMeasurementConstPtr& measurement_rov,
+                    const GnssMeasurementConstPtr& measurement_ref,
                     const GnssMeasurementIndex index_rov,
                     const GnssMeasurementIndex index_ref,
                     const GnssErrorParameter& error_parameter)
 {
-  CHECK(!checkZero(measurement_ref.position)) << 
+  CHECK(!checkZero(measurement_ref->position)) << 
     "The position of reference station is not setted!";
 
+  index_rov_ = index_rov;
+  index_ref_ = index_ref;
   setMeasurement(measurement_rov, measurement_ref);
 
-  satellite_rov_ = measurement_rov_.getSat(index_rov);
-  satellite_ref_ = measurement_ref_.getSat(index_ref);
-
-  observation_rov_ = measurement_rov_.getObs(index_rov);
-  observation_ref_ = measurement_ref_.getObs(index_ref);
-
   // Check parameter block types
   // Group 1
   if (dims_.kNumParameterBlocks == 3 && 
@@ -86,10 +82,10 @@ void PhaserangeErrorSD<Ns ...>::setInformation(const GnssErrorParameter& error_p
   Eigen::Vector3d factor;
   for (size_t i = 0; i < 3; i++) factor(i) = error_parameter_.phase_error_factor[i];
   double elevation_rov = gnss_common::satelliteElevation(
-    satellite_rov_.sat_position, measurement_rov_.position);
+    satellite_rov_->sat_position, measurement_rov_->position);
   covariance_ = covariance_t(
     (square(factor(0)) + square(factor(1) / sin(elevation_rov))) * 2.0);
-  char system = satellite_rov_.getSystem();
+  char system = satellite_rov_->getSystem();
   covariance_ *= square(error_parameter_.system_error_ratio.at(system));
 
   information_ = covariance_.inverse();
@@ -155,19 +151,19 @@ bool PhaserangeErrorSD<Ns ...>::EvaluateWithMinimalJacobians(
     t_WR_ECEF = coordinate_->convert(t_WR_W, GeoType::ENU, GeoType::ECEF);
   }
 
-  double timestamp = measurement_rov_.timestamp;
+  double timestamp = measurement_rov_->timestamp;
 
   double rho_rov = gnss_common::satelliteToReceiverDistance(
-    satellite_rov_.sat_position, t_WR_ECEF);
+    satellite_rov_->sat_position, t_WR_ECEF);
   double rho_ref = gnss_common::satelliteToReceiverDistance(
-    satellite_ref_.sat_position, measurement_ref_.position);
+    satellite_ref_->sat_position, measurement_ref_->position);
 
   double elevation_rov = gnss_common::satelliteElevation(
-    satellite_rov_.sat_position, t_WR_ECEF);
+    satellite_rov_->sat_position, t_WR_ECEF);
   double elevation_ref = gnss_common::satelliteElevation(
-    satellite_ref_.sat_position, measurement_ref_.position);
+    satellite_ref_->sat_position, measurement_ref_->position);
   double azimuth_rov = gnss_common::satelliteAzimuth(
-    satellite_rov_.sat_position, t_WR_ECEF);
+    satellite_rov_->sat_position, t_WR_ECEF);
 
   // Atmosphere
   if (!is_estimate_atmosphere_) 
@@ -225,7 +221,7 @@ bool PhaserangeErrorSD<Ns ...>::EvaluateWithMinimalJacobians(
   {
     // Receiver position in ECEF
     Eigen::Matrix<double, 1, 3> J_t_ECEF = 
-      -((t_WR_ECEF - satellite_rov_.sat_position) / rho_rov).transpose();
+      -((t_WR_ECEF - satellite_rov_->sat_position) / rho_rov).transpose();
     
     // Poses
     Eigen::Matrix<double, 1, 6> J_T_WS;
@@ -215,7 +215,11 @@ bool PppEstimator::estimate()
   size_t n_pseudorange = numPseudorangeError(curState());
   size_t n_phaserange = numPhaserangeError(curState());
   size_t n_doppler = numDopplerError(curState());
-  if (gnss_base_options_.use_outlier_rejection)
+  if (gnss_base_options_.use_outlier_rejection && 
+      gnss_base_options_.use_robust_fde) {
+    optimizeWithRobustFde(curState(), &curAmbiguityState());
+  }
+  else if (gnss_base_options_.use_outlier_rejection)
   while (1)
   {
     optimize();
@@ -19,13 +19,12 @@ namespace gici {
 // Construct with measurement and information matrix
 template<int... Ns>
 PseudorangeError<Ns ...>::PseudorangeError(
-                       const GnssMeasurement& measurement,
+                       const GnssMeasurementConstPtr& measurement,
                        const GnssMeasurementIndex index,
                        const GnssErrorParameter& error_parameter)
 {
+  index_ = index;
   setMeasurement(measurement);
-  satellite_ = measurement_.getSat(index);
-  observation_ = measurement_.getObs(index);
 
   // Check parameter block types
   // Group 1
@@ -68,64 +67,65 @@ PseudorangeError<Ns ...>::PseudorangeError(
   setInformation(error_parameter);  // 信息矩阵
 }
 
-// Set the information.
-template<int... Ns>
-void PseudorangeError<Ns ...>::setInformation(const GnssErrorParameter& error_parameter)
+// Variance of a pseudorange measurement
+double pseudorangeVariance(const GnssMeasurement& measurement,
+                           const Satellite& satellite,
+                           const Observation& observation,
+                           const GnssErrorParameter& error_parameter,
+                           const bool is_estimate_atmosphere)
 {
-  // compute variance
-  error_parameter_ = error_parameter;
   Eigen::Vector3d factor;
-  for (size_t i = 0; i < 3; i++) factor(i) = error_parameter_.phase_error_factor[i];
-  double ratio = square(error_parameter_.code_to_phase_ratio);
+  for (size_t i = 0; i < 3; i++) factor(i) = error_parameter.phase_error_factor[i];
+  double ratio = square(error_parameter.code_to_phase_ratio);
   double elevation = gnss_common::satelliteElevation( // 高度角
-    satellite_.sat_position, measurement_.position);
+    satellite.sat_position, measurement.position);
   double azimuth = gnss_common::satelliteAzimuth(     // 方位角
-    satellite_.sat_position, measurement_.position);
-  double timestamp = measurement_.timestamp;
+    satellite.sat_position, measurement.position);
+  double timestamp = measurement.timestamp;
 
   double ephemeris_var, ionosphere_var, troposphere_var;
-  if (!is_estimate_atmosphere_) {
+  if (!is_estimate_atmosphere) {
     // ephemeris error
-    if (satellite_.sat_type == SatEphType::Broadcast) {
-      ephemeris_var = square(error_parameter_.ephemeris_broadcast);
+    if (satellite.sat_type == SatEphType::Broadcast) {
+      ephemeris_var = square(error_parameter.ephemeris_broadcast);
     }
-    else if (satellite_.sat_type == SatEphType::Precise) {
-      ephemeris_var = square(error_parameter_.ephemeris_precise);
+    else if (satellite.sat_type == SatEphType::Precise) {
+      ephemeris_var = square(error_parameter.ephemeris_precise);
     }
     // ionosphere error
-    if (satellite_.ionosphere != 0.0 && 
-        satellite_.ionosphere_type == IonoType::Augmentation) {
-      ionosphere_var = square(error_parameter_.ionosphere_augment);
+    if (satellite.ionosphere != 0.0 && 
+        satellite.ionosphere_type == IonoType::Augmentation) {
+      ionosphere_var = square(error_parameter.ionosphere_augment);
     }
-    else if (satellite_.ionosphere != 0.0 && 
-             satellite_.ionosphere_type == IonoType::DualFrequency) {
-      ionosphere_var = square(error_parameter_.ionosphere_dual_frequency);
+    else if (satellite.ionosphere != 0.0 && 
+             satellite.ionosphere_type == IonoType::DualFrequency) {
+      ionosphere_var = square(error_parameter.ionosphere_dual_frequency);
     }
     else {
       double ionosphere_delay = gnss_common::ionosphereBroadcast(
-        timestamp, measurement_.position, azimuth, elevation, 
-        observation_.wavelength, measurement_.ionosphere_parameters);
+        timestamp, measurement.position, azimuth, elevation, 
+        observation.wavelength, measurement.ionosphere_parameters);
       ionosphere_var = square(
-        error_parameter_.ionosphere_broadcast_factor * ionosphere_delay);
+        error_parameter.ionosphere_broadcast_factor * ionosphere_delay);
     }
     // troposphere error
     double troposphere_delay = gnss_common::troposphereSaastamoinen(
-      timestamp, measurement_.position, elevation);
+      timestamp, measurement.position, elevation);
     troposphere_var = square(
-      error_parameter_.troposphere_model_factor * troposphere_delay);
+      error_parameter.troposphere_model_factor * troposphere_delay);
     // troposphere wet delay
-    if (measurement_.troposphere_wet != 0.0) {
-      troposphere_var = square(error_parameter_.troposphere_augment);
+    if (measurement.troposphere_wet != 0.0) {
+      troposphere_var = square(error_parameter.troposphere_augment);
     }
   }
   else {
     // we do not add ephemeris error in precise positioning case
     // because the precise ephemeris is highly time-correlated, which
     // cannot be treated as white noise.
-    if (satellite_.sat_type == SatEphType::Broadcast) {
-      ephemeris_var = square(error_parameter_.ephemeris_broadcast);
+    if (satellite.sat_type == SatEphType::Broadcast) {
+      ephemeris_var = square(error_parameter.ephemeris_broadcast);
     }
-    else if (satellite_.sat_type == SatEphType::Precise) {
+    else if (satellite.sat_type == SatEphType::Precise) {
       ephemeris_var = 0.0;
     }
     // ionosphere error
@@ -136,14 +136,24 @@ void PseudorangeError<Ns ...>::setInformation(const GnssErrorParameter& error_pa
 
   double covariance = (square(factor(0)) + square(factor(1) / sin(elevation))) * ratio + 
     ephemeris_var + ionosphere_var + troposphere_var;
-  char system = satellite_.getSystem();
-  covariance *= square(error_parameter_.system_error_ratio.at(system));
+  char system = satellite.getSystem();
+  covariance *= square(error_parameter.system_error_ratio.at(system));
   // add IFCB residual error for GPS L5
-  if (satellite_.getSystem() == 'G' && checkEqual(observation_.wavelength, 
+  if (satellite.getSystem() == 'G' && checkEqual(observation.wavelength, 
       CLIGHT / gnss_common::phaseToFrequency('G', PHASE_L5))) {
-    covariance += square(error_parameter_.residual_gps_ifcb);
+    covariance += square(error_parameter.residual_gps_ifcb);
   }
-  covariance_ = covariance_t(covariance);
+  return covariance;
+}
+
+// Set the information.
+template<int... Ns>
+void PseudorangeError<Ns ...>::setInformation(const GnssErrorParameter& error_parameter)
+{
+  // compute variance
+  error_parameter_ = error_parameter;
+  covariance_ = covariance_t(pseudorangeVariance(*measurement_, *satellite_,
+    observation_, error_parameter_, is_estimate_atmosphere_));
 
   information_ = covariance_.inverse();
   // perform the Cholesky decomposition on order to obtain the correct error weighting
@@ -204,16 +214,26 @@ bool PseudorangeError<Ns ...>::EvaluateWithMinimalJacobians(
   }
 
   // Earth tide
-  double timestamp = measurement_.timestamp;
-  Eigen::Vector3d tide = gnss_common::solidEarthTide(timestamp, t_WR_ECEF);
-  t_WR_ECEF += tide;  // 固体潮改正
+  double timestamp = measurement_->timestamp;
+  const bool use_cache = corrections_ && corrections_->valid(t_WR_ECEF);
+  GnssStationCorrections station;
+  GnssSatelliteCorrections terms;
+  if (use_cache) {
+    station = corrections_->station();
+    terms = corrections_->satellite(correction_slot_);
+    t_WR_ECEF += station.tide;
+  }
+  else {
+    Eigen::Vector3d tide = gnss_common::solidEarthTide(timestamp, t_WR_ECEF);
+    t_WR_ECEF += tide;  // 固体潮改正
+  }
   
   double rho = gnss_common::satelliteToReceiverDistance(  // 距离
-    satellite_.sat_position, t_WR_ECEF);
-  double elevation = gnss_common::satelliteElevation(
-    satellite_.sat_position, t_WR_ECEF);
-  double azimuth = gnss_common::satelliteAzimuth(
-    satellite_.sat_position, t_WR_ECEF);
+    satellite_->sat_position, t_WR_ECEF);
+  double elevation = use_cache ? terms.elevation : 
+    gnss_common::satelliteElevation(satellite_->sat_position, t_WR_ECEF);
+  double azimuth = use_cache ? terms.azimuth : 
+    gnss_common::satelliteAzimuth(satellite_->sat_position, t_WR_ECEF);
 
   // Atmosphere
   if (!is_estimate_atmosphere_) 
@@ -222,30 +242,35 @@ bool PseudorangeError<Ns ...>::EvaluateWithMinimalJacobians(
     ifb = 0.0;
 
     // troposphere hydro-static delay
-    troposphere_delay = gnss_common::troposphereSaastamoinen( // 计算对流程干延迟
-      timestamp, t_WR_ECEF, elevation);
+    troposphere_delay = use_cache ? terms.troposphere_hydro :
+      gnss_common::troposphereSaastamoinen(timestamp, t_WR_ECEF, elevation); // 计算对流程干延迟
     // troposphere wet delay
-    if (measurement_.troposphere_wet != 0.0) {                // 湿延迟如果有就用GMF进行投影
-      gnss_common::troposphereGMF(timestamp, t_WR_ECEF, elevation, nullptr, &gmf_wet);
-      troposphere_delay += measurement_.troposphere_wet * gmf_wet;
+    if (measurement_->troposphere_wet != 0.0) {                // 湿延迟如果有就用GMF进行投影
+      if (use_cache) gmf_wet = terms.gmf_wet;
+      else gnss_common::troposphereGMF(timestamp, t_WR_ECEF, elevation, nullptr, &gmf_wet);
+      troposphere_delay += measurement_->troposphere_wet * gmf_wet;
     }
 
     // ionosphere
-    if (satellite_.ionosphere != 0.0 && 
-        satellite_.ionosphere_type == IonoType::Augmentation) {
-      ionosphere_delay = satellite_.ionosphere;
+    if (satellite_->ionosphere != 0.0 && 
+        satellite_->ionosphere_type == IonoType::Augmentation) {
+      ionosphere_delay = satellite_->ionosphere;
       ionosphere_delay = gnss_common::ionosphereConvertFromBase(
         ionosphere_delay, observation_.wavelength);
     }
-    else if (satellite_.ionosphere != 0.0 && 
-             satellite_.ionosphere_type == IonoType::DualFrequency) {
-      ionosphere_delay = satellite_.ionosphere;
+    else if (satellite_->ionosphere != 0.0 && 
+             satellite_->ionosphere_type == IonoType::DualFrequency) {
+      ionosphere_delay = satellite_->ionosphere;
       ionosphere_delay = gnss_common::ionosphereConvertFromBase(
         ionosphere_delay, observation_.wavelength);
     }
+    else if (use_cache) {
+      ionosphere_delay = gnss_common::ionosphereConvertFromBase(
+        terms.ionosphere, observation_.wavelength);
+    }
     else {
       ionosphere_delay = gnss_common::ionosphereBroadcast(timestamp, t_WR_ECEF, 
-          azimuth, elevation, observation_.wavelength, measurement_.ionosphere_parameters);
+          azimuth, elevation, observation_.wavelength, measurement_->ionosphere_parameters);
     }
   }
   // use estimated atomspheric delays
@@ -264,9 +289,17 @@ bool PseudorangeError<Ns ...>::EvaluateWithMinimalJacobians(
     }
 
     // troposphere hydro-static delay
-    double zhd = gnss_common::troposphereSaastamoinen(timestamp, t_WR_ECEF, PI / 2.0);
-    // mapping
-    gnss_common::troposphereGMF(timestamp, t_WR_ECEF, elevation, &gmf_hydro, &gmf_wet);
+    double zhd;
+    if (use_cache) {
+      zhd = station.zenith_hydro;
+      gmf_hydro = terms.gmf_hydro;
+      gmf_wet = terms.gmf_wet;
+    }
+    else {
+      zhd = gnss_common::troposphereSaastamoinen(timestamp, t_WR_ECEF, PI / 2.0);
+      // mapping
+      gnss_common::troposphereGMF(timestamp, t_WR_ECEF, elevation, &gmf_hydro, &gmf_wet);
+    }
     troposphere_delay = zhd * gmf_hydro + zwd * gmf_wet;
 
     // ionosphere delay to current frequency
@@ -276,7 +309,7 @@ bool PseudorangeError<Ns ...>::EvaluateWithMinimalJacobians(
 
   // Get estimate derivated measurement
   double pseudorange_estimate = rho + clock -            // 误差改正
-    satellite_.sat_clock + ifb + troposphere_delay + ionosphere_delay;
+    satellite_->sat_clock + ifb + troposphere_delay + ionosphere_delay;
 
   // Compute error
   double pseudorange = observation_.pseudorange;
@@ -292,7 +325,7 @@ bool PseudorangeError<Ns ...>::EvaluateWithMinimalJacobians(
   {
     // Receiver position in ECEF
     Eigen::Matrix<double, 1, 3> J_t_ECEF =      // 单位向量
-      -((t_WR_ECEF - satellite_.sat_position) / rho).transpose();
+      -((t_WR_ECEF - satellite_->sat_position) / rho).transpose();
     
     // Poses
     Eigen::Matrix<double, 1, 6> J_T_WS;
@@ -0,0 +1,298 @@
+/**
+* @Function: Batched pseudorange residual block of one epoch for ceres backend
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#include "gici/gnss/pseudorange_error_batch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glog/logging.h>
+
+#include "gici/gnss/gnss_common.h"
+#include "gici/gnss/pseudorange_error.h"
+
+namespace gici {
+
+// Construct with measurement and error parameter
+PseudorangeErrorBatch::PseudorangeErrorBatch(
+                      const GnssMeasurementConstPtr& measurement,
+                      const GnssErrorParameter& error_parameter,
+                      const double tolerance) :
+  measurement_(measurement), error_parameter_(error_parameter),
+  tolerance_(tolerance)
+{
+  base_t::set_num_residuals(0);
+  base_t::mutable_parameter_block_sizes()->push_back(3);
+}
+
+// Add a row
+void PseudorangeErrorBatch::addRow(const GnssMeasurementIndex& index)
+{
+  CHECK_LT(numRows(), static_cast<size_t>(kMaxRows));
+  const Satellite& satellite = measurement_->getSat(index);
+  const Observation& observation = measurement_->getObs(index);
+
+  // clock parameter of this system
+  const char system = satellite.getSystem();
+  auto it = std::find(systems_.begin(), systems_.end(), system);
+  if (it == systems_.end()) {
+    systems_.push_back(system);
+    base_t::mutable_parameter_block_sizes()->push_back(1);
+    clock_masks_.push_back(std::vector<double>(numRows(), 0.0));
+    it = systems_.end() - 1;
+  }
+  const size_t clock_index = it - systems_.begin();
+  for (size_t k = 0; k < clock_masks_.size(); k++) {
+    clock_masks_[k].push_back(k == clock_index ? 1.0 : 0.0);
+  }
+
+  indexes_.push_back(index);
+  satellites_.push_back(&satellite);
+  clock_indexes_.push_back(static_cast<int>(clock_index));
+  satellite_x_.push_back(satellite.sat_position(0));
+  satellite_y_.push_back(satellite.sat_position(1));
+  satellite_z_.push_back(satellite.sat_position(2));
+  satellite_clocks_.push_back(satellite.sat_clock);
+  pseudoranges_.push_back(observation.pseudorange);
+  wavelengths_.push_back(observation.wavelength);
+  // the weighting is the same as the one of single pseudorange error
+  square_root_information_.push_back(1.0 / sqrt(pseudorangeVariance(
+    *measurement_, satellite, observation, error_parameter_, false)));
+  weights_.push_back(1.0);
+
+  base_t::set_num_residuals(static_cast<int>(indexes_.size()));
+  has_linearization_point_ = false;
+}
+
+// Number of rows with non-zero weights
+size_t PseudorangeErrorBatch::numActiveRows() const
+{
+  size_t num = 0;
+  for (size_t i = 0; i < weights_.size(); i++) {
+    if (weights_[i] > 0.0) num++;
+  }
+  return num;
+}
+
+// Check if any active row is connected to the clock of given system
+bool PseudorangeErrorBatch::hasActiveRows(const char system) const
+{
+  for (size_t i = 0; i < indexes_.size(); i++) {
+    if (weights_[i] > 0.0 && systems_[clock_indexes_[i]] == system) return true;
+  }
+  return false;
+}
+
+// Compute the errors of all rows without weighting and loss
+void PseudorangeErrorBatch::computeRowErrors(
+  double const* const * parameters, Eigen::VectorXd& errors, bool normalize) const
+{
+  Workspace workspace;
+  computeErrors(parameters, workspace);
+  errors = workspace.errors.matrix();
+  if (normalize) {
+    errors.array() *= Eigen::Map<const Eigen::ArrayXd>(
+      square_root_information_.data(), numRows());
+  }
+}
+
+// This evaluates the error term and additionally computes the Jacobians.
+bool PseudorangeErrorBatch::Evaluate(double const* const * parameters,
+                                     double* residuals, double** jacobians) const
+{
+  return EvaluateWithMinimalJacobians(parameters, residuals, jacobians, nullptr);
+}
+
+// This evaluates the error term and additionally computes
+// the Jacobians in the minimal internal representation.
+bool PseudorangeErrorBatch::EvaluateWithMinimalJacobians(
+    double const* const * parameters, double* residuals, double** jacobians,
+    double** jacobians_minimal) const
+{
+  const int n = static_cast<int>(numRows());
+  Workspace workspace;
+  computeErrors(parameters, workspace);
+
+  // weigh it
+  Eigen::Map<const Eigen::ArrayXd> square_root_information(
+    square_root_information_.data(), n);
+  Eigen::Map<const Eigen::ArrayXd> weights(weights_.data(), n);
+  Eigen::Map<Eigen::ArrayXd> weighted_error(residuals, n);
+  weighted_error = workspace.errors * square_root_information * weights;
+
+  // row-wise robustification, the same as the ceres corrector applies to a
+  // one-dimensional residual block, so that the rows are weighted in the same
+  // way as the single pseudorange errors (see ceres/internal/ceres/corrector.cc)
+  RowArray& scale = workspace.scale;
+  scale = square_root_information * weights;
+  if (loss_function_) {
+    double rho[3];
+    for (int i = 0; i < n; i++) {
+      const double sq_norm = square(weighted_error(i));
+      loss_function_->Evaluate(sq_norm, rho);
+      const double sqrt_rho1 = sqrt(rho[1]);
+      if (sq_norm == 0.0 || rho[2] <= 0.0) {
+        scale(i) *= sqrt_rho1;
+        weighted_error(i) *= sqrt_rho1;
+        continue;
+      }
+      const double alpha = 1.0 - sqrt(1.0 + 2.0 * sq_norm * rho[2] / rho[1]);
+      scale(i) *= sqrt_rho1 * (1.0 - alpha);
+      weighted_error(i) *= sqrt_rho1 / (1.0 - alpha);
+    }
+  }
+
+  // compute Jacobian
+  if (jacobians != nullptr)
+  {
+    // Receiver position in ECEF
+    if (jacobians[0] != nullptr) {
+      Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor>>
+        J_t_ECEF(jacobians[0], n, 3);
+      const RowArray scale_rho = scale / workspace.rho;
+      J_t_ECEF.col(0) = (workspace.dx * scale_rho).matrix();
+      J_t_ECEF.col(1) = (workspace.dy * scale_rho).matrix();
+      J_t_ECEF.col(2) = (workspace.dz * scale_rho).matrix();
+      if (jacobians_minimal != nullptr && jacobians_minimal[0] != nullptr) {
+        Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor>>
+          J_t_ECEF_minimal(jacobians_minimal[0], n, 3);
+        J_t_ECEF_minimal = J_t_ECEF;
+      }
+    }
+
+    // Clocks
+    for (size_t k = 0; k < systems_.size(); k++) {
+      if (jacobians[1 + k] == nullptr) continue;
+      Eigen::Map<Eigen::VectorXd> J_clock(jacobians[1 + k], n);
+      J_clock = -(scale * Eigen::Map<const Eigen::ArrayXd>(
+        clock_masks_[k].data(), n)).matrix();
+      if (jacobians_minimal != nullptr && jacobians_minimal[1 + k] != nullptr) {
+        Eigen::Map<Eigen::VectorXd>(jacobians_minimal[1 + k], n) = J_clock;
+      }
+    }
+  }
+
+  return true;
+}
+
+// Convert normalized residual to raw residual
+void PseudorangeErrorBatch::deNormalizeResidual(double *residuals) const
+{
+  for (size_t i = 0; i < numRows(); i++) {
+    const double factor = square_root_information_[i] * weights_[i];
+    residuals[i] = (factor > 0.0) ? residuals[i] / factor : 0.0;
+  }
+}
+
+// Refresh tide and model delays if the receiver moved beyond tolerance
+void PseudorangeErrorBatch::updateCorrections(const Eigen::Vector3d& t_WR_ECEF)
+{
+  if (has_linearization_point_ &&
+      (t_WR_ECEF - linearization_point_).norm() <= tolerance_) return;
+
+  linearization_point_ = t_WR_ECEF;
+  computeCorrections(t_WR_ECEF, tide_, delays_);
+  has_linearization_point_ = true;
+}
+
+// Compute the unweighted errors into workspace
+void PseudorangeErrorBatch::computeErrors(
+  double const* const * parameters, Workspace& workspace) const
+{
+  const int n = static_cast<int>(numRows());
+  Eigen::Vector3d t_WR_ECEF = Eigen::Map<const Eigen::Vector3d>(parameters[0]);
+
+  // Earth tide and model atmosphere delays, prepared before solving, or computed
+  // here if the receiver is beyond tolerance from where they were prepared
+  Eigen::Vector3d tide;
+  RowArray delays_direct;
+  const RowArray* delays = &delays_;
+  if (has_linearization_point_ &&
+      (t_WR_ECEF - linearization_point_).norm() <= tolerance_) {
+    tide = tide_;
+  }
+  else {
+    computeCorrections(t_WR_ECEF, tide, delays_direct);
+    delays = &delays_direct;
+  }
+  t_WR_ECEF += tide;
+
+  // Line-of-sights
+  Eigen::Map<const Eigen::ArrayXd> satellite_x(satellite_x_.data(), n);
+  Eigen::Map<const Eigen::ArrayXd> satellite_y(satellite_y_.data(), n);
+  Eigen::Map<const Eigen::ArrayXd> satellite_z(satellite_z_.data(), n);
+  workspace.dx = satellite_x - t_WR_ECEF(0);
+  workspace.dy = satellite_y - t_WR_ECEF(1);
+  workspace.dz = satellite_z - t_WR_ECEF(2);
+
+  // Distances considering the earth rotation effect
+  // (see gnss_common::satelliteToReceiverDistance)
+  RowArray& rho = workspace.rho;
+  rho = (workspace.dx.square() + workspace.dy.square() +
+         workspace.dz.square()).sqrt() * (OMGE / CLIGHT);
+  const RowArray cos_rho = rho.cos();
+  const RowArray sin_rho = rho.sin();
+  rho = ((satellite_x - (t_WR_ECEF(0) * cos_rho - t_WR_ECEF(1) * sin_rho)).square() +
+         (satellite_y - (t_WR_ECEF(1) * cos_rho + t_WR_ECEF(0) * sin_rho)).square() +
+         workspace.dz.square()).sqrt();
+
+  // Clocks
+  RowArray clocks = RowArray::Zero(n);
+  for (size_t k = 0; k < systems_.size(); k++) {
+    clocks += Eigen::Map<const Eigen::ArrayXd>(clock_masks_[k].data(), n) *
+      parameters[1 + k][0];
+  }
+
+  // Errors
+  workspace.errors = Eigen::Map<const Eigen::ArrayXd>(pseudoranges_.data(), n) -
+    (rho + clocks - Eigen::Map<const Eigen::ArrayXd>(
+    satellite_clocks_.data(), n) + *delays);
+}
+
+// Compute tide and model delays at given receiver position
+void PseudorangeErrorBatch::computeCorrections(const Eigen::Vector3d& t_WR_ECEF,
+  Eigen::Vector3d& tide, RowArray& delays) const
+{
+  const double timestamp = measurement_->timestamp;
+  tide = gnss_common::solidEarthTide(timestamp, t_WR_ECEF);
+  const Eigen::Vector3d position = t_WR_ECEF + tide;
+
+  delays.resize(numRows());
+  for (size_t i = 0; i < numRows(); i++) {
+    const Satellite& satellite = *satellites_[i];
+    double elevation = gnss_common::satelliteElevation(
+      satellite.sat_position, position);
+    double azimuth = gnss_common::satelliteAzimuth(
+      satellite.sat_position, position);
+
+    // troposphere
+    double troposphere_delay = gnss_common::troposphereSaastamoinen(
+      timestamp, position, elevation);
+    if (measurement_->troposphere_wet != 0.0) {
+      double gmf_wet;
+      gnss_common::troposphereGMF(timestamp, position, elevation, nullptr, &gmf_wet);
+      troposphere_delay += measurement_->troposphere_wet * gmf_wet;
+    }
+
+    // ionosphere
+    double ionosphere_delay;
+    if (satellite.ionosphere != 0.0 &&
+        (satellite.ionosphere_type == IonoType::Augmentation ||
+         satellite.ionosphere_type == IonoType::DualFrequency)) {
+      ionosphere_delay = gnss_common::ionosphereConvertFromBase(
+        satellite.ionosphere, wavelengths_[i]);
+    }
+    else {
+      ionosphere_delay = gnss_common::ionosphereBroadcast(timestamp, position,
+        azimuth, elevation, wavelengths_[i], measurement_->ionosphere_parameters);
+    }
+
+    delays(i) = troposphere_delay + ionosphere_delay;
+  }
+}
+
+}
@@ -17,29 +17,23 @@ namespace gici {
 // Construct with measurement and information matrix
 template<int... Ns>
 PseudorangeErrorDD<Ns ...>::PseudorangeErrorDD(
-                    const GnssMeasurement& measurement_rov,
-                    const GnssMeasurement& measurement_ref,
+                    const GnssMeasurementConstPtr& measurement_rov,
+                    const GnssMeasurementConstPtr& measurement_ref,
                     const GnssMeasurementIndex index_rov,
                     const GnssMeasurementIndex index_ref,
                     const GnssMeasurementIndex index_rov_base,
                     const GnssMeasurementIndex index_ref_base,
                     const GnssErrorParameter& error_parameter)
 {
-  CHECK(!checkZero(measurement_ref.position)) << 
+  CHECK(!checkZero(measurement_ref->position)) << 
     "The position of reference station is not setted!";
 
+  index_rov_ = index_rov;
+  index_ref_ = index_ref;
+  index_rov_base_ = index_rov_base;
+  index_ref_base_ = index_ref_base;
   setMeasurement(measurement_rov, measurement_ref);
 
-  satellite_rov_ = measurement_rov_.getSat(index_rov);
-  satellite_ref_ = measurement_ref_.getSat(index_ref);
-  satellite_rov_base_ = measurement_rov_.getSat(index_rov_base);
-  satellite_ref_base_ = measurement_ref_.getSat(index_ref_base);
-
-  observation_rov_ = measurement_rov_.getObs(index_rov);
-  observation_ref_ = measurement_ref_.getObs(index_ref);
-  observation_rov_base_ = measurement_rov_.getObs(index_rov_base);
-  observation_ref_base_ = measurement_ref_.getObs(index_ref_base);
-
   // Check parameter block types
   // Group 1
   if (dims_.kNumParameterBlocks == 1 && 
@@ -89,10 +83,10 @@ void PseudorangeErrorDD<Ns ...>::setInformation(const GnssErrorParameter& error_
   for (size_t i = 0; i < 3; i++) factor(i) = error_parameter_.phase_error_factor[i];
   double ratio = square(error_parameter_.code_to_phase_ratio);
   double elevation_rov = gnss_common::satelliteElevation(
-    satellite_rov_.sat_position, measurement_rov_.position);
+    satellite_rov_->sat_position, measurement_rov_->position);
   covariance_ = covariance_t(
     (square(factor(0)) + square(factor(1) / sin(elevation_rov))) * ratio * 4.0);
-  char system = satellite_rov_.getSystem();
+  char system = satellite_rov_->getSystem();
   covariance_ *= square(error_parameter_.system_error_ratio.at(system));
 
   information_ = covariance_.inverse();
@@ -149,25 +143,25 @@ bool PseudorangeErrorDD<Ns ...>::EvaluateWithMinimalJacobians(
     t_WR_ECEF = coordinate_->convert(t_WR_W, GeoType::ENU, GeoType::ECEF);
   }
 
-  double timestamp = measurement_rov_.timestamp;
+  double timestamp = measurement_rov_->timestamp;
 
   double rho_rov = gnss_common::satelliteToReceiverDistance(  // 接收机和卫星的距离
-    satellite_rov_.sat_position, t_WR_ECEF);
+    satellite_rov_->sat_position, t_WR_ECEF);
   double rho_ref = gnss_common::satelliteToReceiverDistance(
-    satellite_ref_.sat_position, measurement_ref_.position);
+    satellite_ref_->sat_position, measurement_ref_->position);
   double rho_rov_base = gnss_common::satelliteToReceiverDistance( // 接收机和base卫星的距离
-    satellite_rov_base_.sat_position, t_WR_ECEF);
+    satellite_rov_base_->sat_position, t_WR_ECEF);
   double rho_ref_base = gnss_common::satelliteToReceiverDistance(
-    satellite_ref_base_.sat_position, measurement_ref_.position);
+    satellite_ref_base_->sat_position, measurement_ref_->position);
 
   double elevation_rov = gnss_common::satelliteElevation(
-    satellite_rov_.sat_position, t_WR_ECEF);
+    satellite_rov_->sat_position, t_WR_ECEF);
   double elevation_ref = gnss_common::satelliteElevation(
-    satellite_ref_.sat_position, measurement_ref_.position);
+    satellite_ref_->sat_position, measurement_ref_->position);
   double elevation_rov_base = gnss_common::satelliteElevation(
-    satellite_rov_base_.sat_position, t_WR_ECEF);
+    satellite_rov_base_->sat_position, t_WR_ECEF);
   double elevation_ref_base = gnss_common::satelliteElevation(
-    satellite_ref_base_.sat_position, measurement_ref_.position);
+    satellite_ref_base_->sat_position, measurement_ref_->position);
 
   // Atmosphere
   if (!is_estimate_atmosphere_) 
@@ -193,21 +187,38 @@ bool PseudorangeErrorDD<Ns ...>::EvaluateWithMinimalJacobians(
     }
 
     // troposphere hydro-static delay
-    double zhd_rov = gnss_common::troposphereSaastamoinen(
-      timestamp, t_WR_ECEF, PI / 2.0);
-    double zhd_ref = gnss_common::troposphereSaastamoinen(
-      timestamp, t_WR_ECEF, PI / 2.0);
-    double zhd_rov_base = gnss_common::troposphereSaastamoinen(
-      timestamp, t_WR_ECEF, PI / 2.0);
-    double zhd_ref_base = gnss_common::troposphereSaastamoinen(
-      timestamp, t_WR_ECEF, PI / 2.0);
+    double zhd_rov, zhd_ref, zhd_rov_base, zhd_ref_base;
+    if (corrections_ && corrections_->valid(t_WR_ECEF)) {
+      // rover side terms from the per-epoch cache, the reference side 
+      // mappings are still computed here as their elevations differ.
+      const GnssSatelliteCorrections& terms_rov =
+        corrections_->satellite(correction_slot_rov_);
+      const GnssSatelliteCorrections& terms_rov_base =
+        corrections_->satellite(correction_slot_rov_base_);
+      zhd_rov = zhd_ref = zhd_rov_base = zhd_ref_base = 
+        corrections_->station().zenith_hydro;
+      gmf_hydro_rov = terms_rov.gmf_hydro;
+      gmf_wet_rov = terms_rov.gmf_wet;
+      gmf_hydro_rov_base = terms_rov_base.gmf_hydro;
+      gmf_wet_rov_base = terms_rov_base.gmf_wet;
+    }
+    else {
+      zhd_rov = gnss_common::troposphereSaastamoinen(
+        timestamp, t_WR_ECEF, PI / 2.0);
+      zhd_ref = gnss_common::troposphereSaastamoinen(
+        timestamp, t_WR_ECEF, PI / 2.0);
+      zhd_rov_base = gnss_common::troposphereSaastamoinen(
+        timestamp, t_WR_ECEF, PI / 2.0);
+      zhd_ref_base = gnss_common::troposphereSaastamoinen(
+        timestamp, t_WR_ECEF, PI / 2.0);
+      gnss_common::troposphereGMF(
+        timestamp, t_WR_ECEF, elevation_rov, &gmf_hydro_rov, &gmf_wet_rov);
+      gnss_common::troposphereGMF(
+        timestamp, t_WR_ECEF, elevation_rov_base, &gmf_hydro_rov_base, &gmf_wet_rov_base);
+    }
     // mapping
-    gnss_common::troposphereGMF(  // 投影函数模型
-      timestamp, t_WR_ECEF, elevation_rov, &gmf_hydro_rov, &gmf_wet_rov);
     gnss_common::troposphereGMF(
       timestamp, t_WR_ECEF, elevation_ref, &gmf_hydro_ref, &gmf_wet_ref);
-    gnss_common::troposphereGMF(
-      timestamp, t_WR_ECEF, elevation_rov_base, &gmf_hydro_rov_base, &gmf_wet_rov_base);
     gnss_common::troposphereGMF(
       timestamp, t_WR_ECEF, elevation_ref_base, &gmf_hydro_ref_base, &gmf_wet_ref_base);
     dtroposphere_delay = zhd_rov * gmf_hydro_rov - zhd_ref * gmf_hydro_ref - 
@@ -242,8 +253,8 @@ bool PseudorangeErrorDD<Ns ...>::EvaluateWithMinimalJacobians(
   {
     // Receiver position in ECEF
     Eigen::Matrix<double, 1, 3> J_t_ECEF = 
-      -((t_WR_ECEF - satellite_rov_.sat_position) / rho_rov).transpose() + 
-       ((t_WR_ECEF - satellite_rov_base_.sat_position) / rho_rov_base).transpose();
+      -((t_WR_ECEF - satellite_rov_->sat_position) / rho_rov).transpose() + 
+       ((t_WR_ECEF - satellite_rov_base_->sat_position) / rho_rov_base).transpose();
     
     // Poses
     Eigen::Matrix<double, 1, 6> J_T_WS;
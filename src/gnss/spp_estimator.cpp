@@ -10,6 +10,7 @@
 
 #include "gici/gnss/gnss_parameter_blocks.h"
 #include "gici/gnss/gnss_common.h"
+#include "gici/gnss/pseudorange_error_batch.h"
 
 namespace gici {
 
@@ -155,8 +156,13 @@ bool SppEstimator::estimate()
 {
   status_ = EstimatorStatus::Converged;
 
+  // Optimize with single-pass robust FDE
+  if (gnss_base_options_.use_outlier_rejection && 
+      gnss_base_options_.use_robust_fde) {
+    optimizeWithRobustFde(curState());
+  }
   // Optimize with FDE(误差)
-  if (gnss_base_options_.use_outlier_rejection)
+  else if (gnss_base_options_.use_outlier_rejection)
   while (1)
   {
     optimize(); // 执行优化
@@ -195,6 +201,18 @@ bool SppEstimator::estimate()
   for (auto residual_block : residual_blocks) {
     std::shared_ptr<ErrorInterface> interface = residual_block.error_interface_ptr;
     ErrorType type = interface->typeInfo();
+    if (type == ErrorType::kPseudorangeErrorBatch) {
+      std::shared_ptr<PseudorangeErrorBatch> batch = 
+        std::static_pointer_cast<PseudorangeErrorBatch>(interface);
+      Eigen::VectorXd errors;
+      computePseudorangeBatchErrors(residual_block, errors, true);
+      for (size_t row = 0; row < batch->numRows(); row++) {
+        if (batch->rowWeight(row) == 0.0) continue;
+        n_residual++;
+        chi_square += square(errors(row));
+      }
+      continue;
+    }
     if (!(type == ErrorType::kPseudorangeError)) continue;  // 伪距残差
     double residual[1];
     n_residual++;
@@ -11,7 +11,7 @@
 namespace gici {
 
 // Initialize IMU pose and biases with gravity vector
-bool initPoseAndBiases(const ImuMeasurements& imu_measurements,
+bool initPoseAndBiases(const ImuMeasurementVector& imu_measurements,
                        const double gravity,
                        Transformation& T_WS,
                        SpeedAndBias& speed_and_bias, 
@@ -110,4 +110,64 @@ bool initYawFromVelocity(const Eigen::Vector3d& v_WS_W, double& yaw)
   return true;
 }
 
+// Propagate IMU covariance P = F * P * F^T with one-step transition matrix F
+void propagateImuCovariance(const double dt, 
+                            const Eigen::Matrix3d& F_qq,
+                            const Eigen::Matrix3d& F_qb,
+                            const Eigen::Matrix3d& F_vq,
+                            Eigen::Matrix<double, 15, 15>& P)
+{
+  // M = F * P, only the p, q and v block rows are changed
+  Eigen::Matrix<double, 9, 15> M;
+  M.middleRows<3>(0) = P.middleRows<3>(0) + dt * P.middleRows<3>(6);
+  M.middleRows<3>(3).noalias() = F_qq * P.middleRows<3>(3);
+  M.middleRows<3>(3).noalias() += F_qb * P.middleRows<3>(9);
+  M.middleRows<3>(6) = P.middleRows<3>(6);
+  M.middleRows<3>(6).noalias() += F_vq * P.middleRows<3>(3);
+  M.middleRows<3>(6).noalias() += F_qb * P.middleRows<3>(12);
+
+  // P = M * F^T, upper block triangle. The bias-bias blocks are not changed.
+  P.block<3, 3>(0, 0) = M.block<3, 3>(0, 0) + dt * M.block<3, 3>(0, 6);
+  P.block<6, 3>(0, 3).noalias() = M.block<6, 3>(0, 3) * F_qq.transpose();
+  P.block<6, 3>(0, 3).noalias() += M.block<6, 3>(0, 9) * F_qb.transpose();
+  P.block<9, 3>(0, 6) = M.block<9, 3>(0, 6);
+  P.block<9, 3>(0, 6).noalias() += M.block<9, 3>(0, 3) * F_vq.transpose();
+  P.block<9, 3>(0, 6).noalias() += M.block<9, 3>(0, 12) * F_qb.transpose();
+  P.block<9, 6>(0, 9) = M.block<9, 6>(0, 9);
+
+  // Mirror to lower block triangle
+  for (int i = 1; i < 5; i++) {
+    for (int j = 0; j < i && j < 3; j++) {
+      P.block<3, 3>(3 * i, 3 * j) = P.block<3, 3>(3 * j, 3 * i).transpose();
+    }
+  }
+}
+
+// Accumulate IMU transition matrix J = F * J
+void accumulateImuTransition(const double dt, 
+                             const Eigen::Matrix3d& F_qq,
+                             const Eigen::Matrix3d& F_qb,
+                             const Eigen::Matrix3d& F_vq,
+                             Eigen::Matrix<double, 15, 15>& J)
+{
+  // the p and v rows use the old q and v rows, so update them first
+  const Eigen::Matrix<double, 3, 15> J_q = J.middleRows<3>(3);
+  J.middleRows<3>(0) += dt * J.middleRows<3>(6);
+  J.middleRows<3>(6).noalias() += F_vq * J_q;
+  J.middleRows<3>(6).noalias() += F_qb * J.middleRows<3>(12);
+  J.middleRows<3>(3).noalias() = F_qq * J_q;
+  J.middleRows<3>(3).noalias() += F_qb * J.middleRows<3>(9);
+}
+
+// Transform IMU covariance P = F * P * F^T with an accumulated transition matrix
+void transformImuCovariance(const Eigen::Matrix<double, 15, 15>& F,
+                            Eigen::Matrix<double, 15, 15>& P)
+{
+  Eigen::Matrix<double, 9, 15> FP;
+  FP.noalias() = F.topRows<9>() * P;
+  P.topLeftCorner<9, 9>().noalias() = FP * F.topRows<9>().transpose();
+  P.topRightCorner<9, 6>() = FP.rightCols<6>();
+  P.bottomLeftCorner<6, 9>() = FP.rightCols<6>().transpose();
+}
+
 }
\ No newline at end of file
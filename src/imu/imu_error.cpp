@@ -46,12 +46,16 @@
 #include <math.h>
 
 #include "gici/estimate/pose_local_parameterization.h"
+#include "gici/imu/imu_common.h"
 #include "gici/utility/transform.h"
 
 namespace gici {
 
+std::atomic<size_t> ImuError::num_redo_in_evaluation_{0};
+std::atomic<size_t> ImuError::num_redo_in_relinearization_{0};
+
 // Construct with measurements and parameters.
-ImuError::ImuError(const ImuMeasurements &imu_measurements,
+ImuError::ImuError(const ImuMeasurementVector &imu_measurements,
                    const ImuParameters& imu_parameters,
                    const double& t_0, const double& t_1)
 {
@@ -216,16 +220,12 @@ int ImuError::redoPreintegration(const Transformation& /*T_WS*/,
         - 0.25 * dt * dt * (C * acc_S_x * dalpha_db_g_0 + C_1 * acc_S_x * dalpha_db_g_);
 
     // covariance propagation
-    Eigen::Matrix<double, 15, 15> F_delta =
-        Eigen::Matrix<double, 15, 15>::Identity();
-    // transform
-    F_delta.block<3, 3>(0, 6) = Eigen::Matrix3d::Identity() * dt;
-    F_delta.block<3, 3>(3, 3) = -skewSymmetric(omega_S_true * dt);
-    F_delta.block<3, 3>(3, 9) = -C * dt;
-    F_delta.block<3, 3>(6, 3) =
+    // transform, with the structure of the transition matrix
+    const Eigen::Matrix3d F_qq = -skewSymmetric(omega_S_true * dt);
+    const Eigen::Matrix3d F_qb = -C * dt;
+    const Eigen::Matrix3d F_vq =
         -skewSymmetric(0.5 * (C + C_1) * acc_S_true * dt);
-    F_delta.block<3, 3>(6, 12) = -C * dt;
-    P_delta_ = F_delta * P_delta_ * F_delta.transpose();
+    propagateImuCovariance(dt, F_qq, F_qb, F_vq, P_delta_);
     // add noise. Note that transformations with rotation matrices can be
     // ignored, since the noise is isotropic.
     //F_tot = F_delta*F_tot;
@@ -283,11 +283,40 @@ int ImuError::redoPreintegration(const Transformation& /*T_WS*/,
 
   //std::cout << F_tot;
 
+  redoCounter_++;
+
   return n_integrated;
 }
 
+// Redo the pre-integration if the biases moved too far from the linearization point.
+bool ImuError::relinearize(const Transformation& T_WS,
+                           const SpeedAndBias& speed_and_biases) const
+{
+  // not integrated yet
+  if (redo_) {
+    redoPreintegration(T_WS, speed_and_biases);
+    num_redo_in_relinearization_++;
+    redo_ = false;
+    return true;
+  }
+
+  // no Evaluate() or other relinearize() runs on this error term meanwhile, so
+  // the linearization point can be read without locking
+  const double delta_t = t1_ - t0_;
+  const Eigen::Matrix<double, 6, 1> Delta_b =
+    speed_and_biases.tail<6>() - speed_and_biases_ref_.tail<6>();
+  if (Delta_b.head<3>().norm() * delta_t <= relinearization_gyro_threshold_ &&
+      Delta_b.tail<3>().norm() * delta_t <= relinearization_acc_threshold_) {
+    return false;
+  }
+
+  redoPreintegration(T_WS, speed_and_biases);
+  num_redo_in_relinearization_++;
+  return true;
+}
+
 // Propagates pose, speeds and biases with given IMU measurements.
-int ImuError::propagation(const ImuMeasurements& imu_measurements,
+int ImuError::propagation(const ImuMeasurementVector& imu_measurements,
                           const ImuParameters& imu_params,
                           Transformation& T_WS,
                           SpeedAndBias& speed_and_biases,
@@ -300,7 +329,7 @@ int ImuError::propagation(const ImuMeasurements& imu_measurements,
   const double t_end_adjusted = t_end - imu_params.delay_imu_cam;
   // sanity check:
   bool modify_front = false, modify_back = false;;
-  ImuMeasurements imu_measurements_modified;
+  ImuMeasurementVector imu_measurements_modified;
   double dt0 = t_start_adjusted - imu_measurements.front().timestamp;
   double dt1 = t_end_adjusted - imu_measurements.back().timestamp;
   if (dt0 < 0.0) { /* 确保时间有效 */
@@ -315,14 +344,15 @@ int ImuError::propagation(const ImuMeasurements& imu_measurements,
   }
   if (modify_front || modify_back) imu_measurements_modified = imu_measurements;
   if (modify_front) {
-    imu_measurements_modified.push_front(imu_measurements.front());
+    imu_measurements_modified.insert(
+      imu_measurements_modified.begin(), imu_measurements.front());
     imu_measurements_modified.front().timestamp = t_start_adjusted;
   }
   if (modify_back) {
     imu_measurements_modified.push_back(imu_measurements.back());
     imu_measurements_modified.back().timestamp = t_end_adjusted;
   }
-  const ImuMeasurements *imu_measurements_ptr = 
+  const ImuMeasurementVector *imu_measurements_ptr = 
     (modify_front || modify_back) ? &imu_measurements_modified : &imu_measurements;
   /**
    * CHECK_LE 宏函数，检查val1是否小于等于val2
@@ -354,7 +384,7 @@ int ImuError::propagation(const ImuMeasurements& imu_measurements,
   int num_propagated = 0;
 
   double time = t_start_adjusted;
-  const ImuMeasurements& imu = *imu_measurements_ptr;
+  const ImuMeasurementVector& imu = *imu_measurements_ptr;
   for (size_t i = 0; i < imu.size() - 1; i++)
   {
     if (!has_started && /* 这里相当于对积分的起始时刻又限制了一遍 */
@@ -450,28 +480,24 @@ int ImuError::propagation(const ImuMeasurements& imu_measurements,
     acc_doubleintegral +=
         acc_integral * dt + 0.25 * (C + C_1) * acc_S_true * dt * dt;
 
-    // Jacobian 
-    Eigen::Matrix<double,15,15> F_delta =
-        Eigen::Matrix<double,15,15>::Identity();
+    // Jacobian, with the structure of the transition matrix
+    Eigen::Matrix3d F_qq, F_qb, F_vq;
     if (jacobian || covariance)
     {
-      F_delta.block<3, 3>(0, 6) = Eigen::Matrix3d::Identity() * dt;
-      F_delta.block<3, 3>(3, 3) = -skewSymmetric(omega_S_true * dt);
-      F_delta.block<3, 3>(3, 9) = -C * dt;
-      F_delta.block<3, 3>(6, 3) =
-          -skewSymmetric(0.5 * (C + C_1) * acc_S_true * dt);
-      F_delta.block<3, 3>(6, 12) = -C * dt;
+      F_qq = -skewSymmetric(omega_S_true * dt);
+      F_qb = -C * dt;
+      F_vq = -skewSymmetric(0.5 * (C + C_1) * acc_S_true * dt);
     }
     if (jacobian)
     {
-      F = F_delta * F;
+      accumulateImuTransition(dt, F_qq, F_qb, F_vq, F);
     }
 
     // covariance propagation
     if (covariance)
     {
       // transform
-      P_delta = F_delta * P_delta * F_delta.transpose();
+      propagateImuCovariance(dt, F_qq, F_qb, F_vq, P_delta);
       // add noise. Note that transformations with rotation matrices can be
       // ignored, since the noise is isotropic.
       //F_tot = F_delta*F_tot;
@@ -586,18 +612,22 @@ bool ImuError::EvaluateWithMinimalJacobians(double const* const * parameters,
   // call the propagation
   const double delta_t = t1_ - t0_;
   Eigen::Matrix<double, 6, 1> Delta_b;
-  // ensure unique access
-  {
+  // with first-order bias correction, the pre-integration is (re-)done by
+  // relinearize() before each solve, and is not changed while solving. So we
+  // only lock if it has not been integrated yet. redo_ is cleared only after
+  // the integration is done, so reading false here means it is complete.
+  const bool lock_free = first_order_bias_correction_ && !redo_.load();
+  if (!first_order_bias_correction_) {
+    // ensure unique access
     std::lock_guard<std::mutex> lock(preintegration_mutex_);
     Delta_b = speed_and_biases_0.tail<6>()
         - speed_and_biases_ref_.tail<6>();
+    if (Delta_b.head<3>().norm() * delta_t > 0.0001) redo_ = true;
   }
-  redo_ = redo_ || (Delta_b.head<3>().norm() * delta_t > 0.0001);
   if (redo_)
   {
     redoPreintegration(T_WS_0, speed_and_biases_0);
-    redoCounter_++;
-    Delta_b.setZero();
+    num_redo_in_evaluation_++;
     redo_ = false;
     /*if (redoCounter_ > 1) {
       std::cout << "pre-integration no. " << redoCounter_ << std::endl;
@@ -606,8 +636,12 @@ bool ImuError::EvaluateWithMinimalJacobians(double const* const * parameters,
 
   // actual propagation output:
   {
-    std::lock_guard<std::mutex> lock(preintegration_mutex_);
+    std::unique_lock<std::mutex> lock(preintegration_mutex_, std::defer_lock);
+    if (!lock_free) lock.lock();
     // this is a bit stupid, but shared read-locks only come in C++14
+    // the linearization point may have been moved by relinearize()
+    Delta_b = speed_and_biases_0.tail<6>()
+        - speed_and_biases_ref_.tail<6>();
     const Eigen::Vector3d g_W = Eigen::Vector3d(0, 0, imu_parameters_.g);
 
     // assign Jacobian w.r.t. x0
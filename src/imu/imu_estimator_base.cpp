@@ -8,6 +8,8 @@
 **/
 #include "gici/imu/imu_estimator_base.h"
 
+#include <algorithm>
+
 #include "gici/estimate/speed_and_bias_parameter_block.h"
 #include "gici/imu/imu_error.h"
 #include "gici/imu/speed_and_bias_error.h"
@@ -24,7 +26,10 @@ namespace gici {
 ImuEstimatorBase::ImuEstimatorBase(
                     const ImuEstimatorBaseOptions& options,
                     const EstimatorBaseOptions& base_options) :
-  imu_base_options_(options), EstimatorBase(base_options)
+  imu_base_options_(options), EstimatorBase(base_options), 
+  imu_measurements_(options.imu_buffer_capacity),
+  imu_preintegration_manager_(options.use_first_order_bias_correction ? 
+    base_options.num_threads : 1)
 {
   Eigen::Quaterniond q_BI = 
     eulerAngleToQuaternion(imu_base_options_.body_to_imu_rotation * D2R);
@@ -38,27 +43,52 @@ ImuEstimatorBase::~ImuEstimatorBase()
 // Add IMU meausrement
 void ImuEstimatorBase::addImuMeasurement(const ImuMeasurement& imu_measurement)
 {
-  if (imu_measurements_.size() != 0 && 
-      imu_measurements_.back().timestamp > imu_measurement.timestamp) {
+  // read the latest one only once, the buffer can be emptied in between by other threads
+  ImuMeasurement last_imu;
+  if (imu_measurements_.tryBack(last_imu) && 
+      last_imu.timestamp > imu_measurement.timestamp) {
     LOG(WARNING) << "Received IMU with previous timestamp!";
   }
   else {
-    imu_mutex_.lock();
-    imu_measurements_.push_back(imu_measurement);
-    imu_measurements_.back().angular_velocity = 
-      rotateImuToBody(imu_measurements_.back().angular_velocity);
-    imu_measurements_.back().linear_acceleration = 
-      rotateImuToBody(imu_measurements_.back().linear_acceleration);
-    imu_mutex_.unlock();
+    ImuMeasurement imu = imu_measurement;
+    imu.angular_velocity = rotateImuToBody(imu.angular_velocity);
+    imu.linear_acceleration = rotateImuToBody(imu.linear_acceleration);
+    handleDroppedImuMeasurements(imu_measurements_.pushBack(imu));
+  }
+
+  // delete used IMU measurement
+  if (states_.size() > 0 && !do_not_remove_imu_measurements_) {
+    imu_measurements_.popFrontBefore(oldestState().timestamp - 1.0);
+  }
+}
+
+// Add a batch of IMU measurements
+void ImuEstimatorBase::addImuMeasurements(const ImuMeasurementBatch& imu_measurements)
+{
+  // rotate to body frame and check timestamps
+  imu_measurements_in_body_.clear();
+  ImuMeasurement last_imu;
+  bool has_last = imu_measurements_.tryBack(last_imu);
+  double last_timestamp = has_last ? last_imu.timestamp : 0.0;
+  for (int i = 0; i < imu_measurements.size; i++) {
+    const ImuMeasurement& imu_measurement = imu_measurements.measurements[i];
+    if (has_last && last_timestamp > imu_measurement.timestamp) {
+      LOG(WARNING) << "Received IMU with previous timestamp!";
+      continue;
+    }
+    ImuMeasurement imu = imu_measurement;
+    imu.angular_velocity = rotateImuToBody(imu.angular_velocity);
+    imu.linear_acceleration = rotateImuToBody(imu.linear_acceleration);
+    imu_measurements_in_body_.push_back(imu);
+    last_timestamp = imu.timestamp; has_last = true;
   }
+  handleDroppedImuMeasurements(imu_measurements_.pushBack(
+    imu_measurements_in_body_.data(), imu_measurements_in_body_.size()));
 
   // delete used IMU measurement
-  imu_mutex_.lock();
-  if (states_.size() > 0 && !do_not_remove_imu_measurements_)
-  while (imu_measurements_.front().timestamp < oldestState().timestamp - 1.0) {
-    imu_measurements_.pop_front();
+  if (states_.size() > 0 && !do_not_remove_imu_measurements_) {
+    imu_measurements_.popFrontBefore(oldestState().timestamp - 1.0);
   }
-  imu_mutex_.unlock();
 }
 
 // IMU integration
@@ -70,11 +100,11 @@ bool ImuEstimatorBase::imuIntegration(
   if (checkEqual(timestamp, last_timestamp)) return true;
 
   // Integrate to desired timestamp
-  imu_mutex_.lock();
+  const ImuMeasurementVector& imu_measurements = 
+    getImuMeasurementsBetween(last_timestamp, timestamp);
   ImuError::propagation(
-    imu_measurements_, imu_base_options_.imu_parameters, T_WS, speed_and_bias,
+    imu_measurements, imu_base_options_.imu_parameters, T_WS, speed_and_bias,
     last_timestamp, timestamp, nullptr, nullptr);
-  imu_mutex_.unlock();
   T_WS.getRotation().normalize();
 
   return true;
@@ -91,12 +121,13 @@ bool ImuEstimatorBase::imuIntegration(
 
   // Integrate to desired timestamp
   Eigen::Matrix<double, 15, 15> delta_P, F;
-  imu_mutex_.lock();
+  const ImuMeasurementVector& imu_measurements = 
+    getImuMeasurementsBetween(last_timestamp, timestamp);
   ImuError::propagation(
-    imu_measurements_, imu_base_options_.imu_parameters, T_WS, speed_and_bias,
+    imu_measurements, imu_base_options_.imu_parameters, T_WS, speed_and_bias,
     last_timestamp, timestamp, &delta_P, &F);
-  imu_mutex_.unlock();
-  covariance = F * covariance * F.transpose() + delta_P;
+  transformImuCovariance(F, covariance);
+  covariance += delta_P;
   T_WS.getRotation().normalize();
 
   return true;
@@ -164,7 +195,8 @@ bool ImuEstimatorBase::getPoseEstimateAt(
     imu_state_mutex_.unlock(); return false;
   }
   // not sufficiant IMU data
-  if (imu_measurements_.back().timestamp < timestamp) { // 当前的时间比窗口内的IMU还要新
+  ImuMeasurement last_imu;
+  if (!imu_measurements_.tryBack(last_imu) || last_imu.timestamp < timestamp) { // 当前的时间比窗口内的IMU还要新
     imu_state_mutex_.unlock(); return false;
   }
 
@@ -179,8 +211,13 @@ bool ImuEstimatorBase::getPoseEstimateAt(
   bool ret;
   SpeedAndBias speed_and_bias;
   Eigen::Matrix<double, 15, 15> covariance; covariance.setZero();
+  // start from cached checkpoints
+  if (imu_base_options_.propagation_checkpoint_interval > 0) {
+    ret = getMotionFromCheckpoints(
+      base_state, timestamp, T_WS, speed_and_bias, covariance);
+  }
   // start from base state
-  if (!checkEqual(last_base_state_.timestamp, base_state.timestamp) || 
+  else if (!checkEqual(last_base_state_.timestamp, base_state.timestamp) || 
       !checkLessEqual(last_timestamp_, timestamp)) {
     if (need_covariance_) {
       ret = getMotionFromEstimateAndImuIntegration(
@@ -260,6 +297,61 @@ bool ImuEstimatorBase::getCovarianceAt(
   return true;
 }
 
+// Get a pose and speed and bias from cached checkpoints and IMU integration
+bool ImuEstimatorBase::getMotionFromCheckpoints(
+  const State& base_state, const double timestamp, 
+  Transformation& T_WS, SpeedAndBias& speed_and_bias,
+  Eigen::Matrix<double, 15, 15>& covariance)
+{
+  // The checkpoints are built by the backend from its latest state. Integrate from the
+  // estimate if they start from another state or were built without covariance.
+  if (imu_checkpoints_.size() == 0 || 
+      !checkEqual(imu_checkpoints_.front().timestamp, base_state.timestamp) ||
+      (need_covariance_ && !imu_checkpoints_with_covariance_)) {
+    if (need_covariance_) {
+      return getMotionFromEstimateAndImuIntegration(
+        base_state, timestamp, T_WS, speed_and_bias, covariance);
+    }
+    else {
+      return getMotionFromEstimateAndImuIntegration(
+        base_state, timestamp, T_WS, speed_and_bias);
+    }
+  }
+
+  // Extend the checkpoints with the IMU measurements received after the last update
+  const int interval = imu_base_options_.propagation_checkpoint_interval;
+  double checkpoint_timestamp;
+  while (getImuTimestampAfter(imu_checkpoints_.back().timestamp, 
+         interval, checkpoint_timestamp) && checkpoint_timestamp <= timestamp) {
+    ImuCheckpoint checkpoint = imu_checkpoints_.back();
+    checkpoint.timestamp = checkpoint_timestamp;
+    if (need_covariance_) {
+      imuIntegration(imu_checkpoints_.back().timestamp, checkpoint.timestamp, 
+        checkpoint.T_WS, checkpoint.speed_and_bias, checkpoint.covariance);
+    }
+    else {
+      imuIntegration(imu_checkpoints_.back().timestamp, checkpoint.timestamp, 
+        checkpoint.T_WS, checkpoint.speed_and_bias);
+    }
+    imu_checkpoints_.push_back(checkpoint);
+  }
+
+  // Integrate from the nearest checkpoint before the given timestamp
+  auto it = std::upper_bound(imu_checkpoints_.begin(), imu_checkpoints_.end(), 
+    timestamp, [](const double t, const ImuCheckpoint& checkpoint) 
+    { return t < checkpoint.timestamp; });
+  if (it != imu_checkpoints_.begin()) it--;
+  T_WS = it->T_WS;
+  speed_and_bias = it->speed_and_bias;
+  covariance = it->covariance;
+  if (need_covariance_) {
+    return imuIntegration(it->timestamp, timestamp, T_WS, speed_and_bias, covariance);
+  }
+  else {
+    return imuIntegration(it->timestamp, timestamp, T_WS, speed_and_bias);
+  }
+}
+
 // Add IMU speed and bias block to graph
 void ImuEstimatorBase::addImuSpeedAndBiasParameterBlock(
   const BackendId backend_id, 
@@ -267,7 +359,7 @@ void ImuEstimatorBase::addImuSpeedAndBiasParameterBlock(
 {
   BackendId speed_and_bias_id = changeIdType(backend_id, IdType::ImuStates);
   std::shared_ptr<SpeedAndBiasParameterBlock> speed_and_bias_parameter_block = 
-    std::make_shared<SpeedAndBiasParameterBlock>(
+    makePooled<SpeedAndBiasParameterBlock>(object_pool_,
     prior, speed_and_bias_id.asInteger());
   CHECK(graph_->addParameterBlock(speed_and_bias_parameter_block));
 }
@@ -279,7 +371,7 @@ void ImuEstimatorBase::addPoseParameterBlock(
 {
   if (graph_->parameterBlockExists(backend_id.asInteger())) return;
   std::shared_ptr<PoseParameterBlock> pose_parameter_block = 
-    std::make_shared<PoseParameterBlock>(T_WS_prior, backend_id.asInteger());
+    makePooled<PoseParameterBlock>(object_pool_, T_WS_prior, backend_id.asInteger());
   CHECK(graph_->addParameterBlock(pose_parameter_block, Graph::Pose6d));
 }
 
@@ -292,11 +384,16 @@ void ImuEstimatorBase::addImuResidualBlock(const State& last_state, State& cur_s
   BackendId cur_pose_id = cur_state.id_in_graph;
   BackendId last_speed_and_bias_id = changeIdType(last_pose_id, IdType::ImuStates);
   BackendId speed_and_bias_id = changeIdType(cur_pose_id, IdType::ImuStates);
-  imu_mutex_.lock();
+  // ImuError keeps the measurements within 0.1s margins of its time range
   std::shared_ptr<ImuError> imu_error =
-    std::make_shared<ImuError>(imu_measurements_, imu_base_options_.imu_parameters,
-                              last_timestamp, timestamp);
-  imu_mutex_.unlock();
+    makePooled<ImuError>(object_pool_, 
+      getImuMeasurementsBetween(last_timestamp - 0.1, timestamp + 0.1), 
+      imu_base_options_.imu_parameters, last_timestamp, timestamp);
+  if (imu_base_options_.use_first_order_bias_correction) {
+    imu_error->setFirstOrderBiasCorrection(
+      imu_base_options_.relinearization_gyro_threshold, 
+      imu_base_options_.relinearization_acc_threshold);
+  }
   cur_state.imu_residual_to_lhs = 
     graph_->addResidualBlock(imu_error, nullptr, 
       graph_->parameterBlockPtr(last_pose_id.asInteger()), 
@@ -317,7 +414,7 @@ void ImuEstimatorBase::addImuSpeedAndBiasResidualBlock(
 {
   BackendId speed_and_bias_id = changeIdType(state.id_in_graph, IdType::ImuStates);
   std::shared_ptr<SpeedAndBiasError> speed_and_bias_error = 
-    std::make_shared<SpeedAndBiasError>(speed_and_bias, 
+    makePooled<SpeedAndBiasError>(object_pool_, speed_and_bias, 
     square(std_speed), 
     square(std_bg), 
     square(std_ba));
@@ -338,7 +435,7 @@ void ImuEstimatorBase::addPoseResidualBlock(
   information(4, 4) = 1.0 / square(std_roll_pitch);
   information(5, 5) = 1.0 / square(std_yaw);
   std::shared_ptr<PoseError> pose_error = 
-    std::make_shared<PoseError>(T_WS, information);
+    makePooled<PoseError>(object_pool_, T_WS, information);
   ceres::ResidualBlockId residual_id = 
     graph_->addResidualBlock(pose_error, nullptr,
       graph_->parameterBlockPtr(pose_id.asInteger()));
@@ -351,7 +448,7 @@ void ImuEstimatorBase::addYawResidualBlock(
   BackendId pose_id = state.id_in_graph;
 #if 0
   std::shared_ptr<YawError> yaw_error = 
-    std::make_shared<YawError>(yaw, 1.0 / square(std_yaw));
+    makePooled<YawError>(object_pool_, yaw, 1.0 / square(std_yaw));
 #else
   Transformation T_WS = getPoseEstimate(state);
   Eigen::Vector3d rpy = quaternionToEulerAngle(T_WS.getEigenQuaternion());
@@ -361,7 +458,7 @@ void ImuEstimatorBase::addYawResidualBlock(
   information.setIdentity(); information *= 1.0e-6;
   information(5, 5) = 1.0 / square(std_yaw);
   std::shared_ptr<PoseError> yaw_error = 
-    std::make_shared<PoseError>(T_WS, information);
+    makePooled<PoseError>(object_pool_, T_WS, information);
 #endif
   ceres::ResidualBlockId residual_id = 
     graph_->addResidualBlock(yaw_error, nullptr,
@@ -378,7 +475,7 @@ void ImuEstimatorBase::addRollPitchResidualBlock(
   Eigen::Matrix2d information = 
     Eigen::Matrix2d::Identity() / square(std_pitch_and_roll);
   std::shared_ptr<RollAndPitchError> roll_pitch_error = 
-    std::make_shared<RollAndPitchError>(pitch_and_roll, information);
+    makePooled<RollAndPitchError>(object_pool_, pitch_and_roll, information);
 #else
   Transformation T_WS = getPoseEstimate(state);
   Eigen::Vector3d rpy = quaternionToEulerAngle(T_WS.getEigenQuaternion());
@@ -389,7 +486,7 @@ void ImuEstimatorBase::addRollPitchResidualBlock(
   information(3, 3) = 1.0 / square(std_pitch_and_roll);
   information(4, 4) = 1.0 / square(std_pitch_and_roll);
   std::shared_ptr<PoseError> roll_pitch_error = 
-    std::make_shared<PoseError>(T_WS, information);
+    makePooled<PoseError>(object_pool_, T_WS, information);
 #endif
   ceres::ResidualBlockId residual_id = 
     graph_->addResidualBlock(roll_pitch_error, nullptr,
@@ -411,7 +508,7 @@ void ImuEstimatorBase::addHMCResidualBlock(const State& state)
 
   double std = sqrt(square(imu_base_options_.body_to_imu_rotation_std * D2R) + 
     square(0.1 / speed.head<2>().norm()));
-  std::shared_ptr<HMCError> hmc_error = std::make_shared<HMCError>(std);
+  std::shared_ptr<HMCError> hmc_error = makePooled<HMCError>(object_pool_, std);
   ceres::ResidualBlockId residual_id = 
     graph_->addResidualBlock(hmc_error, nullptr,
       graph_->parameterBlockPtr(pose_id.asInteger()),
@@ -432,7 +529,7 @@ void ImuEstimatorBase::addNHCResidualBlock(const State& state)
     imu_base_options_.car_motion_max_anguler_velocity) return;
 
   double std = imu_base_options_.body_to_imu_rotation_std * D2R;
-  std::shared_ptr<NHCError> nhc_error = std::make_shared<NHCError>(std);
+  std::shared_ptr<NHCError> nhc_error = makePooled<NHCError>(object_pool_, std);
   ceres::ResidualBlockId residual_id = 
     graph_->addResidualBlock(nhc_error, nullptr,
       graph_->parameterBlockPtr(pose_id.asInteger()),
@@ -445,22 +542,22 @@ void ImuEstimatorBase::addZUPTResidualBlock(const State& state)
   if (!imu_base_options_.zupt_duration) return;
 
   // Check zero motion
-  imu_mutex_.lock();
+  static thread_local ImuMeasurementVector imu_measurements;
+  imu_measurements_.getBetween(state.timestamp - imu_base_options_.zupt_duration, 
+    state.timestamp, imu_measurements);
   std::vector<double> acc[3], gyro[3];
-  for (int i = imu_measurements_.size() - 1; i >= 0; i--) {
-    ImuMeasurement& imu = imu_measurements_[i];
+  for (int i = imu_measurements.size() - 1; i >= 0; i--) {
+    const ImuMeasurement& imu = imu_measurements[i];
     if (imu.timestamp > state.timestamp) continue;
     if (imu.timestamp < state.timestamp - imu_base_options_.zupt_duration) break;
+    // the buffer does not cover the whole duration
     if (i == 0 && imu.timestamp > 
-        state.timestamp - imu_base_options_.zupt_duration) {
-      imu_mutex_.unlock(); return;
-    }
+        state.timestamp - imu_base_options_.zupt_duration) return;
     for (int j = 0; j < 3; j++) {
       acc[j].push_back(imu.linear_acceleration(j));
       gyro[j].push_back(imu.angular_velocity(j));
     }
   }
-  imu_mutex_.unlock();
   double median_acc[3], median_gyro[3];
   double std_acc[3], std_gyro[3];
   for (int i = 0; i < 3; i++) {
@@ -488,7 +585,7 @@ void ImuEstimatorBase::addZUPTResidualBlock(const State& state)
   information.bottomRightCorner<6, 6>() *= bias_information;
   BackendId speed_and_bias_id = changeIdType(state.id_in_graph, IdType::ImuStates);
   std::shared_ptr<SpeedAndBiasError> error = 
-    std::make_shared<SpeedAndBiasError>(speed_and_bias, information);
+    makePooled<SpeedAndBiasError>(object_pool_, speed_and_bias, information);
   graph_->addResidualBlock(error, 
     huber_loss_function_ ? huber_loss_function_.get() : nullptr,
     graph_->parameterBlockPtr(speed_and_bias_id.asInteger()));
@@ -891,6 +988,106 @@ void ImuEstimatorBase::eraseImuState(const State& state)
   imu_state_mutex_.unlock();
 }
 
+// Get IMU measurements that cover the given time range
+const ImuMeasurementVector& ImuEstimatorBase::getImuMeasurementsBetween(
+  const double start_timestamp, const double end_timestamp)
+{
+  // the query and backend threads both integrate, so each keeps its own buffer
+  static thread_local ImuMeasurementVector imu_measurements;
+  const double delay = imu_base_options_.imu_parameters.delay_imu_cam;
+  imu_measurements_.getBetween(
+    start_timestamp - delay, end_timestamp - delay, imu_measurements);
+  return imu_measurements;
+}
+
+// Get the timestamp of the n-th IMU measurement after given timestamp
+bool ImuEstimatorBase::getImuTimestampAfter(
+  const double timestamp, const int n, double& timestamp_after)
+{
+  const double delay = imu_base_options_.imu_parameters.delay_imu_cam;
+  if (!imu_measurements_.getTimestampAfter(timestamp - delay, n, timestamp_after)) {
+    return false;
+  }
+  timestamp_after += delay;
+  return true;
+}
+
+// Count and report the IMU measurements dropped by the buffer
+void ImuEstimatorBase::handleDroppedImuMeasurements(const size_t num_dropped)
+{
+  if (num_dropped == 0) {
+    if (dropping_imu_measurements_) {
+      LOG(WARNING) << "IMU buffer stopped dropping measurements. "
+        << num_dropped_imu_measurements_.load() << " dropped in total.";
+    }
+    dropping_imu_measurements_ = false;
+    return;
+  }
+
+  // warn at the start of each overflow period
+  num_dropped_imu_measurements_ += num_dropped;
+  if (!dropping_imu_measurements_) {
+    LOG(WARNING) << "IMU buffer is full! Dropping oldest measurements. "
+      << "Consider increasing imu_buffer_capacity (now "
+      << imu_measurements_.capacity() << ").";
+  }
+  dropping_imu_measurements_ = true;
+}
+
+// Rebuild the integration checkpoints from the latest estimate
+void ImuEstimatorBase::updateImuCheckpoints()
+{
+  const int interval = imu_base_options_.propagation_checkpoint_interval;
+  if (interval <= 0) return;
+
+  // The estimates and the states are only modified by this thread, so we build the
+  // new checkpoints without locking, and only lock to swap them in
+  auto it_state = states_.rbegin();
+  while (it_state != states_.rend() && !it_state->valid()) it_state++;
+  if (it_state == states_.rend()) return;
+  const State& base_state = *it_state;
+  const bool with_covariance = need_covariance_;
+  ImuCheckpoint base;
+  base.timestamp = base_state.timestamp;
+  base.T_WS = getPoseEstimate(base_state);
+  base.speed_and_bias = getSpeedAndBiasEstimate(base_state);
+  if (with_covariance) base.covariance = getCovariance(base_state);
+  else base.covariance.setZero();
+  imu_checkpoints_update_.clear();
+  imu_checkpoints_update_.push_back(base);
+
+  // Integrate to the latest IMU measurement
+  double checkpoint_timestamp;
+  while (getImuTimestampAfter(imu_checkpoints_update_.back().timestamp, 
+         interval, checkpoint_timestamp)) {
+    ImuCheckpoint checkpoint = imu_checkpoints_update_.back();
+    checkpoint.timestamp = checkpoint_timestamp;
+    if (with_covariance) {
+      imuIntegration(imu_checkpoints_update_.back().timestamp, checkpoint.timestamp, 
+        checkpoint.T_WS, checkpoint.speed_and_bias, checkpoint.covariance);
+    }
+    else {
+      imuIntegration(imu_checkpoints_update_.back().timestamp, checkpoint.timestamp, 
+        checkpoint.T_WS, checkpoint.speed_and_bias);
+    }
+    imu_checkpoints_update_.push_back(checkpoint);
+  }
+
+  imu_state_mutex_.lock();
+  imu_checkpoints_.swap(imu_checkpoints_update_);
+  imu_checkpoints_with_covariance_ = with_covariance;
+  imu_state_mutex_.unlock();
+}
+
+// Solve current graph, with IMU pre-integrations updated beforehand if enabled
+void ImuEstimatorBase::optimize()
+{
+  if (imu_base_options_.use_first_order_bias_correction) {
+    imu_preintegration_manager_.update(graph_);
+  }
+  EstimatorBase::optimize();
+}
+
 // Down-weight IMU residual block
 void ImuEstimatorBase::downWeightImuResidualBlock(
   const ceres::ResidualBlockId residual_id, double factor)
@@ -906,32 +1103,28 @@ void ImuEstimatorBase::downWeightImuResidualBlock(
 // Get a IMU measurement near given timestamp
 ImuMeasurement ImuEstimatorBase::getImuMeasurementNear(const double timestamp) 
 {
-  imu_mutex_.lock();
-  if (timestamp <= imu_measurements_.front().timestamp) {
-    ImuMeasurement imu = imu_measurements_.front();
-    imu_mutex_.unlock();
-    return imu;
+  // the last one not after and the first one after given timestamp
+  static thread_local ImuMeasurementVector imu_measurements;
+  imu_measurements_.getBetween(timestamp, timestamp, imu_measurements);
+  CHECK(imu_measurements.size() > 0);
+  if (timestamp <= imu_measurements.front().timestamp) {
+    return imu_measurements.front();
   }
-  if (timestamp >= imu_measurements_.back().timestamp) {
-    ImuMeasurement imu = imu_measurements_.back();
-    imu_mutex_.unlock();
-    return imu;
+  if (timestamp >= imu_measurements.back().timestamp) {
+    return imu_measurements.back();
   }
 
-  for (size_t i = 1; i < imu_measurements_.size(); i++) {
-    ImuMeasurement last_imu = imu_measurements_[i - 1];
-    ImuMeasurement cur_imu = imu_measurements_[i];
+  for (size_t i = 1; i < imu_measurements.size(); i++) {
+    const ImuMeasurement& last_imu = imu_measurements[i - 1];
+    const ImuMeasurement& cur_imu = imu_measurements[i];
     double last_dt = last_imu.timestamp - timestamp;
     double cur_dt = cur_imu.timestamp - timestamp;
     if (cur_dt > 0.0 && last_dt <= 0.0) {
-      imu_mutex_.unlock();
       return (fabs(cur_dt) > fabs(last_dt)) ? last_imu : cur_imu;
     }
   }
 
-  ImuMeasurement imu = imu_measurements_.back();
-  imu_mutex_.unlock();
-  return imu;
+  return imu_measurements.back();
 }
 
 }
\ No newline at end of file
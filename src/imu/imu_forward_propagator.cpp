@@ -0,0 +1,141 @@
+/**
+* @Function: Forward IMU propagation for low-latency outputs
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#include "gici/imu/imu_forward_propagator.h"
+
+#include <algorithm>
+
+#include "gici/imu/imu_common.h"
+#include "gici/imu/imu_error.h"
+
+namespace gici {
+
+namespace {
+
+// Maximum duration of buffered IMU measurements for replaying (s)
+constexpr double kMaxBufferDuration = 5.0;
+
+}
+
+// The default constructor
+ImuForwardPropagator::ImuForwardPropagator(
+  const ImuEstimatorBaseOptions& options, const bool propagate_covariance) :
+  options_(options), propagate_covariance_(propagate_covariance)
+{}
+
+// The default destructor
+ImuForwardPropagator::~ImuForwardPropagator()
+{}
+
+// Set the latest backend solution as base state
+void ImuForwardPropagator::setBaseState(
+  const Solution& solution, const double gravity)
+{
+  std::shared_ptr<BaseState> base_state = std::allocate_shared<BaseState>(
+    Eigen::aligned_allocator<BaseState>());
+  base_state->solution = solution;
+  base_state->gravity = gravity;
+  if (!propagate_covariance_) base_state->solution.covariance.setZero();
+  std::atomic_store(&base_state_, std::shared_ptr<const BaseState>(base_state));
+}
+
+// Drop the base state
+void ImuForwardPropagator::reset()
+{
+  std::atomic_store(&base_state_, std::shared_ptr<const BaseState>());
+}
+
+// Integrate a raw IMU measurement and get the propagated solution
+bool ImuForwardPropagator::propagate(
+  const ImuMeasurement& imu_measurement, Solution& solution)
+{
+  // Buffer measurement in body frame
+  if (imu_measurements_.size() > 0 &&
+      imu_measurements_.back().timestamp >= imu_measurement.timestamp) {
+    return false;
+  }
+  ImuMeasurement imu = imu_measurement;
+  imu.angular_velocity =
+    ImuEstimatorBase::rotateImuToBody(imu.angular_velocity, options_);
+  imu.linear_acceleration =
+    ImuEstimatorBase::rotateImuToBody(imu.linear_acceleration, options_);
+  imu_measurements_.push_back(imu);
+  while (imu_measurements_.front().timestamp <
+         imu.timestamp - kMaxBufferDuration) {
+    imu_measurements_.pop_front();
+  }
+
+  // Take the latest base state
+  std::shared_ptr<const BaseState> base_state = std::atomic_load(&base_state_);
+  if (base_state == nullptr) {
+    used_base_state_ = nullptr; return false;
+  }
+
+  // Replay from a new base state
+  const double delay = options_.imu_parameters.delay_imu_cam;
+  if (base_state != used_base_state_) {
+    const double base_timestamp = base_state->solution.timestamp;
+    if (imu_measurements_.front().timestamp > base_timestamp - delay) {
+      LOG(WARNING) << "Forward propagator has no IMU measurement at base state "
+                   << std::fixed << base_timestamp << "!";
+      used_base_state_ = nullptr; return false;
+    }
+    // the ones before base state are not needed anymore
+    while (imu_measurements_.size() > 1 &&
+           imu_measurements_[1].timestamp <= base_timestamp - delay) {
+      imu_measurements_.pop_front();
+    }
+    used_base_state_ = base_state;
+    options_.imu_parameters.g = base_state->gravity;
+    state_ = base_state->solution;
+  }
+  if (used_base_state_ == nullptr) return false;
+
+  // Integrate to current measurement
+  if (imu.timestamp < state_.timestamp) return false;
+  integrate(imu.timestamp);
+  solution = state_;
+
+  return true;
+}
+
+// Integrate current state to given timestamp with buffered measurements
+void ImuForwardPropagator::integrate(const double timestamp)
+{
+  if (checkEqual(timestamp, state_.timestamp)) return;
+
+  // Take the measurements that cover the time range
+  const double delay = options_.imu_parameters.delay_imu_cam;
+  auto compare = [](const double t, const ImuMeasurement& imu)
+    { return t < imu.timestamp; };
+  auto begin = std::upper_bound(imu_measurements_.begin(),
+    imu_measurements_.end(), state_.timestamp - delay, compare);
+  if (begin != imu_measurements_.begin()) begin--;
+  auto end = std::upper_bound(begin, imu_measurements_.end(),
+    timestamp - delay, compare);
+  if (end != imu_measurements_.end()) end++;
+  // copied into a kept buffer, so that no allocation is done per sample
+  integration_measurements_.assign(begin, end);
+
+  // Integrate
+  if (propagate_covariance_) {
+    Eigen::Matrix<double, 15, 15> delta_P, F;
+    ImuError::propagation(integration_measurements_, options_.imu_parameters,
+      state_.pose, state_.speed_and_bias, state_.timestamp, timestamp, &delta_P, &F);
+    transformImuCovariance(F, state_.covariance);
+    state_.covariance += delta_P;
+  }
+  else {
+    ImuError::propagation(integration_measurements_, options_.imu_parameters,
+      state_.pose, state_.speed_and_bias, state_.timestamp, timestamp);
+  }
+  state_.pose.getRotation().normalize();
+  state_.timestamp = timestamp;
+}
+
+}
@@ -0,0 +1,70 @@
+/**
+* @Function: Parallel pre-integration of the IMU error terms in a window
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#include "gici/imu/imu_preintegration_manager.h"
+
+#include <algorithm>
+#include <glog/logging.h>
+
+namespace gici {
+
+// The default constructor
+ImuPreintegrationManager::ImuPreintegrationManager(const int num_threads) :
+  num_tasks_(num_threads > 1 ? num_threads : 1)
+{
+  if (num_threads > 1) {
+    thread_pool_ = std::make_shared<ThreadPool>(num_threads - 1);
+  }
+}
+
+// The default destructor
+ImuPreintegrationManager::~ImuPreintegrationManager()
+{}
+
+// Redo the pre-integrations that need it
+size_t ImuPreintegrationManager::update(const std::shared_ptr<Graph>& graph)
+{
+  items_.clear();
+  for (const auto& it : graph->residualBlockIdToResidualBlockSpecMap()) {
+    if (it.second.error_interface_ptr->typeInfo() != ErrorType::kIMUError) continue;
+    const Graph::ParameterBlockCollection& parameters =
+      graph->parameterCollection(it.first);
+    CHECK(parameters.size() == 4);
+    Item item;
+    item.imu_error = std::dynamic_pointer_cast<ImuError>(it.second.error_interface_ptr);
+    item.speed_and_bias =
+      Eigen::Map<const SpeedAndBias>(parameters[1].second->parameters());
+    item.redone = false;
+    items_.push_back(item);
+  }
+  if (items_.size() == 0) return 0;
+
+  // each task takes interleaved items, as the newest ones are usually not integrated
+  const size_t num_tasks = std::min(num_tasks_, items_.size());
+  auto relinearize = [this, num_tasks](const size_t begin) {
+    for (size_t i = begin; i < items_.size(); i += num_tasks) {
+      items_[i].redone = items_[i].imu_error->relinearize(
+        Transformation(), items_[i].speed_and_bias);
+    }
+  };
+  if (thread_pool_ == nullptr || num_tasks == 1) relinearize(0);
+  else {
+    std::vector<std::function<void()>> tasks;
+    for (size_t i = 0; i < num_tasks; i++) {
+      tasks.push_back([&relinearize, i]() { relinearize(i); });
+    }
+    thread_pool_->run(tasks);
+  }
+
+  size_t num_redone = 0;
+  for (const auto& item : items_) if (item.redone) num_redone++;
+  items_.clear();
+  return num_redone;
+}
+
+}
@@ -0,0 +1,108 @@
+/**
+* @Function: Combine high-rate IMU samples into coning and sculling compensated increments
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#include "gici/imu/imu_presummator.h"
+
+#include <glog/logging.h>
+#include <Eigen/Geometry>
+
+namespace gici {
+
+namespace {
+
+// Maximum gap between raw measurements, in number of combined intervals
+constexpr double kMaxGapIntervals = 5.0;
+
+}
+
+// The default constructor
+ImuPresummator::ImuPresummator(const double rate)
+{
+  CHECK(rate > 0.0);
+  interval_ = 1.0 / rate;
+  reset();
+}
+
+// The default destructor
+ImuPresummator::~ImuPresummator()
+{}
+
+// Add a raw measurement
+bool ImuPresummator::add(
+  const ImuMeasurement& measurement, ImuMeasurement& combined)
+{
+  if (!has_last_) {
+    last_ = measurement; has_last_ = true;
+    restart(); return false;
+  }
+
+  // Check time gap
+  const double dt = measurement.timestamp - last_.timestamp;
+  if (dt <= 0.0 || dt > kMaxGapIntervals * interval_) {
+    LOG(WARNING) << "IMU pre-summation restarted because of time gap "
+                 << std::fixed << dt << "s!";
+    last_ = measurement;
+    restart(); return false;
+  }
+
+  // Increments of current raw interval, trapezoidal as the pre-integration
+  const Eigen::Vector3d d_angle =
+    0.5 * (last_.angular_velocity + measurement.angular_velocity) * dt;
+  const Eigen::Vector3d d_velocity =
+    0.5 * (last_.linear_acceleration + measurement.linear_acceleration) * dt;
+
+  // Coning and sculling with increments before current one
+  coning_ += 0.5 * delta_angle_.cross(d_angle);
+  sculling_ += 0.5 * (delta_angle_.cross(d_velocity) +
+                      delta_velocity_.cross(d_angle));
+  delta_angle_ += d_angle;
+  delta_velocity_ += d_velocity;
+  last_ = measurement;
+
+  // Wait until the interval is filled, closing it at the nearest raw measurement
+  const double duration = measurement.timestamp - start_timestamp_;
+  if (duration < interval_ - 0.5 * dt) return false;
+
+  // Rotation vector and velocity increment in the body frame at start
+  const Eigen::Vector3d phi = delta_angle_ + coning_;
+  Eigen::Vector3d delta_velocity = delta_velocity_ +
+    0.5 * delta_angle_.cross(delta_velocity_) + sculling_;
+
+  // Rotate velocity increment to the body frame at the middle
+  const double angle = phi.norm();
+  if (angle > 0.0) {
+    delta_velocity =
+      Eigen::AngleAxisd(-0.5 * angle, phi / angle).toRotationMatrix() * delta_velocity;
+  }
+
+  combined.timestamp = start_timestamp_ + 0.5 * duration;
+  combined.angular_velocity = phi / duration;
+  combined.linear_acceleration = delta_velocity / duration;
+
+  restart();
+  return true;
+}
+
+// Drop the current increments
+void ImuPresummator::reset()
+{
+  has_last_ = false;
+  restart();
+}
+
+// Clear increments and start a new interval from the last measurement
+void ImuPresummator::restart()
+{
+  start_timestamp_ = has_last_ ? last_.timestamp : 0.0;
+  delta_angle_.setZero();
+  delta_velocity_.setZero();
+  coning_.setZero();
+  sculling_.setZero();
+}
+
+}
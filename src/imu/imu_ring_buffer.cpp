@@ -0,0 +1,259 @@
+/**
+* @Function: Fixed-capacity IMU measurement buffer with lock-free readers
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#include "gici/imu/imu_ring_buffer.h"
+
+#include <cstring>
+#include <thread>
+#include <glog/logging.h>
+
+namespace gici {
+
+// The default constructor
+ImuRingBuffer::ImuRingBuffer(const size_t capacity)
+{
+  size_t size = 1;
+  while (size < capacity) size <<= 1;
+  buffer_.reset(new std::atomic<uint64_t>[size * kSlotWords]);
+  for (size_t i = 0; i < size * kSlotWords; i++) {
+    buffer_[i].store(0, std::memory_order_relaxed);
+  }
+  mask_ = size - 1;
+}
+
+// The default destructor
+ImuRingBuffer::~ImuRingBuffer()
+{}
+
+// Append a measurement
+size_t ImuRingBuffer::pushBack(const ImuMeasurement& measurement)
+{
+  return pushBack(&measurement, 1);
+}
+
+// Append measurements in one modification
+size_t ImuRingBuffer::pushBack(
+  const ImuMeasurement *measurements, const size_t size)
+{
+  if (size == 0) return 0;
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  uint64_t head = head_.load(std::memory_order_relaxed);
+  uint64_t tail = tail_.load(std::memory_order_relaxed);
+  size_t num_dropped = 0;
+  beginWrite();
+  for (size_t i = 0; i < size; i++) {
+    if (tail - head == capacity()) {
+      head++; num_dropped++;
+    }
+    storeSlot(tail++, measurements[i]);
+  }
+  head_.store(head, std::memory_order_relaxed);
+  tail_.store(tail, std::memory_order_relaxed);
+  endWrite();
+  return num_dropped;
+}
+
+// Prepend a measurement
+bool ImuRingBuffer::pushFront(const ImuMeasurement& measurement)
+{
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  const uint64_t head = head_.load(std::memory_order_relaxed);
+  const uint64_t tail = tail_.load(std::memory_order_relaxed);
+  if (tail - head == capacity()) {
+    LOG(WARNING) << "IMU buffer is full! Unable to prepend measurement.";
+    return false;
+  }
+  // logical indexes are unsigned, so we shift the whole range when it reaches zero
+  beginWrite();
+  if (head == 0) {
+    head_.store(capacity(), std::memory_order_relaxed);
+    tail_.store(tail + capacity(), std::memory_order_relaxed);
+  }
+  const uint64_t new_head = head_.load(std::memory_order_relaxed) - 1;
+  storeSlot(new_head, measurement);
+  head_.store(new_head, std::memory_order_relaxed);
+  endWrite();
+  return true;
+}
+
+// Erase the measurements older than given timestamp
+void ImuRingBuffer::popFrontBefore(const double timestamp)
+{
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  uint64_t head = head_.load(std::memory_order_relaxed);
+  const uint64_t tail = tail_.load(std::memory_order_relaxed);
+  while (head < tail && loadTimestamp(head) < timestamp) head++;
+  if (head == head_.load(std::memory_order_relaxed)) return;
+  // the slots are not overwritten, only the head index is moved
+  beginWrite();
+  head_.store(head, std::memory_order_relaxed);
+  endWrite();
+}
+
+// Number of measurements
+size_t ImuRingBuffer::size() const
+{
+  size_t size;
+  read([this, &size] {
+    size = tail_.load(std::memory_order_relaxed) -
+           head_.load(std::memory_order_relaxed);
+  });
+  return size;
+}
+
+// Get the oldest measurement in one read
+bool ImuRingBuffer::tryFront(ImuMeasurement& measurement) const
+{
+  bool valid;
+  read([this, &measurement, &valid] {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    valid = head != tail_.load(std::memory_order_relaxed);
+    if (valid) measurement = loadSlot(head);
+  });
+  return valid;
+}
+
+// Get the latest measurement in one read
+bool ImuRingBuffer::tryBack(ImuMeasurement& measurement) const
+{
+  bool valid;
+  read([this, &measurement, &valid] {
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    valid = head_.load(std::memory_order_relaxed) != tail;
+    if (valid) measurement = loadSlot(tail - 1);
+  });
+  return valid;
+}
+
+// Copy all measurements
+void ImuRingBuffer::getAll(ImuMeasurementVector& measurements) const
+{
+  read([this, &measurements] {
+    measurements.clear();
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    // inconsistent indexes of an interfered read, will be retried
+    if (tail - head > capacity()) return;
+    for (uint64_t i = head; i < tail; i++) measurements.push_back(loadSlot(i));
+  });
+}
+
+// Copy the measurements that cover the given time range
+void ImuRingBuffer::getBetween(const double start_timestamp, 
+  const double end_timestamp, ImuMeasurementVector& measurements) const
+{
+  read([this, &measurements, start_timestamp, end_timestamp] {
+    measurements.clear();
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head > capacity()) return;
+    uint64_t begin = upperBound(head, tail, start_timestamp);
+    if (begin != head) begin--;
+    uint64_t end = upperBound(begin, tail, end_timestamp);
+    if (end != tail) end++;
+    for (uint64_t i = begin; i < end; i++) measurements.push_back(loadSlot(i));
+  });
+}
+
+// Get the timestamp of the n-th measurement after given timestamp
+bool ImuRingBuffer::getTimestampAfter(
+  const double timestamp, const size_t n, double& timestamp_after) const
+{
+  CHECK(n > 0);
+  bool valid;
+  read([this, &valid, &timestamp_after, timestamp, n] {
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    const uint64_t index = upperBound(
+      head_.load(std::memory_order_relaxed), tail, timestamp) + n - 1;
+    valid = index < tail;
+    if (valid) timestamp_after = loadTimestamp(index);
+  });
+  return valid;
+}
+
+// First logical index in [begin, end) whose timestamp is larger than given one
+uint64_t ImuRingBuffer::upperBound(
+  uint64_t begin, uint64_t end, const double timestamp) const
+{
+  while (begin < end) {
+    const uint64_t middle = begin + (end - begin) / 2;
+    if (timestamp < loadTimestamp(middle)) end = middle;
+    else begin = middle + 1;
+  }
+  return begin;
+}
+
+// Store a measurement to the slot of a logical index
+void ImuRingBuffer::storeSlot(
+  const uint64_t index, const ImuMeasurement& measurement)
+{
+  const double values[kSlotWords] = {measurement.timestamp,
+    measurement.angular_velocity(0), measurement.angular_velocity(1),
+    measurement.angular_velocity(2), measurement.linear_acceleration(0),
+    measurement.linear_acceleration(1), measurement.linear_acceleration(2)};
+  std::atomic<uint64_t> *words = &buffer_[(index & mask_) * kSlotWords];
+  for (size_t i = 0; i < kSlotWords; i++) {
+    uint64_t word;
+    memcpy(&word, &values[i], sizeof(word));
+    words[i].store(word, std::memory_order_relaxed);
+  }
+}
+
+// Load the measurement in the slot of a logical index
+ImuMeasurement ImuRingBuffer::loadSlot(const uint64_t index) const
+{
+  ImuMeasurement measurement;
+  measurement.timestamp = loadWord(index, 0);
+  for (size_t i = 0; i < 3; i++) {
+    measurement.angular_velocity(i) = loadWord(index, 1 + i);
+    measurement.linear_acceleration(i) = loadWord(index, 4 + i);
+  }
+  return measurement;
+}
+
+// Load a word of the slot of a logical index
+double ImuRingBuffer::loadWord(const uint64_t index, const size_t word) const
+{
+  const uint64_t bits = buffer_[(index & mask_) * kSlotWords + word].load(
+    std::memory_order_relaxed);
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Run a read operation until no writer interfered
+template<typename Function>
+void ImuRingBuffer::read(Function&& function) const
+{
+  while (true) {
+    const uint64_t sequence = sequence_.load(std::memory_order_acquire);
+    if (sequence & 1) {
+      std::this_thread::yield(); continue;
+    }
+    function();
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence_.load(std::memory_order_relaxed) == sequence) return;
+  }
+}
+
+// Mark the begin of a modification
+void ImuRingBuffer::beginWrite()
+{
+  sequence_.store(sequence_.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+// Mark the end of a modification
+void ImuRingBuffer::endWrite()
+{
+  sequence_.store(sequence_.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_release);
+}
+
+}
@@ -464,6 +464,11 @@ void ImuDataIntegration::dataCallback(
     handleIMU(input_tag, data->imu);
     mutex_.unlock();
   }
+  if (data->imu_batch && valid_) {
+    mutex_.lock();
+    handleIMUBatch(input_tag, data->imu_batch);
+    mutex_.unlock();
+  }
 }
 
 // Handle IMU data
@@ -471,9 +476,65 @@ void ImuDataIntegration::handleIMU(const std::string& formator_tag,
                 const std::shared_ptr<DataCluster::IMU>& imu)
 {
   // Get role
+  ImuRole role;
+  if (!getRole(formator_tag, role)) return;
+
+  // Convert IMU data
+  ImuMeasurement epoch(imu->time, 
+    Eigen::Map<Eigen::Vector3d>(imu->angular_velocity), 
+    Eigen::Map<Eigen::Vector3d>(imu->acceleration));
+
+  // Combine raw samples
+  if (presummation_rate_ > 0.0) {
+    ImuMeasurement combined;
+    if (!getPresummator(formator_tag)->add(epoch, combined)) return;
+    epoch = combined;
+  }
+
+  // Call INS processor
+  for (auto it_imu_callback : estimator_callbacks_) {
+    EstimatorDataCluster estimator_data(
+      epoch, role, formator_tag.substr(4, formator_tag.size() - 4));
+    it_imu_callback(estimator_data);
+  }
+}
+
+// Handle IMU data batch
+void ImuDataIntegration::handleIMUBatch(const std::string& formator_tag, 
+                const ImuMeasurementBatchPtr& imu_batch)
+{
+  // Get role
+  ImuRole role;
+  if (!getRole(formator_tag, role)) return;
+
+  // Combine raw samples
+  ImuMeasurementBatchPtr batch = imu_batch;
+  if (presummation_rate_ > 0.0) {
+    const ImuPresummatorPtr& presummator = getPresummator(formator_tag);
+    batch = makePooled<ImuMeasurementBatch>(batch_pool_);
+    ImuMeasurement combined;
+    for (int i = 0; i < imu_batch->size; i++) {
+      if (presummator->add(imu_batch->measurements[i], combined)) {
+        batch->push_back(combined);
+      }
+    }
+  }
+  if (batch->size == 0) return;
+
+  // Call INS processor. The batch is shared by all estimators without copying.
+  for (auto it_imu_callback : estimator_callbacks_) {
+    EstimatorDataCluster estimator_data(
+      batch, role, formator_tag.substr(4, formator_tag.size() - 4));
+    it_imu_callback(estimator_data);
+  }
+}
+
+// Get role of IMU formator
+bool ImuDataIntegration::getRole(const std::string& formator_tag, ImuRole& role)
+{
   if (behaviors_.find(formator_tag) == behaviors_.end()) {
     LOG(ERROR) << "Formator tag " << formator_tag << " not registered!";
-    return;
+    return false;
   }
   std::vector<ImuRole> roles;
   bool has_major = false;
@@ -482,7 +543,7 @@ void ImuDataIntegration::handleIMU(const std::string& formator_tag,
     option_tools::convert(behaviors_.at(formator_tag)[i], roles[i]);
     if (roles[i] == ImuRole::Minor) {
       LOG(WARNING) << "We do not support multiple IMUs currently!";
-      return;
+      return false;
     }
     if (roles[i] == ImuRole::Major) has_major = true;
   }
@@ -491,20 +552,22 @@ void ImuDataIntegration::handleIMU(const std::string& formator_tag,
   }
   else if (roles.size() == 0) {
     LOG(ERROR) << "No role for current IMU was specified!";
-    return;
+    return false;
   }
+  role = roles[0];
+  return true;
+}
 
-  // Convert IMU data
-  ImuMeasurement epoch(imu->time, 
-    Eigen::Map<Eigen::Vector3d>(imu->angular_velocity), 
-    Eigen::Map<Eigen::Vector3d>(imu->acceleration));
-
-  // Call INS processor
-  for (auto it_imu_callback : estimator_callbacks_) {
-    EstimatorDataCluster estimator_data(
-      epoch, roles[0], formator_tag.substr(4, formator_tag.size() - 4));
-    it_imu_callback(estimator_data);
+// Get pre-summator of IMU formator
+const ImuPresummatorPtr& ImuDataIntegration::getPresummator(
+  const std::string& formator_tag)
+{
+  auto it = presummators_.find(formator_tag);
+  if (it == presummators_.end()) {
+    it = presummators_.insert(std::make_pair(formator_tag, 
+      std::make_shared<ImuPresummator>(presummation_rate_))).first;
   }
+  return it->second;
 }
 
 // Data callback
@@ -455,7 +455,7 @@ int RTCM2Formator::decode(const uint8_t *buf, int size,
 }
 
 // Encode data to stream
-int RTCM2Formator::encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf)
+int RTCM2Formator::encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size)
 {
   LOG(ERROR) << "RTCM2 Encoding not supported!";
   return 0;
@@ -550,7 +550,7 @@ int RTCM3Formator::decode(const uint8_t *buf, int size,
 
 // Encode data to stream
 int RTCM3Formator::encode(
-  const std::shared_ptr<DataCluster>& data, uint8_t *buf)
+  const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size)
 {
 #if 0  // not finished yet
   // Check the control structure
@@ -705,7 +705,7 @@ int GnssRawFormator::decode(const uint8_t *buf, int size,
 }
 
 // Encode data to stream
-int GnssRawFormator::encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf)
+int GnssRawFormator::encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size)
 {
   LOG(ERROR) << "GNSS-Raw Encoding not supported!";
   return 0;
@@ -755,7 +755,7 @@ int ImageV4L2Formator::decode(const uint8_t *buf, int size,
 }
 
 // Encode data to stream
-int ImageV4L2Formator::encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf)
+int ImageV4L2Formator::encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size)
 {
   LOG(ERROR) << "Image-V4L2 Encoding not supported!";
   return 0;
@@ -824,7 +824,7 @@ int ImagePackFormator::decode(const uint8_t *buf, int size,
 
 // Encode data to stream
 int ImagePackFormator::encode(
-    const std::shared_ptr<DataCluster>& data, uint8_t *buf)
+    const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size)
 {
   img_t *image;
   init_img(image, data->image->width, data->image->height, data->image->step);
@@ -847,6 +847,7 @@ IMUPackFormator::IMUPackFormator(Option& option)
   type_ = FormatorType::IMUPack;
 
   init_imu(&imu_);
+  batch_pool_ = std::make_shared<ObjectPool>();
 }
 
 IMUPackFormator::IMUPackFormator(YAML::Node& node)
@@ -854,6 +855,7 @@ IMUPackFormator::IMUPackFormator(YAML::Node& node)
   type_ = FormatorType::IMUPack;
 
   init_imu(&imu_);
+  batch_pool_ = std::make_shared<ObjectPool>();
 }
 
 IMUPackFormator::~IMUPackFormator()
@@ -865,47 +867,74 @@ IMUPackFormator::~IMUPackFormator()
 int IMUPackFormator::decode(const uint8_t *buf, int size, 
     std::vector<std::shared_ptr<DataCluster>>& data)
 {
-  int n_data = 0;
+  // All measurements in this read are put into one batch
+  static_assert(MaxDataSize::IMUPack <= ImuMeasurementBatch::Capacity, 
+    "IMU batch cannot hold max data length!");
   data.clear();
+  ImuMeasurementBatchPtr batch;
   for (int i = 0; i < size; i++) {
     int ret = input_imu(&imu_, buf[i]);
     if (ret <= 0) continue;
 
-    std::shared_ptr<DataCluster> data_ptr;
-    data_ptr = std::make_shared<DataCluster>(FormatorType::IMUPack);
-    data_ptr->imu->time = gnss_common::gtimeToDouble(imu_.time);
-    for (int k = 0; k < 3; k++) {
-      data_ptr->imu->acceleration[k] = imu_.acc[k];
-      data_ptr->imu->angular_velocity[k] = imu_.gyro[k];
-    }
-    data.push_back(data_ptr);
+    if (batch == nullptr) batch = makePooled<ImuMeasurementBatch>(batch_pool_);
+    batch->push_back(ImuMeasurement(gnss_common::gtimeToDouble(imu_.time), 
+      Eigen::Map<Eigen::Vector3d>(imu_.gyro), Eigen::Map<Eigen::Vector3d>(imu_.acc)));
 
-    if (++n_data >= MaxDataSize::IMUPack) {
+    if (batch->size >= MaxDataSize::IMUPack) {
       LOG(WARNING) << "Max data length surpassed!";
       break;
     }
   }
+  if (batch == nullptr) return 0;
 
-  return n_data;
+  data.push_back(std::make_shared<DataCluster>(batch));
+  return 1;
 }
 
 // Encode data to stream
-int IMUPackFormator::encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf)
-{
-  imu_t *imu;
-  init_imu(imu);
-  imu->time = gnss_common::doubleToGtime(data->imu->time);
-  for (int i = 0; i < 3; i++) {
-    imu->acc[i] = data->imu->acceleration[i];
-    imu->gyro[i] = data->imu->angular_velocity[i];
+int IMUPackFormator::encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size)
+{
+  imu_t imu;
+  init_imu(&imu);
+  // returns -1 if the remaining buffer can not hold the message
+  auto encodeOne = [&imu](const double time, const double *acc, 
+                          const double *gyro, uint8_t *buf, int size) {
+    imu.time = gnss_common::doubleToGtime(time);
+    for (int i = 0; i < 3; i++) {
+      imu.acc[i] = acc[i];
+      imu.gyro[i] = gyro[i];
+    }
+    if (!gen_imu(&imu)) return 0;
+    if (imu.nbyte > size) return -1;
+    memcpy(buf, imu.buff, imu.nbyte);
+    return imu.nbyte;
+  };
+
+  int nbyte = 0;
+  if (data->imu) {
+    nbyte = encodeOne(data->imu->time, 
+      data->imu->acceleration, data->imu->angular_velocity, buf, size);
+    if (nbyte < 0) {
+      LOG(WARNING) << "IMU pack: Buffer overflow! Message dropped.";
+      nbyte = 0;
+    }
   }
-
-  if (!gen_imu(imu)) return 0;
-
-  memcpy(buf, imu->buff, imu->nbyte);
-  int nbyte = imu->nbyte;
-  free_imu(imu);
-  return imu->nbyte;
+  else if (data->imu_batch) {
+    for (int i = 0; i < data->imu_batch->size; i++) {
+      const ImuMeasurement& measurement = data->imu_batch->measurements[i];
+      int n = encodeOne(measurement.timestamp, measurement.linear_acceleration.data(), 
+        measurement.angular_velocity.data(), buf + nbyte, size - nbyte);
+      if (n < 0) {
+        LOG(WARNING) << "IMU pack: Buffer overflow! Dropped " 
+          << data->imu_batch->size - i << " of " << data->imu_batch->size 
+          << " measurements in batch.";
+        break;
+      }
+      nbyte += n;
+    }
+  }
+  free_imu(&imu);
+  return nbyte;
 }
 
 // Option pack --------------------------------------------------
@@ -932,7 +961,7 @@ int OptionFormator::decode(const uint8_t *buf, int size,
 }
 
 // Encode data to stream
-int OptionFormator::encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf)
+int OptionFormator::encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size)
 {
   return 0;
 }
@@ -973,7 +1002,7 @@ int NmeaFormator::decode(const uint8_t *buf, int size,
 }
 
 // Encode data to stream
-int NmeaFormator::encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf)
+int NmeaFormator::encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size)
 {
   if (data->solution == nullptr) return 0;
 
@@ -1324,7 +1353,7 @@ int DcbFileFormator::decode(const uint8_t *buf, int size,
 }
 
 // Encode data to stream
-int DcbFileFormator::encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf)
+int DcbFileFormator::encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size)
 {
   LOG(ERROR) << "DCB file encoding not supported!";
 
@@ -1464,7 +1493,7 @@ int AtxFileFormator::decode(const uint8_t *buf, int size,
 }
 
 // Encode data to stream
-int AtxFileFormator::encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf)
+int AtxFileFormator::encode(const std::shared_ptr<DataCluster>& data, uint8_t *buf, int size)
 {
   LOG(ERROR) << "ATX file encoding not supported!";
 
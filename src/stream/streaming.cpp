@@ -236,7 +236,7 @@ void Streaming::pipelineConvertCallback(
 
   // Encode
   mutex_logging_.lock();
-  buf_size_logging_ = formator->encode(data, buf_logging_);
+  buf_size_logging_ = formator->encode(data, buf_logging_, max_buf_size_);
   need_logging_ = true;
   mutex_logging_.unlock();
 }
@@ -267,7 +267,7 @@ void Streaming::outputDataCallback(
   // Encode according to solution types
   bool no_valid = false;
   if (data->solution) {
-    buf_size_output_ = formator->encode(data, buf_output_);
+    buf_size_output_ = formator->encode(data, buf_output_, max_buf_size_);
   }
   else {
     no_valid = true;
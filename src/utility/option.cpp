@@ -224,6 +224,15 @@ void convert<std::string, ceres::TrustRegionStrategyType>
   LOG_INVALId;
 }
 
+template <>
+void convert<std::string, GraphSolverType>
+  (const std::string& in, GraphSolverType& out)
+{
+  MAP_IN_OUT("ceres", GraphSolverType::Ceres);
+  MAP_IN_OUT("gauss_newton", GraphSolverType::GaussNewton);
+  LOG_INVALId;
+}
+
 // Mapping from in to return
 #define MAP_IN_RET(x, y) if (in == x) { return y; }
 
@@ -470,6 +479,10 @@ void loadOptions<AmbiguityResolutionOptions>(
   LOAD_COMMON(min_percentage_fixation_wl);
   LOAD_COMMON(min_percentage_fixation_uwl);
   LOAD_COMMON(ratio);
+  LOAD_COMMON(use_incremental_partial_ar);
+  LOAD_COMMON(num_threads);
+  LOAD_COMMON(max_time);
+  LOAD_COMMON(dump_path);
 
   std::vector<std::string> system_excludes;
   bool has_glonass = false;
@@ -592,6 +605,7 @@ void loadOptions<FeatureHandlerOptions>(
   LOAD_COMMON(min_disparity_init_landmark);
   LOAD_COMMON(min_translation_init_landmark);
   LOAD_COMMON(min_parallax_angle_init_landmark);
+  LOAD_COMMON(num_detection_threads);
 
   if (checkSubOption(node, "detector")) {
     YAML::Node subnode = node["detector"];
@@ -625,6 +639,17 @@ void loadOptions<EstimatorBaseOptions>(
   LOAD_COMMON(force_initial_global_position);
   LOAD_COMMON(log_intermediate_data);
   LOAD_COMMON(log_intermediate_data_directory);
+  LOAD_COMMON(benchmark_graph_solver);
+  LOAD_COMMON(incremental_ordering);
+  LOAD_COMMON(block_sparse_marginalization);
+  LOAD_COMMON(square_root_marginalization);
+  LOAD_COMMON(use_object_pool);
+
+  std::string graph_solver_type;
+  if (option_tools::safeGet(node, "graph_solver_type", &graph_solver_type)) {
+    delete_space(graph_solver_type);
+    convert(graph_solver_type, options.graph_solver_type);
+  }
 
   std::string solver_type;
   if (option_tools::safeGet(node, "solver_type", &solver_type)) {
@@ -671,12 +696,18 @@ void loadOptions<GnssEstimatorBaseOptions>(
   LOAD_COMMON(max_pesudorange_error);
   LOAD_COMMON(max_phaserange_error);
   LOAD_COMMON(max_doppler_error);
+  LOAD_COMMON(use_robust_fde);
+  LOAD_COMMON(robust_fde_k0);
+  LOAD_COMMON(robust_fde_k1);
   LOAD_COMMON(good_observation_min_num_satellites);
   LOAD_COMMON(good_observation_max_gdop);
   LOAD_COMMON(good_observation_max_reject_ratio);
   LOAD_COMMON(reset_ambiguity_min_num_continuous_unfix);
   LOAD_COMMON(diverge_max_reject_ratio);
   LOAD_COMMON(diverge_min_num_continuous_reject);
+  LOAD_COMMON(use_correction_cache);
+  LOAD_COMMON(correction_cache_tolerance);
+  LOAD_COMMON(use_batched_pseudorange);
 
   if (checkSubOption(node, "gnss_common")) {
     YAML::Node subnode = node["gnss_common"];
@@ -713,6 +744,12 @@ void loadOptions<ImuEstimatorBaseOptions>(
   LOAD_COMMON(zupt_sigma_zero_velocity);
   LOAD_COMMON(car_motion_min_velocity);
   LOAD_COMMON(car_motion_max_anguler_velocity);
+  LOAD_COMMON(use_first_order_bias_correction);
+  LOAD_COMMON(relinearization_gyro_threshold);
+  LOAD_COMMON(relinearization_acc_threshold);
+  LOAD_COMMON(propagation_checkpoint_interval);
+  LOAD_COMMON(imu_buffer_capacity);
+  LOAD_COMMON(use_forward_propagation);
 
   if (checkSubOption(node, "imu_parameters")) {
     YAML::Node subnode = node["imu_parameters"];
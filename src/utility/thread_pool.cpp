@@ -0,0 +1,71 @@
+/**
+* @Function: Small worker pool for parallel tasks
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#include "gici/utility/thread_pool.h"
+
+namespace gici {
+
+// The default constructor
+ThreadPool::ThreadPool(const size_t num_threads)
+{
+  for (size_t i = 0; i < num_threads; i++) {
+    threads_.push_back(std::thread(&ThreadPool::work, this));
+  }
+}
+
+// The default destructor
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  task_condition_.notify_all();
+  for (auto& thread : threads_) thread.join();
+}
+
+// Run tasks and wait until all of them finished
+void ThreadPool::run(const std::vector<std::function<void()>>& tasks)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (const auto& task : tasks) tasks_.push_back(task);
+  task_condition_.notify_all();
+
+  // help the workers and then wait for the running ones
+  while (executeOne(lock)) {}
+  done_condition_.wait(lock, [this] {
+    return tasks_.size() == 0 && num_running_ == 0; });
+}
+
+// Worker loop
+void ThreadPool::work()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    task_condition_.wait(lock, [this] { return quit_ || tasks_.size() > 0; });
+    if (quit_) return;
+    executeOne(lock);
+  }
+}
+
+// Take and execute one task of the batch
+bool ThreadPool::executeOne(std::unique_lock<std::mutex>& lock)
+{
+  if (tasks_.size() == 0) return false;
+  std::function<void()> task = std::move(tasks_.front());
+  tasks_.pop_front();
+  num_running_++;
+  lock.unlock();
+  task();
+  lock.lock();
+  num_running_--;
+  if (tasks_.size() == 0 && num_running_ == 0) done_condition_.notify_all();
+  return true;
+}
+
+}
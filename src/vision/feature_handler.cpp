@@ -15,6 +15,7 @@
 #include "gici/estimate/homogeneous_point_parameter_block.h"
 #include "gici/estimate/pose_error.h"
 #include "gici/vision/reprojection_error.h"
+#include "gici/vision/parallel_fast_detector.h"
 #include "gici/imu/imu_error.h"
 
 namespace gici {
@@ -27,8 +28,15 @@ FeatureHandler::FeatureHandler(const FeatureHandlerOptions& options,
   speed_and_bias_(SpeedAndBias::Zero()), global_scale_initialized_(false)
 {
   // initialize modules
-  detector_ = feature_detection_utils::makeDetector(
-    options.detector, cams_->getCameraShared(0));
+  if (options.num_detection_threads > 1 && 
+      options.detector.detector_type == DetectorType::kFast) {
+    detector_ = std::make_shared<ParallelFastDetector>(
+      options.detector, cams_->getCameraShared(0), options.num_detection_threads);
+  }
+  else {
+    detector_ = feature_detection_utils::makeDetector(
+      options.detector, cams_->getCameraShared(0));
+  }
   tracker_ = std::make_shared<FeatureTracker>(options.tracker);
   initializer_ = makeVisualInitializer(options.initialization, detector_, tracker_);
 
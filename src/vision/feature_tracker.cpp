@@ -15,6 +15,13 @@
 
 namespace gici {
 
+namespace {
+
+// Maximum number of frames whose LK pyramids are cached
+constexpr size_t kMaxCachedPyramids = 4;
+
+}
+
 FeatureTracker::FeatureTracker(FeatureTrackerOptions options)
 {
   CHECK(options.window_size.size() == 2);
@@ -34,13 +41,17 @@ void FeatureTracker::track(const FramePtr& ref_frame,
       ref_frame->px_vec_.col(i)[0], ref_frame->px_vec_.col(i)[1]));
   }
   
+  // Use prebuilt pyramids, so that each image is only pyramided once
+  const std::vector<cv::Mat> ref_pyramid = getPyramid(ref_frame);
+  const std::vector<cv::Mat> cur_pyramid = getPyramid(cur_frame);
+
   std::vector<unsigned char> status;
   if (options_.use_relative_rotation && 
       !checkEqual(q_cur_ref.coeffs(), Eigen::Quaterniond::Identity().coeffs())) {     // 使用先验位姿
     // Predict feature pixel using relative orientation
     predictFeatureTracking(ref_frame, cur_frame, q_cur_ref, ref_points, cur_points);  // 感觉是给光流跟踪提供了个初始值
                                                                                       // Vins里也有类似的操作，用速度给一个大概的初值
-    cv::calcOpticalFlowPyrLK(ref_frame->img_pyr_[0], cur_frame->img_pyr_[0],
+    cv::calcOpticalFlowPyrLK(ref_pyramid, cur_pyramid,
         ref_points, cur_points, status, cv::noArray(), 
         cv::Size(options_.window_size[0], options_.window_size[1]), 
         options_.max_level, 
@@ -49,7 +60,7 @@ void FeatureTracker::track(const FramePtr& ref_frame,
         cv::OPTFLOW_USE_INITIAL_FLOW);
   }
   else {
-    cv::calcOpticalFlowPyrLK(ref_frame->img_pyr_[0], cur_frame->img_pyr_[0],
+    cv::calcOpticalFlowPyrLK(ref_pyramid, cur_pyramid,
         ref_points, cur_points, status, cv::noArray(), 
         cv::Size(options_.window_size[0], options_.window_size[1]), 
         options_.max_level, 
@@ -148,4 +159,24 @@ void FeatureTracker::predictFeatureTracking(const FramePtr& ref_frame,
   }
 }
 
+// Get the LK pyramid of a frame
+std::vector<cv::Mat> FeatureTracker::getPyramid(const FramePtr& frame)
+{
+  for (auto it = pyramids_.begin(); it != pyramids_.end(); it++) {
+    if (it->frame_id != frame->id()) continue;
+    FramePyramid cached = *it;
+    pyramids_.erase(it);
+    pyramids_.push_back(cached);
+    return cached.pyramid;
+  }
+
+  FramePyramid cached;
+  cached.frame_id = frame->id();
+  cv::buildOpticalFlowPyramid(frame->img_pyr_[0], cached.pyramid, 
+    cv::Size(options_.window_size[0], options_.window_size[1]), options_.max_level);
+  if (pyramids_.size() >= kMaxCachedPyramids) pyramids_.pop_front();
+  pyramids_.push_back(cached);
+  return cached.pyramid;
+}
+
 }
\ No newline at end of file
@@ -0,0 +1,154 @@
+/**
+* @Function: FAST feature detection in parallel row bands
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#include "gici/vision/parallel_fast_detector.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <fast/fast.h>
+#include <glog/logging.h>
+
+namespace gici {
+
+namespace {
+
+// Extra rows detected around a band: 3 for the FAST circle and 1 for the
+// neighbors of the 3x3 non-maximum suppression
+constexpr int kBandMargin = 4;
+
+// Minimum number of rows of a band
+constexpr int kMinBandRows = 32;
+
+}
+
+// The default constructor
+ParallelFastDetector::ParallelFastDetector(const DetectorOptions& options,
+    const CameraPtr& cam, const int num_threads) :
+  svo::FastDetector(options, cam), num_threads_(std::max(num_threads, 1))
+{
+  if (num_threads_ > 1) {
+    thread_pool_ = std::make_shared<ThreadPool>(num_threads_ - 1);
+  }
+}
+
+// Detect features
+void ParallelFastDetector::detect(
+    const svo::ImgPyr& img_pyr,
+    const cv::Mat& mask,
+    const size_t max_n_features,
+    Keypoints& px_vec,
+    Scores& score_vec,
+    Levels& level_vec,
+    Gradients& grad_vec,
+    FeatureTypes& types_vec)
+{
+  const size_t min_level = options_.min_level;
+  const size_t max_level = options_.max_level;
+  CHECK_LE(max_level, img_pyr.size() - 1);
+
+  // Split levels into bands
+  bands_.clear();
+  for (size_t level = min_level; level <= max_level; level++) {
+    const int rows = img_pyr[level].rows;
+    const int num_bands = std::max(1, std::min(num_threads_, rows / kMinBandRows));
+    const int band_rows = (rows + num_bands - 1) / num_bands;
+    for (int row = 0; row < rows; row += band_rows) {
+      Band band;
+      band.level = level;
+      band.row_begin = row;
+      band.row_end = std::min(rows, row + band_rows);
+      bands_.push_back(band);
+    }
+  }
+
+  // Detect
+  if (thread_pool_ == nullptr) {
+    for (auto& band : bands_) detectBand(img_pyr[band.level], band);
+  }
+  else {
+    std::vector<std::function<void()>> tasks;
+    for (size_t i = 0; i < bands_.size(); i++) {
+      tasks.push_back([this, &img_pyr, i]() {
+        detectBand(img_pyr[bands_[i].level], bands_[i]);
+      });
+    }
+    thread_pool_->run(tasks);
+  }
+
+  // Merge in level and row order, a corner only replaces a strictly better one
+  // as the serial detector does
+  svo::Corners corners(
+        grid_.n_cols*grid_.n_rows,
+        svo::Corner(0, 0, options_.threshold_primary, 0, 0.0f));
+  for (const auto& band : bands_) {
+    for (const auto& best : band.best_corners) {
+      if (best.second.score > corners.at(best.first).score) {
+        corners.at(best.first) = best.second;
+      }
+    }
+  }
+  bands_.clear();
+
+  feature_detection_utils::fillFeatures(
+        corners, FeatureType::kCorner, mask, options_.threshold_primary,
+        max_n_features, px_vec, score_vec, level_vec, grad_vec, types_vec, grid_);
+
+  resetGrid();
+}
+
+// Detect FAST corners in a band and keep the best one of each cell
+void ParallelFastDetector::detectBand(const cv::Mat& img, Band& band) const
+{
+  // Detect in the band with margins, as a sub-image of the level
+  const int row_begin = std::max(0, band.row_begin - kBandMargin);
+  const int row_end = std::min(img.rows, band.row_end + kBandMargin);
+  const fast::fast_byte *data =
+    (fast::fast_byte*) img.data + row_begin * img.step;
+  const int threshold = options_.threshold_primary;
+  std::vector<fast::fast_xy> fast_corners;
+#if __SSE2__
+  fast::fast_corner_detect_10_sse2(data, img.cols, row_end - row_begin,
+    img.step, threshold, fast_corners);
+#elif HAVE_FAST_NEON
+  fast::fast_corner_detect_9_neon(data, img.cols, row_end - row_begin,
+    img.step, threshold, fast_corners);
+#else
+  fast::fast_corner_detect_10(data, img.cols, row_end - row_begin,
+    img.step, threshold, fast_corners);
+#endif
+  std::vector<int> scores, nm_corners;
+  fast::fast_corner_score_10(data, img.step,
+    fast_corners, threshold, scores);
+  fast::fast_nonmax_3x3(fast_corners, scores, nm_corners);
+
+  // Best corner of each cell, the first one wins ties as in the serial detector
+  const int scale = (1 << band.level);
+  const int maxw = img.cols - options_.border;
+  const int maxh = img.rows - options_.border;
+  std::unordered_map<size_t, size_t> cell_to_best;
+  band.best_corners.clear();
+  for (const int& i : nm_corners) {
+    const int x = fast_corners[i].x;
+    const int y = fast_corners[i].y + row_begin;
+    if (y < band.row_begin || y >= band.row_end) continue;
+    if (x < options_.border || y < options_.border || x >= maxw || y >= maxh) continue;
+    const size_t k = grid_.getCellIndex(x, y, scale);
+    if (grid_.occupancy_.at(k)) continue;
+    const svo::Corner corner(x * scale, y * scale, scores[i], band.level, 0.0f);
+    auto it = cell_to_best.find(k);
+    if (it == cell_to_best.end()) {
+      cell_to_best.insert(std::make_pair(k, band.best_corners.size()));
+      band.best_corners.push_back(std::make_pair(k, corner));
+    }
+    else if (corner.score > band.best_corners[it->second].second.score) {
+      band.best_corners[it->second].second = corner;
+    }
+  }
+}
+
+}
@@ -0,0 +1,170 @@
+/**
+* @Function: Check and time the ambiguity constraint updates against dense references
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <Eigen/Dense>
+
+#include "gici/gnss/ambiguity_common.h"
+
+using namespace gici;
+
+// Get current time
+double getCurrentTime()
+{
+  return std::chrono::duration<double>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Random covariance of ambiguities, correlated in groups as in a PPP-AR window
+Eigen::MatrixXd generateCovariance(const int n, std::mt19937& generator)
+{
+  std::normal_distribution<double> noise(0.0, 1.0);
+  const int group_size = 8;
+  Eigen::MatrixXd covariance = Eigen::MatrixXd::Zero(n, n);
+  for (int start = 0; start < n; start += group_size) {
+    const int size = std::min(group_size, n - start);
+    Eigen::MatrixXd A(size, size);
+    for (int i = 0; i < size; i++) {
+      for (int j = 0; j < size; j++) A(i, j) = noise(generator);
+    }
+    covariance.block(start, start, size, size) = A * A.transpose() * 0.01 +
+      Eigen::MatrixXd::Identity(size, size) * 0.001;
+  }
+  return covariance;
+}
+
+// Difference operator of k combinations: NL rows with 2 non-zeros and WL rows
+// with 4 non-zeros
+AmbiguityDifference generateDifference(const int k, const int n,
+                                       std::mt19937& generator)
+{
+  std::uniform_int_distribution<int> column(0, n - 1);
+  std::vector<Eigen::Triplet<double>> coefficients;
+  for (int i = 0; i < k; i++) {
+    const int num_nonzeros = (i % 2 == 0) ? 2 : 4;
+    std::vector<int> columns;
+    while (static_cast<int>(columns.size()) < num_nonzeros) {
+      const int c = column(generator);
+      if (std::find(columns.begin(), columns.end(), c) == columns.end()) {
+        columns.push_back(c);
+      }
+    }
+    for (int j = 0; j < num_nonzeros; j++) {
+      coefficients.push_back(Eigen::Triplet<double>(
+        i, columns[j], (j % 2 == 0) ? 5.0 : -5.0));
+    }
+  }
+  AmbiguityDifference difference(k, n);
+  difference.setFromTriplets(coefficients.begin(), coefficients.end());
+  return difference;
+}
+
+// Dense Kalman update with explicit inverse, as the former implementation
+void constrainAmbiguitiesDense(const Eigen::MatrixXd& J,
+                               const Eigen::VectorXd& fixed_ambiguities,
+                               const double variance,
+                               Eigen::VectorXd& ambiguities,
+                               Eigen::MatrixXd& covariance)
+{
+  Eigen::MatrixXd R = Eigen::MatrixXd::Identity(J.rows(), J.rows()) * variance;
+  Eigen::MatrixXd K = covariance * J.transpose() *
+    (J * covariance * J.transpose() + R).inverse();
+  ambiguities += K * (fixed_ambiguities - J * ambiguities);
+  covariance = (Eigen::MatrixXd::Identity(J.cols(), J.cols()) - K * J) * covariance;
+}
+
+int main(int argc, char** argv)
+{
+  const int n = argc > 1 ? atoi(argv[1]) : 120;
+  const int k = argc > 2 ? atoi(argv[2]) : 40;
+  const int num_rounds = argc > 3 ? atoi(argv[3]) : 100;
+  const double variance = 1.0e-6;
+  const double tolerance = 1.0e-6;
+  bool passed = true;
+
+  std::mt19937 generator(0);
+  std::normal_distribution<double> noise(0.0, 1.0);
+  const Eigen::MatrixXd covariance = generateCovariance(n, generator);
+  const AmbiguityDifference difference = generateDifference(k, n, generator);
+  const Eigen::MatrixXd D = Eigen::MatrixXd(difference);
+  Eigen::VectorXd ambiguities(n);
+  for (int i = 0; i < n; i++) ambiguities(i) = noise(generator) * 10.0;
+  const Eigen::VectorXd fixed_ambiguities = (D * ambiguities).array().round();
+
+  // Covariance transform
+  Eigen::MatrixXd transformed_covariance;
+  transformAmbiguityCovariance(difference, covariance, transformed_covariance);
+  const double transform_difference =
+    (transformed_covariance - D * covariance * D.transpose()).cwiseAbs().maxCoeff();
+  if (transform_difference > tolerance) passed = false;
+
+  // Constraint update
+  Eigen::VectorXd ambiguities_sparse = ambiguities;
+  Eigen::MatrixXd covariance_sparse = covariance;
+  if (!constrainAmbiguities(difference, fixed_ambiguities, variance,
+      ambiguities_sparse, covariance_sparse)) passed = false;
+  Eigen::VectorXd ambiguities_dense = ambiguities;
+  Eigen::MatrixXd covariance_dense = covariance;
+  constrainAmbiguitiesDense(D, fixed_ambiguities, variance,
+    ambiguities_dense, covariance_dense);
+  const double ambiguity_difference =
+    (ambiguities_sparse - ambiguities_dense).cwiseAbs().maxCoeff();
+  const double covariance_difference =
+    (covariance_sparse - covariance_dense).cwiseAbs().maxCoeff();
+  if (ambiguity_difference > tolerance || covariance_difference > tolerance) {
+    passed = false;
+  }
+
+  // A non positive definite innovation covariance should be rejected without
+  // touching the states
+  Eigen::VectorXd ambiguities_rejected = ambiguities;
+  Eigen::MatrixXd covariance_rejected = covariance;
+  if (constrainAmbiguities(difference, fixed_ambiguities, -1.0e6,
+      ambiguities_rejected, covariance_rejected) ||
+      ambiguities_rejected != ambiguities || covariance_rejected != covariance) {
+    std::cout << "Non positive definite innovation covariance is not rejected"
+              << std::endl;
+    passed = false;
+  }
+
+  // Timing
+  double start_time = getCurrentTime();
+  for (int round = 0; round < num_rounds; round++) {
+    ambiguities_dense = ambiguities;
+    covariance_dense = covariance;
+    constrainAmbiguitiesDense(D, fixed_ambiguities, variance,
+      ambiguities_dense, covariance_dense);
+  }
+  const double time_dense = (getCurrentTime() - start_time) / num_rounds;
+  start_time = getCurrentTime();
+  for (int round = 0; round < num_rounds; round++) {
+    ambiguities_sparse = ambiguities;
+    covariance_sparse = covariance;
+    constrainAmbiguities(difference, fixed_ambiguities, variance,
+      ambiguities_sparse, covariance_sparse);
+  }
+  const double time_sparse = (getCurrentTime() - start_time) / num_rounds;
+
+  std::cout << std::fixed << std::setprecision(3)
+    << n << " ambiguities, " << k << " combinations" << std::endl
+    << "dense: " << time_dense * 1.0e3 << " ms, "
+    << "sparse: " << time_sparse * 1.0e3 << " ms, "
+    << "speedup: " << time_dense / time_sparse << std::endl
+    << std::scientific << std::setprecision(3)
+    << "max difference of transform: " << transform_difference
+    << ", ambiguities: " << ambiguity_difference
+    << ", covariance: " << covariance_difference << std::endl
+    << (passed ? "PASSED" : "FAILED") << std::endl;
+
+  return passed ? 0 : 1;
+}
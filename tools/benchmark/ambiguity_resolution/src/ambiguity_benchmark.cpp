@@ -0,0 +1,243 @@
+/**
+* @Function: Replay float ambiguities of epochs through the AR engines
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <Eigen/Dense>
+
+#include "gici/gnss/ambiguity_resolution.h"
+
+using namespace gici;
+
+// Dimension bins for statistics
+const std::vector<int> bin_edges = {5, 10, 20, 50, 100, 200};
+
+// Statistics of one engine in one bin
+struct Statistics {
+  int num_epochs = 0;
+  int num_nl_fixed = 0;
+  int num_wl_fixed = 0;
+  double total_time = 0.0;  // in second
+  std::vector<double> ratios;  // of the applied lane solutions
+};
+
+// Ratio percentiles to report
+const std::vector<double> ratio_percentiles = {5.0, 50.0, 95.0};
+
+// Engine setup
+struct Engine {
+  std::string name;
+  bool use_incremental_partial_ar;
+  int num_threads;
+};
+
+// Get current time
+double getCurrentTime()
+{
+  return std::chrono::duration<double>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Get bin index, -1 if out of range
+int getBin(const int dimension)
+{
+  if (dimension < bin_edges.front()) return -1;
+  for (size_t i = 1; i < bin_edges.size(); i++) {
+    if (dimension < bin_edges[i]) return i - 1;
+  }
+  return bin_edges.size() - 2;
+}
+
+// Get percentile (in %) of values
+double getPercentile(std::vector<double> values, const double percentile)
+{
+  std::sort(values.begin(), values.end());
+  const size_t index = static_cast<size_t>(
+    round(percentile / 100.0 * (values.size() - 1)));
+  return values[index];
+}
+
+// Generate synthetic RTK epochs of GPS and Galileo with 2 or 3 frequencies
+std::vector<AmbiguitySnapshot> generateSnapshots(const int num_epochs)
+{
+  const std::vector<char> systems = {'G', 'E'};
+  const std::vector<double> wavelengths = {
+    CLIGHT / FREQ1, CLIGHT / FREQ2, CLIGHT / FREQ5};
+  std::mt19937 generator(0);
+  std::normal_distribution<double> normal(0.0, 1.0);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  std::uniform_int_distribution<int> num_satellite_distribution(4, 12);
+  std::vector<AmbiguitySnapshot> snapshots;
+  for (int epoch = 0; epoch < num_epochs; epoch++) {
+    const int num_frequencies = (epoch % 2 == 0) ? 2 : 3;
+    AmbiguitySnapshot snapshot;
+    snapshot.mode = 1;
+    std::vector<double> values, wavelength_values, elevations;
+    for (const char system : systems) {
+      const int num_satellites = num_satellite_distribution(generator);
+      for (int s = 1; s <= num_satellites; s++) {
+        std::ostringstream prn;
+        prn << system << std::setw(2) << std::setfill('0') << s;
+        const double elevation = (15.0 + 70.0 * uniform(generator)) * D2R;
+        for (int f = 0; f < num_frequencies; f++) {
+          snapshot.ids.push_back(createGnssAmbiguityId(prn.str(), f + 1, epoch));
+          values.push_back(round(100.0 * normal(generator)) * wavelengths[f]);
+          wavelength_values.push_back(wavelengths[f]);
+          elevations.push_back(elevation);
+        }
+      }
+    }
+
+    // correlated covariance, with noise levels from converged to converging
+    const int n = snapshot.ids.size();
+    Eigen::MatrixXd A(n, n);
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j < n; j++) A(i, j) = normal(generator);
+    }
+    const double scale = 0.005 + 0.05 * uniform(generator);
+    Eigen::MatrixXd covariance = A * A.transpose() / n * scale * scale;
+    for (int i = 0; i < n; i++) {
+      // lower elevation with larger variance
+      const double sigma = 0.003 / sin(elevations[i]);
+      covariance(i, i) += sigma * sigma;
+    }
+    Eigen::MatrixXd L = covariance.llt().matrixL();
+    Eigen::VectorXd noise(n);
+    for (int i = 0; i < n; i++) noise(i) = normal(generator);
+
+    snapshot.values = Eigen::Map<Eigen::VectorXd>(values.data(), n) + L * noise;
+    snapshot.wavelengths = Eigen::Map<Eigen::VectorXd>(wavelength_values.data(), n);
+    snapshot.elevations = Eigen::Map<Eigen::VectorXd>(elevations.data(), n);
+    snapshot.covariance = covariance;
+    snapshots.push_back(snapshot);
+  }
+  return snapshots;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 2) {
+    std::cerr << "Invalid input variables! Supported variables are: " << std::endl
+              << "<path-to-executable> <path-to-snapshot-file> [num-repeats]" << std::endl
+              << "<path-to-executable> --synthetic [num-epochs] [num-repeats]"
+              << std::endl;
+    return -1;
+  }
+
+  // Load snapshots
+  std::vector<AmbiguitySnapshot> snapshots;
+  int num_repeats = 1;
+  if (std::string(argv[1]) == "--synthetic") {
+    int num_epochs = argc > 2 ? atoi(argv[2]) : 200;
+    if (argc > 3) num_repeats = atoi(argv[3]);
+    snapshots = generateSnapshots(num_epochs);
+  }
+  else {
+    std::ifstream file(argv[1]);
+    if (!file.is_open()) {
+      std::cerr << "Unable to open " << argv[1] << std::endl;
+      return -1;
+    }
+    AmbiguitySnapshot snapshot;
+    while (readAmbiguitySnapshot(file, snapshot)) snapshots.push_back(snapshot);
+    if (argc > 2) num_repeats = atoi(argv[2]);
+  }
+  if (num_repeats < 1) num_repeats = 1;
+  std::cout << "Loaded " << snapshots.size() << " epochs." << std::endl;
+
+  // Replay every epoch through the lane formation and partial AR of
+  // AmbiguityResolution, without graph. Each repeat replays the whole sequence
+  // with a fresh instance, as the previous epoch is carried to the next one.
+  // The first engine is the reference of the results.
+  const std::vector<Engine> engines = {
+    {"full", false, 1}, {"incremental", true, 1}, {"incremental-3-threads", true, 3}};
+  const size_t num_bins = bin_edges.size() - 1;
+  std::vector<std::vector<Statistics>> statistics(
+    engines.size(), std::vector<Statistics>(num_bins));
+  std::vector<std::vector<AmbiguityResolution::Result>> results(engines.size());
+  std::vector<int> num_mismatch(engines.size(), 0);
+  for (size_t e = 0; e < engines.size(); e++) {
+    AmbiguityResolutionOptions options;
+    options.use_incremental_partial_ar = engines[e].use_incremental_partial_ar;
+    options.num_threads = engines[e].num_threads;
+    results[e].resize(snapshots.size(), AmbiguityResolution::Result::NoFix);
+
+    for (int r = 0; r < num_repeats; r++) {
+      AmbiguityResolution ambiguity_resolution(options, nullptr);
+      for (size_t k = 0; k < snapshots.size(); k++) {
+        const AmbiguitySnapshot& snapshot = snapshots[k];
+        const int bin = getBin(snapshot.ids.size());
+
+        double start_time = getCurrentTime();
+        AmbiguityResolution::Result result = ambiguity_resolution.replay(snapshot);
+        const double time = getCurrentTime() - start_time;
+        if (bin < 0) continue;
+
+        Statistics& statistic = statistics[e][bin];
+        statistic.total_time += time / num_repeats;
+        if (r > 0) continue;
+        results[e][k] = result;
+        statistic.num_epochs++;
+        if (result == AmbiguityResolution::Result::NlFix) statistic.num_nl_fixed++;
+        if (result != AmbiguityResolution::Result::NoFix) statistic.num_wl_fixed++;
+        const std::vector<double>& ratios = ambiguity_resolution.getRatios();
+        statistic.ratios.insert(statistic.ratios.end(), ratios.begin(), ratios.end());
+      }
+    }
+
+    // compare with the reference engine
+    for (size_t k = 0; k < snapshots.size(); k++) {
+      if (getBin(snapshots[k].ids.size()) < 0) continue;
+      if (results[e][k] != results[0][k]) num_mismatch[e]++;
+    }
+  }
+
+  // Report
+  for (size_t e = 0; e < engines.size(); e++) {
+    std::cout << std::endl << "Engine: " << engines[e].name << std::endl;
+    std::cout << std::setw(10) << "dimension" << std::setw(8) << "count"
+              << std::setw(14) << "time(us)" << std::setw(10) << "nl(%)"
+              << std::setw(10) << "wl(%)";
+    for (const double percentile : ratio_percentiles) {
+      std::ostringstream name;
+      name << "ratio-p" << percentile;
+      std::cout << std::setw(12) << name.str();
+    }
+    std::cout << std::endl;
+    for (size_t b = 0; b < num_bins; b++) {
+      Statistics& statistic = statistics[e][b];
+      if (statistic.num_epochs == 0) continue;
+      std::ostringstream range;
+      range << bin_edges[b] << "-" << bin_edges[b + 1] - (b + 1 < num_bins ? 1 : 0);
+      std::cout << std::fixed << std::setprecision(1)
+        << std::setw(10) << range.str()
+        << std::setw(8) << statistic.num_epochs
+        << std::setw(14) << statistic.total_time / statistic.num_epochs * 1.0e6
+        << std::setw(10) << 100.0 * statistic.num_nl_fixed / statistic.num_epochs
+        << std::setw(10) << 100.0 * statistic.num_wl_fixed / statistic.num_epochs;
+      for (const double percentile : ratio_percentiles) {
+        if (statistic.ratios.size() == 0) std::cout << std::setw(12) << "-";
+        else std::cout << std::setw(12) << std::setprecision(2)
+          << getPercentile(statistic.ratios, percentile);
+      }
+      std::cout << std::endl;
+    }
+    if (e > 0) {
+      std::cout << "Epochs with different results from the " << engines[0].name
+                << " engine: " << num_mismatch[e] << std::endl;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,264 @@
+/**
+* @Function: Check and time BackendId encoding against the former implementation
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstring>
+#include <unordered_map>
+#include <algorithm>
+
+#include "gici/estimate/estimator_types.h"
+
+using namespace gici;
+
+// The former byte-buffer implementation of BackendId bit operations, which goes
+// through RTKLIB getbitu/setbitu on the big-endian bytes of the id
+namespace legacy {
+
+uint32_t getBits(uint64_t id, int start, int end) {
+  int length = end - start + 1;
+  uint8_t buffer[8];
+  for (int i = 0; i < 8; i++) {
+    buffer[i] = (id >> (8 * (7 - i))) & 0xFF;
+  }
+  return getbitu(buffer, start, length);
+}
+
+template<typename T>
+uint64_t setBits(T data, int start, int end) {
+  int length = end - start + 1;
+  uint32_t bits = static_cast<uint32_t>(data);
+  uint64_t id = 0;
+  uint8_t buffer[8];
+  memset(buffer, 0, sizeof(uint8_t) * 8);
+  setbitu(buffer, start, length, bits);
+  for (int i = 0; i < 8; i++) {
+    uint64_t byte = static_cast<uint64_t>(buffer[i]) << (8 * (7 - i));
+    id += byte;
+  }
+  return id;
+}
+
+template<typename T>
+uint64_t resetBits(uint64_t id, T data, int start, int end) {
+  int length = end - start + 1;
+  uint32_t bits = static_cast<uint32_t>(data);
+  uint64_t out_id = 0;
+  uint8_t buffer[8];
+  for (int i = 0; i < 8; i++) {
+    buffer[i] = (id >> (8 * (7 - i))) & 0xFF;
+  }
+  setbitu(buffer, start, length, bits);
+  for (int i = 0; i < 8; i++) {
+    uint64_t byte = static_cast<uint64_t>(buffer[i]) << (8 * (7 - i));
+    out_id |= byte;
+  }
+  return out_id;
+}
+
+std::string gPrn(uint64_t id) {
+  char system = static_cast<char>(getBits(id, BITS_GNSS_SYSTEM));
+  int prn_number = static_cast<int>(getBits(id, BITS_GNSS_PRN));
+  char prn_buf[4];
+  sprintf(prn_buf, "%c%02d", system, prn_number);
+  return std::string(prn_buf);
+}
+
+uint64_t createGnssAmbiguityId(std::string prn, int phase_id, int32_t bundle_id) {
+  char system = prn[0];
+  int prn_number = atoi(prn.substr(1, 2).data());
+  return setBits(BackendId::adjustBundleId(
+      bundle_id, IdType::gAmbiguity), BITS_BUNDLEID) |
+    setBits(system, BITS_GNSS_SYSTEM) |
+    setBits(prn_number, BITS_GNSS_PRN) |
+    setBits(phase_id, BITS_GNSS_PHASEID) |
+    setBits(IdType::gAmbiguity, BITS_IDTYPE);
+}
+
+uint64_t createGnssIfbId(char system, int code_id, std::string prn) {
+  int prn_number = 0;
+  if (prn != "") prn_number = atoi(prn.substr(1, 2).data());
+  return setBits(0, BITS_BUNDLEID) |
+    setBits(system, BITS_GNSS_SYSTEM) |
+    setBits(prn_number, BITS_GNSS_PRN) |
+    setBits(code_id, BITS_GNSS_CODEID) |
+    setBits(IdType::gIfb, BITS_IDTYPE);
+}
+
+}
+
+// Bit field
+struct Field {
+  const char* name;
+  int start;
+  int end;
+};
+
+// Get current time
+double getCurrentTime()
+{
+  return std::chrono::duration<double>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Ids of a sliding window: positions, velocities, clocks and ambiguities of
+// 3 frequencies of all satellites, for each epoch
+std::vector<uint64_t> generateWindowIds(const int num_epochs)
+{
+  const std::string systems = "GREC";
+  std::vector<uint64_t> ids;
+  for (int32_t epoch = 0; epoch < num_epochs; epoch++) {
+    ids.push_back(createGnssPositionId(epoch).asInteger());
+    ids.push_back(createGnssVelocityId(epoch).asInteger());
+    for (const char system : systems) {
+      ids.push_back(createGnssClockId(system, epoch).asInteger());
+      for (int prn_number = 1; prn_number <= 12; prn_number++) {
+        std::string prn(3, '0');
+        prn[0] = system;
+        prn[1] = static_cast<char>('0' + prn_number / 10);
+        prn[2] = static_cast<char>('0' + prn_number % 10);
+        for (int phase_id = 1; phase_id <= 3; phase_id++) {
+          ids.push_back(createGnssAmbiguityId(prn, phase_id, epoch).asInteger());
+        }
+      }
+    }
+  }
+  return ids;
+}
+
+// Lookup time per id (in second) and the largest bucket of a hash table of ids
+template<typename Hash>
+double timeLookups(const std::vector<uint64_t>& ids, const int num_repeats,
+                   size_t& max_bucket_size, uint64_t& checksum)
+{
+  std::unordered_map<uint64_t, size_t, Hash> map;
+  for (size_t i = 0; i < ids.size(); i++) map.insert(std::make_pair(ids[i], i));
+  max_bucket_size = 0;
+  for (size_t b = 0; b < map.bucket_count(); b++) {
+    max_bucket_size = std::max(max_bucket_size, map.bucket_size(b));
+  }
+  const double start_time = getCurrentTime();
+  for (int r = 0; r < num_repeats; r++) {
+    for (const uint64_t id : ids) checksum += map.find(id)->second;
+  }
+  return (getCurrentTime() - start_time) / (num_repeats * ids.size());
+}
+
+int main(int argc, char** argv)
+{
+  const int num_samples = argc > 1 ? atoi(argv[1]) : 1000000;
+
+  const std::vector<Field> fields = {
+    {"IDTYPE", BITS_IDTYPE}, {"BUNDLEID", BITS_BUNDLEID},
+    {"IMU_SUBID", BITS_IMU_SUBID}, {"GNSS_SYSTEM", BITS_GNSS_SYSTEM},
+    {"GNSS_PRN", BITS_GNSS_PRN}, {"GNSS_SATELLITE", BITS_GNSS_SATELLITE},
+    {"GNSS_PHASEID", BITS_GNSS_PHASEID}, {"GNSS_CODEID", BITS_GNSS_CODEID},
+    {"CAMERA_IDX", BITS_CAMERA_IDX}, {"LANDMARKID", BITS_LANDMARKID}};
+
+  // Random ids and field values
+  std::mt19937_64 generator(0);
+  std::vector<uint64_t> ids(num_samples);
+  std::vector<uint32_t> values(num_samples);
+  for (int i = 0; i < num_samples; i++) {
+    ids[i] = generator();
+    values[i] = static_cast<uint32_t>(generator());
+  }
+
+  // Bit operations of every field
+  size_t num_mismatches = 0;
+  for (const Field& field : fields) {
+    size_t num_field_mismatches = 0;
+    for (int i = 0; i < num_samples; i++) {
+      if (BackendId::getBits(ids[i], field.start, field.end) !=
+          legacy::getBits(ids[i], field.start, field.end)) num_field_mismatches++;
+      if (BackendId::setBits(values[i], field.start, field.end) !=
+          legacy::setBits(values[i], field.start, field.end)) num_field_mismatches++;
+      if (BackendId::resetBits(ids[i], values[i], field.start, field.end) !=
+          legacy::resetBits(ids[i], values[i], field.start, field.end)) {
+        num_field_mismatches++;
+      }
+    }
+    if (num_field_mismatches > 0) {
+      std::cout << "Mismatches in " << field.name << ": "
+                << num_field_mismatches << std::endl;
+    }
+    num_mismatches += num_field_mismatches;
+  }
+
+  // Encoding and decoding of GNSS parameter ids
+  const std::string systems = "GRECJ";
+  std::uniform_int_distribution<int32_t> bundle_distribution(
+    RANGE_BUNDLE_ID_MIN, RANGE_BUNDLE_ID_MAX);
+  for (const char system : systems) {
+    for (int prn_number = 1; prn_number <= 63; prn_number++) {
+      std::string prn(3, '0');
+      prn[0] = system;
+      prn[1] = static_cast<char>('0' + prn_number / 10);
+      prn[2] = static_cast<char>('0' + prn_number % 10);
+      for (int phase_id = 0; phase_id < 8; phase_id++) {
+        const int32_t bundle_id = bundle_distribution(generator);
+        const BackendId id = createGnssAmbiguityId(prn, phase_id, bundle_id);
+        const uint64_t id_legacy =
+          legacy::createGnssAmbiguityId(prn, phase_id, bundle_id);
+        if (id.asInteger() != id_legacy || id.gPrn() != legacy::gPrn(id_legacy) ||
+            id.gPrn() != prn || id.gPhaseId() != phase_id ||
+            id.bundleId() != bundle_id || id.gSatellite() != gnssSatelliteKey(prn) ||
+            id.gSatellite() != gnssSatelliteKey(system, prn_number) ||
+            BackendIdHash()(id) != BackendIdHash()(id.asInteger())) {
+          std::cout << "Mismatch in ambiguity id of " << prn << std::endl;
+          num_mismatches++;
+        }
+        const BackendId ifb_id = createGnssIfbId(system, phase_id, prn);
+        if (ifb_id.asInteger() != legacy::createGnssIfbId(system, phase_id, prn) ||
+            ifb_id.gCodeId() != phase_id) {
+          std::cout << "Mismatch in IFB id of " << prn << std::endl;
+          num_mismatches++;
+        }
+      }
+    }
+  }
+
+  // Timing
+  uint64_t checksum = 0;
+  double start_time = getCurrentTime();
+  for (int i = 0; i < num_samples; i++) {
+    checksum += legacy::getBits(ids[i], BITS_GNSS_PRN);
+    checksum += legacy::resetBits(ids[i], values[i], BITS_BUNDLEID);
+  }
+  const double time_legacy = getCurrentTime() - start_time;
+  start_time = getCurrentTime();
+  for (int i = 0; i < num_samples; i++) {
+    checksum -= BackendId::getBits(ids[i], BITS_GNSS_PRN);
+    checksum -= BackendId::resetBits(ids[i], values[i], BITS_BUNDLEID);
+  }
+  const double time_current = getCurrentTime() - start_time;
+
+  // Hash tables of the ids of a sliding window, as in the graph
+  const std::vector<uint64_t> window_ids = generateWindowIds(20);
+  const int num_repeats = std::max(1, num_samples / static_cast<int>(window_ids.size()));
+  size_t max_bucket_std, max_bucket_backend_id;
+  const double time_std = timeLookups<std::hash<uint64_t>>(
+    window_ids, num_repeats, max_bucket_std, checksum);
+  const double time_backend_id = timeLookups<BackendIdHash>(
+    window_ids, num_repeats, max_bucket_backend_id, checksum);
+
+  std::cout << std::fixed << std::setprecision(3)
+    << num_samples << " samples, " << num_mismatches << " mismatches" << std::endl
+    << "legacy: " << time_legacy * 1.0e9 / num_samples << " ns/sample, "
+    << "current: " << time_current * 1.0e9 / num_samples << " ns/sample" << std::endl
+    << window_ids.size() << " window ids, lookup with std::hash: " 
+    << time_std * 1.0e9 << " ns (largest bucket " << max_bucket_std << "), "
+    << "with BackendIdHash: " << time_backend_id * 1.0e9 << " ns (largest bucket "
+    << max_bucket_backend_id << ")" << std::endl
+    << "checksum: " << checksum << std::endl;
+
+  return num_mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,248 @@
+/**
+* @Function: Evaluate GNSS residuals with and without the correction caches
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <Eigen/Dense>
+
+#include "gici/gnss/gnss_common.h"
+#include "gici/gnss/gnss_correction_cache.h"
+#include "gici/gnss/pseudorange_error.h"
+#include "gici/gnss/pseudorange_error_dd.h"
+
+using namespace gici;
+
+// A residual with its parameters and Jacobian storage
+struct Residual {
+  std::shared_ptr<ErrorInterface> error;
+  std::vector<double*> parameters;
+  std::vector<std::vector<double>> jacobians;
+  std::vector<double*> jacobian_ptrs;
+  double value;
+};
+
+// Get current time
+double getCurrentTime()
+{
+  return std::chrono::duration<double>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Generate an epoch of GPS L1 code observations at given receiver position
+GnssMeasurement generateEpoch(const Eigen::Vector3d& receiver,
+                              const double timestamp,
+                              const int num_satellites,
+                              std::mt19937& generator)
+{
+  Eigen::Vector3d lla;
+  ecef2pos(receiver.data(), lla.data());
+  const double sin_lat = sin(lla(0)), cos_lat = cos(lla(0));
+  const double sin_lon = sin(lla(1)), cos_lon = cos(lla(1));
+  Eigen::Matrix3d R_ENU_ECEF;
+  R_ENU_ECEF << -sin_lon, -sin_lat * cos_lon, cos_lat * cos_lon,
+                 cos_lon, -sin_lat * sin_lon, cos_lat * sin_lon,
+                     0.0,            cos_lat,           sin_lat;
+
+  std::uniform_real_distribution<double> azimuth_distribution(0.0, 2.0 * PI);
+  std::uniform_real_distribution<double> elevation_distribution(
+    10.0 * D2R, 85.0 * D2R);
+  std::normal_distribution<double> noise(0.0, 1.0);
+
+  GnssMeasurement measurement;
+  measurement.timestamp = timestamp;
+  measurement.position = receiver;
+  measurement.troposphere_wet = 0.0;
+  measurement.ionosphere_parameters.resize(8);
+  measurement.ionosphere_parameters <<
+    0.1118e-07, 0.2235e-07, -0.4172e-06, 0.6557e-06,
+    0.1249e+06, -0.4424e+06, 0.1507e+07, -0.2621e+06;
+  for (int i = 0; i < num_satellites; i++) {
+    const double azimuth = azimuth_distribution(generator);
+    const double elevation = elevation_distribution(generator);
+    const Eigen::Vector3d direction(cos(elevation) * sin(azimuth),
+      cos(elevation) * cos(azimuth), sin(elevation));
+
+    Satellite satellite;
+    std::ostringstream prn;
+    prn << "G" << std::setw(2) << std::setfill('0') << i + 1;
+    satellite.prn = prn.str();
+    satellite.sat_type = SatEphType::Broadcast;
+    satellite.sat_position = receiver + R_ENU_ECEF * direction * 2.0e7;
+    satellite.sat_velocity.setZero();
+    satellite.sat_clock = 0.0;
+    satellite.ionosphere = 0.0;
+    satellite.ionosphere_type = IonoType::Broadcast;
+
+    Observation observation;
+    observation.wavelength = CLIGHT / FREQ1;
+    observation.pseudorange = gnss_common::satelliteToReceiverDistance(
+      satellite.sat_position, receiver) + noise(generator);
+    observation.phaserange = 0.0;
+    observation.doppler = 0.0;
+    observation.SNR = 45.0;
+    observation.LLI = 0;
+    observation.slip = false;
+    observation.raw_code = CODE_L1C;
+    satellite.observations.insert(std::make_pair(CODE_L1C, observation));
+    measurement.satellites.insert(std::make_pair(satellite.prn, satellite));
+  }
+  return measurement;
+}
+
+// Add a residual and its storage
+template<typename ErrorType>
+void addResidual(const std::shared_ptr<ErrorType>& error,
+                 const std::vector<double*>& parameters,
+                 std::vector<Residual>& residuals)
+{
+  Residual residual;
+  residual.error = error;
+  residual.parameters = parameters;
+  for (size_t i = 0; i < parameters.size(); i++) {
+    residual.jacobians.push_back(std::vector<double>(
+      error->parameter_block_sizes()[i] * error->residualDim()));
+  }
+  for (auto& jacobian : residual.jacobians) {
+    residual.jacobian_ptrs.push_back(jacobian.data());
+  }
+  residuals.push_back(residual);
+}
+
+// Evaluate all the residuals with Jacobians for several rounds, returns the
+// time per round
+double evaluate(std::vector<Residual>& residuals, const int num_rounds)
+{
+  const double start_time = getCurrentTime();
+  for (int round = 0; round < num_rounds; round++) {
+    for (Residual& residual : residuals) {
+      residual.error->EvaluateWithMinimalJacobians(residual.parameters.data(),
+        &residual.value, residual.jacobian_ptrs.data(), nullptr);
+    }
+  }
+  return (getCurrentTime() - start_time) / num_rounds;
+}
+
+// Maximum difference of residuals and Jacobians
+double getMaxDifference(const std::vector<Residual>& residuals_1,
+                        const std::vector<Residual>& residuals_2)
+{
+  double max_difference = 0.0;
+  for (size_t i = 0; i < residuals_1.size(); i++) {
+    max_difference = std::max(max_difference,
+      fabs(residuals_1[i].value - residuals_2[i].value));
+    for (size_t j = 0; j < residuals_1[i].jacobians.size(); j++) {
+      for (size_t k = 0; k < residuals_1[i].jacobians[j].size(); k++) {
+        max_difference = std::max(max_difference, fabs(
+          residuals_1[i].jacobians[j][k] - residuals_2[i].jacobians[j][k]));
+      }
+    }
+  }
+  return max_difference;
+}
+
+int main(int argc, char** argv)
+{
+  const int num_satellites = argc > 1 ? atoi(argv[1]) : 20;
+  const int num_rounds = argc > 2 ? atoi(argv[2]) : 1000;
+  const double tolerance = 1.0;
+
+  // Rover and reference station epochs
+  std::mt19937 generator(0);
+  const double timestamp = 1.6e9;
+  const Eigen::Vector3d receiver(-2853445.0, 4667464.0, 3268291.0);
+  const Eigen::Vector3d reference = receiver + Eigen::Vector3d(3000.0, -2000.0, 1000.0);
+  GnssMeasurementConstPtr measurement_rov = std::make_shared<const GnssMeasurement>(
+    generateEpoch(receiver, timestamp, num_satellites, generator));
+  GnssMeasurement measurement_ref_raw = *measurement_rov;
+  measurement_ref_raw.position = reference;
+  for (auto& sat : measurement_ref_raw.satellites) {
+    sat.second.observations.at(CODE_L1C).pseudorange =
+      gnss_common::satelliteToReceiverDistance(sat.second.sat_position, reference);
+  }
+  GnssMeasurementConstPtr measurement_ref =
+    std::make_shared<const GnssMeasurement>(measurement_ref_raw);
+
+  // Parameters
+  double position[3] = {receiver(0), receiver(1), receiver(2)};
+  double clock[1] = {0.0}, ifb[1] = {0.0};
+  double zwd_rov[1] = {0.1}, zwd_ref[1] = {0.1};
+  double ionosphere[1] = {1.0}, ionosphere_base[1] = {1.2};
+
+  // Residuals of the SPP, PPP and RTK models. The DD residuals take the corrections
+  // without earth tide, so they have their own cache.
+  GnssErrorParameter error_parameter;
+  GnssCorrectionCachePtr corrections = std::make_shared<GnssCorrectionCache>(
+    timestamp, measurement_rov->ionosphere_parameters, tolerance, true);
+  GnssCorrectionCachePtr corrections_dd = std::make_shared<GnssCorrectionCache>(
+    timestamp, measurement_rov->ionosphere_parameters, tolerance, false);
+  std::vector<Residual> residuals;
+  const std::string prn_base = measurement_rov->satellites.begin()->first;
+  for (const auto& sat : measurement_rov->satellites) {
+    const GnssMeasurementIndex index(sat.first, CODE_L1C);
+    auto spp_error = std::make_shared<PseudorangeError<3, 1>>(
+      measurement_rov, index, error_parameter);
+    spp_error->setCorrectionCache(corrections);
+    addResidual(spp_error, {position, clock}, residuals);
+
+    auto ppp_error = std::make_shared<PseudorangeError<3, 1, 1, 1, 1>>(
+      measurement_rov, index, error_parameter);
+    ppp_error->setCorrectionCache(corrections);
+    addResidual(ppp_error, {position, clock, ifb, zwd_rov, ionosphere}, residuals);
+
+    if (sat.first == prn_base) continue;
+    const GnssMeasurementIndex index_base(prn_base, CODE_L1C);
+    auto rtk_error = std::make_shared<PseudorangeErrorDD<3, 1, 1, 1, 1>>(
+      measurement_rov, measurement_ref, index, index, index_base, index_base,
+      error_parameter);
+    rtk_error->setCorrectionCache(corrections_dd);
+    addResidual(rtk_error,
+      {position, zwd_rov, zwd_ref, ionosphere, ionosphere_base}, residuals);
+  }
+
+  // Fill the caches as the estimator does before solving
+  corrections->update(receiver);
+  corrections_dd->update(receiver);
+
+  // Timing
+  corrections->setEnabled(false);
+  corrections_dd->setEnabled(false);
+  const double time_direct = evaluate(residuals, num_rounds);
+  std::vector<Residual> residuals_direct = residuals;
+  corrections->setEnabled(true);
+  corrections_dd->setEnabled(true);
+  const double time_cached = evaluate(residuals, num_rounds);
+
+  // The cached corrections should be identical at the point they were computed
+  const double difference_at_point = getMaxDifference(residuals_direct, residuals);
+
+  // and close to the direct ones within tolerance
+  position[0] += tolerance * 0.5;
+  corrections->setEnabled(false);
+  corrections_dd->setEnabled(false);
+  evaluate(residuals, 1);
+  residuals_direct = residuals;
+  corrections->setEnabled(true);
+  corrections_dd->setEnabled(true);
+  evaluate(residuals, 1);
+  const double difference_in_tolerance = getMaxDifference(residuals_direct, residuals);
+
+  std::cout << std::fixed << std::setprecision(3)
+    << residuals.size() << " residuals, " << num_rounds << " rounds" << std::endl
+    << "direct: " << time_direct * 1.0e6 << " us/round, "
+    << "cached: " << time_cached * 1.0e6 << " us/round, "
+    << "speedup: " << time_direct / time_cached << std::endl
+    << std::scientific << std::setprecision(3)
+    << "max difference at cache point: " << difference_at_point
+    << ", within tolerance: " << difference_in_tolerance << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,169 @@
+/**
+* @Function: Compare dense and structured IMU covariance propagation
+*
+* @Author  : Cheng Chi
+* @Email   : chichengcn@sjtu.edu.cn
+*
+* Copyright (C) 2023 by Cheng Chi, All rights reserved.
+**/
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <Eigen/Dense>
+
+#include "gici/imu/imu_common.h"
+
+using namespace gici;
+
+using Matrix15d = Eigen::Matrix<double, 15, 15>;
+
+// One IMU step
+struct Step {
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  double dt;
+  Eigen::Matrix3d F_qq, F_qb, F_vq;
+};
+
+// Get current time
+double getCurrentTime()
+{
+  return std::chrono::duration<double>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Skew-symmetric matrix
+Eigen::Matrix3d skew(const Eigen::Vector3d& v)
+{
+  Eigen::Matrix3d m;
+  m << 0.0, -v(2), v(1), v(2), 0.0, -v(0), -v(1), v(0), 0.0;
+  return m;
+}
+
+// Dense transition matrix of a step
+Matrix15d denseTransition(const Step& step)
+{
+  Matrix15d F = Matrix15d::Identity();
+  F.block<3, 3>(0, 6) = Eigen::Matrix3d::Identity() * step.dt;
+  F.block<3, 3>(3, 3) = step.F_qq;
+  F.block<3, 3>(3, 9) = step.F_qb;
+  F.block<3, 3>(6, 3) = step.F_vq;
+  F.block<3, 3>(6, 12) = step.F_qb;
+  return F;
+}
+
+// Add process noise, the same as pre-integration
+void addNoise(const double dt, Matrix15d& P)
+{
+  for (int i = 0; i < 15; i++) P(i, i) += dt * 1.0e-6;
+}
+
+int main(int argc, char** argv)
+{
+  const int num_steps = argc > 1 ? atoi(argv[1]) : 800;
+  const int num_repeats = argc > 2 ? atoi(argv[2]) : 1000;
+
+  // Random IMU steps at 400 Hz
+  std::mt19937 generator(0);
+  std::normal_distribution<double> normal(0.0, 1.0);
+  std::vector<Step, Eigen::aligned_allocator<Step>> steps(num_steps);
+  Eigen::Matrix3d C = Eigen::Matrix3d::Identity();
+  for (Step& step : steps) {
+    step.dt = 1.0 / 400.0;
+    const Eigen::Vector3d omega(normal(generator), normal(generator), normal(generator));
+    const Eigen::Vector3d acc(normal(generator), normal(generator), 9.8 + normal(generator));
+    const Eigen::Matrix3d C_1 = C * Eigen::AngleAxisd(omega.norm() * step.dt,
+      omega.normalized()).toRotationMatrix();
+    step.F_qq = -skew(omega * step.dt);
+    step.F_qb = -C * step.dt;
+    step.F_vq = -skew(0.5 * (C + C_1) * acc * step.dt);
+    C = C_1;
+  }
+
+  // Step-wise covariance propagation (pre-integration)
+  Matrix15d P_dense, P_structured;
+  double start_time = getCurrentTime();
+  for (int r = 0; r < num_repeats; r++) {
+    P_dense.setZero();
+    for (const Step& step : steps) {
+      const Matrix15d F = denseTransition(step);
+      P_dense = F * P_dense * F.transpose();
+      addNoise(step.dt, P_dense);
+    }
+  }
+  const double time_dense = (getCurrentTime() - start_time) / num_repeats / num_steps;
+  start_time = getCurrentTime();
+  for (int r = 0; r < num_repeats; r++) {
+    P_structured.setZero();
+    for (const Step& step : steps) {
+      propagateImuCovariance(step.dt, step.F_qq, step.F_qb, step.F_vq, P_structured);
+      addNoise(step.dt, P_structured);
+    }
+  }
+  const double time_structured = (getCurrentTime() - start_time) / num_repeats / num_steps;
+  const double error_propagation =
+    (P_dense - P_structured).cwiseAbs().maxCoeff() / P_dense.cwiseAbs().maxCoeff();
+
+  // Transition accumulation
+  Matrix15d J_dense, J_structured;
+  start_time = getCurrentTime();
+  for (int r = 0; r < num_repeats; r++) {
+    J_dense.setIdentity();
+    for (const Step& step : steps) J_dense = denseTransition(step) * J_dense;
+  }
+  const double time_dense_accumulate =
+    (getCurrentTime() - start_time) / num_repeats / num_steps;
+  start_time = getCurrentTime();
+  for (int r = 0; r < num_repeats; r++) {
+    J_structured.setIdentity();
+    for (const Step& step : steps) {
+      accumulateImuTransition(step.dt, step.F_qq, step.F_qb, step.F_vq, J_structured);
+    }
+  }
+  const double time_structured_accumulate =
+    (getCurrentTime() - start_time) / num_repeats / num_steps;
+  const double error_accumulate =
+    (J_dense - J_structured).cwiseAbs().maxCoeff() / J_dense.cwiseAbs().maxCoeff();
+
+  // Covariance transformation with accumulated transition (state queries)
+  Matrix15d P_0 = P_dense + Matrix15d::Identity();
+  Matrix15d P_transform_dense, P_transform_structured;
+  const int num_transforms = num_repeats * 100;
+  start_time = getCurrentTime();
+  for (int r = 0; r < num_transforms; r++) {
+    P_transform_dense = J_dense * P_0 * J_dense.transpose();
+    P_0(0, 0) += 1.0e-12;
+  }
+  const double time_dense_transform = (getCurrentTime() - start_time) / num_transforms;
+  P_0 = P_dense + Matrix15d::Identity();
+  start_time = getCurrentTime();
+  for (int r = 0; r < num_transforms; r++) {
+    P_transform_structured = P_0;
+    transformImuCovariance(J_structured, P_transform_structured);
+    P_0(0, 0) += 1.0e-12;
+  }
+  const double time_structured_transform = (getCurrentTime() - start_time) / num_transforms;
+  const double error_transform =
+    (P_transform_dense - P_transform_structured).cwiseAbs().maxCoeff() /
+    P_transform_dense.cwiseAbs().maxCoeff();
+
+  // Report
+  std::cout << std::setw(14) << "kernel" << std::setw(14) << "dense(ns)"
+            << std::setw(16) << "structured(ns)" << std::setw(10) << "speedup"
+            << std::setw(14) << "rel. error" << std::endl;
+  auto report = [](const std::string& name, const double t_dense,
+                   const double t_structured, const double error) {
+    std::cout << std::setw(14) << name << std::fixed << std::setprecision(1)
+              << std::setw(14) << t_dense * 1.0e9
+              << std::setw(16) << t_structured * 1.0e9
+              << std::setw(10) << t_dense / t_structured
+              << std::scientific << std::setprecision(2)
+              << std::setw(14) << error << std::endl;
+  };
+  report("propagate", time_dense, time_structured, error_propagation);
+  report("accumulate", time_dense_accumulate, time_structured_accumulate, error_accumulate);
+  report("transform", time_dense_transform, time_structured_transform, error_transform);
+
+  return 0;
+}
@@ -187,6 +187,9 @@ double getTimestamp(const std::shared_ptr<DataCluster>& data, const YAML::Node&
   if (data->imu) {
     SET_TIMESTAMP(data->imu->time);
   }
+  if (data->imu_batch) {
+    SET_TIMESTAMP(data->imu_batch->back().timestamp);
+  }
 
   // we need gps time
   return gnss_common::gtimeToDouble(utc2gpst(gnss_common::doubleToGtime(timestamp)));
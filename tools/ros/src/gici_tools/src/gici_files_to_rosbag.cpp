@@ -44,7 +44,7 @@ struct RosbagOption {
 
 // Write DataCluster to rosbag
 void writeRosbag(const std::shared_ptr<DataCluster> data_cluster,
-  rosbag::Bag& bag, RosbagOption& option, int sequence, double time_tag)
+  rosbag::Bag& bag, RosbagOption& option, int& sequence, double time_tag)
 {
   if (option.format == "image") 
   {
@@ -60,18 +60,35 @@ void writeRosbag(const std::shared_ptr<DataCluster> data_cluster,
   }
   if (option.format == "imu")
   {
-    CHECK(data_cluster->imu);
-    auto& imu = *data_cluster->imu;
-    sensor_msgs::Imu msg;
-    msg.header.seq = sequence;
-    msg.header.stamp = ros::Time(imu.time);
-    msg.angular_velocity.x = imu.angular_velocity[0];
-    msg.angular_velocity.y = imu.angular_velocity[1];
-    msg.angular_velocity.z = imu.angular_velocity[2];
-    msg.linear_acceleration.x = imu.acceleration[0];
-    msg.linear_acceleration.y = imu.acceleration[1];
-    msg.linear_acceleration.z = imu.acceleration[2];
-    bag.write(option.topic_name, ros::Time(time_tag), msg);
+    CHECK(data_cluster->imu || data_cluster->imu_batch);
+    if (data_cluster->imu) {
+      auto& imu = *data_cluster->imu;
+      sensor_msgs::Imu msg;
+      msg.header.seq = sequence;
+      msg.header.stamp = ros::Time(imu.time);
+      msg.angular_velocity.x = imu.angular_velocity[0];
+      msg.angular_velocity.y = imu.angular_velocity[1];
+      msg.angular_velocity.z = imu.angular_velocity[2];
+      msg.linear_acceleration.x = imu.acceleration[0];
+      msg.linear_acceleration.y = imu.acceleration[1];
+      msg.linear_acceleration.z = imu.acceleration[2];
+      bag.write(option.topic_name, ros::Time(time_tag), msg);
+    }
+    if (data_cluster->imu_batch) {
+      for (int i = 0; i < data_cluster->imu_batch->size; i++) {
+        auto& imu = data_cluster->imu_batch->measurements[i];
+        sensor_msgs::Imu msg;
+        msg.header.seq = (i == 0) ? sequence : ++sequence;
+        msg.header.stamp = ros::Time(imu.timestamp);
+        msg.angular_velocity.x = imu.angular_velocity(0);
+        msg.angular_velocity.y = imu.angular_velocity(1);
+        msg.angular_velocity.z = imu.angular_velocity(2);
+        msg.linear_acceleration.x = imu.linear_acceleration(0);
+        msg.linear_acceleration.y = imu.linear_acceleration(1);
+        msg.linear_acceleration.z = imu.linear_acceleration(2);
+        bag.write(option.topic_name, ros::Time(time_tag), msg);
+      }
+    }
   }
   if (option.format == "gnss_raw")
   {